@@ -81,9 +81,9 @@ void main()
 
   #if $SHOW_TEXTURE
     #if $TEXTURE_IS_RGB
-      fragColor = texture(VP_texIMG, vec3(fsIn.texcoords, VP_layerIMG)).rgb;
+      fragColor = VP_getIMG(fsIn.texcoords).rgb;
     #else
-      fragColor = texture(VP_texIMG, vec3(fsIn.texcoords, VP_layerIMG)).rrr;
+      fragColor = VP_getIMG(fsIn.texcoords).rrr;
     #endif
     
     #if $ENABLE_HDR
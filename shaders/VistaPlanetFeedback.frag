@@ -0,0 +1,36 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#version 330
+
+// Writes the virtual page of the image data sampled by each pixel, see
+// VirtualTextureFeedback. It is used with the vertex shader of the planet.
+
+$VP_TERRAIN_SHADER_UNIFORMS
+$VP_TERRAIN_SHADER_FUNCTIONS
+
+// inputs ----------------------------------------------------------------------
+in VS_OUT
+{
+    vec2  texcoords;
+    vec3  normal;
+    vec3  position;
+    vec3  planetCenter;
+    vec2  lngLat;
+    float height;
+    vec2  vertexPosition;
+    vec3  sunDir;
+} fsIn;
+
+// outputs ---------------------------------------------------------------------
+layout(location = 0) out uint feedback;
+
+// -----------------------------------------------------------------------------
+void main(void)
+{
+    gl_FragDepth = length(fsIn.position) / VP_farClip;
+    feedback     = VP_getFeedbackIMG(fsIn.texcoords);
+}
@@ -4,6 +4,112 @@
 //                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Samples the given page of VP_texIMG. Arrays of samplers may only be indexed
+// with constant expressions in GLSL 3.30, hence the pages are selected one by
+// one. The derivatives selecting the mipmap level are taken before branching,
+// so that they are well defined wherever this is called from.
+vec4 VP_sampleIMG(int page, vec3 tc)
+{
+    vec2 dx = dFdx(tc.xy);
+    vec2 dy = dFdy(tc.xy);
+
+    if (page == 1)
+    {
+        return textureGrad(VP_texIMG[1], tc, dx, dy);
+    }
+
+    if (page == 2)
+    {
+        return textureGrad(VP_texIMG[2], tc, dx, dy);
+    }
+
+    if (page == 3)
+    {
+        return textureGrad(VP_texIMG[3], tc, dx, dy);
+    }
+
+    return textureGrad(VP_texIMG[0], tc, dx, dy);
+}
+
+// Fetches a texel of the given page of VP_texIMG.
+vec4 VP_fetchIMG(int page, ivec3 texel)
+{
+    if (page == 1)
+    {
+        return texelFetch(VP_texIMG[1], texel, 0);
+    }
+
+    if (page == 2)
+    {
+        return texelFetch(VP_texIMG[2], texel, 0);
+    }
+
+    if (page == 3)
+    {
+        return texelFetch(VP_texIMG[3], texel, 0);
+    }
+
+    return texelFetch(VP_texIMG[0], texel, 0);
+}
+
+// Converts texture coordinates of the current image tile to texels, with
+// the centers of the texels at integral positions.
+vec2 VP_getTexelIMG(vec2 tc)
+{
+    return clamp(tc * VP_TEXTURESIZE - 0.5, 0.0, float(VP_TEXTURESIZE - 1));
+}
+
+// Returns the virtual page of the current image tile containing texel.
+ivec2 VP_getVirtualPageIMG(vec2 texel)
+{
+    return min(ivec2(texel / VP_VIRTUALPAGESIZE), ivec2(VP_VIRTUALPAGES - 1));
+}
+
+// Samples the current image tile in the virtual texturing mode. The page
+// table entry gives the position of the page in the cache and its scale, the
+// scale is below one if the page falls back to a coarser tile. Pages which are
+// not loaded at all are gray.
+vec4 VP_sampleVirtualIMG(vec2 tc)
+{
+    vec2  texel = VP_getTexelIMG(tc);
+    ivec2 page  = VP_getVirtualPageIMG(texel);
+    vec4  entry = VP_fetchIMG(VP_pageIMG, ivec3(page, VP_layerIMG));
+
+    if (entry.w == 0.0)
+    {
+        return vec4(0.5);
+    }
+
+    vec2 cache = entry.xy + (texel - page * VP_VIRTUALPAGESIZE) * entry.z + 0.5;
+    return texture(VP_texVirtualIMG, cache / textureSize(VP_texVirtualIMG, 0));
+}
+
+// Samples the image data of the current tile.
+vec4 VP_getIMG(vec2 tc)
+{
+    if (VP_virtualIMG)
+    {
+        return VP_sampleVirtualIMG(tc);
+    }
+
+    return VP_sampleIMG(VP_pageIMG, vec3(tc, VP_layerIMG));
+}
+
+// Returns the virtual page of the current image tile sampled at tc, encoded as
+// by VirtualPageTable::encodeFeedback, or 0 if there is no image data.
+uint VP_getFeedbackIMG(vec2 tc)
+{
+    if (VP_layerIMG < 0)
+    {
+        return 0u;
+    }
+
+    ivec2 page = VP_getVirtualPageIMG(VP_getTexelIMG(tc));
+    int   tile = VP_layerIMG * VP_MAXPAGES + VP_pageIMG;
+
+    return uint((tile * VP_VIRTUALPAGES + page.y) * VP_VIRTUALPAGES + page.x) + 1u;
+}
+
 vec3 VP_getShadowMapCoords(int cascade, vec3 position)
 {
     vec4 smap_coords = VP_shadowProjectionViewMatrices[cascade] * vec4(position, 1.0);
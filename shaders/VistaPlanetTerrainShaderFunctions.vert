@@ -6,7 +6,8 @@
 
 // -----------------------------------------------------------------------------
 // Helper functions for VistaPlanet terrain shaders.
-// The two most commonly used functions are 
+// VP_loadTile(mode) has to be called before any of the others. The two most
+// commonly used functions are 
 //      vec4 VP_getVertexPosition(in ivec2 vtxPos)
 //      vec3 VP_getVertexNormal(in ivec2 vtxPos)
 // near the bottom of the file. They respectively compute the vertex position
@@ -17,6 +18,71 @@
 
 layout(location = 0) in ivec2 VP_iPosition;
 
+// Reads the parameters of the current tile from VP_tiles, the layout matches
+// TileDrawList::Instance. This has to be called at the start of main() with
+// the mode which is passed to VP_getVertexPosition() later on. Only the
+// parameters this vertex needs are fetched: those of the neighbour tiles only
+// near the edges of the tile, the corners and normals only if the position is
+// interpolated (mode != 0).
+void VP_loadTile(int mode)
+{
+    int base = (VP_tileBase + gl_InstanceID) * VP_TILETEXELS;
+
+    ivec4 texel = texelFetch(VP_tiles, base);
+    VP_tileOffsetScale = texel.xyz;
+    VP_pageDEM         = texel.w;
+
+    texel = texelFetch(VP_tiles, base + 1);
+    VP_demOffsetScale = texel.xyz;
+    VP_layerDEM       = texel.w;
+
+    texel = texelFetch(VP_tiles, base + 2);
+    VP_imgOffsetScale = texel.xyz;
+    VP_pageIMG        = texel.w;
+
+    texel = texelFetch(VP_tiles, base + 3);
+    VP_f1f2             = texel.xy;
+    VP_layerIMG         = texel.z;
+    VP_demAverageHeight = intBitsToFloat(texel.w);
+
+    // passed on to the fragment shader, hence it is read for all vertices
+    VP_edgeDelta = texelFetch(VP_tiles, base + 4);
+
+    // VP_getVertexHeight() samples the neighbour tiles on and beyond the
+    // edges, VP_getVertexNormal() samples one vertex further in each direction
+    ivec2 basePos = VP_iPosition + VP_demOffsetScale.xy;
+
+    if (any(lessThanEqual(basePos, ivec2(1))) ||
+        any(greaterThanEqual(basePos, ivec2(VP_MAXVERTEX - 1))))
+    {
+        VP_edgePageDEM  = texelFetch(VP_tiles, base + 5);
+        VP_edgeLayerDEM = texelFetch(VP_tiles, base + 6);
+        VP_edgeOffset   = texelFetch(VP_tiles, base + 7);
+    }
+    else
+    {
+        VP_edgePageDEM  = ivec4(0);
+        VP_edgeLayerDEM = ivec4(0);
+        VP_edgeOffset   = ivec4(0);
+    }
+
+    if (mode != 0)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            VP_corners[i] = intBitsToFloat(texelFetch(VP_tiles, base + 8 + i).xyz);
+            VP_normals[i] = intBitsToFloat(texelFetch(VP_tiles, base + 12 + i).xyz);
+        }
+    }
+}
+
+// Reads the parameters of the current tile for all modes, see
+// VP_loadTile(int).
+void VP_loadTile()
+{
+    VP_loadTile(2);
+}
+
 float VP_getJR(vec2 posXY)
 {
     return VP_f1f2.x - posXY.x - posXY.y;
@@ -47,6 +113,29 @@ vec2 VP_getTexCoordIMG(vec2 iPosition)
     return (iPosition + VP_imgOffsetScale.xy) / VP_imgOffsetScale.z;
 }
 
+// Samples the given page of VP_texDEM. Arrays of samplers may only be indexed
+// with constant expressions in GLSL 3.30, hence the pages are selected one by
+// one.
+float VP_sampleDEM(int page, vec3 tc)
+{
+    if (page == 1)
+    {
+        return texture(VP_texDEM[1], tc).x;
+    }
+
+    if (page == 2)
+    {
+        return texture(VP_texDEM[2], tc).x;
+    }
+
+    if (page == 3)
+    {
+        return texture(VP_texDEM[3], tc).x;
+    }
+
+    return texture(VP_texDEM[0], tc).x;
+}
+
 float VP_getVertexHeight(ivec2 iPosition)
 {
     // For edges where the resolution changes, data is taken from the lower
@@ -79,7 +168,7 @@ float VP_getVertexHeight(ivec2 iPosition)
             tc = vec2(tc.y, 1.0 - tc.x);
         }
 
-        return texture(VP_texDEM, vec3(tc, VP_edgeLayerDEM.z)).x;
+        return VP_sampleDEM(VP_edgePageDEM.z, vec3(tc, VP_edgeLayerDEM.z));
     }
     
     // NW edge - sample neightbour patch if same or lower resolution
@@ -98,7 +187,7 @@ float VP_getVertexHeight(ivec2 iPosition)
             tc = vec2(1.0 - tc.y, tc.x);
         }
 
-        return texture(VP_texDEM, vec3(tc, VP_edgeLayerDEM.y)).x;
+        return VP_sampleDEM(VP_edgePageDEM.y, vec3(tc, VP_edgeLayerDEM.y));
     }
     
     // NE edge - sample neightbour patch if lower resolution or if same
@@ -118,7 +207,7 @@ float VP_getVertexHeight(ivec2 iPosition)
             tc = vec2(tc.y, 1.0 - tc.x);
         }
 
-        return texture(VP_texDEM, vec3(tc, VP_edgeLayerDEM.x)).x;
+        return VP_sampleDEM(VP_edgePageDEM.x, vec3(tc, VP_edgeLayerDEM.x));
     }
     
     // SE edge - sample neightbour patch if lower resolution or if same
@@ -138,7 +227,7 @@ float VP_getVertexHeight(ivec2 iPosition)
             tc = vec2(1.0 - tc.y, tc.x);
         }
 
-        return texture(VP_texDEM, vec3(tc, VP_edgeLayerDEM.w)).x;
+        return VP_sampleDEM(VP_edgePageDEM.w, vec3(tc, VP_edgeLayerDEM.w));
     }
 
     // multiple cases here:
@@ -146,7 +235,7 @@ float VP_getVertexHeight(ivec2 iPosition)
     //  edge vertex in western direction and neighbours have higher resolution
     //  edge vertex in eastern direction and neighbours have same or higher resolution
     vec2 tc = VP_getTexCoordDEM(basePos);
-    return texture(VP_texDEM, vec3(tc, VP_layerDEM)).x;
+    return VP_sampleDEM(VP_pageDEM, vec3(tc, VP_layerDEM));
 }
 
 // Converts point posXY (in [0, 1]^2), which are relative coordinates inside a
@@ -14,61 +14,100 @@ const int   VP_TEXTURESIZE = 257;
 const int   VP_MAXVERTEX      = 256;
 const float VP_VERTEXDISTANCE = 1.0 / VP_MAXVERTEX;
 
-// uniforms - global for a planet ----------------------------------------------
-uniform mat4  VP_matProjection;
-uniform mat4  VP_matModelView;
-uniform float VP_farClip;
+// number of pages of VP_texDEM and VP_texIMG, must match TexturePagePool::sMaxPages
+const int   VP_MAXPAGES = 4;
+
+// number of texels of VP_tiles per tile, must match TileDrawList::sTexelsPerInstance
+const int   VP_TILETEXELS = 16;
+
+// layout of the virtual textures, must match VirtualPageTable
+const int   VP_VIRTUALPAGES    = 4;
+const int   VP_VIRTUALPAGESIZE = 64;
+
+// maximum number of shadow cascades, must match TerrainShader::sMaxShadowCascades
+const int   VP_MAXCASCADES = 5;
+
+// uniforms - global for a render pass, must match TerrainShader::FrameUniforms
+layout(std140) uniform VP_FrameUniforms
+{
+    mat4  VP_matProjection;
+    mat4  VP_matModelView;
+    mat4  VP_shadowProjectionViewMatrices[VP_MAXCASCADES];
+
+    // planet parameters, radius and scale factor for height values
+    vec2  VP_radius;
+    float VP_heightScale;
 
+    float VP_shadowBias;
+    int   VP_shadowCascades;
+    bool  VP_shadowMapMode;
+
+    // if VP_virtualIMG is true, VP_texIMG holds the page tables of the image
+    // tiles and the pages are stored in VP_texVirtualIMG
+    bool  VP_virtualIMG;
+
+    float VP_farClip;
+};
+
+// uniforms - global for a planet ----------------------------------------------
 uniform float VP_blendEnd = 0.0002;
 uniform float VP_blendStart = 0.02;
 
-// planet parameters, radius and scale factor for height values
-uniform float VP_heightScale;
-uniform vec2 VP_radius;
+// texture pages storing elevation and image data for all patches
+uniform sampler2DArray VP_texDEM[VP_MAXPAGES];
+uniform sampler2DArray VP_texIMG[VP_MAXPAGES];
+uniform sampler2D      VP_texVirtualIMG;
+
+// parameters - current tile --------------------------------------------------
 
-// texture storing elevation data for all patches
-uniform sampler2DArray VP_texDEM;
-uniform sampler2DArray VP_texIMG;
+// the parameters of all tiles of a draw call, see TileDrawList::Instance. The
+// tile of an instance is at index VP_tileBase + gl_InstanceID
+uniform isamplerBuffer VP_tiles;
+uniform int            VP_tileBase;
 
-// uniforms - current tile -----------------------------------------------------
+// The parameters below are read by VP_loadTile() in the vertex shader. Those
+// which are used by the fragment shader as well are passed on as flat
+// varyings, $VP_TILE_VARYING is replaced by "flat out" or "flat in" by
+// TerrainShader.
 
-uniform float VP_demAverageHeight;
+float VP_demAverageHeight;
 
 // offset (xy) and total number of patches (z) (relative to base patch)
-uniform ivec3 VP_tileOffsetScale;
+$VP_TILE_VARYING ivec3 VP_tileOffsetScale;
 
 // offset (xy) and divisor (z) for DEM tile tex coords
-uniform ivec3 VP_demOffsetScale;
+$VP_TILE_VARYING ivec3 VP_demOffsetScale;
 
 // offset (xy) and divisor (z) for IMG tile tex coords
-uniform ivec3 VP_imgOffsetScale;
+$VP_TILE_VARYING ivec3 VP_imgOffsetScale;
 
 // difference in resolution to neighbour tile (x: NE, y: NW, z: SW, w: SE)
-uniform ivec4 VP_edgeDelta;
+$VP_TILE_VARYING ivec4 VP_edgeDelta;
 
-// layer of VP_texDEM the neighbour tile is stored in (x: NE, y: NW, z: SW,
-// w: SE) - only entries VP_edgeLayerDEM.I are valid where VP_edgeDelta.I != 0
-uniform ivec4 VP_edgeLayerDEM;
+// page and layer of VP_texDEM the neighbour tile is stored in (x: NE, y: NW,
+// z: SW, w: SE) - only entries VP_edgePageDEM.I and VP_edgeLayerDEM.I are valid
+// where VP_edgeDelta.I != 0
+ivec4 VP_edgePageDEM;
+ivec4 VP_edgeLayerDEM;
 
 // offset to apply to coordinates on neighbour tiles (x: NE, y: NW, z: SW,
 // w: SE)
-uniform ivec4 VP_edgeOffset;
+ivec4 VP_edgeOffset;
 
 // patch coordinate parameters f1, f2 (indirectly specifies base patch)
-uniform ivec2 VP_f1f2;
+ivec2 VP_f1f2;
 
-// layer of VP_texDEM the current patch's elevation data is stored in
-uniform int VP_layerDEM;
+// page and layer of VP_texDEM the current patch's elevation data is stored in
+int VP_pageDEM;
+int VP_layerDEM;
 
-// layer of VP_texIMG the current patch's image data is stored in
-uniform int VP_layerIMG;
+// page and layer of VP_texIMG the current patch's image data is stored in,
+// VP_layerIMG is -1 if there is no image data
+$VP_TILE_VARYING int VP_pageIMG;
+$VP_TILE_VARYING int VP_layerIMG;
 
-uniform vec3 VP_corners[4];
-uniform vec3 VP_normals[4];
+vec3 VP_corners[4];
+vec3 VP_normals[4];
 
 // uniforms - shadow stuff -----------------------------------------------------
-uniform bool            VP_shadowMapMode;
-uniform sampler2DShadow VP_shadowMaps[5];
-uniform mat4            VP_shadowProjectionViewMatrices[5];
-uniform float           VP_shadowBias = 0.0001;
-uniform int             VP_shadowCascades;
+uniform sampler2DShadow VP_shadowMaps[VP_MAXCASCADES];
@@ -0,0 +1,462 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Culling.hpp"
+
+// SSE2 is part of every x86-64 CPU. On other architectures the batched tests fall back to plain
+// loops over the boxes.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSP_LOD_BODIES_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <cmath>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Ray-sphere intersection test for a single corner point p. With the ray direction u = d / |d|,
+// d = p - camPos, the ray hits the sphere at t = -b +- sqrt(b^2 - c) with b = dot(camPos, u). The
+// corner is visible if there is no intersection, if both intersections are behind the camera (e.g.
+// while travelling in a deep crater and looking above) or if the corner is in front of the sphere.
+// The conditions are multiplied by |d| and squared where possible, so that neither a division nor
+// a square root is required.
+bool isCornerVisible(glm::dvec3 const& camPos, double c, double x, double y, double z) {
+  double const dx = x - camPos.x;
+  double const dy = y - camPos.y;
+  double const dz = z - camPos.z;
+  double const l2 = dx * dx + dy * dy + dz * dz;                   // |d|^2
+  double const e  = camPos.x * dx + camPos.y * dy + camPos.z * dz; // b * |d|
+
+  bool const noIntersection = e * e < c * l2;
+  bool const bothBehind     = e > 0.0 && c > 0.0;
+  bool const inFront        = e + l2 < 0.0 && 2.0 * e + l2 + c > 0.0;
+
+  return noIntersection || bothBehind || inFront;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns a mask with bit i set if box i is on the inner side of plane. xs, ys and zs point to the
+// coordinates of the p-vertices of the boxes.
+unsigned testPlane(glm::dvec4 const& plane, double const* xs, double const* ys, double const* zs) {
+  unsigned inside = 0;
+
+#ifdef CSP_LOD_BODIES_CULLING_SSE2
+  __m128d const nx = _mm_set1_pd(plane.x);
+  __m128d const ny = _mm_set1_pd(plane.y);
+  __m128d const nz = _mm_set1_pd(plane.z);
+  __m128d const d  = _mm_set1_pd(-plane.w);
+
+  for (int i = 0; i < BoxBatch::sSize; i += 2) {
+    __m128d dist = _mm_mul_pd(nx, _mm_load_pd(xs + i));
+    dist         = _mm_add_pd(dist, _mm_mul_pd(ny, _mm_load_pd(ys + i)));
+    dist         = _mm_add_pd(dist, _mm_mul_pd(nz, _mm_load_pd(zs + i)));
+
+    inside |= static_cast<unsigned>(_mm_movemask_pd(_mm_cmpge_pd(dist, d))) << i;
+  }
+#else
+  for (int i = 0; i < BoxBatch::sSize; ++i) {
+    bool const in = plane.x * xs[i] + plane.y * ys[i] + plane.z * zs[i] >= -plane.w;
+    inside |= static_cast<unsigned>(in) << static_cast<unsigned>(i);
+  }
+#endif
+
+  return inside;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The same as above for oriented boxes. The distance of the p-vertex of a box is the distance of
+// its center plus the sum of the absolute projections of its half axes onto the plane's normal.
+unsigned testPlane(glm::dvec4 const& plane, OrientedBoxBatch const& boxes) {
+  unsigned inside = 0;
+
+#ifdef CSP_LOD_BODIES_CULLING_SSE2
+  __m128d const nx   = _mm_set1_pd(plane.x);
+  __m128d const ny   = _mm_set1_pd(plane.y);
+  __m128d const nz   = _mm_set1_pd(plane.z);
+  __m128d const d    = _mm_set1_pd(-plane.w);
+  __m128d const sign = _mm_set1_pd(-0.0);
+
+  for (int i = 0; i < OrientedBoxBatch::sSize; i += 2) {
+    __m128d dist = _mm_mul_pd(nx, _mm_load_pd(boxes.mCenter[0].data() + i));
+    dist         = _mm_add_pd(dist, _mm_mul_pd(ny, _mm_load_pd(boxes.mCenter[1].data() + i)));
+    dist         = _mm_add_pd(dist, _mm_mul_pd(nz, _mm_load_pd(boxes.mCenter[2].data() + i)));
+
+    for (auto const& axis : boxes.mHalfAxes) {
+      __m128d proj = _mm_mul_pd(nx, _mm_load_pd(axis[0].data() + i));
+      proj         = _mm_add_pd(proj, _mm_mul_pd(ny, _mm_load_pd(axis[1].data() + i)));
+      proj         = _mm_add_pd(proj, _mm_mul_pd(nz, _mm_load_pd(axis[2].data() + i)));
+      dist         = _mm_add_pd(dist, _mm_andnot_pd(sign, proj));
+    }
+
+    inside |= static_cast<unsigned>(_mm_movemask_pd(_mm_cmpge_pd(dist, d))) << i;
+  }
+#else
+  for (std::size_t i = 0; i < OrientedBoxBatch::sSize; ++i) {
+    double dist = plane.x * boxes.mCenter[0][i] + plane.y * boxes.mCenter[1][i] +
+                  plane.z * boxes.mCenter[2][i];
+
+    for (auto const& axis : boxes.mHalfAxes) {
+      dist += std::abs(plane.x * axis[0][i] + plane.y * axis[1][i] + plane.z * axis[2][i]);
+    }
+
+    inside |= static_cast<unsigned>(dist >= -plane.w) << static_cast<unsigned>(i);
+  }
+#endif
+
+  return inside;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns a mask with bit i set if the corner of box i given by xs, ys and zs is not occluded, see
+// isCornerVisible().
+unsigned testCorner(
+    glm::dvec3 const& camPos, double c, double const* xs, double const* ys, double const* zs) {
+  unsigned visible = 0;
+
+#ifdef CSP_LOD_BODIES_CULLING_SSE2
+  __m128d const camX = _mm_set1_pd(camPos.x);
+  __m128d const camY = _mm_set1_pd(camPos.y);
+  __m128d const camZ = _mm_set1_pd(camPos.z);
+  __m128d const cc   = _mm_set1_pd(c);
+  __m128d const zero = _mm_setzero_pd();
+  __m128d const cPos = _mm_cmpgt_pd(cc, zero);
+
+  for (int i = 0; i < BoxBatch::sSize; i += 2) {
+    __m128d const dx = _mm_sub_pd(_mm_load_pd(xs + i), camX);
+    __m128d const dy = _mm_sub_pd(_mm_load_pd(ys + i), camY);
+    __m128d const dz = _mm_sub_pd(_mm_load_pd(zs + i), camZ);
+
+    __m128d l2 = _mm_mul_pd(dx, dx);
+    l2         = _mm_add_pd(l2, _mm_mul_pd(dy, dy));
+    l2         = _mm_add_pd(l2, _mm_mul_pd(dz, dz));
+
+    __m128d e = _mm_mul_pd(camX, dx);
+    e         = _mm_add_pd(e, _mm_mul_pd(camY, dy));
+    e         = _mm_add_pd(e, _mm_mul_pd(camZ, dz));
+
+    __m128d const noIntersection = _mm_cmplt_pd(_mm_mul_pd(e, e), _mm_mul_pd(cc, l2));
+    __m128d const bothBehind     = _mm_and_pd(_mm_cmpgt_pd(e, zero), cPos);
+    __m128d const inFront        = _mm_and_pd(_mm_cmplt_pd(_mm_add_pd(e, l2), zero),
+        _mm_cmpgt_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(e, e), l2), cc), zero));
+
+    __m128d const result = _mm_or_pd(_mm_or_pd(noIntersection, bothBehind), inFront);
+    visible |= static_cast<unsigned>(_mm_movemask_pd(result)) << i;
+  }
+#else
+  for (int i = 0; i < BoxBatch::sSize; ++i) {
+    bool const in = isCornerVisible(camPos, c, xs[i], ys[i], zs[i]);
+    visible |= static_cast<unsigned>(in) << static_cast<unsigned>(i);
+  }
+#endif
+
+  return visible;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The same as above for oriented boxes. The corners are enumerated by the bits of corner, bit a
+// selects the sign of half axis a.
+unsigned testCorner(
+    glm::dvec3 const& camPos, double c, OrientedBoxBatch const& boxes, unsigned corner) {
+  unsigned visible = 0;
+
+#ifdef CSP_LOD_BODIES_CULLING_SSE2
+  __m128d const camX = _mm_set1_pd(camPos.x);
+  __m128d const camY = _mm_set1_pd(camPos.y);
+  __m128d const camZ = _mm_set1_pd(camPos.z);
+  __m128d const cc   = _mm_set1_pd(c);
+  __m128d const zero = _mm_setzero_pd();
+  __m128d const cPos = _mm_cmpgt_pd(cc, zero);
+
+  // The half axes are negated by flipping their sign bits.
+  __m128d const sign0 = (corner & 1U) ? zero : _mm_set1_pd(-0.0);
+  __m128d const sign1 = (corner & 2U) ? zero : _mm_set1_pd(-0.0);
+  __m128d const sign2 = (corner & 4U) ? zero : _mm_set1_pd(-0.0);
+
+  for (int i = 0; i < OrientedBoxBatch::sSize; i += 2) {
+    __m128d p[3];
+
+    for (std::size_t k = 0; k < 3; ++k) {
+      auto const& axes = boxes.mHalfAxes;
+      p[k]             = _mm_load_pd(boxes.mCenter[k].data() + i);
+      p[k] = _mm_add_pd(p[k], _mm_xor_pd(sign0, _mm_load_pd(axes[0][k].data() + i)));
+      p[k] = _mm_add_pd(p[k], _mm_xor_pd(sign1, _mm_load_pd(axes[1][k].data() + i)));
+      p[k] = _mm_add_pd(p[k], _mm_xor_pd(sign2, _mm_load_pd(axes[2][k].data() + i)));
+    }
+
+    __m128d const dx = _mm_sub_pd(p[0], camX);
+    __m128d const dy = _mm_sub_pd(p[1], camY);
+    __m128d const dz = _mm_sub_pd(p[2], camZ);
+
+    __m128d l2 = _mm_mul_pd(dx, dx);
+    l2         = _mm_add_pd(l2, _mm_mul_pd(dy, dy));
+    l2         = _mm_add_pd(l2, _mm_mul_pd(dz, dz));
+
+    __m128d e = _mm_mul_pd(camX, dx);
+    e         = _mm_add_pd(e, _mm_mul_pd(camY, dy));
+    e         = _mm_add_pd(e, _mm_mul_pd(camZ, dz));
+
+    __m128d const noIntersection = _mm_cmplt_pd(_mm_mul_pd(e, e), _mm_mul_pd(cc, l2));
+    __m128d const bothBehind     = _mm_and_pd(_mm_cmpgt_pd(e, zero), cPos);
+    __m128d const inFront        = _mm_and_pd(_mm_cmplt_pd(_mm_add_pd(e, l2), zero),
+        _mm_cmpgt_pd(_mm_add_pd(_mm_add_pd(_mm_add_pd(e, e), l2), cc), zero));
+
+    __m128d const result = _mm_or_pd(_mm_or_pd(noIntersection, bothBehind), inFront);
+    visible |= static_cast<unsigned>(_mm_movemask_pd(result)) << i;
+  }
+#else
+  for (std::size_t i = 0; i < OrientedBoxBatch::sSize; ++i) {
+    std::array<double, 3> p{};
+
+    for (std::size_t k = 0; k < 3; ++k) {
+      p[k] = boxes.mCenter[k][i];
+
+      for (std::size_t a = 0; a < 3; ++a) {
+        double const h = boxes.mHalfAxes[a][k][i];
+        p[k] += (corner & (1U << a)) ? h : -h;
+      }
+    }
+
+    bool const in = isCornerVisible(camPos, c, p[0], p[1], p[2]);
+    visible |= static_cast<unsigned>(in) << static_cast<unsigned>(i);
+  }
+#endif
+
+  return visible;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The loop of the batched frustum tests, testPlane returns the mask of the boxes on the inner side
+// of a plane.
+template <typename PlaneTest>
+unsigned testPlanes(
+    Frustum const& frustum, unsigned mask, int& planeHint, PlaneTest const& testPlane) {
+  auto const& planes   = frustum.getPlanes();
+  std::size_t planeIdx = static_cast<std::size_t>(planeHint);
+
+  // the plane index wraps around without a division, this loop is short enough for it to matter
+  for (std::size_t i = 0; i < Frustum::NUM_PLANES && mask != 0; ++i) {
+    unsigned const inside = testPlane(planes[planeIdx]);
+
+    if ((mask & ~inside) != 0) {
+      planeHint = static_cast<int>(planeIdx);
+    }
+
+    mask &= inside;
+
+    if (++planeIdx == Frustum::NUM_PLANES) {
+      planeIdx = 0;
+    }
+  }
+
+  return mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void BoxBatch::set(int idx, BoundingBox<double> const& box) {
+  mMinX.at(idx) = box.getMin().x;
+  mMinY.at(idx) = box.getMin().y;
+  mMinZ.at(idx) = box.getMin().z;
+  mMaxX.at(idx) = box.getMax().x;
+  mMaxY.at(idx) = box.getMax().y;
+  mMaxZ.at(idx) = box.getMax().z;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OrientedBoxBatch::set(int idx, OrientedTileBounds const& box) {
+  for (int c = 0; c < 3; ++c) {
+    mCenter.at(c).at(idx) = box.mCenter[c];
+
+    for (int a = 0; a < 3; ++a) {
+      mHalfAxes.at(a).at(c).at(idx) = box.mHalfAxes.at(a)[c];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool testInFrustum(Frustum const& frustum, BoundingBox<double> const& box) {
+  glm::dvec3 const& tbMin = box.getMin();
+  glm::dvec3 const& tbMax = box.getMax();
+
+  for (auto const& plane : frustum.getPlanes()) {
+    // If the corner furthest along the normal is outside, all corners are outside.
+    glm::dvec3 const pVertex(plane.x > 0.0 ? tbMax.x : tbMin.x, plane.y > 0.0 ? tbMax.y : tbMin.y,
+        plane.z > 0.0 ? tbMax.z : tbMin.z);
+
+    if (plane.x * pVertex.x + plane.y * pVertex.y + plane.z * pVertex.z < -plane.w) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool testInFrustum(Frustum const& frustum, OrientedTileBounds const& bounds) {
+  for (auto const& plane : frustum.getPlanes()) {
+    glm::dvec3 const normal(plane.x, plane.y, plane.z);
+
+    double dist = glm::dot(normal, bounds.mCenter);
+
+    for (auto const& axis : bounds.mHalfAxes) {
+      dist += std::abs(glm::dot(normal, axis));
+    }
+
+    if (dist < -plane.w) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned testInFrustum(
+    Frustum const& frustum, BoxBatch const& boxes, unsigned mask, int& planeHint) {
+  return testPlanes(frustum, mask, planeHint, [&boxes](glm::dvec4 const& plane) {
+    // The p-vertex is chosen by the plane's normal only, so it is the same for all boxes.
+    return testPlane(plane, plane.x > 0.0 ? boxes.mMaxX.data() : boxes.mMinX.data(),
+        plane.y > 0.0 ? boxes.mMaxY.data() : boxes.mMinY.data(),
+        plane.z > 0.0 ? boxes.mMaxZ.data() : boxes.mMinZ.data());
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned testInFrustum(
+    Frustum const& frustum, OrientedBoxBatch const& boxes, unsigned mask, int& planeHint) {
+  return testPlanes(frustum, mask, planeHint,
+      [&boxes](glm::dvec4 const& plane) { return testPlane(plane, boxes); });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool testAboveHorizon(glm::dvec3 const& camPos, double radius, BoundingBox<double> const& box) {
+  double const c = glm::dot(camPos, camPos) - radius * radius;
+
+  glm::dvec3 const& tbMin = box.getMin();
+  glm::dvec3 const& tbMax = box.getMax();
+
+  for (unsigned corner = 0; corner < 8; ++corner) {
+    glm::dvec3 const tbPnt((corner & 1U) ? tbMax.x : tbMin.x, (corner & 2U) ? tbMax.y : tbMin.y,
+        (corner & 4U) ? tbMax.z : tbMin.z);
+
+    if (isCornerVisible(camPos, c, tbPnt.x, tbPnt.y, tbPnt.z)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool testAboveHorizon(glm::dvec3 const& camPos, double radius, OrientedTileBounds const& bounds) {
+  double const c = glm::dot(camPos, camPos) - radius * radius;
+
+  for (unsigned corner = 0; corner < 8; ++corner) {
+    glm::dvec3 tbPnt = bounds.mCenter;
+
+    for (unsigned a = 0; a < 3; ++a) {
+      tbPnt += (corner & (1U << a)) ? bounds.mHalfAxes.at(a) : -bounds.mHalfAxes.at(a);
+    }
+
+    if (isCornerVisible(camPos, c, tbPnt.x, tbPnt.y, tbPnt.z)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned testAboveHorizon(
+    glm::dvec3 const& camPos, double radius, BoxBatch const& boxes, unsigned mask) {
+  double const c = glm::dot(camPos, camPos) - radius * radius;
+
+  unsigned visible = 0;
+
+  // The corners are enumerated by the bits of corner, each of them is tested for all boxes at once.
+  // Stop as soon as one corner of each box is visible.
+  for (unsigned corner = 0; corner < 8 && (mask & visible) != mask; ++corner) {
+    visible |= testCorner(camPos, c, (corner & 1U) ? boxes.mMaxX.data() : boxes.mMinX.data(),
+        (corner & 2U) ? boxes.mMaxY.data() : boxes.mMinY.data(),
+        (corner & 4U) ? boxes.mMaxZ.data() : boxes.mMinZ.data());
+  }
+
+  return mask & visible;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned testAboveHorizon(
+    glm::dvec3 const& camPos, double radius, OrientedBoxBatch const& boxes, unsigned mask) {
+  double const c = glm::dot(camPos, camPos) - radius * radius;
+
+  unsigned visible = 0;
+
+  for (unsigned corner = 0; corner < 8 && (mask & visible) != mask; ++corner) {
+    visible |= testCorner(camPos, c, boxes, corner);
+  }
+
+  return mask & visible;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool testBackFacing(glm::dvec3 const& camPos, OrientedTileBounds const& bounds) {
+  if (bounds.mConeCos <= 0.0) {
+    return false;
+  }
+
+  glm::dvec3 const& a0 = bounds.mHalfAxes[0];
+  glm::dvec3 const& a1 = bounds.mHalfAxes[1];
+  glm::dvec3 const& a2 = bounds.mHalfAxes[2];
+
+  glm::dvec3 const v  = camPos - bounds.mCenter;
+  double const     d2 = glm::dot(v, v);
+  double const     r2 = glm::dot(a0, a0) + glm::dot(a1, a1) + glm::dot(a2, a2);
+
+  // The camera is inside the bounding sphere of the box.
+  if (d2 <= r2) {
+    return false;
+  }
+
+  // Seen from any point of the bounding sphere, the camera is within the angle beta of v, with
+  // sin(beta) = r / d. All surface normals face away from the camera if the angle between v and
+  // the cone's axis exceeds pi / 2 + alpha + beta, alpha being the half angle of the normal cone.
+  // The terms below are multiplied by d.
+  double const r        = std::sqrt(r2);
+  double const dCosBeta = std::sqrt(d2 - r2);
+
+  if (bounds.mConeCos * dCosBeta <= bounds.mConeSin * r) {
+    return false;
+  }
+
+  return glm::dot(bounds.mConeAxis, v) < -(bounds.mConeSin * dCosBeta + bounds.mConeCos * r);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
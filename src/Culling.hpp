@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_CULLING_HPP
+#define CSP_LOD_BODIES_CULLING_HPP
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+#include "TileBounds.hpp"
+
+#include <array>
+
+namespace csp::lodbodies {
+
+/// The axis aligned bounding boxes of the four children of a tile in structure-of-arrays layout.
+/// The batched tests below process all four boxes at once using SSE2 instructions where available.
+struct BoxBatch {
+  static int const sSize = 4;
+
+  /// Copies box to slot idx.
+  void set(int idx, BoundingBox<double> const& box);
+
+  alignas(32) std::array<double, sSize> mMinX{};
+  alignas(32) std::array<double, sSize> mMinY{};
+  alignas(32) std::array<double, sSize> mMinZ{};
+  alignas(32) std::array<double, sSize> mMaxX{};
+  alignas(32) std::array<double, sSize> mMaxY{};
+  alignas(32) std::array<double, sSize> mMaxZ{};
+};
+
+/// The same as BoxBatch for OrientedTileBounds. Each box is stored as its center and three
+/// orthogonal half axes. The tests need four times as many operations per plane and per corner as
+/// those of BoxBatch, so this is only used for oriented bounds.
+struct OrientedBoxBatch {
+  static int const sSize = BoxBatch::sSize;
+
+  using Lanes = std::array<double, sSize>;
+
+  /// Copies box to slot idx.
+  void set(int idx, OrientedTileBounds const& box);
+
+  /// mCenter[c][i] is the coordinate c of the center of box i.
+  alignas(32) std::array<Lanes, 3> mCenter{};
+
+  /// mHalfAxes[a][c][i] is the coordinate c of the half axis a of box i.
+  alignas(32) std::array<std::array<Lanes, 3>, 3> mHalfAxes{};
+};
+
+/// Returns whether box intersects frustum. For each plane only the corner of the box furthest along
+/// the plane's normal (the "p-vertex") is tested, as described in "Optimized View Frustum Culling
+/// Algorithms for Bounding Boxes" by Assarsson and Möller.
+bool testInFrustum(Frustum const& frustum, BoundingBox<double> const& box);
+
+/// Returns whether the oriented box of bounds intersects frustum. This is the same test as above,
+/// the distance of the p-vertex is the distance of the center plus the box's projected radius.
+bool testInFrustum(Frustum const& frustum, OrientedTileBounds const& bounds);
+
+/// Batched version of testInFrustum. Only the boxes whose bit is set in mask are considered, the
+/// returned mask has bit i set if box i intersects frustum. The planes are tested beginning with
+/// planeHint, which is updated to the last plane which rejected a box. Passing the same hint to
+/// subsequent calls makes use of the coherence between neighbouring boxes.
+unsigned testInFrustum(
+    Frustum const& frustum, BoxBatch const& boxes, unsigned mask, int& planeHint);
+unsigned testInFrustum(
+    Frustum const& frustum, OrientedBoxBatch const& boxes, unsigned mask, int& planeHint);
+
+/// Returns whether any corner of box is not occluded by a sphere around the origin with the given
+/// radius when seen from camPos. This culls tiles behind the horizon.
+bool testAboveHorizon(glm::dvec3 const& camPos, double radius, BoundingBox<double> const& box);
+bool testAboveHorizon(glm::dvec3 const& camPos, double radius, OrientedTileBounds const& bounds);
+
+/// Batched version of testAboveHorizon. Only the boxes whose bit is set in mask are considered, the
+/// returned mask has bit i set if box i is not occluded.
+unsigned testAboveHorizon(
+    glm::dvec3 const& camPos, double radius, BoxBatch const& boxes, unsigned mask);
+unsigned testAboveHorizon(
+    glm::dvec3 const& camPos, double radius, OrientedBoxBatch const& boxes, unsigned mask);
+
+/// Returns whether all of the tile's surface faces away from camPos, i.e. whether it is hidden by
+/// the terrain in front of it. The normal cone of bounds is compared to the cone of directions from
+/// the bounding sphere of the box towards the camera, as described in "The Cone of Normals
+/// Technique for Fast Processing of Curved Patches" by Shirman and Abi-Ezzi. Tiles whose normal
+/// cone is too wide are never rejected.
+bool testBackFacing(glm::dvec3 const& camPos, OrientedTileBounds const& bounds);
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_CULLING_HPP
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "EvictionPolicy.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool EvictionPolicy::mayEvict(Tile const& resident, Tile const& waiting) {
+  return resident.mLastFrame < waiting.mLastFrame;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EvictionPolicy::setCandidates(std::vector<Tile> candidates) {
+  mCandidates = std::move(candidates);
+  mOrder.resize(mCandidates.size());
+  mNext = 0;
+
+  // least valuable candidates first: oldest, then finest
+  std::iota(mOrder.begin(), mOrder.end(), std::size_t(0));
+  std::sort(mOrder.begin(), mOrder.end(), [this](std::size_t lhs, std::size_t rhs) {
+    Tile const& l = mCandidates[lhs];
+    Tile const& r = mCandidates[rhs];
+    return l.mLastFrame != r.mLastFrame ? l.mLastFrame < r.mLastFrame : l.mLevel > r.mLevel;
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int EvictionPolicy::selectVictim(Tile const& waiting) {
+  // The next candidate is the oldest one left. If it may not be evicted, none of the others may.
+  if (mNext == mOrder.size() || !mayEvict(mCandidates[mOrder[mNext]], waiting)) {
+    return -1;
+  }
+
+  return static_cast<int>(mOrder[mNext++]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int EvictionPolicy::getNewestFrame() const {
+  return mOrder.empty() ? -1 : mCandidates[mOrder.back()].mLastFrame;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
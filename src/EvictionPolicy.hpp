@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_EVICTIONPOLICY_HPP
+#define CSP_LOD_BODIES_EVICTIONPOLICY_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Decides which tiles a full TileTextureArray evicts from the GPU in favour of tiles waiting for
+/// their upload.
+///
+/// A resident tile may only be evicted for a waiting tile which has been used more recently. Hence
+/// tiles used in the last frame are never evicted, and tiles do not evict each other back and
+/// forth while the camera is still. Among the tiles which may be evicted, the least recently used
+/// ones go first and among those the finest levels, since they cover the least of the screen.
+///
+/// The policy does not know about RenderData or OpenGL, so that it can be evaluated in a CPU only
+/// simulation.
+class EvictionPolicy {
+ public:
+  /// The properties of a tile the policy is based on.
+  struct Tile {
+    int mLastFrame;
+    int mLevel;
+  };
+
+  /// Returns whether resident may be evicted in favour of waiting.
+  static bool mayEvict(Tile const& resident, Tile const& waiting);
+
+  /// Sets the resident tiles which may be evicted. They are identified by their index in
+  /// candidates.
+  void setCandidates(std::vector<Tile> candidates);
+
+  /// Returns the index of the least valuable candidate which may be evicted in favour of waiting,
+  /// or -1 if there is none. Each candidate is returned at most once. The waiting tiles must be
+  /// passed in order of decreasing importance, as they are taken from an UploadQueue.
+  int selectVictim(Tile const& waiting);
+
+  /// Returns the most recent frame any candidate has been used in, or -1 if there are none. A
+  /// waiting tile used at least as recently can not evict anything, since all tiles on the GPU are
+  /// needed as well.
+  int getNewestFrame() const;
+
+ private:
+  std::vector<Tile>        mCandidates;
+  std::vector<std::size_t> mOrder;
+  std::size_t              mNext{};
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_EVICTIONPOLICY_HPP
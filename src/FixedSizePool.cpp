@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FixedSizePool.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t alignUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::uint32_t getIndex(std::uint64_t head) {
+  return static_cast<std::uint32_t>(head & 0xFFFFFFFFu);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t makeHead(std::uint64_t oldHead, std::uint32_t index) {
+  return (((oldHead >> 32u) + 1u) << 32u) | index;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FixedSizePool::FixedSizePool(std::size_t blockSize, std::size_t blocksPerSlab)
+    : mBlockSize(blockSize)
+    , mBlockStride(sizeof(BlockHeader) + alignUp(blockSize, alignof(std::max_align_t)))
+    , mBlocksPerSlab(blocksPerSlab > 0 ? blocksPerSlab : 1)
+    , mFreeHead(sInvalidIndex)
+    , mSlabs()
+    , mNumSlabs(0)
+    , mNumAllocated(0) {
+  for (auto& slab : mSlabs) {
+    slab.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FixedSizePool::~FixedSizePool() {
+  std::size_t const numSlabs = mNumSlabs.load();
+
+  for (std::size_t i = 0; i < numSlabs; ++i) {
+    std::free(mSlabs.at(i).load());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* FixedSizePool::allocate() {
+  BlockHeader*  block = nullptr;
+  std::uint64_t head  = mFreeHead.load(std::memory_order_acquire);
+
+  while (block == nullptr) {
+    std::uint32_t const index = getIndex(head);
+
+    if (index == sInvalidIndex) {
+      // Free list is empty, either add a new slab or retry if another thread just did so.
+      block = grow();
+      head  = mFreeHead.load(std::memory_order_acquire);
+      continue;
+    }
+
+    // The header stays valid even if another thread pops this block in the meantime, as slabs are
+    // never released. In that case the counter in head has changed and the exchange fails.
+    BlockHeader*        candidate = getHeader(index);
+    std::uint32_t const next      = candidate->mNext.load(std::memory_order_relaxed);
+
+    if (mFreeHead.compare_exchange_weak(head, makeHead(head, next), std::memory_order_acq_rel,
+            std::memory_order_acquire)) {
+      block = candidate;
+    }
+  }
+
+  mNumAllocated.fetch_add(1, std::memory_order_relaxed);
+
+  return reinterpret_cast<char*>(block) + sizeof(BlockHeader);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FixedSizePool::deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  auto* block = reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - sizeof(BlockHeader));
+  pushChain(block, block);
+
+  mNumAllocated.fetch_sub(1, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FixedSizePool::getBlockSize() const {
+  return mBlockSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FixedSizePool::getBlocksPerSlab() const {
+  return mBlocksPerSlab;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FixedSizePool::getNumSlabs() const {
+  return mNumSlabs.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FixedSizePool::getNumAllocated() const {
+  return mNumAllocated.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t FixedSizePool::getReservedBytes() const {
+  return getNumSlabs() * mBlocksPerSlab * mBlockStride;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FixedSizePool::BlockHeader* FixedSizePool::getHeader(std::uint32_t index) const {
+  char* slab = mSlabs.at(index / mBlocksPerSlab).load(std::memory_order_acquire);
+  return reinterpret_cast<BlockHeader*>(slab + (index % mBlocksPerSlab) * mBlockStride);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FixedSizePool::pushChain(BlockHeader* first, BlockHeader* last) {
+  std::uint64_t head = mFreeHead.load(std::memory_order_relaxed);
+
+  do {
+    last->mNext.store(getIndex(head), std::memory_order_relaxed);
+  } while (!mFreeHead.compare_exchange_weak(
+      head, makeHead(head, first->mIndex), std::memory_order_release, std::memory_order_relaxed));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FixedSizePool::BlockHeader* FixedSizePool::grow() {
+  std::lock_guard<std::mutex> lock(mGrowMutex);
+
+  // Another thread may have added a slab while we were waiting for the lock.
+  if (getIndex(mFreeHead.load(std::memory_order_acquire)) != sInvalidIndex) {
+    return nullptr;
+  }
+
+  std::size_t const slabIdx = mNumSlabs.load(std::memory_order_relaxed);
+
+  if (slabIdx >= sMaxSlabs ||
+      (slabIdx + 1) * mBlocksPerSlab >= static_cast<std::size_t>(sInvalidIndex)) {
+    throw std::bad_alloc();
+  }
+
+  auto* slab = static_cast<char*>(std::malloc(mBlocksPerSlab * mBlockStride));
+
+  if (slab == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  std::size_t const firstIndex = slabIdx * mBlocksPerSlab;
+
+  for (std::size_t i = 0; i < mBlocksPerSlab; ++i) {
+    auto* header   = new (slab + i * mBlockStride) BlockHeader;
+    header->mIndex = static_cast<std::uint32_t>(firstIndex + i);
+    header->mNext.store(static_cast<std::uint32_t>(firstIndex + i + 1), std::memory_order_relaxed);
+  }
+
+  mSlabs.at(slabIdx).store(slab, std::memory_order_release);
+  mNumSlabs.store(slabIdx + 1, std::memory_order_release);
+
+  // The first block is returned directly, all others go to the free list.
+  auto* first = reinterpret_cast<BlockHeader*>(slab);
+
+  if (mBlocksPerSlab > 1) {
+    pushChain(reinterpret_cast<BlockHeader*>(slab + mBlockStride),
+        reinterpret_cast<BlockHeader*>(slab + (mBlocksPerSlab - 1) * mBlockStride));
+  }
+
+  return first;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
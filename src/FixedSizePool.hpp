@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_FIXEDSIZEPOOL_HPP
+#define CSP_LOD_BODIES_FIXEDSIZEPOOL_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace csp::lodbodies {
+
+/// Allocator for blocks of one fixed size. Memory is requested from the system in slabs of
+/// several blocks and is never returned before the pool is destroyed, so a long running session
+/// which constantly loads and prunes tiles reuses the same few slabs instead of fragmenting the
+/// heap.
+///
+/// allocate() and deallocate() may be called concurrently from any thread. Both operate on a
+/// lock-free free list, only adding a new slab when the free list is empty takes a mutex.
+/// All blocks must have been returned to the pool before it is destroyed.
+class FixedSizePool : private boost::noncopyable {
+ public:
+  /// Upper limit for the number of slabs a single pool can manage.
+  static std::size_t const sMaxSlabs = 8192;
+
+  /// Creates a pool for blocks of blockSize bytes, memory is requested in slabs of blocksPerSlab
+  /// blocks.
+  explicit FixedSizePool(std::size_t blockSize, std::size_t blocksPerSlab);
+  ~FixedSizePool();
+
+  /// Returns a block of getBlockSize() bytes. Throws std::bad_alloc if no memory is available.
+  void* allocate();
+
+  /// Returns a block previously obtained from allocate() of this pool.
+  void deallocate(void* ptr);
+
+  std::size_t getBlockSize() const;
+  std::size_t getBlocksPerSlab() const;
+
+  /// Number of slabs allocated so far.
+  std::size_t getNumSlabs() const;
+
+  /// Number of blocks currently handed out.
+  std::size_t getNumAllocated() const;
+
+  /// Number of bytes requested from the system for all slabs.
+  std::size_t getReservedBytes() const;
+
+ private:
+  /// Stored in front of each block. Holds the index of the block and, while the block is on the
+  /// free list, the index of the next free block.
+  struct alignas(std::max_align_t) BlockHeader {
+    std::uint32_t              mIndex;
+    std::atomic<std::uint32_t> mNext;
+  };
+
+  static std::uint32_t const sInvalidIndex = 0xFFFFFFFF;
+
+  BlockHeader* getHeader(std::uint32_t index) const;
+
+  /// Pushes the chain of free blocks first..last onto the free list.
+  void pushChain(BlockHeader* first, BlockHeader* last);
+
+  /// Allocates a new slab and returns its first block, the others are pushed to the free list.
+  BlockHeader* grow();
+
+  std::size_t const mBlockSize;
+  std::size_t const mBlockStride;
+  std::size_t const mBlocksPerSlab;
+
+  /// The head of the free list. The lower 32 bits hold the index of the first free block, the
+  /// upper 32 bits a counter which is incremented on each modification to avoid the ABA problem.
+  std::atomic<std::uint64_t> mFreeHead;
+
+  std::array<std::atomic<char*>, sMaxSlabs> mSlabs;
+  std::atomic<std::size_t>                  mNumSlabs;
+  std::atomic<std::size_t>                  mNumAllocated;
+  std::mutex                                mGrowMutex;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_FIXEDSIZEPOOL_HPP
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "FrameBudget.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// Weight of the last frame in the averaged stage durations. Smaller values react slower to changes
+// but are less affected by single slow frames.
+double const StageTimeWeight = 0.1;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameBudget::setBudget(double milliseconds) {
+  mBudget = milliseconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double FrameBudget::getBudget() const {
+  return mBudget;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameBudget::beginFrame(Clock::time_point now) {
+  mFrameStart = now;
+  mStageStart = now;
+
+  // the deadline is computed once the deferrable stage starts
+  mDeadline = Clock::time_point::max();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameBudget::endStage(Stage stage, Clock::time_point now) {
+  double const duration = std::chrono::duration<double, std::milli>(now - mStageStart).count();
+  double&      average  = mStageTimes.at(static_cast<std::size_t>(stage));
+
+  average += StageTimeWeight * (duration - average);
+
+  mStageStart = now;
+
+  auto const next = static_cast<std::size_t>(stage) + 1;
+
+  if (next < mStageTimes.size() && isDeferrable(static_cast<Stage>(next))) {
+    updateDeadline(static_cast<Stage>(next), now);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double FrameBudget::getStageTime(Stage stage) const {
+  return mStageTimes.at(static_cast<std::size_t>(stage));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameBudget::Clock::time_point FrameBudget::getDeadline() const {
+  return mDeadline;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool FrameBudget::isDeferrable(Stage stage) {
+  return stage == Stage::eUpdate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameBudget::updateDeadline(Stage stage, Clock::time_point now) {
+  if (mBudget <= 0.0) {
+    mDeadline = Clock::time_point::max();
+    return;
+  }
+
+  // The stages before this one have already been measured in this frame, only the expected
+  // durations of the following ones have to be reserved.
+  double reserved = std::chrono::duration<double, std::milli>(now - mFrameStart).count();
+
+  for (auto i = static_cast<std::size_t>(stage) + 1; i < mStageTimes.size(); ++i) {
+    if (!isDeferrable(static_cast<Stage>(i))) {
+      reserved += mStageTimes.at(i);
+    }
+  }
+
+  // If the other stages take longer than the budget, the deadline is already over and only the
+  // minimum amount of deferrable work is done.
+  double const available = std::max(0.0, mBudget - reserved);
+
+  mDeadline = now + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::milli>(available));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_FRAMEBUDGET_HPP
+#define CSP_LOD_BODIES_FRAMEBUDGET_HPP
+
+#include <array>
+#include <chrono>
+
+namespace csp::lodbodies {
+
+/// Measures the stages of VistaPlanet::doFrame and decides how much time is left for the work
+/// which can be deferred to later frames, i.e. merging loaded tiles into the trees and uploading
+/// them to the GPU.
+///
+/// The duration of each stage is averaged over several frames. When the deferrable stage starts,
+/// the time which already passed in this frame and the expected durations of the stages which still
+/// follow are subtracted from the budget, the rest is available until getDeadline(). A budget of
+/// zero disables the limit.
+class FrameBudget {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Stage { eBounds = 0, eUpdate, eTraverse, eRequest, eRender, eCount };
+
+  /// Sets the time in milliseconds all stages together should take per frame.
+  void   setBudget(double milliseconds);
+  double getBudget() const;
+
+  /// Starts a new frame at the given time. The first stage starts at the same time.
+  void beginFrame(Clock::time_point now = Clock::now());
+
+  /// Ends the current stage at the given time. The next stage starts at the same time. If it is the
+  /// deferrable one, the deadline for this frame is computed.
+  void endStage(Stage stage, Clock::time_point now = Clock::now());
+
+  /// Returns the averaged duration of stage in milliseconds.
+  double getStageTime(Stage stage) const;
+
+  /// Returns the point in time until which deferrable work may be done in the current frame.
+  Clock::time_point getDeadline() const;
+
+ private:
+  using StageTimes = std::array<double, static_cast<std::size_t>(Stage::eCount)>;
+
+  static bool isDeferrable(Stage stage);
+
+  /// Computes the deadline when the deferrable stage starts at now.
+  void updateDeadline(Stage stage, Clock::time_point now);
+
+  double            mBudget = 0.0;
+  StageTimes        mStageTimes{};
+  Clock::time_point mFrameStart;
+  Clock::time_point mStageStart;
+  Clock::time_point mDeadline = Clock::time_point::max();
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_FRAMEBUDGET_HPP
@@ -0,0 +1,302 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HorizonMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// The azimuths are pseudo angles in [0, 4), see HorizonMap::getAzimuth().
+double const BinSize = 4.0 / 256.0;
+
+// The smallest angle in radians covered by a bin. Towards the diagonals the pseudo angle changes
+// more slowly than the angle.
+double const MinBinAngle = BinSize;
+
+// Wraps a difference of pseudo angles to [-2, 2].
+double wrapAzimuth(double azimuth) {
+  if (azimuth > 2.0) {
+    return azimuth - 4.0;
+  }
+
+  if (azimuth < -2.0) {
+    return azimuth + 4.0;
+  }
+
+  return azimuth;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+HorizonMap::HorizonMap()
+    : mElevations(sAzimuthBins * sDistanceBands, std::numeric_limits<float>::lowest()) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HorizonMap::reset(glm::dvec3 const& camPos, double radius) {
+  mCamPos = camPos;
+  mRadius = radius;
+  mEmpty  = true;
+  mUp     = glm::normalize(camPos);
+
+  glm::dvec3 const reference =
+      std::abs(mUp.y) < 0.9 ? glm::dvec3(0.0, 1.0, 0.0) : glm::dvec3(1.0, 0.0, 0.0);
+  mEast  = glm::normalize(glm::cross(reference, mUp));
+  mNorth = glm::cross(mUp, mEast);
+
+  std::fill(mElevations.begin(), mElevations.end(), std::numeric_limits<float>::lowest());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HorizonMap::addOccluder(OccluderCell const& cell) {
+  glm::dvec3 const v          = cell.mCenter - mCamPos;
+  double const     height     = glm::dot(v, mUp);
+  double const     horizontal = glm::length(v - height * mUp);
+
+  // Cells below the camera cover too many directions to be of any use, cells far away are too
+  // small to cover a whole bin.
+  if (horizontal <= cell.mRadius || 2.0 * cell.mRadius < MinBinAngle * horizontal) {
+    return;
+  }
+
+  // The cell only hides tiles which are farther away than all of its points.
+  int const band = std::max(0, getBand(horizontal + cell.mRadius, true));
+
+  if (band >= sDistanceBands) {
+    return;
+  }
+
+  // The sine of the lowest elevation angle of all points within the radius of the cell's center.
+  // It is the elevation of the center minus the angular radius of the cell.
+  double const dist      = glm::length(v);
+  double const radiusSin = cell.mRadius / dist;
+  double const radiusCos = std::sqrt(1.0 - radiusSin * radiusSin);
+  auto const   sine      = static_cast<float>((height * radiusCos - horizontal * radiusSin) / dist);
+
+  // If the cell extends below the nadir of the camera, the sine does not grow with the angle.
+  if (horizontal * radiusCos + height * radiusSin < 0.0) {
+    return;
+  }
+
+  // The surface of the cell connects its corners, hence it covers all azimuths between them.
+  double const first  = getAzimuth(cell.mCorners[0] - mCamPos);
+  double       minAzi = 0.0;
+  double       maxAzi = 0.0;
+
+  for (std::size_t i = 1; i < cell.mCorners.size(); ++i) {
+    double const azimuth = wrapAzimuth(getAzimuth(cell.mCorners.at(i) - mCamPos) - first);
+    minAzi               = std::min(minAzi, azimuth);
+    maxAzi               = std::max(maxAzi, azimuth);
+  }
+
+  auto const begin = static_cast<int>(std::ceil((first + minAzi) / BinSize));
+  auto const end   = static_cast<int>(std::floor((first + maxAzi) / BinSize));
+
+  for (int bin = begin; bin < end; ++bin) {
+    int const idx    = ((bin % sAzimuthBins) + sAzimuthBins) % sAzimuthBins;
+    float&    stored = mElevations.at(idx * sDistanceBands + band);
+    stored           = std::max(stored, sine);
+    mEmpty           = false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HorizonMap::testUseful(OccluderCell const& cell) const {
+  glm::dvec3 const v          = cell.mCenter - mCamPos;
+  double const     horizontal = glm::length(v - glm::dot(v, mUp) * mUp);
+
+  return horizontal > 0.8 * cell.mRadius && 2.5 * cell.mRadius >= MinBinAngle * horizontal;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void HorizonMap::finish() {
+  // Occluders closer than a distance band also hide everything in the farther bands.
+  for (int bin = 0; bin < sAzimuthBins; ++bin) {
+    for (int band = 1; band < sDistanceBands; ++band) {
+      float& sine = mElevations.at(bin * sDistanceBands + band);
+      sine        = std::max(sine, mElevations.at(bin * sDistanceBands + band - 1));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HorizonMap::isEmpty() const {
+  return mEmpty;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HorizonMap::testOccluded(OrientedTileBounds const& bounds) const {
+  if (mEmpty) {
+    return false;
+  }
+
+  std::array<glm::dvec3, 8> corners{};
+
+  for (unsigned corner = 0; corner < 8; ++corner) {
+    corners.at(corner) = bounds.mCenter;
+
+    for (unsigned axis = 0; axis < 3; ++axis) {
+      corners.at(corner) +=
+          (corner & (1U << axis)) ? bounds.mHalfAxes.at(axis) : -bounds.mHalfAxes.at(axis);
+    }
+  }
+
+  return testOccluded(corners);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HorizonMap::testOccluded(BoundingBox<double> const& bounds) const {
+  if (mEmpty) {
+    return false;
+  }
+
+  glm::dvec3 const& bbMin = bounds.getMin();
+  glm::dvec3 const& bbMax = bounds.getMax();
+
+  std::array<glm::dvec3, 8> corners{};
+
+  for (unsigned corner = 0; corner < 8; ++corner) {
+    corners.at(corner) = glm::dvec3((corner & 1U) ? bbMax.x : bbMin.x,
+        (corner & 2U) ? bbMax.y : bbMin.y, (corner & 4U) ? bbMax.z : bbMin.z);
+  }
+
+  return testOccluded(corners);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool HorizonMap::testOccluded(std::array<glm::dvec3, 8> const& corners) const {
+  glm::dvec3 center(0.0);
+
+  for (auto const& corner : corners) {
+    center += 0.125 * corner;
+  }
+
+  double radius = 0.0;
+
+  for (auto const& corner : corners) {
+    radius = std::max(radius, glm::length(corner - center));
+  }
+
+  glm::dvec3 const v    = center - mCamPos;
+  double const     dist = glm::length(v);
+
+  if (dist <= radius) {
+    return false;
+  }
+
+  glm::dvec3 const horizontal = v - glm::dot(v, mUp) * mUp;
+  double const     first      = getAzimuth(corners[0] - mCamPos);
+  double           minAzi     = 0.0;
+  double           maxAzi     = 0.0;
+  double           maxSin     = -1.0;
+  double           hRadius    = 0.0;
+
+  for (auto const& corner : corners) {
+    glm::dvec3 const c = corner - mCamPos;
+    double const     h = glm::dot(c, mUp);
+
+    hRadius = std::max(hRadius, glm::length(c - h * mUp - horizontal));
+    maxSin  = std::max(maxSin, h / glm::length(c));
+
+    double const azimuth = wrapAzimuth(getAzimuth(c) - first);
+    minAzi               = std::min(minAzi, azimuth);
+    maxAzi               = std::max(maxAzi, azimuth);
+  }
+
+  // Only occluders which are closer than all points of the bounds may hide them.
+  double const minHorizontal = glm::length(horizontal) - hRadius;
+
+  if (minHorizontal <= 0.0) {
+    return false;
+  }
+
+  int const band = std::min(sDistanceBands - 1, getBand(minHorizontal, false));
+
+  if (band < 0) {
+    return false;
+  }
+
+  // Directions below the horizontal plane with an elevation angle below a negative value form a
+  // convex cone, hence the highest direction to the bounds is one of the corners. Above the plane,
+  // an edge of the bounds may rise above its corners. Its highest point is at most the angular
+  // diameter of the bounds away from the corners, which limits how much higher it can be.
+  if (maxSin > 0.0) {
+    // The cosine of the angular diameter of the bounds.
+    double const diameterCos = 1.0 - 2.0 * (radius / dist) * (radius / dist);
+
+    if (diameterCos <= 0.0) {
+      return false;
+    }
+
+    maxSin /= diameterCos;
+  }
+
+  auto const begin = static_cast<int>(std::floor((first + minAzi) / BinSize));
+  auto const end   = static_cast<int>(std::floor((first + maxAzi) / BinSize));
+
+  for (int bin = begin; bin <= end; ++bin) {
+    int const idx = ((bin % sAzimuthBins) + sAzimuthBins) % sAzimuthBins;
+
+    if (maxSin >= mElevations.at(idx * sDistanceBands + band)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double HorizonMap::getAzimuth(glm::dvec3 const& v) const {
+  double const x   = glm::dot(v, mEast);
+  double const y   = glm::dot(v, mNorth);
+  double const sum = std::abs(x) + std::abs(y);
+
+  if (sum == 0.0) {
+    return 0.0;
+  }
+
+  // Increases monotonically with the angle from 0 at mEast over 1 at mNorth to 4 at mEast again.
+  double const azimuth = y / sum;
+
+  if (x < 0.0) {
+    return 2.0 - azimuth;
+  }
+
+  return azimuth < 0.0 ? azimuth + 4.0 : azimuth;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int HorizonMap::getBand(double distance, bool roundUp) const {
+  // The upper limit of band i is mRadius * 2^((i - sDistanceBands + 1) / 2).
+  double const band = 2.0 * std::log2(distance / mRadius) + sDistanceBands - 1;
+
+  if (!std::isfinite(band)) {
+    return band > 0.0 ? sDistanceBands : -1;
+  }
+
+  return static_cast<int>(roundUp ? std::ceil(band) : std::floor(band));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
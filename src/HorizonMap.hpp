@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_HORIZONMAP_HPP
+#define CSP_LOD_BODIES_HORIZONMAP_HPP
+
+#include "BoundingBox.hpp"
+#include "TileBounds.hpp"
+
+#include <array>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// A conservative horizon of the terrain around the camera used to cull tiles which are hidden
+/// behind mountains or inside craters and canyons.
+///
+/// The directions around the camera are divided into azimuth bins, measured in the plane
+/// perpendicular to the line from the planet's center to the camera. For each bin and each of a
+/// number of increasing distances from the camera, the map stores the sine of the elevation angle
+/// below which the view is blocked by terrain closer than this distance. The terrain is given as
+/// OccluderCells, whose surface is never above the actual terrain. A cell only contributes to the
+/// bins it covers completely and only with the lowest elevation angle of its surface, so a tile is
+/// only reported as occluded if every ray from the camera to it passes below the terrain before
+/// reaching it.
+///
+/// No trigonometric functions are evaluated, as the map is built from thousands of cells each
+/// frame. The azimuths are pseudo angles and the elevations are stored as sines.
+class HorizonMap {
+ public:
+  HorizonMap();
+
+  /// Removes all occluders and sets the camera position for the following calls. The distances
+  /// stored for each azimuth bin are relative to the given radius of the planet.
+  void reset(glm::dvec3 const& camPos, double radius);
+
+  /// Adds the cell to all azimuth bins it covers completely.
+  void addOccluder(OccluderCell const& cell);
+
+  /// Returns false if the cell is too small to cover an azimuth bin or contains the camera's nadir.
+  /// This is checked with some margin, so that cells which pass may still be added to the map of a
+  /// slightly different camera position.
+  bool testUseful(OccluderCell const& cell) const;
+
+  /// Must be called after all occluders have been added and before testing bounds.
+  void finish();
+
+  /// Returns whether any occluder has been added since the last reset().
+  bool isEmpty() const;
+
+  /// Returns whether the given bounds are completely hidden by the occluders.
+  bool testOccluded(OrientedTileBounds const& bounds) const;
+  bool testOccluded(BoundingBox<double> const& bounds) const;
+
+ private:
+  static int const sAzimuthBins   = 256;
+  static int const sDistanceBands = 48;
+
+  bool testOccluded(std::array<glm::dvec3, 8> const& corners) const;
+
+  /// Returns a pseudo angle in [0, 4) which increases monotonically with the azimuth of v.
+  double getAzimuth(glm::dvec3 const& v) const;
+
+  /// Returns the index of the distance band whose upper limit is closest to distance. If roundUp is
+  /// true, the limit is at least distance, otherwise it is at most distance.
+  int getBand(double distance, bool roundUp) const;
+
+  glm::dvec3 mCamPos{};
+  glm::dvec3 mUp{};
+  glm::dvec3 mEast{};
+  glm::dvec3 mNorth{};
+  double     mRadius{};
+  bool       mEmpty{true};
+
+  // The sines of the elevation angles of all distance bands of the first azimuth bin, followed by
+  // those of the second bin and so on.
+  std::vector<float> mElevations;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_HORIZONMAP_HPP
@@ -6,6 +6,7 @@
 
 #include "LODVisitor.hpp"
 
+#include "Culling.hpp"
 #include "PlanetParameters.hpp"
 #include "RenderDataDEM.hpp"
 #include "RenderDataImg.hpp"
@@ -14,6 +15,11 @@
 #include "logger.hpp"
 
 #include <VistaBase/VistaStreamUtils.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 
 namespace csp::lodbodies {
@@ -27,120 +33,17 @@ namespace {
 // re-allocations.
 std::size_t const PreAllocSize = 200;
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-// Returns if the tile bounds @a tb intersect the @a frustum.
-// For each plane of the @a frustum determine if any corner of the
-// bounding box is inside the plane's halfspace. If all corners are
-// outside one halfspace the bounding box is outside the frustum
-// and the algorithm stops early.
-// TODO There is potential for optimization here, the paper
-// "Optimized View Frustum Culling - Algorithms for Bounding Boxes"
-// http://www.cse.chalmers.se/~uffe/vfc_bbox.pdf
-// contains ideas (for example how to avoid testing all 8 corners).
-bool testInFrustum(Frustum const& frustum, BoundingBox<double> const& tb) {
-  bool result = true;
-
-  glm::dvec3 const& tbMin = tb.getMin();
-  glm::dvec3 const& tbMax = tb.getMax();
-
-  // 8 corners of tile's bounding box
-  std::array<glm::dvec3, 8> tbPnts = {
-      {glm::dvec3(tbMin[0], tbMin[1], tbMin[2]), glm::dvec3(tbMax[0], tbMin[1], tbMin[2]),
-          glm::dvec3(tbMax[0], tbMin[1], tbMax[2]), glm::dvec3(tbMin[0], tbMin[1], tbMax[2]),
-
-          glm::dvec3(tbMin[0], tbMax[1], tbMin[2]), glm::dvec3(tbMax[0], tbMax[1], tbMin[2]),
-          glm::dvec3(tbMax[0], tbMax[1], tbMax[2]), glm::dvec3(tbMin[0], tbMax[1], tbMax[2])}};
-
-  // loop over planes of frustum
-  auto pIt  = frustum.getPlanes().begin();
-  auto pEnd = frustum.getPlanes().end();
-
-  for (std::size_t i = 0; pIt != pEnd; ++pIt, ++i) {
-    glm::dvec3 const normal(*pIt);
-    double const     d       = -(*pIt)[3];
-    bool             outside = true;
-
-    // test if any BB corner is inside the halfspace defined
-    // by the current plane
-    for (auto const& tbPnt : tbPnts) {
-      if (glm::dot(normal, tbPnt) >= d) {
-        // corner j is inside - stop testing
-        outside = false;
-        break;
-      }
-    }
-
-    // if all corners are outside the halfspace, the bounding box
-    // is outside - stop testing
-    if (outside) {
-      result = false;
-      break;
-    }
-  }
-
-  return result;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-// Returns true if one the eight tile bbox corner points is not occluded by a proxy sphere.
-// Culls tiles behind the horizon.
-bool testFrontFacing(glm::dvec3 const& camPos, PlanetParameters const* params,
-    BoundingBox<double> const& tb, TreeManagerBase* treeMgrDEM) {
-  assert(treeMgrDEM != nullptr);
-
-  // Get minimum height of all base patches (needed for radius of proxy culling sphere)
-  auto minHeight(std::numeric_limits<float>::max());
-  for (int i(0); i < TileQuadTree::sNumRoots; ++i) {
-    auto*       tile       = treeMgrDEM->getTree()->getRoot(i)->getTile();
-    auto const& castedTile = dynamic_cast<Tile<float> const&>(*tile);
-    minHeight              = std::min(minHeight, castedTile.getMinMaxPyramid()->getMin());
-  }
-
-  double dScaledPolarRadius = params->mPolarRadius + (minHeight * params->mHeightScale);
-  double dProxyRadius =
-      std::min(dScaledPolarRadius, params->mEquatorialRadius + (minHeight * params->mHeightScale));
+// If temporal coherence is enabled, all refinement decisions are discarded once the camera moved
+// further than this fraction of its altitude since the decisions were made.
+double const CoherenceThreshold = 0.1;
 
-  glm::dvec3 const& tbMin = tb.getMin();
-  glm::dvec3 const& tbMax = tb.getMax();
+// A reused refinement decision is only valid as long as the camera moved less than this fraction
+// of its distance to the tile.
+double const CoherenceMaxMove = 0.1;
 
-  // 8 corners of tile's bounding box
-  std::array<glm::dvec3, 8> tbPnts = {
-      {glm::dvec3(tbMin[0], tbMin[1], tbMin[2]), glm::dvec3(tbMax[0], tbMin[1], tbMin[2]),
-          glm::dvec3(tbMax[0], tbMin[1], tbMax[2]), glm::dvec3(tbMin[0], tbMin[1], tbMax[2]),
-
-          glm::dvec3(tbMin[0], tbMax[1], tbMin[2]), glm::dvec3(tbMax[0], tbMax[1], tbMin[2]),
-          glm::dvec3(tbMax[0], tbMax[1], tbMax[2]), glm::dvec3(tbMin[0], tbMax[1], tbMax[2])}};
-
-  // Simple ray-sphere intersection test for every corner point
-  for (auto const& tbPnt : tbPnts) {
-    double     dRayLength = glm::length(tbPnt - camPos);
-    glm::dvec3 vRayDir    = (tbPnt - camPos) / dRayLength;
-    double     b          = glm::dot(camPos, vRayDir);
-    double     c          = glm::dot(camPos, camPos) - dProxyRadius * dProxyRadius;
-    double     fDet       = b * b - c;
-    // No intersection between corner and camera position: Tile visible!:
-    if (fDet < 0.0) {
-      return true;
-    }
-
-    fDet = std::sqrt(fDet);
-    // Both intersection points are behind the camera but tile is in front
-    // (presumes tiles to be frustum culled already!!!)
-    // E.g. While travelling in a deep crater and looking above
-    if ((-b - fDet) < 0.0 && (-b + fDet) < 0.0) {
-      return true;
-    }
-
-    // Tile in front of planet:
-    if (dRayLength < -b - fDet) {
-      return true;
-    }
-  }
-
-  return false;
-}
+// Each traversal starting from scratch gets a new generation, decisions of other generations are
+// ignored. This is global, as several LODVisitors may work on the same trees.
+std::atomic<int> nextCoherenceGeneration(0);
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -197,6 +100,51 @@ RenderDataDEM* findParentRData(TreeManagerBase* treeMgr, TileId tileId) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Returns the @c RenderDataDEM of tile @a tileId or of its closest parent which is marked as
+// @c RenderDataDEM::Flags::eRender, or nullptr if there is none.
+RenderDataDEM* findRenderedRData(TreeManagerBase* treeMgr, TileId tileId) {
+  while (true) {
+    auto* rdata = treeMgr->find<RenderDataDEM>(tileId);
+
+    if (rdata && rdata->testFlag(RenderDataDEM::Flags::eRender)) {
+      return rdata;
+    }
+
+    if (tileId.level() == 0) {
+      return nullptr;
+    }
+
+    tileId = HEALPix::getParentTileId(tileId);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the level at which the vertices of a tile are about one texel of the shadow map apart.
+// matLight transforms from model space to the clip space of an orthographic projection.
+int calcShadowLevel(
+    glm::dmat4 const& matLight, glm::ivec4 const& viewport, PlanetParameters const& params) {
+  // the size of a texel in model space along the x and y axes of the shadow map
+  double texelX = 2.0 / viewport.z /
+                  glm::length(glm::dvec3(matLight[0][0], matLight[1][0], matLight[2][0]));
+  double texelY = 2.0 / viewport.w /
+                  glm::length(glm::dvec3(matLight[0][1], matLight[1][1], matLight[2][1]));
+  double texel = std::min(texelX, texelY);
+
+  // the base patches are about sqrt(pi / 3) radians wide
+  double spacing = std::sqrt(glm::pi<double>() / 3.0) * params.mEquatorialRadius /
+                   (TileBase::SizeX - 1);
+
+  if (!(texel > 0.0)) {
+    return LODVisitor::sMaxDepth - 1;
+  }
+
+  return std::clamp(static_cast<int>(std::ceil(std::log2(spacing / texel))), 0,
+      LODVisitor::sMaxDepth - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -215,25 +163,34 @@ LODVisitor::LODVisitor(
     , mLodData()
     , mCullData()
     , mStackTop(-1)
+    , mPlaneHint(0)
     , mFrameCount(0)
     , mUpdateLOD(true)
-    , mUpdateCulling(true) {
+    , mUpdateCulling(true)
+    , mTemporalCoherence(true)
+    , mOrientedBounds(true)
+    , mGeometricLod(true)
+    , mOcclusionCulling(false)
+    , mLoadAheadLevels(3)
+    , mNumRefineTests(0)
+    , mNumThreads(1) {
   setTreeManagerDEM(treeMgrDEM);
   setTreeManagerIMG(treeMgrIMG);
-
-  mStack.resize(sMaxStackDepth);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void LODVisitor::setTreeManagerDEM(TreeManagerBase* treeMgr) {
+  // the tiles of the OLD tree manager may be removed after this
+  resetRenderLists();
+
   // unset tree from OLD tree manager
   if (mTreeMgrDEM) {
     setTreeDEM(nullptr);
   }
 
-  mStack.clear();
-  mStack.resize(sMaxStackDepth);
+  mStack.fill(LODState());
+  mOccluders.clear();
 
   mTreeMgrDEM = treeMgr;
 
@@ -248,6 +205,9 @@ void LODVisitor::setTreeManagerDEM(TreeManagerBase* treeMgr) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void LODVisitor::setTreeManagerIMG(TreeManagerBase* treeMgr) {
+  // the tiles of the OLD tree manager may be removed after this
+  resetRenderLists();
+
   // unset tree from OLD tree manager
   if (mTreeMgrIMG) {
     setTreeIMG(nullptr);
@@ -265,6 +225,41 @@ void LODVisitor::setTreeManagerIMG(TreeManagerBase* treeMgr) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LODVisitor::updateCoherenceData() {
+  CoherenceData& data = mCoherenceData;
+
+  // Decisions are not reused while LOD or culling updates are disabled, as they would be made for
+  // an outdated camera.
+  if (!mTemporalCoherence || !mUpdateLOD || !mUpdateCulling) {
+    data.mGeneration = -1;
+    return;
+  }
+
+  double const fov =
+      std::max(mLodData.mFrustumES.getHorizontalFOV(), mLodData.mFrustumES.getVerticalFOV());
+  double const altitude = glm::length(mCullData.mCamPos) -
+                          std::min(mParams->mEquatorialRadius, mParams->mPolarRadius);
+
+  data.mDistance = glm::length(mCullData.mCamPos - data.mRefCamPos);
+
+  // The view direction does not matter, as the solid angle of a tile only depends on the camera
+  // position. Culling is done each frame anyways.
+  bool const outdated = data.mGeneration < 0 || data.mDistance > CoherenceThreshold * altitude ||
+                        data.mFov != fov || data.mLodFactor != mParams->mLodFactor ||
+                        data.mHeightScale != mParams->mHeightScale;
+
+  if (outdated) {
+    data.mGeneration  = nextCoherenceGeneration++;
+    data.mRefCamPos   = mCullData.mCamPos;
+    data.mDistance    = 0.0;
+    data.mFov         = fov;
+    data.mLodFactor   = mParams->mLodFactor;
+    data.mHeightScale = mParams->mHeightScale;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool LODVisitor::preTraverse() {
   bool result = true;
 
@@ -281,13 +276,26 @@ bool LODVisitor::preTraverse() {
     mCullData.mMatN   = glm::inverseTranspose(glm::f64mat3x3(mMatVM));
     auto v4CamPos     = glm::inverse(mMatVM)[3];
     mCullData.mCamPos = glm::dvec3(v4CamPos[0], v4CamPos[1], v4CamPos[2]);
+
+    mHorizonMap.reset(
+        mCullData.mCamPos, std::max(mParams->mEquatorialRadius, mParams->mPolarRadius));
+
+    if (mOcclusionCulling) {
+      for (auto const& cell : mOccluders) {
+        mHorizonMap.addOccluder(cell);
+      }
+    }
+
+    mHorizonMap.finish();
   }
 
+  updateCoherenceData();
+  mNumRefineTests = 0;
+
   // clear load/render lists
   mLoadDEM.clear();
   mLoadIMG.clear();
-  mRenderDEM.clear();
-  mRenderIMG.clear();
+  resetRenderLists();
   mStackTop = -1;
 
   // make sure root nodes are present
@@ -307,12 +315,149 @@ bool LODVisitor::preTraverse() {
     }
   }
 
+  // Get minimum height of all base patches (needed for radius of proxy culling sphere)
+  if (result && mTreeDEM) {
+    auto minHeight(std::numeric_limits<float>::max());
+    for (int i(0); i < TileQuadTree::sNumRoots; ++i) {
+      auto*       tile       = mTreeDEM->getRoot(i)->getTile();
+      auto const& castedTile = dynamic_cast<Tile<float> const&>(*tile);
+      minHeight              = std::min(minHeight, castedTile.getMinMaxPyramid()->getMin());
+    }
+
+    double dScaledPolarRadius = mParams->mPolarRadius + (minHeight * mParams->mHeightScale);
+    mCullData.mProxyRadius    = std::min(
+        dScaledPolarRadius, mParams->mEquatorialRadius + (minHeight * mParams->mHeightScale));
+  }
+
   return result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LODVisitor::visitRoots() {
+  if (mNumThreads <= 1) {
+    TileVisitor<LODVisitor>::visitRoots();
+    return;
+  }
+
+  prepareWorkers();
+
+  // The roots are handed out one at a time, as their sub trees differ a lot in size depending on
+  // the view.
+  std::atomic<int> nextRoot(0);
+
+  auto traverse = [this, &nextRoot](LODVisitor* worker) {
+    for (int i = nextRoot++; i < TileQuadTree::sNumRoots; i = nextRoot++) {
+      worker->visitRoot(i);
+
+      // The lists of mRootLists are empty, so the worker starts the next root with empty lists.
+      RootLists& lists = mRootLists.at(i);
+      std::swap(lists.mLoadDEM, worker->mLoadDEM);
+      std::swap(lists.mLoadIMG, worker->mLoadIMG);
+      std::swap(lists.mRenderDEM, worker->mRenderDEM);
+      std::swap(lists.mRenderIMG, worker->mRenderIMG);
+    }
+  };
+
+  std::vector<std::future<void>> results;
+  results.reserve(mWorkers.size() - 1);
+
+  for (std::size_t i = 1; i < mWorkers.size(); ++i) {
+    LODVisitor* worker = mWorkers[i].get();
+    results.push_back(mThreadPool->enqueue([&traverse, worker]() { traverse(worker); }));
+  }
+
+  traverse(mWorkers[0].get());
+
+  for (auto& result : results) {
+    result.get();
+  }
+
+  for (auto const& worker : mWorkers) {
+    mNumRefineTests += worker->mNumRefineTests;
+  }
+
+  // Merge in root order, this gives the same lists a sequential traversal would produce.
+  for (auto& lists : mRootLists) {
+    mLoadDEM.insert(mLoadDEM.end(), lists.mLoadDEM.begin(), lists.mLoadDEM.end());
+    mLoadIMG.insert(mLoadIMG.end(), lists.mLoadIMG.begin(), lists.mLoadIMG.end());
+    mRenderDEM.insert(mRenderDEM.end(), lists.mRenderDEM.begin(), lists.mRenderDEM.end());
+    mRenderIMG.insert(mRenderIMG.end(), lists.mRenderIMG.begin(), lists.mRenderIMG.end());
+
+    lists.mLoadDEM.clear();
+    lists.mLoadIMG.clear();
+    lists.mRenderDEM.clear();
+    lists.mRenderIMG.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::prepareWorkers() {
+  while (mWorkers.size() < static_cast<std::size_t>(mNumThreads)) {
+    mWorkers.push_back(std::make_unique<LODVisitor>(*mParams));
+  }
+
+  // The workers only read the trees and the per-frame data. Each of them writes to the RenderData
+  // of the nodes of the roots it traverses only.
+  for (auto& worker : mWorkers) {
+    worker->mParams     = mParams;
+    worker->mTreeMgrDEM = mTreeMgrDEM;
+    worker->mTreeMgrIMG = mTreeMgrIMG;
+    worker->mTreeDEM    = mTreeDEM;
+    worker->mTreeIMG    = mTreeIMG;
+    worker->mLodData    = mLodData;
+    worker->mCullData   = mCullData;
+    worker->mFrameCount = mFrameCount;
+    worker->mStackTop   = -1;
+
+    worker->mOrientedBounds  = mOrientedBounds;
+    worker->mGeometricLod    = mGeometricLod;
+    worker->mLoadAheadLevels = mLoadAheadLevels;
+    worker->mHorizonMap      = mHorizonMap;
+
+    worker->mCoherenceData  = mCoherenceData;
+    worker->mNumRefineTests = 0;
+
+    worker->mLoadDEM.clear();
+    worker->mLoadIMG.clear();
+    worker->mRenderDEM.clear();
+    worker->mRenderIMG.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void LODVisitor::postTraverse() {
+  // Request coarse tiles first, so that the tiles requested in advance (see addLoadAhead) usually
+  // arrive after their ancestors. The sort is stable to keep the lists of sequential and parallel
+  // traversals identical.
+  auto const levelLess = [](TileId const& lhs, TileId const& rhs) {
+    return lhs.level() < rhs.level();
+  };
+
+  std::stable_sort(mLoadDEM.begin(), mLoadDEM.end(), levelLess);
+  std::stable_sort(mLoadIMG.begin(), mLoadIMG.end(), levelLess);
+
+  // Remember the occluders of the drawn elevation tiles for the next frame. Consecutive entries may
+  // refer to the same elevation tile if it is drawn with several image tiles. Skipping occluders
+  // is always safe, so the ones which are too small to matter are not copied.
+  if (mUpdateCulling) {
+    mOccluders.clear();
+  }
+
+  if (mUpdateCulling && mOcclusionCulling) {
+    for (std::size_t i = 0; i < mRenderDEM.size(); ++i) {
+      if (i == 0 || mRenderDEM.at(i) != mRenderDEM.at(i - 1)) {
+        for (auto const& cell : dynamic_cast<RenderDataDEM*>(mRenderDEM.at(i))->getOccluders()) {
+          if (mHorizonMap.testUseful(cell)) {
+            mOccluders.push_back(cell);
+          }
+        }
+      }
+    }
+  }
+
   // Determine edges with LOD change
   // For each edge the level difference is stored and the RenderDataDEM
   // object for the neighbour. If the level of the neighbour is lower,
@@ -372,9 +517,11 @@ bool LODVisitor::preVisitRoot(TileId const& tileId) {
 
   // track highest resolution nodes in this sub tree (in case there is
   // higher resolution image data than DEM data).
-  state.mLastDEM  = nullptr;
-  state.mLastIMG  = nullptr;
-  state.mMaxLevel = 0;
+  state.mLastDEM        = nullptr;
+  state.mLastIMG        = nullptr;
+  state.mMaxLevel       = 0;
+  state.mMaxLevelDEM    = 0;
+  state.mChildrenCulled = false;
 
   // fetch RenderDataDEM for visited node and mark as used in this frame
   if (mTreeMgrDEM && state.mNodeDEM) {
@@ -413,9 +560,11 @@ bool LODVisitor::preVisit(TileId const& tileId) {
   // track highest resolution nodes that can not be refined further (e.g.
   // because not all 4 children are loaded) - these are NULL if parent nodes
   // so far can all be refined
-  state.mLastDEM  = stateP.mLastDEM;
-  state.mLastIMG  = stateP.mLastIMG;
-  state.mMaxLevel = stateP.mMaxLevel;
+  state.mLastDEM        = stateP.mLastDEM;
+  state.mLastIMG        = stateP.mLastIMG;
+  state.mMaxLevel       = stateP.mMaxLevel;
+  state.mMaxLevelDEM    = stateP.mMaxLevelDEM;
+  state.mChildrenCulled = false;
 
   // fetch RenderDataDEM for visited node and mark as used in this frame
   if (mTreeMgrDEM && !state.mLastDEM && state.mNodeDEM) {
@@ -463,8 +612,9 @@ bool LODVisitor::visitNode(TileId const& tileId) {
   //      Else:
   //          draw this level
 
-  bool result  = false;
-  bool visible = testVisible(tileId, mTreeMgrDEM);
+  bool      result  = false;
+  bool      visible = testVisible(tileId, mTreeMgrDEM);
+  LODState& state   = getLODState();
 
   if (visible) {
     // should this node be refined to achieve desired resolution?
@@ -472,6 +622,11 @@ bool LODVisitor::visitNode(TileId const& tileId) {
 
     if (needRefine) {
       result = handleRefine(tileId);
+
+      // If all DEM children are available, they are culled together before visiting them.
+      if (result && mTreeMgrDEM && state.mNodeDEM && !state.mLastDEM) {
+        cullChildren();
+      }
     } else {
       // resolution is sufficient
       drawLevel();
@@ -496,10 +651,14 @@ bool LODVisitor::handleRefine(TileId const& /*tileId*/) {
   if (mTreeMgrDEM != nullptr && mTreeMgrIMG != nullptr) {
     // DEM and IMG data
 
-    // request to load missing children
+    // request to load missing children, elevation data is only loaded if the geometric error of
+    // this node requires it
     if (!childrenDemAvailable) {
       state.mLastDEM = state.mLastDEM ? state.mLastDEM : state.mNodeDEM;
-      addLoadChildrenDEM(nodeDEM);
+
+      if (state.mRefineDEM) {
+        addLoadChildrenDEM(nodeDEM);
+      }
     }
 
     if (!childrenImgAvailable) {
@@ -549,6 +708,9 @@ void LODVisitor::addLoadChildrenDEM(TileNode* node) {
         rd->setLastFrame(mFrameCount);
       }
     }
+
+    // the elevation data is requested down to the level required by its own error only
+    addLoadAhead(node, getLODState().mMaxLevelDEM, mTreeMgrDEM, mLoadDEM);
   }
 }
 
@@ -568,12 +730,117 @@ void LODVisitor::addLoadChildrenIMG(TileNode* node) {
         rd->setLastFrame(mFrameCount);
       }
     }
+
+    addLoadAhead(node, getLODState().mMaxLevel, mTreeMgrIMG, mLoadIMG);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::addLoadAhead(TileNode* node, int targetLevel, TreeManagerBase* treeMgr,
+    std::vector<TileId>& loadList) {
+  // The chain ends at the level estimated by testNeedRefine(), but never below the deepest level
+  // of the data set.
+  int const maxLevel = std::min({targetLevel, node->getChildMaxLevel(),
+      node->getLevel() + 1 + mLoadAheadLevels});
+
+  TileId    tileId  = node->getTileId();
+  TileNode* current = node;
+
+  // Follow the children closest to the camera and request all four children of each of them, as
+  // a tile can only be refined if all of its children are available.
+  while (tileId.level() + 1 < maxLevel) {
+    int    closest = 0;
+    double minDist = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < 4; ++i) {
+      glm::dvec3 const center = HEALPix::getCenterCartesian(HEALPix::getChildTileId(tileId, i),
+          mParams->mEquatorialRadius, mParams->mPolarRadius);
+      double const     dist   = glm::length(center - mCullData.mCamPos);
+
+      if (dist < minDist) {
+        closest = i;
+        minDist = dist;
+      }
+    }
+
+    tileId  = HEALPix::getChildTileId(tileId, closest);
+    current = current ? current->getChild(closest) : nullptr;
+
+    for (int i = 0; i < 4; ++i) {
+      TileNode* child = current ? current->getChild(i) : nullptr;
+
+      if (!child) {
+        loadList.push_back(HEALPix::getChildTileId(tileId, i));
+      } else {
+        // mark child as used to avoid it being removed before its ancestors can be refined
+        treeMgr->findRData(child)->setLastFrame(mFrameCount);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::cullChildren() {
+  LODState& state = getLODState();
+
+  std::array<RenderDataDEM const*, BoxBatch::sSize> children{};
+
+  for (int i = 0; i < BoxBatch::sSize; ++i) {
+    children.at(i) = mTreeMgrDEM->find<RenderDataDEM>(state.mNodeDEM->getChild(i));
+  }
+
+  // The axis aligned boxes have their own batch type, as their tests are considerably cheaper.
+  unsigned visible = 0;
+
+  if (mOrientedBounds) {
+    OrientedBoxBatch boxes;
+
+    for (int i = 0; i < OrientedBoxBatch::sSize; ++i) {
+      boxes.set(i, children.at(i)->getOrientedBounds());
+    }
+
+    visible = testInFrustum(mCullData.mFrustumMS, boxes, 0xFU, mPlaneHint);
+    visible = testAboveHorizon(mCullData.mCamPos, mCullData.mProxyRadius, boxes, visible);
+  } else {
+    BoxBatch boxes;
+
+    for (int i = 0; i < BoxBatch::sSize; ++i) {
+      boxes.set(i, children.at(i)->getBounds());
+    }
+
+    visible = testInFrustum(mCullData.mFrustumMS, boxes, 0xFU, mPlaneHint);
+    visible = testAboveHorizon(mCullData.mCamPos, mCullData.mProxyRadius, boxes, visible);
+  }
+
+  if (mOrientedBounds) {
+    for (int i = 0; i < BoxBatch::sSize; ++i) {
+      unsigned const bit = 1U << static_cast<unsigned>(i);
+
+      if ((visible & bit) != 0 &&
+          (testBackFacing(mCullData.mCamPos, children.at(i)->getOrientedBounds()) ||
+              mHorizonMap.testOccluded(children.at(i)->getOrientedBounds()))) {
+        visible &= ~bit;
+      }
+    }
+  } else if (!mHorizonMap.isEmpty()) {
+    for (int i = 0; i < BoxBatch::sSize; ++i) {
+      unsigned const bit = 1U << static_cast<unsigned>(i);
+
+      if ((visible & bit) != 0 && mHorizonMap.testOccluded(children.at(i)->getBounds())) {
+        visible &= ~bit;
+      }
+    }
   }
+
+  state.mChildrenCulled  = true;
+  state.mVisibleChildren = visible;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM) {
+bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* /*treeMgrDEM*/) {
   bool      result = false;
   LODState& state  = getLODState();
 
@@ -582,12 +849,24 @@ bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM)
     // DEM resolution is at least as high as IMG resolution.
     // Use the bounds of the DEM node to decide visibility.
 
-    BoundingBox<double> const& tb = state.mRdDEM->getBounds();
+    LODState const* stateP = tileId.level() > 0 ? &getLODState(tileId.level() - 1) : nullptr;
+
+    if (stateP && stateP->mChildrenCulled) {
+      // The parent already tested this node together with its siblings.
+      int const childIdx = HEALPix::getChildIdxAtLevel(tileId, tileId.level());
+      result = (stateP->mVisibleChildren & (1U << static_cast<unsigned>(childIdx))) != 0;
+    } else if (mOrientedBounds) {
+      OrientedTileBounds const& tb = state.mRdDEM->getOrientedBounds();
 
-    result = testInFrustum(mCullData.mFrustumMS, tb);
+      result = testInFrustum(mCullData.mFrustumMS, tb) &&
+               testAboveHorizon(mCullData.mCamPos, mCullData.mProxyRadius, tb) &&
+               !testBackFacing(mCullData.mCamPos, tb) && !mHorizonMap.testOccluded(tb);
+    } else {
+      BoundingBox<double> const& tb = state.mRdDEM->getBounds();
 
-    if (result) {
-      result = testFrontFacing(mCullData.mCamPos, mParams, tb, treeMgrDEM);
+      result = testInFrustum(mCullData.mFrustumMS, tb) &&
+               testAboveHorizon(mCullData.mCamPos, mCullData.mProxyRadius, tb) &&
+               !mHorizonMap.testOccluded(tb);
     }
 
     if (state.mRdIMG && state.mRdIMG->hasBounds()) {
@@ -634,12 +913,9 @@ bool LODVisitor::testVisible(TileId const& tileId, TreeManagerBase* treeMgrDEM)
       logger().error("Failed to test visibility of Tile: Unknown tile template type!");
     }
 
-    result = testInFrustum(mCullData.mFrustumMS, tb);
-
-    if (result) {
-      result = testFrontFacing(mCullData.mCamPos, mParams, tb, treeMgrDEM);
-    }
-    // result = true;
+    result = testInFrustum(mCullData.mFrustumMS, tb) &&
+             testAboveHorizon(mCullData.mCamPos, mCullData.mProxyRadius, tb) &&
+             !mHorizonMap.testOccluded(tb);
   }
 
   return result;
@@ -651,63 +927,158 @@ bool LODVisitor::testNeedRefine(TileId const& tileId) {
   bool      result = false;
   LODState& state  = getLODState();
 
+  // Decisions are only stored for tiles with their own elevation data, the bounds of other tiles
+  // depend on the currently loaded elevation data.
+  RenderData* coherentRd = nullptr;
+
+  if (mCoherenceData.mGeneration >= 0 && state.mNodeDEM &&
+      state.mRdDEM->getNode() == state.mNodeDEM) {
+    coherentRd = state.mRdDEM;
+
+    RenderData::LodDecision const& decision = coherentRd->getLodDecision();
+
+    if (decision.mGeneration == mCoherenceData.mGeneration &&
+        mCoherenceData.mDistance < decision.mValidRadius) {
+      state.mMaxLevel    = decision.mMaxLevel;
+      state.mMaxLevelDEM = decision.mMaxLevelDEM;
+      state.mRefineDEM = decision.mRefineDEM || mParams->mMinLevel > tileId.level();
+      return decision.mRefine || mParams->mMinLevel > tileId.level();
+    }
+  }
+
   if (state.mNodeDEM || state.mRdIMG->hasBounds()) {
-    BoundingBox<double> tb;
+    ++mNumRefineTests;
+
+    std::array<glm::dvec3, 8> corners{};
+    glm::dvec3                tbCenter;
+    glm::dvec3                tbClosest;
+
+    if (state.mNodeDEM && mOrientedBounds) {
+      OrientedTileBounds const& tb = state.mRdDEM->getOrientedBounds();
+      tbCenter                     = tb.mCenter;
+      tbClosest                    = tb.mCenter;
+
+      for (unsigned corner = 0; corner < 8; ++corner) {
+        corners.at(corner) = tb.mCenter;
+
+        for (unsigned axis = 0; axis < 3; ++axis) {
+          corners.at(corner) +=
+              (corner & (1U << axis)) ? tb.mHalfAxes.at(axis) : -tb.mHalfAxes.at(axis);
+        }
+      }
+
+      for (auto const& axis : tb.mHalfAxes) {
+        double const length2 = glm::dot(axis, axis);
 
-    if (state.mNodeDEM) {
-      // simple case, there is a DEM node for this level, i.e.
-      // DEM resolution is at least as high as IMG resolution
-      tb = state.mRdDEM->getBounds();
+        if (length2 > 0.0) {
+          tbClosest +=
+              std::clamp(glm::dot(mCullData.mCamPos - tb.mCenter, axis) / length2, -1.0, 1.0) *
+              axis;
+        }
+      }
     } else {
-      // use calculated bounds based on minMaxPyramid
-      tb = state.mRdIMG->getBounds();
+      // If there is a DEM node for this level, i.e. DEM resolution is at least as high as IMG
+      // resolution, its bounds are used. Otherwise use the calculated bounds based on the
+      // minMaxPyramid.
+      BoundingBox<double> const& tb    = state.mNodeDEM ? state.mRdDEM->getBounds()
+                                                        : state.mRdIMG->getBounds();
+      glm::dvec3 const&          tbMin = tb.getMin();
+      glm::dvec3 const&          tbMax = tb.getMax();
+      tbCenter                         = 0.5 * (tbMin + tbMax);
+      tbClosest                        = glm::clamp(mCullData.mCamPos, tbMin, tbMax);
+
+      for (unsigned corner = 0; corner < 8; ++corner) {
+        corners.at(corner) = glm::dvec3((corner & 1U) ? tbMax.x : tbMin.x,
+            (corner & 2U) ? tbMax.y : tbMin.y, (corner & 4U) ? tbMax.z : tbMin.z);
+      }
     }
 
-    glm::dvec3 const& tbMin    = tb.getMin();
-    glm::dvec3 const& tbMax    = tb.getMax();
-    glm::dvec3        tbCenter = 0.5 * (tbMin + tbMax);
-
     // A tile is refined if the solid angle it occupies when seen from the
     // camera is above a given threshold. To estimate the solid angle, the
     // angles between the vector from the camera to the bounding box center
     // and all vectors from the camera to all eight corners of the bounding
     // box are calculated and the maximum of those is taken.
-
-    // 8 corners of tile's bounding box
-    std::array<glm::dvec3, 8> tbDirs = {
-        {glm::normalize(glm::dvec3(tbMin.x, tbMin.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMin.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMin.y, tbMax.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMin.x, tbMin.y, tbMax.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMin.x, tbMax.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMax.y, tbMin.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMax.x, tbMax.y, tbMax.z) - mCullData.mCamPos),
-            glm::normalize(glm::dvec3(tbMin.x, tbMax.y, tbMax.z) - mCullData.mCamPos)}};
-
+    // As acos is monotonically decreasing, the maximum angle belongs to the minimum cosine.
     glm::dvec3 centerDir = glm::normalize(tbCenter - mCullData.mCamPos);
+    double     minCos(1.0);
 
-    double maxAngle(0.0);
-
-    for (auto& tbDir : tbDirs) {
-      maxAngle = std::max(std::acos(std::min(1.0, glm::dot(tbDir, centerDir))), maxAngle);
+    for (auto const& tbPnt : corners) {
+      minCos = std::min(glm::dot(glm::normalize(tbPnt - mCullData.mCamPos), centerDir), minCos);
     }
 
+    double maxAngle = std::acos(minCos);
+
     // calculate field of view
     double fov =
         std::max(mLodData.mFrustumES.getHorizontalFOV(), mLodData.mFrustumES.getVerticalFOV());
 
-    double ratio = maxAngle / fov * mParams->mLodFactor;
+    double ratio     = maxAngle / fov * mParams->mLodFactor;
+    double slack     = ratio > 10.0 ? ratio / 10.0 - 1.0 : 10.0 / ratio - 1.0;
+    state.mRefineDEM = ratio > 10.0;
+
+    // the ratio which decides about refining the elevation data
+    double ratioDEM = ratio;
+
+    double const distance = glm::length(tbClosest - mCullData.mCamPos);
+
+    if (mGeometricLod && state.mNodeDEM && state.mRdDEM->getNode() == state.mNodeDEM) {
+      // Elevation tiles are refined if their geometric error projected to the screen is above a
+      // threshold instead. The error is compared to the angle between adjacent samples at which
+      // the solid angle criterion above would refine the tile, so flat tiles are refined much
+      // later and rough tiles earlier.
+      double const errorRatio = distance > 0.0 ? state.mRdDEM->getGeometricError() / distance *
+                                                     0.5 * (TileBase::SizeX - 1) / fov *
+                                                     mParams->mLodFactor
+                                               : std::numeric_limits<double>::max();
+      double const errorSlack =
+          errorRatio > 10.0 ? errorRatio / 10.0 - 1.0 : 10.0 / errorRatio - 1.0;
+
+      state.mRefineDEM = errorRatio > 10.0;
+      ratioDEM         = errorRatio;
+
+      // Image tiles are still refined based on their size on screen, the elevation data of this
+      // tile is used for their children unless its error requires refinement as well.
+      if (mTreeMgrIMG) {
+        ratio = std::max(ratio, errorRatio);
+        slack = std::min(slack, errorSlack);
+      } else {
+        ratio = errorRatio;
+        slack = errorSlack;
+      }
+    }
 
     result = ratio > 10.0;
 
+    // The minimum level is not part of the stored decision.
+    bool const refineDEM = state.mRefineDEM;
+
     if (mParams->mMinLevel > tileId.level()) {
-      result = true;
+      result           = true;
+      state.mRefineDEM = true;
     }
 
     // estimate how many more levels are necessary to achieve desired
     // lod factor - used for the case below (no DEM node for level)
-    double const deltaLvl = std::max(0.0, std::ceil(std::log(ratio) / std::log(4.0)));
-    state.mMaxLevel       = static_cast<int>(tileId.level() + deltaLvl);
+    double const deltaLvl    = std::max(0.0, std::ceil(std::log(ratio) / std::log(4.0)));
+    double const deltaLvlDEM = std::max(0.0, std::ceil(std::log(ratioDEM) / std::log(4.0)));
+    state.mMaxLevel          = static_cast<int>(tileId.level() + deltaLvl);
+    state.mMaxLevelDEM       = static_cast<int>(tileId.level() + deltaLvlDEM);
+
+    if (coherentRd) {
+      // Both ratios scale with the inverse distance to the tile. Within the limits of
+      // CoherenceMaxMove, moving the camera by a fraction x of the distance to the closest point
+      // of the tile changes them by less than a factor of 1 + 4x.
+      double const move = distance * std::min(CoherenceMaxMove, slack / 4.0);
+
+      RenderData::LodDecision decision;
+      decision.mGeneration  = mCoherenceData.mGeneration;
+      decision.mRefine      = ratio > 10.0;
+      decision.mRefineDEM   = refineDEM;
+      decision.mMaxLevel    = state.mMaxLevel;
+      decision.mMaxLevelDEM = state.mMaxLevelDEM;
+      decision.mValidRadius = move - mCoherenceData.mDistance;
+      coherentRd->setLodDecision(decision);
+    }
   }
 
   return result;
@@ -824,6 +1195,115 @@ bool LODVisitor::getUpdateCulling() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LODVisitor::setNumThreads(int numThreads) {
+  // copied, std::min would bind a reference to the constant, which is not defined out of class
+  int const numRoots = TileQuadTree::sNumRoots;
+  numThreads         = std::max(1, std::min(numThreads, numRoots));
+
+  if (numThreads == mNumThreads) {
+    return;
+  }
+
+  mNumThreads = numThreads;
+  mWorkers.clear();
+
+  // The calling thread traverses roots as well.
+  if (mNumThreads > 1) {
+    mThreadPool = std::make_unique<cs::utils::ThreadPool>(mNumThreads - 1);
+  } else {
+    mThreadPool.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int LODVisitor::getNumThreads() const {
+  return mNumThreads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setTemporalCoherence(bool enable) {
+  mTemporalCoherence = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getTemporalCoherence() const {
+  return mTemporalCoherence;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setOrientedBounds(bool enable) {
+  // The refinement decisions depend on the bounds.
+  if (enable != mOrientedBounds) {
+    mCoherenceData.mGeneration = -1;
+  }
+
+  mOrientedBounds = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getOrientedBounds() const {
+  return mOrientedBounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setGeometricLod(bool enable) {
+  if (enable != mGeometricLod) {
+    mCoherenceData.mGeneration = -1;
+  }
+
+  mGeometricLod = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getGeometricLod() const {
+  return mGeometricLod;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setOcclusionCulling(bool enable) {
+  mOcclusionCulling = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool LODVisitor::getOcclusionCulling() const {
+  return mOcclusionCulling;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::setLoadAheadLevels(int levels) {
+  mLoadAheadLevels = std::max(0, levels);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int LODVisitor::getLoadAheadLevels() const {
+  return mLoadAheadLevels;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::clearOccluders() {
+  mOccluders.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t LODVisitor::getNumRefineTests() const {
+  return mNumRefineTests;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 std::vector<TileId> const& LODVisitor::getLoadDEM() const {
   return mLoadDEM;
 }
@@ -848,11 +1328,127 @@ std::vector<RenderData*> const& LODVisitor::getRenderIMG() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LODVisitor::selectShadowTiles(
+    glm::dmat4 const& matVM, glm::dmat4 const& matP, glm::ivec4 const& viewport) {
+  resetShadowTiles();
+
+  if (!mTreeMgrDEM || mRenderDEM.empty()) {
+    return;
+  }
+
+  Frustum const frustum  = Frustum::fromMatrix(matP * matVM);
+  int const     maxLevel = calcShadowLevel(matP * matVM, viewport, *mParams);
+
+  // The tiles of a traversal are ordered depth first, so the descendants of an ancestor and
+  // repeated entries of tiles which are drawn with several image tiles are next to each other.
+  RenderDataDEM* last = nullptr;
+
+  for (auto* rd : mRenderDEM) {
+    auto*  rdDEM  = dynamic_cast<RenderDataDEM*>(rd);
+    TileId tileId = rdDEM->getTileId();
+
+    if (tileId.level() > maxLevel) {
+      while (tileId.level() > maxLevel) {
+        tileId = HEALPix::getParentTileId(tileId);
+      }
+
+      auto* rdParent = mTreeMgrDEM->find<RenderDataDEM>(tileId);
+
+      // if the parent's data is not on the GPU the tile is used as it is
+      if (rdParent && rdParent->getTexLayer() >= 0) {
+        rdDEM = rdParent;
+      }
+    }
+
+    if (rdDEM == last) {
+      continue;
+    }
+
+    last = rdDEM;
+
+    bool const visible = mOrientedBounds ? testInFrustum(frustum, rdDEM->getOrientedBounds())
+                                         : testInFrustum(frustum, rdDEM->getBounds());
+
+    if (visible) {
+      mShadowDEM.push_back(rdDEM);
+    }
+  }
+
+  // The edges of the coarser tiles are determined like in postTraverse(), they are not drawn by the
+  // main pass so their edge information is unused otherwise. A neighbour region which is not
+  // covered by a tile of the traversal is covered by finer tiles which were replaced by a tile at
+  // the same level, unless that is not on the GPU.
+  for (auto* rd : mShadowDEM) {
+    auto* rdDEM = dynamic_cast<RenderDataDEM*>(rd);
+
+    if (rdDEM->testFlag(RenderDataDEM::Flags::eRender)) {
+      continue;
+    }
+
+    TileId const& tileId = rdDEM->getTileId();
+    auto          nIds   = HEALPix::getNeighbourIds(tileId);
+
+    for (int i = 0; i < 4; ++i) {
+      RenderDataDEM* rdNeighbour = mTreeMgrDEM->find<RenderDataDEM>(nIds.at(i));
+      RenderDataDEM* rdRendered  = findRenderedRData(mTreeMgrDEM, nIds.at(i));
+
+      if (rdRendered && rdRendered->getLevel() < tileId.level()) {
+        rdDEM->setEdgeDelta(i, rdRendered->getLevel() - tileId.level());
+        rdDEM->setEdgeRData(i, rdRendered);
+      } else if (rdNeighbour) {
+        rdDEM->setEdgeDelta(i, rdRendered || rdNeighbour->getTexLayer() >= 0 ? 0 : 1);
+        rdDEM->setEdgeRData(i, rdNeighbour);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<RenderData*> const& LODVisitor::getShadowDEM() const {
+  return mShadowDEM;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::resetRenderLists() {
+  resetShadowTiles();
+
+  // A tile may be listed more than once, resetting it again does no harm.
+  for (auto* rd : mRenderDEM) {
+    auto* rdDEM = dynamic_cast<RenderDataDEM*>(rd);
+    rdDEM->resetEdgeDeltas();
+    rdDEM->resetEdgeRData();
+    rdDEM->clearFlags();
+  }
+
+  mRenderDEM.clear();
+  mRenderIMG.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LODVisitor::resetShadowTiles() {
+  // the tiles of the traversal keep their edges until the next traversal
+  for (auto* rd : mShadowDEM) {
+    auto* rdDEM = dynamic_cast<RenderDataDEM*>(rd);
+
+    if (!rdDEM->testFlag(RenderDataDEM::Flags::eRender)) {
+      rdDEM->resetEdgeDeltas();
+      rdDEM->resetEdgeRData();
+    }
+  }
+
+  mShadowDEM.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void LODVisitor::pushState() {
   mStackTop += 1;
 
   // check that stack does not overflow
-  assert(mStackTop < static_cast<int>(sMaxStackDepth));
+  assert(mStackTop < sMaxDepth);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -866,7 +1462,7 @@ void LODVisitor::popState() {
 LODVisitor::StateBase& LODVisitor::getState() {
   // check that stack is valid
   assert(mStackTop >= 0);
-  return mStack.at(mStackTop);
+  return mStack[mStackTop];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -874,23 +1470,23 @@ LODVisitor::StateBase& LODVisitor::getState() {
 LODVisitor::StateBase const& LODVisitor::getState() const {
   // check that stack is valid
   assert(mStackTop >= 0);
-  return mStack.at(mStackTop);
+  return mStack[mStackTop];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 LODVisitor::LODState& LODVisitor::getLODState(int level /*= -1*/) {
   // check that stack is valid
-  assert(mStackTop >= 0);
-  return mStack.at(level >= 0 ? level : mStackTop);
+  assert(mStackTop >= 0 && level < sMaxDepth);
+  return mStack[level >= 0 ? level : mStackTop];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 LODVisitor::LODState const& LODVisitor::getLODState(int level /*= -1*/) const {
   // check that stack is valid
-  assert(mStackTop >= 0);
-  return mStack.at(level >= 0 ? level : mStackTop);
+  assert(mStackTop >= 0 && level < sMaxDepth);
+  return mStack[level >= 0 ? level : mStackTop];
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
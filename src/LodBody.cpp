@@ -19,6 +19,8 @@
 #include <VistaKernel/VistaSystem.h>
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 
+#include <algorithm>
+
 namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -29,7 +31,8 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
     std::shared_ptr<Plugin::Settings> const&                pluginSettings,
     std::shared_ptr<cs::core::GuiManager> const& pGuiManager, std::string const& sCenterName,
     std::string const& sFrameName, std::shared_ptr<GLResources> const& glResources,
-    double tStartExistence, double tEndExistence)
+    std::shared_ptr<RetainBudget> const& retainBudget, double tStartExistence,
+    double tEndExistence)
     : cs::scene::CelestialBody(sCenterName, sFrameName, tStartExistence, tEndExistence)
     , mSettings(settings)
     , mGraphicsEngine(std::move(graphicsEngine))
@@ -61,6 +64,21 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
 
   mPluginSettings->mLODFactor.connectAndTouch([this](float val) { mPlanet.setLODFactor(val); });
 
+  // the memory of the retained trees is limited for all bodies together by the budget
+  mPlanet.setRetainBudget(retainBudget);
+
+  mMaxRetainedDatasetsConnection =
+      mPluginSettings->mMaxRetainedDatasets.connectAndTouch([this](uint32_t val) {
+        mPlanet.setMaxRetainedSources(val);
+        trimRetainedSources(mRetainedDEMSources);
+        trimRetainedSources(mRetainedIMGSources);
+      });
+
+  mMaxUploadMemoryConnection =
+      mPluginSettings->mMaxUploadMemory.connectAndTouch([this](uint32_t val) {
+        mPlanet.setMaxUploadBytes(static_cast<std::size_t>(val) * 1024 * 1024);
+      });
+
   mPluginSettings->mEnableWireframe.connectAndTouch(
       [this](bool val) { mPlanet.getTileRenderer().setWireframe(val); });
 
@@ -69,6 +87,32 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
     mPlanet.getLODVisitor().setUpdateCulling(!val);
   });
 
+  mTraversalThreadsConnection = mPluginSettings->mTraversalThreads.connectAndTouch(
+      [this](uint32_t val) { mPlanet.getLODVisitor().setNumThreads(static_cast<int>(val)); });
+
+  mDrawListThreadsConnection = mPluginSettings->mDrawListThreads.connectAndTouch(
+      [this](uint32_t val) { mPlanet.getTileRenderer().setNumThreads(static_cast<int>(val)); });
+
+  mTemporalCoherenceConnection = mPluginSettings->mEnableTemporalCoherence.connectAndTouch(
+      [this](bool val) { mPlanet.getLODVisitor().setTemporalCoherence(val); });
+
+  mOrientedBoundsConnection = mPluginSettings->mEnableOrientedBounds.connectAndTouch(
+      [this](bool val) { mPlanet.getLODVisitor().setOrientedBounds(val); });
+
+  mGeometricLodConnection = mPluginSettings->mEnableGeometricLod.connectAndTouch(
+      [this](bool val) { mPlanet.getLODVisitor().setGeometricLod(val); });
+
+  mOcclusionCullingConnection = mPluginSettings->mEnableOcclusionCulling.connectAndTouch(
+      [this](bool val) { mPlanet.getLODVisitor().setOcclusionCulling(val); });
+
+  mLoadAheadLevelsConnection = mPluginSettings->mLoadAheadLevels.connectAndTouch(
+      [this](uint32_t val) { mPlanet.getLODVisitor().setLoadAheadLevels(static_cast<int>(val)); });
+
+  mTileTraceConnection =
+      mPluginSettings->mTileTraceDirectory.connectAndTouch([this](std::string const& val) {
+        mPlanet.setTraceFiles(val.empty() ? "" : val + "/" + getCenterName());
+      });
+
   // Add to scenegraph.
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
   mGLNode.reset(pSG->NewOpenGLNode(pSG->GetRoot(), this));
@@ -81,6 +125,16 @@ LodBody::LodBody(std::shared_ptr<cs::core::Settings> const& settings,
 LodBody::~LodBody() {
   mGraphicsEngine->unregisterCaster(&mPlanet);
   mSettings->mGraphics.pHeightScale.disconnect(mHeightScaleConnection);
+  mPluginSettings->mMaxRetainedDatasets.disconnect(mMaxRetainedDatasetsConnection);
+  mPluginSettings->mMaxUploadMemory.disconnect(mMaxUploadMemoryConnection);
+  mPluginSettings->mTraversalThreads.disconnect(mTraversalThreadsConnection);
+  mPluginSettings->mDrawListThreads.disconnect(mDrawListThreadsConnection);
+  mPluginSettings->mEnableTemporalCoherence.disconnect(mTemporalCoherenceConnection);
+  mPluginSettings->mEnableOrientedBounds.disconnect(mOrientedBoundsConnection);
+  mPluginSettings->mEnableGeometricLod.disconnect(mGeometricLodConnection);
+  mPluginSettings->mEnableOcclusionCulling.disconnect(mOcclusionCullingConnection);
+  mPluginSettings->mLoadAheadLevels.disconnect(mLoadAheadLevelsConnection);
+  mPluginSettings->mTileTraceDirectory.disconnect(mTileTraceConnection);
 
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
   pSG->GetRoot()->DisconnectChild(mGLNode.get());
@@ -100,6 +154,22 @@ void LodBody::setSun(std::shared_ptr<const cs::scene::CelestialObject> const& su
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LodBody::setFrameBudget(float milliseconds) {
+  mPlanet.setFrameBudget(milliseconds);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t LodBody::getNumTriangles() const {
+  if (!getIsInExistence() || !pVisible.get()) {
+    return 0;
+  }
+
+  return mPlanet.getNumTriangles();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool LodBody::getIntersection(
     glm::dvec3 const& rayPos, glm::dvec3 const& rayDir, glm::dvec3& pos) const {
   return utils::intersectPlanet(&mPlanet, rayPos, rayDir, pos);
@@ -122,6 +192,7 @@ glm::dvec3 LodBody::getRadii() const {
 void LodBody::setDEMtileSource(std::shared_ptr<TileSource> source) {
   if (!source->isSame(mDEMtileSource.get())) {
     mPlanet.setDEMSource(source.get());
+    retainSource(mRetainedDEMSources, std::move(mDEMtileSource), source.get());
     mDEMtileSource = std::move(source);
   }
 }
@@ -132,6 +203,7 @@ void LodBody::setIMGtileSource(std::shared_ptr<TileSource> source) {
   if (source) {
     if (!source->isSame(mIMGtileSource.get())) {
       mPlanet.setIMGSource(source.get());
+      retainSource(mRetainedIMGSources, std::move(mIMGtileSource), source.get());
       mShader.pEnableTexture = true;
       mShader.pTextureIsRGB  = (source->getDataType() == TileDataType::eU8Vec3);
       mIMGtileSource         = std::move(source);
@@ -140,6 +212,7 @@ void LodBody::setIMGtileSource(std::shared_ptr<TileSource> source) {
     if (mIMGtileSource) {
       mShader.pEnableTexture = false;
       mPlanet.setIMGSource(nullptr);
+      retainSource(mRetainedIMGSources, std::move(mIMGtileSource), nullptr);
       mIMGtileSource = nullptr;
     }
   }
@@ -147,6 +220,30 @@ void LodBody::setIMGtileSource(std::shared_ptr<TileSource> source) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void LodBody::retainSource(std::deque<std::shared_ptr<TileSource>>& retained,
+    std::shared_ptr<TileSource> previous, TileSource const* next) {
+  retained.erase(std::remove_if(retained.begin(), retained.end(),
+                     [next](auto const& source) { return source.get() == next; }),
+      retained.end());
+
+  if (previous) {
+    retained.push_front(std::move(previous));
+  }
+
+  trimRetainedSources(retained);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LodBody::trimRetainedSources(std::deque<std::shared_ptr<TileSource>>& retained) {
+  while (retained.size() > mPluginSettings->mMaxRetainedDatasets.get()) {
+    mPlanet.dropRetainedSource(retained.back().get());
+    retained.pop_back();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 std::shared_ptr<TileSource> const& LodBody::getDEMtileSource() const {
   return mDEMtileSource;
 }
@@ -16,6 +16,7 @@
 #include "VistaPlanet.hpp"
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 
+#include <deque>
 #include <memory>
 
 namespace cs::scene {
@@ -44,7 +45,8 @@ class LodBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
       std::shared_ptr<Plugin::Settings> const&       pluginSettings,
       std::shared_ptr<cs::core::GuiManager> const& pGuiManager, std::string const& sCenterName,
       std::string const& sFrameName, std::shared_ptr<GLResources> const& glResources,
-      double tStartExistence, double tEndExistence);
+      std::shared_ptr<RetainBudget> const& retainBudget, double tStartExistence,
+      double tEndExistence);
 
   LodBody(LodBody const& other) = delete;
   LodBody(LodBody&& other)      = delete;
@@ -58,6 +60,13 @@ class LodBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
 
   void setSun(std::shared_ptr<const cs::scene::CelestialObject> const& sun);
 
+  /// Sets the time in milliseconds this body should take per frame. If many tiles are loaded at
+  /// once, merging and uploading them is spread across several frames. Zero disables the limit.
+  void setFrameBudget(float milliseconds);
+
+  /// Returns the number of triangles drawn in the last frame, zero if the body is not visible.
+  std::size_t getNumTriangles() const;
+
   /// Sets the tile source for elevation data.
   void setDEMtileSource(std::shared_ptr<TileSource> source);
 
@@ -81,6 +90,14 @@ class LodBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
   bool GetBoundingBox(VistaBoundingBox& bb) override;
 
  private:
+  /// Called when a channel switches from previous to next. previous is kept alive in retained (as
+  /// mPlanet retains its tree), next is removed from retained as it becomes active again.
+  void retainSource(std::deque<std::shared_ptr<TileSource>>& retained,
+      std::shared_ptr<TileSource> previous, TileSource const* next);
+
+  /// Drops the least recently used sources (and their trees) exceeding mMaxRetainedDatasets.
+  void trimRetainedSources(std::deque<std::shared_ptr<TileSource>>& retained);
+
   std::shared_ptr<cs::core::Settings>               mSettings;
   std::shared_ptr<cs::core::GraphicsEngine>         mGraphicsEngine;
   std::shared_ptr<cs::core::SolarSystem>            mSolarSystem;
@@ -88,14 +105,26 @@ class LodBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
   std::shared_ptr<const cs::scene::CelestialObject> mSun;
   std::shared_ptr<cs::core::GuiManager>             mGuiManager;
 
-  std::unique_ptr<VistaOpenGLNode> mGLNode;
-  std::shared_ptr<TileSource>      mDEMtileSource;
-  std::shared_ptr<TileSource>      mIMGtileSource;
+  std::unique_ptr<VistaOpenGLNode>        mGLNode;
+  std::shared_ptr<TileSource>             mDEMtileSource;
+  std::shared_ptr<TileSource>             mIMGtileSource;
+  std::deque<std::shared_ptr<TileSource>> mRetainedDEMSources;
+  std::deque<std::shared_ptr<TileSource>> mRetainedIMGSources;
 
   VistaPlanet  mPlanet;
   PlanetShader mShader;
   glm::dvec3   mRadii;
-  int          mHeightScaleConnection = -1;
+  int          mHeightScaleConnection         = -1;
+  int          mMaxRetainedDatasetsConnection = -1;
+  int          mMaxUploadMemoryConnection     = -1;
+  int          mTraversalThreadsConnection    = -1;
+  int          mDrawListThreadsConnection     = -1;
+  int          mTemporalCoherenceConnection   = -1;
+  int          mOrientedBoundsConnection      = -1;
+  int          mGeometricLodConnection        = -1;
+  int          mOcclusionCullingConnection    = -1;
+  int          mLoadAheadLevelsConnection     = -1;
+  int          mTileTraceConnection           = -1;
 };
 
 } // namespace csp::lodbodies
@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "LodController.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// Weight of the last frame in the averaged moments used to estimate the triangle cost.
+double const MomentWeight = 0.05;
+
+// Relative standard deviation of the triangle count below which the estimated triangle cost is
+// mostly taken from the assumption that the whole frame time is spent on triangles.
+double const MinVariation = 0.1;
+
+// Relative deviation from the target time which is tolerated without changing the LOD factor.
+double const DeadBand = 0.03;
+
+// Fraction of the predicted change of the LOD factor which is applied per frame.
+double const Gain = 0.2;
+
+// Maximum factor by which the predicted triangle count may differ from the current one.
+double const MaxTriangleChange = 2.0;
+
+// Relative change of the LOD factor below which the returned LOD factor is not changed.
+double const Hysteresis = 0.02;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LodController::setTargetTime(double milliseconds) {
+  mTargetTime = milliseconds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LodController::getTargetTime() const {
+  return mTargetTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LodController::setRange(double minLodFactor, double maxLodFactor) {
+  mMinLodFactor = minLodFactor;
+  mMaxLodFactor = std::max(minLodFactor, maxLodFactor);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LodController::getMinLodFactor() const {
+  return mMinLodFactor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LodController::getMaxLodFactor() const {
+  return mMaxLodFactor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LodController::update(double frameTime, std::size_t triangles, double lodFactor) {
+  if (triangles == 0) {
+    return std::clamp(lodFactor, mMinLodFactor, mMaxLodFactor);
+  }
+
+  // The LOD factor has been changed by someone else, e.g. on the first frame. The tolerance allows
+  // for the LOD factor being stored as float by the caller.
+  if (std::abs(lodFactor - mAppliedLodFactor) > 1e-4 * lodFactor) {
+    mLodFactor = lodFactor;
+  }
+
+  auto const currentTriangles = static_cast<double>(triangles);
+
+  mSamples.at(mSampleCount % MedianFrames) = {frameTime, currentTriangles};
+  ++mSampleCount;
+
+  // Single slow frames are ignored by using the median of the last frames. The triangle count of
+  // the same frame is used together with it, so that both match even if the triangle count has
+  // changed during the last frames.
+  Samples           samples = mSamples;
+  std::size_t const count   = std::min(mSampleCount, MedianFrames);
+  auto const        median  = samples.begin() + static_cast<std::ptrdiff_t>(count / 2);
+  std::nth_element(samples.begin(), median, samples.begin() + static_cast<std::ptrdiff_t>(count),
+      [](Sample const& a, Sample const& b) { return a.mTime < b.mTime; });
+
+  double const time = median->mTime;
+  double const n    = median->mTriangles;
+
+  if (!mHasMeasurement) {
+    mMeanTriangles  = n;
+    mMeanTime       = time;
+    mHasMeasurement = true;
+  }
+
+  // Update the exponentially weighted moments.
+  double const dn = n - mMeanTriangles;
+  double const dt = time - mMeanTime;
+  mMeanTriangles += MomentWeight * dn;
+  mMeanTime += MomentWeight * dt;
+  mVarTriangles = (1.0 - MomentWeight) * (mVarTriangles + MomentWeight * dn * dn);
+  mCovariance   = (1.0 - MomentWeight) * (mCovariance + MomentWeight * dn * dt);
+
+  // The triangle cost is the slope of a linear regression of the frame time over the triangle
+  // count. If the triangle count hardly varied, there is not enough data for the regression. In
+  // this case the cost is pulled towards the assumption that the whole frame time is caused by
+  // triangles. This overestimates the cost and results in smaller, safe steps. The cost can not be
+  // larger than this either, as the constant part of the frame time is not negative.
+  double const maxCost = time / n;
+  double const prior   = std::pow(MinVariation * mMeanTriangles, 2.0);
+  mTriangleCost        = (mCovariance + prior * maxCost) / (mVarTriangles + prior);
+  mTriangleCost        = std::clamp(mTriangleCost, 0.05 * maxCost, maxCost);
+
+  if (std::abs(time - mTargetTime) < DeadBand * mTargetTime) {
+    mLodFactor        = std::clamp(lodFactor, mMinLodFactor, mMaxLodFactor);
+    mAppliedLodFactor = mLodFactor;
+    return mAppliedLodFactor;
+  }
+
+  // The prediction is an absolute triangle count, hence it does not overshoot even if the median
+  // lags behind a few frames. The number of tiles covering the visible surface grows with the
+  // square of the LOD factor.
+  double const targetTriangles = std::clamp(n + (mTargetTime - time) / mTriangleCost,
+      n / MaxTriangleChange, n * MaxTriangleChange);
+  double const targetLodFactor = lodFactor * std::sqrt(targetTriangles / currentTriangles);
+
+  mLodFactor = std::clamp(
+      mLodFactor + Gain * (targetLodFactor - mLodFactor), mMinLodFactor, mMaxLodFactor);
+
+  // Small steps are accumulated until they are worth invalidating the coherence data. The limits
+  // of the range are always reached.
+  bool const atLimit = mLodFactor == mMinLodFactor || mLodFactor == mMaxLodFactor;
+
+  if (atLimit || std::abs(mLodFactor - lodFactor) > Hysteresis * lodFactor) {
+    mAppliedLodFactor = mLodFactor;
+  } else {
+    mAppliedLodFactor = std::clamp(lodFactor, mMinLodFactor, mMaxLodFactor);
+  }
+
+  return mAppliedLodFactor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double LodController::getTriangleCost() const {
+  return mTriangleCost;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void LodController::reset() {
+  mSamples          = {};
+  mSampleCount      = 0;
+  mMeanTriangles    = 0.0;
+  mMeanTime         = 0.0;
+  mVarTriangles     = 0.0;
+  mCovariance       = 0.0;
+  mTriangleCost     = 0.0;
+  mHasMeasurement   = false;
+  mLodFactor        = 0.0;
+  mAppliedLodFactor = 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_LODCONTROLLER_HPP
+#define CSP_LOD_BODIES_LODCONTROLLER_HPP
+
+#include <array>
+#include <cstddef>
+
+namespace csp::lodbodies {
+
+/// Chooses the LOD factor of the planets so that the frame time approaches a target time.
+///
+/// The frame time is modelled as a constant part plus a cost per drawn triangle. The cost is
+/// estimated from the measured frame times and triangle counts of previous frames. From the
+/// difference between the measured and the target frame time the controller predicts how many
+/// triangles should be drawn and, as the number of tiles grows with the square of the LOD factor,
+/// which LOD factor results in this number. The LOD factor is moved only partially towards this
+/// prediction each frame to avoid oscillations.
+///
+/// Every change of the LOD factor invalidates the temporal coherence data of the LODVisitor. Hence
+/// the controller follows the prediction internally and only returns a new LOD factor once it
+/// differs from the current one by a few percent.
+///
+/// Frame times are filtered with a median over the last few frames, so that single slow frames,
+/// for example when many tiles are uploaded at once, do not reduce the LOD factor.
+class LodController {
+ public:
+  /// Sets the frame time in milliseconds which should be reached.
+  void   setTargetTime(double milliseconds);
+  double getTargetTime() const;
+
+  /// Sets the range of the LOD factor chosen by the controller.
+  void   setRange(double minLodFactor, double maxLodFactor);
+  double getMinLodFactor() const;
+  double getMaxLodFactor() const;
+
+  /// Adds the measurements of the last frame and returns the LOD factor for the next frame.
+  /// frameTime is the duration of the last frame in milliseconds, triangles the number of
+  /// triangles drawn with lodFactor. If no triangles have been drawn, lodFactor is returned. Small
+  /// changes are held back, so lodFactor is returned unchanged in most frames.
+  double update(double frameTime, std::size_t triangles, double lodFactor);
+
+  /// Returns the current estimate of the cost of one triangle in milliseconds.
+  double getTriangleCost() const;
+
+  /// Discards all measurements, for example after the target time has changed.
+  void reset();
+
+ private:
+  static constexpr std::size_t MedianFrames = 15;
+
+  double mTargetTime   = 14.0;
+  double mMinLodFactor = 15.0;
+  double mMaxLodFactor = 50.0;
+
+  struct Sample {
+    double mTime      = 0.0;
+    double mTriangles = 0.0;
+  };
+
+  using Samples = std::array<Sample, MedianFrames>;
+
+  Samples     mSamples{};
+  std::size_t mSampleCount = 0;
+
+  // Exponentially weighted moments of the triangle counts and frame times.
+  double mMeanTriangles  = 0.0;
+  double mMeanTime       = 0.0;
+  double mVarTriangles   = 0.0;
+  double mCovariance     = 0.0;
+  double mTriangleCost   = 0.0;
+  bool   mHasMeasurement = false;
+
+  // The LOD factor the controller is aiming for and the one it returned last.
+  double mLodFactor        = 0.0;
+  double mAppliedLodFactor = 0.0;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_LODCONTROLLER_HPP
@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_MPSCQUEUE_HPP
+#define CSP_LOD_BODIES_MPSCQUEUE_HPP
+
+#include "FixedSizePool.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Lock-free queue with many producers and a single consumer. Producers push items one at a time,
+/// the consumer takes all items pushed so far at once with drain(). This is used to hand loaded
+/// tiles from the loader threads to the render thread without the render thread ever waiting on a
+/// lock.
+///
+/// Internally pushed items form a singly linked list; drain() swaps the list head with nullptr and
+/// reverses the detached list to restore push order. The list links are allocated from a
+/// FixedSizePool, so after warming up neither push() nor drain() touch the heap.
+template <typename T>
+class MPSCQueue : private boost::noncopyable {
+ public:
+  MPSCQueue();
+  ~MPSCQueue();
+
+  /// Appends value to the queue. May be called from any thread.
+  void push(T value);
+
+  /// Appends all items pushed so far to out, in the order they were pushed. Must only be called by
+  /// one thread at a time. Passing the same vector each time avoids allocations once its capacity
+  /// is large enough.
+  void drain(std::vector<T>& out);
+
+  /// Returns true if there are no items in the queue. The result may be outdated immediately if
+  /// other threads push concurrently.
+  bool empty() const;
+
+ private:
+  struct Link {
+    T     mValue;
+    Link* mNext;
+  };
+
+  std::atomic<Link*> mHead;
+  FixedSizePool      mPool;
+};
+
+template <typename T>
+MPSCQueue<T>::MPSCQueue()
+    : mHead(nullptr)
+    , mPool(sizeof(Link), 64) {
+}
+
+template <typename T>
+MPSCQueue<T>::~MPSCQueue() {
+  Link* link = mHead.exchange(nullptr);
+
+  while (link) {
+    Link* next = link->mNext;
+    link->~Link();
+    mPool.deallocate(link);
+    link = next;
+  }
+}
+
+template <typename T>
+void MPSCQueue<T>::push(T value) {
+  auto* link = new (mPool.allocate()) Link{std::move(value), mHead.load(std::memory_order_relaxed)};
+
+  while (!mHead.compare_exchange_weak(
+      link->mNext, link, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+template <typename T>
+void MPSCQueue<T>::drain(std::vector<T>& out) {
+  Link* link = mHead.exchange(nullptr, std::memory_order_acquire);
+
+  // The detached list is in reverse push order.
+  Link* reversed = nullptr;
+
+  while (link) {
+    Link* next  = link->mNext;
+    link->mNext = reversed;
+    reversed    = link;
+    link        = next;
+  }
+
+  while (reversed) {
+    Link* next = reversed->mNext;
+    out.push_back(std::move(reversed->mValue));
+    reversed->~Link();
+    mPool.deallocate(reversed);
+    reversed = next;
+  }
+}
+
+template <typename T>
+bool MPSCQueue<T>::empty() const {
+  return mHead.load(std::memory_order_relaxed) == nullptr;
+}
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_MPSCQUEUE_HPP
@@ -7,6 +7,8 @@
 #include "MinMaxPyramid.hpp"
 #include "Tile.hpp"
 
+#include <cmath>
+
 namespace csp::lodbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -65,6 +67,14 @@ MinMaxPyramid::MinMaxPyramid(Tile<float>* tile)
       mMaxValue = std::max(mMaxValue, v);
       mAvgValue += v / (TileBase::SizeY * TileBase::SizeY);
 
+      if (x > 0) {
+        mMaxStep = std::max(mMaxStep, std::abs(v - tile->data()[y * TileBase::SizeX + x - 1]));
+      }
+
+      if (y > 0) {
+        mMaxStep = std::max(mMaxStep, std::abs(v - tile->data()[(y - 1) * TileBase::SizeX + x]));
+      }
+
       // Construct first 128x128 MinMaxPyramid layer by sampling 256x256 values
       x2                                  = std::min(x2, 127);
       y2                                  = std::min(y2, 127);
@@ -83,6 +93,27 @@ MinMaxPyramid::MinMaxPyramid(Tile<float>* tile)
     }
   }
 
+  // Compare all values which are not part of the half resolution grid with the value interpolated
+  // from their neighbours on that grid.
+  auto const value = [tile](int x, int y) { return tile->data()[y * TileBase::SizeX + x]; };
+
+  for (int y = 0; y < TileBase::SizeY; ++y) {
+    for (int x = (y % 2 == 0) ? 1 : 0; x < TileBase::SizeX; x += (y % 2 == 0) ? 2 : 1) {
+      float interpolated = 0.F;
+
+      if (y % 2 == 0) {
+        interpolated = 0.5F * (value(x - 1, y) + value(x + 1, y));
+      } else if (x % 2 == 0) {
+        interpolated = 0.5F * (value(x, y - 1) + value(x, y + 1));
+      } else {
+        interpolated = 0.25F * (value(x - 1, y - 1) + value(x + 1, y - 1) + value(x - 1, y + 1) +
+                                   value(x + 1, y + 1));
+      }
+
+      mGeometricError = std::max(mGeometricError, std::abs(value(x, y) - interpolated));
+    }
+  }
+
   // Build remaining MinMaxPyramid layers 64x62-2x2
   for (int i(1); i < 7; ++i) {
     y2 = 0;
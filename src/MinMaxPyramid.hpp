@@ -70,6 +70,20 @@ class MinMaxPyramid {
     return mAvgValue;
   }
 
+  /// The largest absolute difference between two horizontally or vertically adjacent values. It is
+  /// used to bound the slopes of the terrain, see calcOrientedTileBounds().
+  float getMaxStep() const {
+    return mMaxStep;
+  }
+
+  /// The largest difference between a value and the value interpolated bilinearly from every second
+  /// value of the tile, i.e. the error made by representing this tile with the resolution of its
+  /// parent. It is used to estimate how much detail refining the tile adds, see
+  /// calcGeometricError().
+  float getGeometricError() const {
+    return mGeometricError;
+  }
+
  protected:
   static float getData(std::vector<std::vector<float>>& pyramid, std::vector<int> const& quadrants);
 
@@ -77,9 +91,11 @@ class MinMaxPyramid {
   std::vector<std::vector<float>> mMinPyramid;
   std::vector<std::vector<float>> mMaxPyramid;
 
-  float mMinValue = std::numeric_limits<float>::max();
-  float mMaxValue = std::numeric_limits<float>::lowest();
-  float mAvgValue = 0.F;
+  float mMinValue       = std::numeric_limits<float>::max();
+  float mMaxValue       = std::numeric_limits<float>::lowest();
+  float mAvgValue       = 0.F;
+  float mMaxStep        = 0.F;
+  float mGeometricError = 0.F;
 };
 
 } // namespace csp::lodbodies
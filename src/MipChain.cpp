@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MipChain.hpp"
+
+#include "TileBase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+int getChannels(TileDataType dataType) {
+  return dataType == TileDataType::eU8Vec3 ? 3 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t getSampleBytes(TileDataType dataType) {
+  return dataType == TileDataType::eFloat32 ? sizeof(float)
+                                            : static_cast<std::size_t>(getChannels(dataType));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The samples of the previous level covered by a sample of the next level along one axis, and
+// the fraction of the sample of the next level each of them covers.
+struct Footprint {
+  int                mFirst;
+  std::vector<float> mWeights;
+};
+
+std::vector<Footprint> getFootprints(int srcSize, int dstSize) {
+  std::vector<Footprint> footprints(dstSize);
+  double const           ratio = static_cast<double>(srcSize) / dstSize;
+
+  for (int i = 0; i < dstSize; ++i) {
+    double const begin = i * ratio;
+    double const end   = (i + 1) * ratio;
+    int const    first = static_cast<int>(std::floor(begin));
+    int const    last  = std::min(srcSize, static_cast<int>(std::ceil(end)));
+
+    footprints[i].mFirst = first;
+
+    for (int j = first; j < last; ++j) {
+      double const overlap = std::min(end, j + 1.0) - std::max(begin, static_cast<double>(j));
+      footprints[i].mWeights.push_back(static_cast<float>(overlap / ratio));
+    }
+  }
+
+  return footprints;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Computes the next level with a box filter, first along the rows and then along the columns.
+// The second pass adds up whole rows, which the compiler vectorizes.
+std::vector<float> downsample(
+    std::vector<float> const& src, int srcX, int srcY, int dstX, int dstY, int channels) {
+  std::vector<Footprint> const footprintsX = getFootprints(srcX, dstX);
+  std::vector<Footprint> const footprintsY = getFootprints(srcY, dstY);
+
+  std::size_t const  rowSize = static_cast<std::size_t>(dstX) * channels;
+  std::vector<float> rows(rowSize * srcY, 0.F);
+
+  for (int y = 0; y < srcY; ++y) {
+    std::size_t const srcRow = static_cast<std::size_t>(y) * srcX * channels;
+
+    for (int x = 0; x < dstX; ++x) {
+      Footprint const& footprint = footprintsX[x];
+
+      for (std::size_t k = 0; k < footprint.mWeights.size(); ++k) {
+        std::size_t const sample = srcRow + (footprint.mFirst + k) * channels;
+
+        for (int c = 0; c < channels; ++c) {
+          rows[y * rowSize + x * channels + c] += footprint.mWeights[k] * src[sample + c];
+        }
+      }
+    }
+  }
+
+  std::vector<float> dst(rowSize * dstY, 0.F);
+
+  for (int y = 0; y < dstY; ++y) {
+    Footprint const& footprint = footprintsY[y];
+    float*           dstRow    = &dst[y * rowSize];
+
+    for (std::size_t k = 0; k < footprint.mWeights.size(); ++k) {
+      float const        weight = footprint.mWeights[k];
+      float const* const srcRow = &rows[(footprint.mFirst + k) * rowSize];
+
+      for (std::size_t i = 0; i < rowSize; ++i) {
+        dstRow[i] += weight * srcRow[i]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      }
+    }
+  }
+
+  return dst;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MipChain::MipChain(TileBase const& tile)
+    : mData(getBytes(tile.getDataType())) {
+  TileDataType const dataType = tile.getDataType();
+  int const          channels = getChannels(dataType);
+  std::size_t const  samples =
+      static_cast<std::size_t>(TileBase::SizeX) * TileBase::SizeY * channels;
+
+  // the levels are computed from each other in full precision
+  std::vector<float> level(samples);
+
+  if (dataType == TileDataType::eFloat32) {
+    auto const* data = tile.getTypedPtr<float>();
+    std::copy(data, data + samples, level.begin()); // NOLINT(*-pointer-arithmetic)
+  } else {
+    auto const* data = tile.getTypedPtr<std::uint8_t>();
+    std::copy(data, data + samples, level.begin()); // NOLINT(*-pointer-arithmetic)
+  }
+
+  for (int l = 1; l < getLevelCount(); ++l) {
+    level = downsample(level, getSizeX(l - 1), getSizeY(l - 1), getSizeX(l), getSizeY(l), channels);
+
+    std::uint8_t* out = &mData[getOffset(dataType, l)];
+
+    if (dataType == TileDataType::eFloat32) {
+      std::memcpy(out, level.data(), level.size() * sizeof(float));
+    } else {
+      std::transform(level.begin(), level.end(), out, [](float value) {
+        return static_cast<std::uint8_t>(std::clamp(std::lround(value), 0L, 255L));
+      });
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MipChain::getLevelCount() {
+  int const size  = std::max(TileBase::SizeX, TileBase::SizeY);
+  int       count = 1;
+
+  while ((size >> count) > 0) {
+    ++count;
+  }
+
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MipChain::getSizeX(int level) {
+  return std::max(1, TileBase::SizeX >> level);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MipChain::getSizeY(int level) {
+  return std::max(1, TileBase::SizeY >> level);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t MipChain::getBytes(TileDataType dataType) {
+  return getOffset(dataType, getLevelCount());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t MipChain::getOffset(TileDataType dataType, int level) {
+  std::size_t offset = 0;
+
+  for (int l = 1; l < level; ++l) {
+    offset += static_cast<std::size_t>(getSizeX(l)) * getSizeY(l) * getSampleBytes(dataType);
+  }
+
+  return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void const* MipChain::getData() const {
+  return mData.data();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
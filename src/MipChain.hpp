@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_MIPCHAIN_HPP
+#define CSP_LOD_BODIES_MIPCHAIN_HPP
+
+#include "TileDataType.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class TileBase;
+
+/// The mipmap levels of the data of a tile. They are computed on the loader threads (see
+/// TreeManagerBase::onNodeLoaded()) and uploaded together with the tile by a TileTextureArray.
+///
+/// Level n has max(1, SizeX >> n) x max(1, SizeY >> n) samples, as OpenGL expects. As the tiles
+/// have an odd number of samples, a sample of a level is not made of exactly 2x2 samples of the
+/// previous level. Instead, the samples of the previous level are weighted by how much of their
+/// area is covered by the sample, so that the levels stay aligned with level 0.
+class MipChain {
+ public:
+  /// Computes all levels below level 0 from the data of tile.
+  explicit MipChain(TileBase const& tile);
+
+  /// The number of levels of a tile, including level 0, down to a level with a single sample.
+  static int getLevelCount();
+
+  /// The number of samples of the given level in x and y direction.
+  static int getSizeX(int level);
+  static int getSizeY(int level);
+
+  /// The number of bytes of all levels but level 0 of a tile with the given data type.
+  static std::size_t getBytes(TileDataType dataType);
+
+  /// The offset of the given level, which must not be 0, in getData().
+  static std::size_t getOffset(TileDataType dataType, int level);
+
+  /// Returns all levels but level 0, one after another without any padding.
+  void const* getData() const;
+
+ private:
+  std::vector<std::uint8_t> mData;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_MIPCHAIN_HPP
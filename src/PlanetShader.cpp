@@ -24,10 +24,11 @@ namespace csp::lodbodies {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 namespace {
-GLenum const TEXUNITNAMEFONT = GL_TEXTURE10;
-GLenum const TEXUNITNAMELUT  = GL_TEXTURE11;
-GLint const  TEXUNITFONT     = 10;
-GLint const  TEXUNITLUT      = 11;
+// the units below are used by TileRenderer for the tile data and the shadow maps
+GLenum const TEXUNITNAMEFONT = GL_TEXTURE13;
+GLenum const TEXUNITNAMELUT  = GL_TEXTURE14;
+GLint const  TEXUNITFONT     = 13;
+GLint const  TEXUNITLUT      = 14;
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -159,6 +160,17 @@ void PlanetShader::compile() {
       cs::utils::toString(static_cast<int>(mPluginSettings->mTerrainProjectionType.get())));
 
   TerrainShader::compile();
+
+  mUniformLocs.mHeightTex         = mShader.GetUniformLocation("heightTex");
+  mUniformLocs.mFontTex           = mShader.GetUniformLocation("fontTex");
+  mUniformLocs.mHeightMin         = mShader.GetUniformLocation("heightMin");
+  mUniformLocs.mHeightMax         = mShader.GetUniformLocation("heightMax");
+  mUniformLocs.mSlopeMin          = mShader.GetUniformLocation("slopeMin");
+  mUniformLocs.mSlopeMax          = mShader.GetUniformLocation("slopeMax");
+  mUniformLocs.mAmbientBrightness = mShader.GetUniformLocation("ambientBrightness");
+  mUniformLocs.mTexGamma          = mShader.GetUniformLocation("texGamma");
+  mUniformLocs.mSunDirIlluminance = mShader.GetUniformLocation("uSunDirIlluminance");
+  mUniformLocs.mFarClip           = mShader.GetUniformLocation("farClip");
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -166,36 +178,17 @@ void PlanetShader::compile() {
 void PlanetShader::bind() {
   TerrainShader::bind();
 
-  GLint loc = -1;
-  loc       = mShader.GetUniformLocation("heightTex");
-  mShader.SetUniform(loc, TEXUNITLUT);
-
-  loc = mShader.GetUniformLocation("fontTex");
-  mShader.SetUniform(loc, TEXUNITFONT);
-
-  loc = mShader.GetUniformLocation("heightMin");
-  mShader.SetUniform(loc, mPluginSettings->mHeightRange.get().x);
-
-  loc = mShader.GetUniformLocation("heightMax");
-  mShader.SetUniform(loc, mPluginSettings->mHeightRange.get().y);
-
-  loc = mShader.GetUniformLocation("slopeMin");
-  mShader.SetUniform(loc, mPluginSettings->mSlopeRange.get().x);
-
-  loc = mShader.GetUniformLocation("slopeMax");
-  mShader.SetUniform(loc, mPluginSettings->mSlopeRange.get().y);
-
-  loc = mShader.GetUniformLocation("ambientBrightness");
-  mShader.SetUniform(loc, mSettings->mGraphics.pAmbientBrightness.get());
-
-  loc = mShader.GetUniformLocation("texGamma");
-  mShader.SetUniform(loc, mPluginSettings->mTextureGamma.get());
-
-  loc = mShader.GetUniformLocation("uSunDirIlluminance");
-  mShader.SetUniform(loc, mSunDirection.x, mSunDirection.y, mSunDirection.z, mSunIlluminance);
-
-  loc = mShader.GetUniformLocation("farClip");
-  mShader.SetUniform(loc, cs::utils::getCurrentFarClipDistance());
+  // only the values which changed since the last frame are uploaded
+  setUniform(mUniformLocs.mHeightTex, TEXUNITLUT);
+  setUniform(mUniformLocs.mFontTex, TEXUNITFONT);
+  setUniform(mUniformLocs.mHeightMin, mPluginSettings->mHeightRange.get().x);
+  setUniform(mUniformLocs.mHeightMax, mPluginSettings->mHeightRange.get().y);
+  setUniform(mUniformLocs.mSlopeMin, mPluginSettings->mSlopeRange.get().x);
+  setUniform(mUniformLocs.mSlopeMax, mPluginSettings->mSlopeRange.get().y);
+  setUniform(mUniformLocs.mAmbientBrightness, mSettings->mGraphics.pAmbientBrightness.get());
+  setUniform(mUniformLocs.mTexGamma, mPluginSettings->mTextureGamma.get());
+  setUniform(mUniformLocs.mSunDirIlluminance, glm::vec4(mSunDirection, mSunIlluminance));
+  setUniform(mUniformLocs.mFarClip, cs::utils::getCurrentFarClipDistance());
 
   mFontTexture->Bind(TEXUNITNAMEFONT);
 
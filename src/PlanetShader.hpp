@@ -49,11 +49,26 @@ class PlanetShader : public TerrainShader {
   void release() override;
 
  private:
+  /// The locations of the uniforms of Planet.vert and Planet.frag, resolved by compile().
+  struct UniformLocs {
+    GLint mHeightTex         = -1;
+    GLint mFontTex           = -1;
+    GLint mHeightMin         = -1;
+    GLint mHeightMax         = -1;
+    GLint mSlopeMin          = -1;
+    GLint mSlopeMax          = -1;
+    GLint mAmbientBrightness = -1;
+    GLint mTexGamma          = -1;
+    GLint mSunDirIlluminance = -1;
+    GLint mFarClip           = -1;
+  };
+
   void compile() override;
 
   std::shared_ptr<cs::core::Settings>   mSettings;
   std::shared_ptr<cs::core::GuiManager> mGuiManager;
   std::shared_ptr<Plugin::Settings>     mPluginSettings;
+  UniformLocs                           mUniformLocs;
   glm::vec3                             mSunDirection                 = glm::vec3(0, 1, 0);
   float                                 mSunIlluminance               = 1.F;
   VistaTexture*                         mFontTexture                  = nullptr;
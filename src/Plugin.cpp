@@ -84,6 +84,7 @@ void to_json(nlohmann::json& j, Plugin::Settings::Dataset const& o) {
 void from_json(nlohmann::json const& j, Plugin::Settings::Body& o) {
   cs::core::Settings::deserialize(j, "activeDemDataset", o.mActiveDemDataset);
   cs::core::Settings::deserialize(j, "activeImgDataset", o.mActiveImgDataset);
+  cs::core::Settings::deserialize(j, "frameBudget", o.mFrameBudget);
   cs::core::Settings::deserialize(j, "demDatasets", o.mDemDatasets);
   cs::core::Settings::deserialize(j, "imgDatasets", o.mImgDatasets);
 }
@@ -91,6 +92,7 @@ void from_json(nlohmann::json const& j, Plugin::Settings::Body& o) {
 void to_json(nlohmann::json& j, Plugin::Settings::Body const& o) {
   cs::core::Settings::serialize(j, "activeDemDataset", o.mActiveDemDataset);
   cs::core::Settings::serialize(j, "activeImgDataset", o.mActiveImgDataset);
+  cs::core::Settings::serialize(j, "frameBudget", o.mFrameBudget);
   cs::core::Settings::serialize(j, "demDatasets", o.mDemDatasets);
   cs::core::Settings::serialize(j, "imgDatasets", o.mImgDatasets);
 }
@@ -101,6 +103,8 @@ void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "terrainProjectionType", o.mTerrainProjectionType);
   cs::core::Settings::deserialize(j, "lodFactor", o.mLODFactor);
   cs::core::Settings::deserialize(j, "autoLod", o.mAutoLOD);
+  cs::core::Settings::deserialize(j, "autoLodFrameTime", o.mAutoLODFrameTime);
+  cs::core::Settings::deserialize(j, "autoLodRange", o.mAutoLODRange);
   cs::core::Settings::deserialize(j, "textureGamma", o.mTextureGamma);
   cs::core::Settings::deserialize(j, "enableHeightlines", o.mEnableHeightlines);
   cs::core::Settings::deserialize(j, "enableLatLongGrid", o.mEnableLatLongGrid);
@@ -115,6 +119,19 @@ void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "maxGPUTilesColor", o.mMaxGPUTilesColor);
   cs::core::Settings::deserialize(j, "maxGPUTilesGray", o.mMaxGPUTilesGray);
   cs::core::Settings::deserialize(j, "maxGPUTilesDEM", o.mMaxGPUTilesDEM);
+  cs::core::Settings::deserialize(j, "maxRetainedDatasets", o.mMaxRetainedDatasets);
+  cs::core::Settings::deserialize(j, "maxRetainedMemory", o.mMaxRetainedMemory);
+  cs::core::Settings::deserialize(j, "maxUploadMemory", o.mMaxUploadMemory);
+  cs::core::Settings::deserialize(j, "traversalThreads", o.mTraversalThreads);
+  cs::core::Settings::deserialize(j, "drawListThreads", o.mDrawListThreads);
+  cs::core::Settings::deserialize(j, "enableTemporalCoherence", o.mEnableTemporalCoherence);
+  cs::core::Settings::deserialize(j, "enableOrientedBounds", o.mEnableOrientedBounds);
+  cs::core::Settings::deserialize(j, "enableGeometricLod", o.mEnableGeometricLod);
+  cs::core::Settings::deserialize(j, "enableOcclusionCulling", o.mEnableOcclusionCulling);
+  cs::core::Settings::deserialize(j, "loadAheadLevels", o.mLoadAheadLevels);
+  cs::core::Settings::deserialize(j, "enableVirtualTextures", o.mEnableVirtualTextures);
+  cs::core::Settings::deserialize(j, "enableMipmaps", o.mEnableMipmaps);
+  cs::core::Settings::deserialize(j, "tileTraceDirectory", o.mTileTraceDirectory);
   cs::core::Settings::deserialize(j, "mapCache", o.mMapCache);
   cs::core::Settings::deserialize(j, "bodies", o.mBodies);
 }
@@ -123,6 +140,8 @@ void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "terrainProjectionType", o.mTerrainProjectionType);
   cs::core::Settings::serialize(j, "lodFactor", o.mLODFactor);
   cs::core::Settings::serialize(j, "autoLod", o.mAutoLOD);
+  cs::core::Settings::serialize(j, "autoLodFrameTime", o.mAutoLODFrameTime);
+  cs::core::Settings::serialize(j, "autoLodRange", o.mAutoLODRange);
   cs::core::Settings::serialize(j, "textureGamma", o.mTextureGamma);
   cs::core::Settings::serialize(j, "enableHeightlines", o.mEnableHeightlines);
   cs::core::Settings::serialize(j, "enableLatLongGrid", o.mEnableLatLongGrid);
@@ -137,6 +156,19 @@ void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "maxGPUTilesColor", o.mMaxGPUTilesColor);
   cs::core::Settings::serialize(j, "maxGPUTilesGray", o.mMaxGPUTilesGray);
   cs::core::Settings::serialize(j, "maxGPUTilesDEM", o.mMaxGPUTilesDEM);
+  cs::core::Settings::serialize(j, "maxRetainedDatasets", o.mMaxRetainedDatasets);
+  cs::core::Settings::serialize(j, "maxRetainedMemory", o.mMaxRetainedMemory);
+  cs::core::Settings::serialize(j, "maxUploadMemory", o.mMaxUploadMemory);
+  cs::core::Settings::serialize(j, "traversalThreads", o.mTraversalThreads);
+  cs::core::Settings::serialize(j, "drawListThreads", o.mDrawListThreads);
+  cs::core::Settings::serialize(j, "enableTemporalCoherence", o.mEnableTemporalCoherence);
+  cs::core::Settings::serialize(j, "enableOrientedBounds", o.mEnableOrientedBounds);
+  cs::core::Settings::serialize(j, "enableGeometricLod", o.mEnableGeometricLod);
+  cs::core::Settings::serialize(j, "enableOcclusionCulling", o.mEnableOcclusionCulling);
+  cs::core::Settings::serialize(j, "loadAheadLevels", o.mLoadAheadLevels);
+  cs::core::Settings::serialize(j, "enableVirtualTextures", o.mEnableVirtualTextures);
+  cs::core::Settings::serialize(j, "enableMipmaps", o.mEnableMipmaps);
+  cs::core::Settings::serialize(j, "tileTraceDirectory", o.mTileTraceDirectory);
   cs::core::Settings::serialize(j, "mapCache", o.mMapCache);
   cs::core::Settings::serialize(j, "bodies", o.mBodies);
 }
@@ -368,6 +400,7 @@ void Plugin::init() {
   mPluginSettings->mAutoLOD.connect([this](bool enabled) {
     if (enabled) {
       mNonAutoLod = mPluginSettings->mLODFactor.get();
+      mLodController.reset();
     } else {
       mPluginSettings->mLODFactor = mNonAutoLod;
       mGuiManager->getGui()->callJavascript(
@@ -384,14 +417,14 @@ void Plugin::init() {
 
   mPluginSettings->mMapCache.connect([this](std::string const& val) {
     for (auto&& body : mLodBodies) {
-      auto src =
-          std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getDEMtileSource());
-      if (src) {
-        src->setCacheDirectory(val);
-      }
-      src = std::dynamic_pointer_cast<TileSourceWebMapService>(body.second->getIMGtileSource());
-      if (src) {
-        src->setCacheDirectory(val);
+      for (auto const& source :
+          {body.second->getDEMtileSource(), body.second->getIMGtileSource()}) {
+        auto shared = std::dynamic_pointer_cast<SharedTileSource>(source);
+        auto src    = std::dynamic_pointer_cast<TileSourceWebMapService>(
+            shared ? shared->getSource() : source);
+        if (src) {
+          src->setCacheDirectory(val);
+        }
       }
     }
   });
@@ -445,20 +478,20 @@ void Plugin::deInit() {
 void Plugin::update() {
   if (mPluginSettings->mAutoLOD.get()) {
 
-    double minLODFactor = 15.0;
-    double maxLODFactor = 50.0;
-    double minTime      = 13.5;
-    double maxTime      = 14.5;
-
-    if (mFrameTimings->pFrameTime.get() > maxTime) {
-      mPluginSettings->mLODFactor = static_cast<float>(std::max(
-          minLODFactor, mPluginSettings->mLODFactor.get() -
-                            std::min(1.0, 0.1 * (mFrameTimings->pFrameTime.get() - maxTime))));
-    } else if (mFrameTimings->pFrameTime.get() < minTime) {
-      mPluginSettings->mLODFactor = static_cast<float>(std::min(
-          maxLODFactor, mPluginSettings->mLODFactor.get() +
-                            std::min(1.0, 0.02 * (minTime - mFrameTimings->pFrameTime.get()))));
+    // All bodies share the frame time, so the triangles of all of them are considered together.
+    // The resulting LOD factor is passed on to each body's VistaPlanet.
+    std::size_t triangles = 0;
+
+    for (auto const& body : mLodBodies) {
+      triangles += body.second->getNumTriangles();
     }
+
+    glm::vec2 const range = mPluginSettings->mAutoLODRange.get();
+    mLodController.setTargetTime(mPluginSettings->mAutoLODFrameTime.get());
+    mLodController.setRange(range.x, range.y);
+
+    mPluginSettings->mLODFactor = static_cast<float>(mLodController.update(
+        mFrameTimings->pFrameTime.get(), triangles, mPluginSettings->mLODFactor.get()));
   }
 }
 
@@ -469,25 +502,28 @@ void Plugin::onLoad() {
   // Read settings from JSON.
   from_json(mAllSettings->mPlugins.at("csp-lod-bodies"), *mPluginSettings);
 
-  // For now, we cannot re-create the GLResources.
+  // The GLResources are shared by all bodies, changes of the tile budgets are applied to them.
   if (!mGLResources) {
     mGLResources =
         std::make_shared<csp::lodbodies::GLResources>(mPluginSettings->mMaxGPUTilesDEM.get(),
-            mPluginSettings->mMaxGPUTilesGray.get(), mPluginSettings->mMaxGPUTilesColor.get());
+            mPluginSettings->mMaxGPUTilesGray.get(), mPluginSettings->mMaxGPUTilesColor.get(),
+            mPluginSettings->mEnableVirtualTextures.get(), mPluginSettings->mEnableMipmaps.get());
+
+    mPluginSettings->mMaxGPUTilesColor.connect([this](uint32_t val) {
+      mGLResources->setMaxLayerCount(TileDataType::eU8Vec3, static_cast<int>(val));
+    });
 
-    mPluginSettings->mMaxGPUTilesColor.connect([](uint32_t /*val*/) {
-      logger().warn("Changing the maximum number of allocated color tiles at run-time is not "
-                    "supported. Please restart CosmoScout VR!");
+    mPluginSettings->mMaxGPUTilesGray.connect([this](uint32_t val) {
+      mGLResources->setMaxLayerCount(TileDataType::eUInt8, static_cast<int>(val));
     });
 
-    mPluginSettings->mMaxGPUTilesGray.connect([](uint32_t /*val*/) {
-      logger().warn("Changing the maximum number of allocated gray-scale tiles at run-time is not "
-                    "supported. Please restart CosmoScout VR!");
+    mPluginSettings->mMaxGPUTilesDEM.connect([this](uint32_t val) {
+      mGLResources->setMaxLayerCount(TileDataType::eFloat32, static_cast<int>(val));
     });
 
-    mPluginSettings->mMaxGPUTilesDEM.connect([](uint32_t /*val*/) {
-      logger().warn("Changing the maximum number of allocated elevation tiles at run-time is not "
-                    "supported. Please restart CosmoScout VR!");
+    // The retained trees of all bodies share one budget as well.
+    mPluginSettings->mMaxRetainedMemory.connectAndTouch([this](uint32_t val) {
+      mRetainBudget->setMaxBytes(static_cast<std::size_t>(val) * 1024 * 1024);
     });
   }
 
@@ -507,6 +543,7 @@ void Plugin::onLoad() {
 
       setImageSource(lodBody->second, settings->second.mActiveImgDataset);
       setElevationSource(lodBody->second, settings->second.mActiveDemDataset);
+      lodBody->second->setFrameBudget(settings->second.mFrameBudget.value_or(0.F));
 
       ++lodBody;
     } else {
@@ -536,12 +573,13 @@ void Plugin::onLoad() {
 
     auto body = std::make_shared<LodBody>(mAllSettings, mGraphicsEngine, mSolarSystem,
         mPluginSettings, mGuiManager, anchor->second.mCenter, anchor->second.mFrame, mGLResources,
-        tStartExistence, tEndExistence);
+        mRetainBudget, tStartExistence, tEndExistence);
 
     mLodBodies.emplace(settings.first, body);
 
     setImageSource(body, settings.second.mActiveImgDataset);
     setElevationSource(body, settings.second.mActiveDemDataset);
+    body->setFrameBudget(settings.second.mFrameBudget.value_or(0.F));
 
     body->setSun(mSolarSystem->getSun());
 
@@ -585,7 +623,8 @@ void Plugin::setImageSource(std::shared_ptr<LodBody> const& body, std::string co
     source->setUrl(dataset->second.mURL);
     source->setDataType(dataset->second.mFormat);
 
-    body->setIMGtileSource(source);
+    // Bodies using the same dataset share the source and its tiles.
+    body->setIMGtileSource(mTileSources->acquire(source));
 
     mGuiManager->getGui()->callJavascript(
         "CosmoScout.lodBodies.setMapDataCopyright", dataset->second.mCopyright);
@@ -615,7 +654,7 @@ void Plugin::setElevationSource(
   source->setUrl(dataset->second.mURL);
   source->setDataType(dataset->second.mFormat);
 
-  body->setDEMtileSource(source);
+  body->setDEMtileSource(mTileSources->acquire(source));
 
   mGuiManager->getGui()->callJavascript(
       "CosmoScout.lodBodies.setElevationDataCopyright", dataset->second.mCopyright);
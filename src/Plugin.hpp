@@ -10,10 +10,14 @@
 #include "../../../src/cs-core/PluginBase.hpp"
 #include "../../../src/cs-utils/DefaultProperty.hpp"
 
+#include "LodController.hpp"
+#include "RetainBudget.hpp"
+#include "SharedTileSource.hpp"
 #include "TileDataType.hpp"
 #include "TileSourceWebMapService.hpp"
 
 #include <glm/gtc/constants.hpp>
+#include <optional>
 #include <vector>
 
 class VistaOpenGLNode;
@@ -45,6 +49,13 @@ class Plugin : public cs::core::PluginBase {
     /// rendering performance.
     cs::utils::DefaultProperty<bool> mAutoLOD{true};
 
+    /// The frame time in milliseconds the automatic level-of-detail aims for, for example 11.1 for
+    /// head-mounted displays running at 90 Hz.
+    cs::utils::DefaultProperty<float> mAutoLODFrameTime{14.F};
+
+    /// The range of the level-of-detail factor chosen by the automatic level-of-detail.
+    cs::utils::DefaultProperty<glm::vec2> mAutoLODRange{glm::vec2(15.F, 50.F)};
+
     /// A multiplier for the brightness of the image channel.
     cs::utils::DefaultProperty<float> mTextureGamma{1.F};
 
@@ -92,6 +103,61 @@ class Plugin : public cs::core::PluginBase {
     /// The maximum allowed elevation tiles.
     cs::utils::DefaultProperty<uint32_t> mMaxGPUTilesDEM{512};
 
+    /// The number of previously used datasets per body and channel whose tiles are kept in memory.
+    /// Switching back to such a dataset does not require reloading its tiles.
+    cs::utils::DefaultProperty<uint32_t> mMaxRetainedDatasets{2};
+
+    /// The maximum amount of tile data in MiB the retained datasets of all bodies may occupy
+    /// together. Tiles shared by bodies using the same dataset are counted once.
+    cs::utils::DefaultProperty<uint32_t> mMaxRetainedMemory{512};
+
+    /// The amount of tile data in MiB uploaded to the GPU per frame for each body and channel. The
+    /// tiles most important for the current view are uploaded first.
+    cs::utils::DefaultProperty<uint32_t> mMaxUploadMemory{8};
+
+    /// The number of threads used to determine the tiles to load and draw for each body. The twelve
+    /// root tiles of the HEALPix scheme are distributed among these threads.
+    cs::utils::DefaultProperty<uint32_t> mTraversalThreads{1};
+
+    /// The number of threads used to prepare the draw parameters of the selected tiles for each
+    /// body. This only pays off for several thousand tiles per frame.
+    cs::utils::DefaultProperty<uint32_t> mDrawListThreads{1};
+
+    /// If enabled, the level of detail decisions of previous frames are reused as long as the
+    /// camera does not move too far.
+    cs::utils::DefaultProperty<bool> mEnableTemporalCoherence{true};
+
+    /// If enabled, tiles are culled and their size on screen is estimated with bounding boxes
+    /// aligned to their surface and a cone of their normals instead of axis aligned boxes.
+    cs::utils::DefaultProperty<bool> mEnableOrientedBounds{true};
+
+    /// If enabled, elevation tiles are refined when their geometric error exceeds a threshold on
+    /// screen, which depends on the LOD factor. Otherwise they are refined based on their size.
+    cs::utils::DefaultProperty<bool> mEnableGeometricLod{true};
+
+    /// If enabled, tiles hidden behind the terrain drawn in the previous frame are culled. Building
+    /// the horizon map costs about 3 ms per frame for 4500 tiles, which is only worth it for
+    /// rugged terrain where many tiles are hidden. On flat terrain it culls nothing.
+    cs::utils::DefaultProperty<bool> mEnableOcclusionCulling{false};
+
+    /// The number of levels below the missing children of a tile which are requested in advance
+    /// towards the camera. Higher values reach the surface in fewer round trips to the map server.
+    cs::utils::DefaultProperty<uint32_t> mLoadAheadLevels{3};
+
+    /// If enabled, only the pages of the image tiles which are actually seen are kept on the GPU,
+    /// so that more image tiles fit into maxGPUTilesColor and maxGPUTilesGray. This is only read
+    /// when the plugin is loaded.
+    cs::utils::DefaultProperty<bool> mEnableVirtualTextures{false};
+
+    /// If enabled, the image tiles on the GPU have mipmap levels. This reduces aliasing of distant
+    /// terrain at the cost of a third more memory per tile. It is ignored if virtual textures are
+    /// enabled and only read when the plugin is loaded.
+    cs::utils::DefaultProperty<bool> mEnableMipmaps{false};
+
+    /// If not empty, the tiles used in each frame are written to "<anchor name>-dem.trace" and
+    /// "<anchor name>-img.trace" in this folder. The tests of EvictionPolicy replay these traces.
+    cs::utils::DefaultProperty<std::string> mTileTraceDirectory{""};
+
     /// Path to the map cache folder, can be absolute or relative to the cosmoscout executable.
     cs::utils::DefaultProperty<std::string> mMapCache{"map-cache"};
 
@@ -108,6 +174,7 @@ class Plugin : public cs::core::PluginBase {
     struct Body {
       std::string mActiveDemDataset; ///< The name of the currently active elevation data set.
       std::string mActiveImgDataset; ///< The name of the currently active image data set.
+      std::optional<float> mFrameBudget; ///< Milliseconds per frame for this body, 0 for no limit.
       std::map<std::string, Dataset> mDemDatasets; ///< The data sets containing elevation data.
       std::map<std::string, Dataset> mImgDatasets; ///< The data sets containing image data.
     };
@@ -129,8 +196,12 @@ class Plugin : public cs::core::PluginBase {
 
   std::shared_ptr<Settings>                       mPluginSettings = std::make_shared<Settings>();
   std::shared_ptr<GLResources>                    mGLResources;
+  std::shared_ptr<TileSourceRegistry>             mTileSources =
+      std::make_shared<TileSourceRegistry>();
+  std::shared_ptr<RetainBudget>                   mRetainBudget = std::make_shared<RetainBudget>();
   std::map<std::string, std::shared_ptr<LodBody>> mLodBodies;
   float                                           mNonAutoLod{};
+  LodController                                   mLodController;
 
   int mActiveBodyConnection = -1;
   int mOnLoadConnection     = -1;
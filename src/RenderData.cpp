@@ -29,6 +29,7 @@ TileId const& RenderData::getTileId() const {
 /* explicit */
 RenderData::RenderData(TileNode* node)
     : mNode(node)
+    , mTexPage(-1)
     , mTexLayer(-1)
     , mLastFrame(-1) {
 }
@@ -61,6 +62,30 @@ bool RenderData::hasBounds() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+RenderData::LodDecision const& RenderData::getLodDecision() const {
+  return mLodDecision;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderData::setLodDecision(LodDecision const& decision) {
+  mLodDecision = decision;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RenderData::Corners const& RenderData::getCorners() const {
+  return mCorners;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderData::setCorners(Corners const& corners) {
+  mCorners = corners;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 TileNode* RenderData::getNode() const {
   return mNode;
 }
@@ -85,6 +110,18 @@ glm::int64 RenderData::getPatchIdx() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+int RenderData::getTexPage() const {
+  return mTexPage;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderData::setTexPage(int page) {
+  mTexPage = page;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 int RenderData::getTexLayer() const {
   return mTexLayer;
 }
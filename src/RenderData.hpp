@@ -26,12 +26,38 @@ class RenderData : private boost::noncopyable {
 
   virtual ~RenderData();
 
+  /// A refinement decision of LODVisitor, which is reused in later frames as long as the camera
+  /// stays within mValidRadius of the reference position of mGeneration (see
+  /// LODVisitor::setTemporalCoherence).
+  struct LodDecision {
+    int    mGeneration{-1};
+    bool   mRefine{};
+    bool   mRefineDEM{};
+    int    mMaxLevel{};
+    int    mMaxLevelDEM{};
+    double mValidRadius{};
+  };
+
+  /// The corners of the tile at mHeight above the surface and the surface normals at them, in model
+  /// space and in order N, W, S, E. The TileDrawList caches them here, as they only change with
+  /// the height.
+  struct Corners {
+    TileId                    mTileId;
+    double                    mHeight{};
+    std::array<glm::dvec3, 4> mPositions{};
+    std::array<glm::dvec3, 4> mNormals{};
+  };
+
   TileNode*     getNode() const;
   void          setNode(TileNode* node);
   int           getLevel() const;
   glm::int64    getPatchIdx() const;
   TileId const& getTileId() const;
 
+  /// The page and layer of the TileTextureArray the tile is stored in. The layer is -1 if the tile
+  /// is not on the GPU.
+  int  getTexPage() const;
+  void setTexPage(int page);
   int  getTexLayer() const;
   void setTexLayer(int layer);
 
@@ -44,15 +70,25 @@ class RenderData : private boost::noncopyable {
   void                       removeBounds();
   bool                       hasBounds() const;
 
+  LodDecision const& getLodDecision() const;
+  void               setLodDecision(LodDecision const& decision);
+
+  /// Initially the corners are those of an invalid TileId.
+  Corners const& getCorners() const;
+  void           setCorners(Corners const& corners);
+
  protected:
   explicit RenderData(TileNode* node = nullptr);
   BoundingBox<double> mTb;
   bool                mHasBounds{};
 
  private:
-  TileNode* mNode{};
-  int       mTexLayer{};
-  int       mLastFrame{};
+  TileNode*   mNode{};
+  int         mTexPage{};
+  int         mTexLayer{};
+  int         mLastFrame{};
+  LodDecision mLodDecision;
+  Corners     mCorners;
 };
 
 } // namespace csp::lodbodies
@@ -19,7 +19,10 @@ RenderDataDEM::RenderDataDEM(TileNode* node)
     : RenderData(node)
     , mLodDeltas()
     , mEdgeRData()
-    , mFlags(0) {
+    , mFlags(0)
+    , mOrientedBounds()
+    , mGeometricError(0.0)
+    , mOccluders() {
   resetEdgeDeltas();
   resetEdgeRData();
 }
@@ -101,6 +104,42 @@ void RenderDataDEM::clearFlags() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+OrientedTileBounds const& RenderDataDEM::getOrientedBounds() const {
+  return mOrientedBounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderDataDEM::setOrientedBounds(OrientedTileBounds const& bounds) {
+  mOrientedBounds = bounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double RenderDataDEM::getGeometricError() const {
+  return mGeometricError;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderDataDEM::setGeometricError(double error) {
+  mGeometricError = error;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileOccluders const& RenderDataDEM::getOccluders() const {
+  return mOccluders;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RenderDataDEM::setOccluders(TileOccluders const& occluders) {
+  mOccluders = occluders;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 RenderDataDEM::Flags operator&(RenderDataDEM::Flags lhs, RenderDataDEM::Flags rhs) {
   return RenderDataDEM::Flags(static_cast<int>(lhs) & static_cast<int>(rhs));
 }
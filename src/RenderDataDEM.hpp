@@ -43,10 +43,29 @@ class RenderDataDEM : public RenderData {
   glm::uint8 getFlags() const;
   void       clearFlags();
 
+  /// Bounds aligned to the tile's surface with a cone of its normals. They are much tighter than
+  /// the axis aligned getBounds() and are used by the LODVisitor for culling and for estimating the
+  /// size of the tile on screen.
+  OrientedTileBounds const& getOrientedBounds() const;
+  void                      setOrientedBounds(OrientedTileBounds const& bounds);
+
+  /// The estimated geometric error of the tile in model space units (see calcGeometricError()). The
+  /// LODVisitor refines tiles whose error is too large when projected to the screen.
+  double getGeometricError() const;
+  void   setGeometricError(double error);
+
+  /// Parts of the tile which hide the terrain behind them (see calcTileOccluders()). The LODVisitor
+  /// uses those of the tiles rendered in the previous frame for occlusion culling.
+  TileOccluders const& getOccluders() const;
+  void                 setOccluders(TileOccluders const& occluders);
+
  private:
   std::array<glm::int8, 4>      mLodDeltas;
   std::array<RenderDataDEM*, 4> mEdgeRData;
   glm::uint8                    mFlags;
+  OrientedTileBounds            mOrientedBounds;
+  double                        mGeometricError;
+  TileOccluders                 mOccluders;
 };
 
 RenderDataDEM::Flags operator&(RenderDataDEM::Flags lhs, RenderDataDEM::Flags rhs);
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "RetainBudget.hpp"
+
+#include "TileBase.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t getTileBytes(TileDataType dataType) {
+  std::size_t const samples = TileBase::SizeX * TileBase::SizeY;
+
+  switch (dataType) {
+  case TileDataType::eFloat32:
+    return samples * sizeof(float);
+  case TileDataType::eUInt8:
+    return samples;
+  case TileDataType::eU8Vec3:
+    return samples * 3;
+  }
+
+  return samples;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RetainBudget::setMaxBytes(std::size_t bytes) {
+  mMaxBytes = bytes;
+  enforceLimit();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t RetainBudget::getMaxBytes() const {
+  return mMaxBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t RetainBudget::getUsedBytes() const {
+  return mUsedBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t RetainBudget::getTreeCount() const {
+  return mTrees.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RetainBudget::add(void const* owner, TileSource const* source,
+    std::vector<TileBase const*> tiles, DropCallback drop) {
+  // a tree is retained only once per owner and source, replace a stale registration
+  remove(owner, source);
+
+  for (TileBase const* tile : tiles) {
+    TileRefs& refs = mTiles[tile];
+
+    if (refs.mTrees++ == 0) {
+      refs.mBytes = getTileBytes(tile->getDataType());
+      mUsedBytes += refs.mBytes;
+    }
+  }
+
+  mTrees.push_front(Tree{owner, source, std::move(tiles), std::move(drop)});
+
+  enforceLimit();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RetainBudget::remove(void const* owner, TileSource const* source) {
+  auto it = std::find_if(mTrees.begin(), mTrees.end(),
+      [owner, source](Tree const& tree) { return tree.mOwner == owner && tree.mSource == source; });
+
+  if (it != mTrees.end()) {
+    release(*it);
+    mTrees.erase(it);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RetainBudget::removeAll(void const* owner) {
+  for (auto it = mTrees.begin(); it != mTrees.end();) {
+    if (it->mOwner == owner) {
+      release(*it);
+      it = mTrees.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RetainBudget::release(Tree const& tree) {
+  for (TileBase const* tile : tree.mTiles) {
+    auto it = mTiles.find(tile);
+
+    if (--it->second.mTrees == 0) {
+      mUsedBytes -= it->second.mBytes;
+      mTiles.erase(it);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RetainBudget::enforceLimit() {
+  while (!mTrees.empty() && mUsedBytes > mMaxBytes) {
+    Tree const&       oldest = mTrees.back();
+    void const*       owner  = oldest.mOwner;
+    TileSource const* source = oldest.mSource;
+
+    // The callback unregisters the tree, which destroys the callback. Hence it is moved out first.
+    DropCallback drop = std::move(mTrees.back().mDrop);
+    drop();
+
+    // in case the callback did not unregister the tree
+    remove(owner, source);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
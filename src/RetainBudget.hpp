@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_RETAINBUDGET_HPP
+#define CSP_LOD_BODIES_RETAINBUDGET_HPP
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class TileBase;
+class TileSource;
+
+/// Limits the memory occupied by the retained trees of all TreeManagers together (see
+/// TreeManagerBase::setMaxRetainedTrees). Each retained tree is registered with its tiles. Tiles
+/// which are shared by several trees, e.g. of two bodies using the same dataset (see
+/// SharedTileSource), are counted once. If the limit is exceeded, the least recently retained trees
+/// are dropped, regardless of the TreeManager they belong to.
+///
+/// All methods must be called from the render thread.
+class RetainBudget {
+ public:
+  /// Called when a tree is dropped. It has to release the tree and call remove() for it.
+  using DropCallback = std::function<void()>;
+
+  /// Sets the maximum amount of tile data in bytes all retained trees may occupy together.
+  void        setMaxBytes(std::size_t bytes);
+  std::size_t getMaxBytes() const;
+
+  /// Returns the amount of tile data the registered trees occupy.
+  std::size_t getUsedBytes() const;
+
+  /// Returns the number of registered trees.
+  std::size_t getTreeCount() const;
+
+  /// Registers the tree owner retained for source, which holds the given tiles. It becomes the most
+  /// recently retained tree. Afterwards trees are dropped until the limit is met, which may include
+  /// this one if it exceeds the limit on its own.
+  void add(void const* owner, TileSource const* source, std::vector<TileBase const*> tiles,
+      DropCallback drop);
+
+  /// Unregisters the tree owner retained for source, e.g. because it has been restored or dropped.
+  /// Does nothing if there is no such tree.
+  void remove(void const* owner, TileSource const* source);
+
+  /// Unregisters all trees of owner without calling their DropCallbacks.
+  void removeAll(void const* owner);
+
+ private:
+  struct Tree {
+    void const*                  mOwner;
+    TileSource const*            mSource;
+    std::vector<TileBase const*> mTiles;
+    DropCallback                 mDrop;
+  };
+
+  /// The number of registered trees which hold a tile and its size.
+  struct TileRefs {
+    int         mTrees;
+    std::size_t mBytes;
+  };
+
+  void release(Tree const& tree);
+
+  /// Drops the least recently retained trees until the limit is met.
+  void enforceLimit();
+
+  std::list<Tree>                               mTrees; ///< Most recently retained first.
+  std::unordered_map<TileBase const*, TileRefs> mTiles;
+  std::size_t                                   mMaxBytes{};
+  std::size_t                                   mUsedBytes{};
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_RETAINBUDGET_HPP
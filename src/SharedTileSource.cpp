@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SharedTileSource.hpp"
+
+#include "TileNode.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Expired cache entries are removed once the cache exceeds this size, the threshold then grows
+// with the number of tiles actually alive.
+std::size_t const minSweepThreshold = 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+SharedTileSource::SharedTileSource(std::shared_ptr<TileSource> source)
+    : mSweepThreshold(minSweepThreshold)
+    , mConsumers(0)
+    , mSource(std::move(source)) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SharedTileSource::~SharedTileSource() {
+  // Shut down the wrapped source while this is still intact, as pending requests call
+  // onNodeLoaded.
+  mSource->fini();
+  mSource.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<TileSource> const& SharedTileSource::getSource() const {
+  return mSource;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SharedTileSource::init() {
+  bool first = false;
+
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    first = mConsumers++ == 0;
+  }
+
+  if (first) {
+    mSource->init();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SharedTileSource::fini() {
+  bool last = false;
+
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    last = mConsumers > 0 && --mConsumers == 0;
+  }
+
+  // Not done while holding mMutex, as the wrapped source may wait for its loader threads, which
+  // call onNodeLoaded.
+  if (last) {
+    mSource->fini();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileDataType SharedTileSource::getDataType() const {
+  return mSource->getDataType();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileNode* SharedTileSource::loadTile(int level, glm::int64 patchIdx) {
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (TileNode* node = findCached(TileId(level, patchIdx))) {
+      return node;
+    }
+  }
+
+  TileNode* node = mSource->loadTile(level, patchIdx);
+
+  if (node) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    storeCached(node);
+  }
+
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SharedTileSource::loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb) {
+  TileId    tileId(level, patchIdx);
+  TileNode* node = nullptr;
+
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    node = findCached(tileId);
+
+    if (!node) {
+      // If the tile is already being loaded for another consumer, just wait for that request.
+      auto inFlight = mInFlight.find(tileId);
+
+      if (inFlight != mInFlight.end()) {
+        inFlight->second.push_back(std::move(cb));
+        return;
+      }
+
+      mInFlight[tileId].push_back(std::move(cb));
+    }
+  }
+
+  if (node) {
+    cb(this, level, patchIdx, node);
+    return;
+  }
+
+  mSource->loadTileAsync(level, patchIdx, [this](TileSource* /*source*/, int level,
+                                              glm::int64 patchIdx, TileNode* node) {
+    onNodeLoaded(level, patchIdx, node);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int SharedTileSource::getPendingRequests() {
+  return mSource->getPendingRequests();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SharedTileSource::isSame(TileSource const* other) const {
+  if (auto const* shared = dynamic_cast<SharedTileSource const*>(other)) {
+    return shared == this || mSource->isSame(shared->mSource.get());
+  }
+
+  return mSource->isSame(other);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileNode* SharedTileSource::findCached(TileId const& tileId) {
+  auto it = mCache.find(tileId);
+
+  if (it == mCache.end()) {
+    return nullptr;
+  }
+
+  std::shared_ptr<TileBase> tile = it->second.mTile.lock();
+
+  if (!tile) {
+    mCache.erase(it);
+    return nullptr;
+  }
+
+  return new TileNode(std::move(tile), it->second.mChildMaxLevel);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SharedTileSource::storeCached(TileNode const* node) {
+  mCache[node->getTileId()] = CachedTile{node->getSharedTile(), node->getChildMaxLevel()};
+
+  // Tiles are dropped by the consumers without notifying this, so from time to time the entries
+  // of tiles which are not used anymore have to be removed.
+  if (mCache.size() > mSweepThreshold) {
+    for (auto it = mCache.begin(); it != mCache.end();) {
+      if (it->second.mTile.expired()) {
+        it = mCache.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    mSweepThreshold = std::max(minSweepThreshold, 2 * mCache.size());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SharedTileSource::onNodeLoaded(int level, glm::int64 patchIdx, TileNode* node) {
+  std::vector<OnLoadCallback> callbacks;
+
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    auto inFlight = mInFlight.find(TileId(level, patchIdx));
+
+    if (inFlight != mInFlight.end()) {
+      callbacks = std::move(inFlight->second);
+      mInFlight.erase(inFlight);
+    }
+
+    if (node) {
+      storeCached(node);
+    }
+  }
+
+  if (callbacks.empty()) {
+    delete node; // NOLINT(cppcoreguidelines-owning-memory)
+    return;
+  }
+
+  // The first consumer receives the loaded node, all others get a node sharing its tile. These are
+  // created first, as a consumer which is not interested anymore deletes its node right away.
+  std::vector<TileNode*> nodes(callbacks.size(), node);
+
+  for (std::size_t i = 1; node && i < nodes.size(); ++i) {
+    nodes[i] = new TileNode(node->getSharedTile(), node->getChildMaxLevel());
+  }
+
+  for (std::size_t i = 0; i < callbacks.size(); ++i) {
+    callbacks[i](this, level, patchIdx, nodes[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<SharedTileSource> TileSourceRegistry::acquire(std::shared_ptr<TileSource> source) {
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  // Forget about datasets which are not used anymore.
+  mSources.erase(std::remove_if(mSources.begin(), mSources.end(),
+                     [](auto const& weak) { return weak.expired(); }),
+      mSources.end());
+
+  for (auto const& weak : mSources) {
+    auto shared = weak.lock();
+
+    if (shared && shared->isSame(source.get())) {
+      return shared;
+    }
+  }
+
+  auto shared = std::make_shared<SharedTileSource>(std::move(source));
+  mSources.push_back(shared);
+
+  return shared;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
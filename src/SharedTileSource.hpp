@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_SHAREDTILESOURCE_HPP
+#define CSP_LOD_BODIES_SHAREDTILESOURCE_HPP
+
+#include "TileSource.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class TileBase;
+
+/// A TileSource which wraps another TileSource in order to share its tiles between several
+/// consumers (i.e. TreeManagers of different bodies using the same dataset). Each consumer still
+/// receives its own TileNode (and hence has its own RenderData), but the TileNodes share the
+/// decoded tile data: As long as a tile is referenced by any TileNode, requests for it are answered
+/// immediately without loading it again. Concurrent requests for a tile which is currently being
+/// loaded are coalesced into a single request to the wrapped source.
+///
+/// Only weak references to the tiles are kept. So a tile is held in memory once while any consumer
+/// uses it, but once all consumers have pruned or dropped it, it has to be loaded again. Keeping
+/// tiles which are not used anymore is up to the consumers (see
+/// TreeManagerBase::setMaxRetainedTrees).
+///
+/// The consumers call init() and fini() in pairs, the wrapped source is initialized by the first
+/// call to init() and shut down once the last consumer called fini().
+///
+/// SharedTileSources should be obtained from a TileSourceRegistry which makes sure that there is
+/// only one instance per dataset.
+class SharedTileSource : public TileSource {
+ public:
+  explicit SharedTileSource(std::shared_ptr<TileSource> source);
+
+  SharedTileSource(SharedTileSource const& other) = delete;
+  SharedTileSource(SharedTileSource&& other)      = delete;
+
+  SharedTileSource& operator=(SharedTileSource const& other) = delete;
+  SharedTileSource& operator=(SharedTileSource&& other) = delete;
+
+  ~SharedTileSource() override;
+
+  /// Returns the wrapped source.
+  std::shared_ptr<TileSource> const& getSource() const;
+
+  /// Initializes the wrapped source if this is the first consumer.
+  void init() override;
+
+  /// Shuts down the wrapped source if this is the last consumer. Calls without a matching call to
+  /// init() are ignored.
+  void fini() override;
+
+  TileDataType getDataType() const override;
+
+  TileNode* loadTile(int level, glm::int64 patchIdx) override;
+  void      loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb) override;
+  int       getPendingRequests() override;
+
+  /// Compares the wrapped sources, other may either be a SharedTileSource or any other source.
+  bool isSame(TileSource const* other) const override;
+
+ private:
+  struct CachedTile {
+    std::weak_ptr<TileBase> mTile;
+    int                     mChildMaxLevel;
+  };
+
+  /// Creates a new TileNode for a tile which is still referenced by another consumer. Returns
+  /// nullptr if there is no such tile. mMutex must be locked.
+  TileNode* findCached(TileId const& tileId);
+
+  /// Remembers the tile of node so that it can be shared. mMutex must be locked.
+  void storeCached(TileNode const* node);
+
+  /// Called by the wrapped source once an asynchronous request is finished.
+  void onNodeLoaded(int level, glm::int64 patchIdx, TileNode* node);
+
+  std::mutex                                              mMutex;
+  std::unordered_map<TileId, CachedTile>                  mCache;
+  std::size_t                                             mSweepThreshold;
+  std::unordered_map<TileId, std::vector<OnLoadCallback>> mInFlight;
+  int                                                     mConsumers;
+
+  // This is declared last, so the wrapped source (and its loader threads) are shut down first.
+  std::shared_ptr<TileSource> mSource;
+};
+
+/// Hands out one SharedTileSource per dataset. The registry only keeps weak references, a dataset
+/// is released once no body uses it anymore.
+class TileSourceRegistry {
+ public:
+  /// Returns the SharedTileSource wrapping a source for which TileSource::isSame is true. If there
+  /// is no such source yet, a new SharedTileSource wrapping the given source is created.
+  std::shared_ptr<SharedTileSource> acquire(std::shared_ptr<TileSource> source);
+
+ private:
+  std::mutex                                   mMutex;
+  std::vector<std::weak_ptr<SharedTileSource>> mSources;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_SHAREDTILESOURCE_HPP
@@ -11,6 +11,8 @@
 #include <VistaOGLExt/VistaGLSLShader.h>
 #include <VistaOGLExt/VistaShaderRegistry.h>
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 
 namespace csp::lodbodies {
@@ -24,6 +26,14 @@ TerrainShader::TerrainShader(std::string vertexSource, std::string fragmentSourc
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+TerrainShader::~TerrainShader() {
+  if (mFrameUniformsBuffer != 0U) {
+    glDeleteBuffers(1, &mFrameUniformsBuffer);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TerrainShader::bind() {
   if (mShaderDirty) {
     compile();
@@ -31,6 +41,11 @@ void TerrainShader::bind() {
   }
 
   mShader.Bind();
+
+  // other shaders may use the same binding point
+  if (mFrameUniformsBuffer != 0U) {
+    glBindBufferBase(GL_UNIFORM_BUFFER, sFrameUniformsBinding, mFrameUniformsBuffer);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -54,10 +69,113 @@ void TerrainShader::compile() {
   cs::utils::replaceString(mFragmentSource, "$VP_TERRAIN_SHADER_UNIFORMS",
       reg.RetrieveShader("VistaPlanetTerrainShaderUniforms.glsl"));
 
+  // the parameters of the tile are read in the vertex shader and passed on to the fragment shader
+  cs::utils::replaceString(mVertexSource, "$VP_TILE_VARYING", "flat out");
+  cs::utils::replaceString(mFragmentSource, "$VP_TILE_VARYING", "flat in");
+
   mShader = VistaGLSLShader();
   mShader.InitVertexShaderFromString(mVertexSource);
   mShader.InitFragmentShaderFromString(mFragmentSource);
   mShader.Link();
+
+  // the new program has none of the previously uploaded values
+  mUniformCache.clear();
+
+  GLuint const program = mShader.GetProgram();
+  GLuint const block   = glGetUniformBlockIndex(program, "VP_FrameUniforms");
+
+  if (block != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program, block, sFrameUniformsBinding);
+  }
+
+  mUniformLocs.mTexDEM        = mShader.GetUniformLocation("VP_texDEM");
+  mUniformLocs.mTexIMG        = mShader.GetUniformLocation("VP_texIMG");
+  mUniformLocs.mTexVirtualIMG = mShader.GetUniformLocation("VP_texVirtualIMG");
+  mUniformLocs.mTiles         = mShader.GetUniformLocation("VP_tiles");
+  mUniformLocs.mTileBase      = mShader.GetUniformLocation("VP_tileBase");
+  mUniformLocs.mShadowMaps    = mShader.GetUniformLocation("VP_shadowMaps");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TerrainShader::UniformLocs const& TerrainShader::getUniformLocs() const {
+  return mUniformLocs;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TerrainShader::setFrameUniforms(FrameUniforms const& values) {
+  if (mFrameUniformsBuffer == 0U) {
+    glGenBuffers(1, &mFrameUniformsBuffer);
+  }
+
+  if (!mFrameUniformsValid || std::memcmp(&values, &mFrameUniforms, sizeof(FrameUniforms)) != 0) {
+    mFrameUniforms      = values;
+    mFrameUniformsValid = true;
+
+    // the storage is orphaned, so that the upload does not wait for previous draw calls
+    glBindBuffer(GL_UNIFORM_BUFFER, mFrameUniformsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &mFrameUniforms, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0U);
+  }
+
+  glBindBufferBase(GL_UNIFORM_BUFFER, sFrameUniformsBinding, mFrameUniformsBuffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TerrainShader::setUniform(GLint loc, int value) {
+  if (updateCache(loc, &value, sizeof(value))) {
+    glUniform1i(loc, value);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TerrainShader::setUniform(GLint loc, float value) {
+  if (updateCache(loc, &value, sizeof(value))) {
+    glUniform1f(loc, value);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TerrainShader::setUniform(GLint loc, glm::vec4 const& value) {
+  if (updateCache(loc, &value, sizeof(value))) {
+    glUniform4f(loc, value.x, value.y, value.z, value.w);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TerrainShader::setUniform(GLint loc, std::vector<GLint> const& values) {
+  if (updateCache(loc, values.data(), values.size() * sizeof(GLint))) {
+    glUniform1iv(loc, static_cast<GLsizei>(values.size()), values.data());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TerrainShader::updateCache(GLint loc, void const* data, std::size_t size) {
+  if (loc < 0) {
+    return false;
+  }
+
+  auto const index = static_cast<std::size_t>(loc);
+
+  if (index >= mUniformCache.size()) {
+    mUniformCache.resize(index + 1);
+  }
+
+  auto&       cached = mUniformCache[index];
+  auto const* bytes  = static_cast<std::uint8_t const*>(data);
+
+  if (cached.size() == size && std::equal(cached.begin(), cached.end(), bytes)) {
+    return false;
+  }
+
+  cached.assign(bytes, bytes + size);
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -7,16 +7,57 @@
 #ifndef CSP_LOD_BODIES_TERRAINSHADER_HPP
 #define CSP_LOD_BODIES_TERRAINSHADER_HPP
 
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <VistaOGLExt/VistaGLSLShader.h>
 
 namespace csp::lodbodies {
 
 /// The base class for the PlanetShader. It builds the shader from various sources and links it.
+///
+/// The uniforms used by the TileRenderer are resolved once per compile() and the values which are
+/// the same for all tiles of a render pass are stored in the uniform block VP_FrameUniforms.
+/// Uniforms set with setUniform() are only uploaded if their value changed, so the values which
+/// rarely change, e.g. the texture units, cost nothing in most frames.
 class TerrainShader {
  public:
+  /// The maximum number of shadow cascades, must match VP_MAXCASCADES.
+  static int const sMaxShadowCascades = 5;
+
+  /// The binding point of the uniform block VP_FrameUniforms.
+  static GLuint const sFrameUniformsBinding = 0;
+
+  /// The contents of the uniform block VP_FrameUniforms in VistaPlanetTerrainShaderUniforms.glsl,
+  /// laid out according to std140. Booleans are stored as integers.
+  struct FrameUniforms {
+    glm::mat4                                 mMatProjection{};
+    glm::mat4                                 mMatModelView{};
+    std::array<glm::mat4, sMaxShadowCascades> mShadowProjectionViewMatrices{};
+    glm::vec2                                 mRadius{};
+    float                                     mHeightScale{};
+    float                                     mShadowBias = 0.0001F;
+    int                                       mShadowCascades{};
+    int                                       mShadowMapMode{};
+    int                                       mVirtualIMG{};
+    float                                     mFarClip{};
+  };
+
+  /// The locations of the uniforms which are not part of VP_FrameUniforms. They are -1 if the
+  /// uniform is not used by the shader.
+  struct UniformLocs {
+    GLint mTexDEM        = -1;
+    GLint mTexIMG        = -1;
+    GLint mTexVirtualIMG = -1;
+    GLint mTiles         = -1;
+    GLint mTileBase      = -1;
+    GLint mShadowMaps    = -1;
+  };
+
   TerrainShader() = default;
   TerrainShader(std::string vertexSource, std::string fragmentSource);
 
@@ -26,11 +67,25 @@ class TerrainShader {
   TerrainShader& operator=(TerrainShader const& other) = delete;
   TerrainShader& operator=(TerrainShader&& other) = delete;
 
-  virtual ~TerrainShader() = default;
+  virtual ~TerrainShader();
 
   virtual void bind();
   virtual void release();
 
+  /// Returns the uniform locations resolved by the last compile(). Only valid after bind().
+  UniformLocs const& getUniformLocs() const;
+
+  /// Uploads the values of VP_FrameUniforms, unless they are the same as those of the last call,
+  /// and binds the uniform buffer to sFrameUniformsBinding. bind() binds it as well.
+  void setFrameUniforms(FrameUniforms const& values);
+
+  /// Set the uniform at loc of the bound shader, unless it already has the given value. Nothing
+  /// is done if loc is -1.
+  void setUniform(GLint loc, int value);
+  void setUniform(GLint loc, float value);
+  void setUniform(GLint loc, glm::vec4 const& value);
+  void setUniform(GLint loc, std::vector<GLint> const& values);
+
   friend class TileRenderer;
 
  protected:
@@ -40,8 +95,22 @@ class TerrainShader {
   std::string     mVertexSource;
   std::string     mFragmentSource;
   VistaGLSLShader mShader;
+
+ private:
+  /// Returns whether the size bytes at data differ from those last passed for loc. If so, they
+  /// are stored for the next call.
+  bool updateCache(GLint loc, void const* data, std::size_t size);
+
+  UniformLocs                            mUniformLocs;
+  std::vector<std::vector<std::uint8_t>> mUniformCache;
+  GLuint                                 mFrameUniformsBuffer = 0U;
+  FrameUniforms                          mFrameUniforms;
+  bool                                   mFrameUniformsValid = false;
 };
 
+static_assert(sizeof(TerrainShader::FrameUniforms) == 480,
+    "TerrainShader::FrameUniforms must match the std140 layout of VP_FrameUniforms.");
+
 } // namespace csp::lodbodies
 
 #endif // CSP_LOD_BODIES_TERRAINSHADER_HPP
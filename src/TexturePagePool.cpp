@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TexturePagePool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TexturePagePool::TexturePagePool(int maxLayerCount)
+    : mMaxLayerCount(maxLayerCount) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TexturePagePool::setMaxLayerCount(int maxLayerCount) {
+  mMaxLayerCount = maxLayerCount;
+
+  // Retire the pages holding the fewest tiles until the active pages fit, those are the first to
+  // become empty.
+  while (getActiveLayerCount() > mMaxLayerCount) {
+    Page* retire = nullptr;
+
+    for (auto& page : mPages) {
+      if (page.mNumLayers > 0 && !page.mRetired &&
+          (!retire || page.mFreeLayers.size() >= retire->mFreeLayers.size())) {
+        retire = &page;
+      }
+    }
+
+    retire->mRetired = true;
+  }
+
+  // Reactivate the retired pages holding the most tiles as long as they fit.
+  while (true) {
+    int   active     = getActiveLayerCount();
+    Page* reactivate = nullptr;
+
+    for (auto& page : mPages) {
+      if (page.mRetired && active + page.mNumLayers <= mMaxLayerCount &&
+          (!reactivate || page.mFreeLayers.size() < reactivate->mFreeLayers.size())) {
+        reactivate = &page;
+      }
+    }
+
+    if (!reactivate) {
+      break;
+    }
+
+    reactivate->mRetired = false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::getMaxLayerCount() const {
+  return mMaxLayerCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TexturePagePool::Handle TexturePagePool::allocate() {
+  for (int i = 0; i < sMaxPages; ++i) {
+    Page& page = mPages.at(i);
+
+    if (!page.mRetired && !page.mFreeLayers.empty()) {
+      int const layer = page.mFreeLayers.back();
+      page.mFreeLayers.pop_back();
+      return Handle{i, layer};
+    }
+  }
+
+  return Handle{};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TexturePagePool::free(Handle handle) {
+  assert(handle.mPage >= 0 && handle.mPage < sMaxPages);
+  assert(handle.mLayer >= 0 && handle.mLayer < mPages.at(handle.mPage).mNumLayers);
+
+  mPages.at(handle.mPage).mFreeLayers.push_back(handle.mLayer);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::getGrowth() const {
+  if (!hasUnusedPage()) {
+    return 0;
+  }
+
+  return std::max(0, mMaxLayerCount - getActiveLayerCount());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::grow() {
+  int const growth = getGrowth();
+
+  if (growth == 0) {
+    return -1;
+  }
+
+  for (int i = 0; i < sMaxPages; ++i) {
+    Page& page = mPages.at(i);
+
+    if (page.mNumLayers == 0) {
+      // Hand out the layers in order, that is from the back of mFreeLayers.
+      page.mNumLayers = growth;
+      page.mRetired   = false;
+      page.mFreeLayers.reserve(growth);
+
+      for (int layer = 0; layer < growth; ++layer) {
+        page.mFreeLayers.push_back(growth - layer - 1);
+      }
+
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::getShortfall() const {
+  if (hasUnusedPage()) {
+    return 0;
+  }
+
+  return std::max(0, mMaxLayerCount - getActiveLayerCount());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::enlarge() {
+  int const shortfall = getShortfall();
+  int       smallest  = -1;
+
+  // the fewer layers the page has, the fewer have to be copied
+  for (int i = 0; i < sMaxPages; ++i) {
+    Page const& page = mPages.at(i);
+
+    if (!page.mRetired && page.mNumLayers > 0 &&
+        (smallest < 0 || page.mNumLayers < mPages.at(smallest).mNumLayers)) {
+      smallest = i;
+    }
+  }
+
+  if (shortfall == 0 || smallest < 0) {
+    return -1;
+  }
+
+  // The new layers are handed out in order before the previously freed ones.
+  Page&     page     = mPages.at(smallest);
+  int const previous = page.mNumLayers;
+  page.mNumLayers += shortfall;
+
+  for (int layer = page.mNumLayers - 1; layer >= previous; --layer) {
+    page.mFreeLayers.push_back(layer);
+  }
+
+  return smallest;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> TexturePagePool::collectEmptyPages() {
+  std::vector<int> result;
+
+  for (int i = 0; i < sMaxPages; ++i) {
+    Page& page = mPages.at(i);
+
+    if (page.mRetired && static_cast<int>(page.mFreeLayers.size()) == page.mNumLayers) {
+      page = Page{};
+      result.push_back(i);
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::getPageLayerCount(int page) const {
+  return mPages.at(page).mNumLayers;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TexturePagePool::isRetired(int page) const {
+  return mPages.at(page).mRetired;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TexturePagePool::getFreeLayerCount() const {
+  std::size_t result = 0;
+
+  for (auto const& page : mPages) {
+    if (!page.mRetired) {
+      result += page.mFreeLayers.size();
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TexturePagePool::getTotalLayerCount() const {
+  std::size_t result = 0;
+
+  for (auto const& page : mPages) {
+    result += page.mNumLayers;
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TexturePagePool::getUsedLayerCount() const {
+  std::size_t result = 0;
+
+  for (auto const& page : mPages) {
+    result += page.mNumLayers - page.mFreeLayers.size();
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TexturePagePool::hasUnusedPage() const {
+  return std::any_of(
+      mPages.begin(), mPages.end(), [](Page const& page) { return page.mNumLayers == 0; });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TexturePagePool::getActiveLayerCount() const {
+  int result = 0;
+
+  for (auto const& page : mPages) {
+    if (!page.mRetired) {
+      result += page.mNumLayers;
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TEXTUREPAGEPOOL_HPP
+#define CSP_LOD_BODIES_TEXTUREPAGEPOOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Manages the layers of the pages of a TileTextureArray. Each page is an array texture whose
+/// number of layers is fixed when it is created, a tile is identified by its page and layer.
+///
+/// The pool holds up to sMaxPages pages. The total number of layers of all active pages never
+/// exceeds the maximum layer count set with setMaxLayerCount(). If the maximum is raised, the pool
+/// grows by adding a page for the missing layers once all active pages are full. If all page slots
+/// are in use, enlarge() adds the missing layers to an existing page instead. If the maximum is
+/// lowered, pages are retired until the active pages fit into the new maximum. No layers are
+/// handed out from retired pages, but their tiles stay valid until they are freed. Once a retired
+/// page is empty, it is removed by collectEmptyPages(). Hence tiles never have to be moved or
+/// re-uploaded when the maximum changes.
+///
+/// The pool does not call OpenGL, creating and deleting the textures of its pages is left to the
+/// TileTextureArray.
+class TexturePagePool {
+ public:
+  /// The maximum number of pages. This must match VP_MAXPAGES in
+  /// VistaPlanetTerrainShaderUniforms.glsl.
+  static int const sMaxPages = 4;
+
+  /// A layer of a page. Both are -1 for an invalid handle.
+  struct Handle {
+    int mPage  = -1;
+    int mLayer = -1;
+  };
+
+  explicit TexturePagePool(int maxLayerCount);
+
+  /// Changes the maximum number of layers of all active pages. Retires or reactivates pages as
+  /// needed, new pages are only added by grow().
+  void setMaxLayerCount(int maxLayerCount);
+  int  getMaxLayerCount() const;
+
+  /// Returns a free layer of an active page, or an invalid handle if all active pages are full.
+  Handle allocate();
+
+  /// Returns a layer returned by allocate() to its page.
+  void free(Handle handle);
+
+  /// Returns the number of layers of the page grow() would add, or 0 if the active pages already
+  /// hold the maximum number of layers or there are no unused page slots.
+  int getGrowth() const;
+
+  /// Adds a page of getGrowth() layers and returns its index, or -1 if getGrowth() returns 0.
+  int grow();
+
+  /// Returns the number of layers the active pages lack to hold the maximum number of layers,
+  /// because all page slots are in use. Otherwise grow() adds them and this returns 0.
+  int getShortfall() const;
+
+  /// Adds getShortfall() layers to the active page with the fewest layers and returns its index, or
+  /// -1 if getShortfall() returns 0 or there is no active page. The existing layers of the page
+  /// keep their indices, its texture has to be reallocated with the previous layers copied over.
+  int enlarge();
+
+  /// Removes all retired pages which do not hold any tiles and returns their indices.
+  std::vector<int> collectEmptyPages();
+
+  /// Returns the number of layers of the given page, 0 if the page does not exist.
+  int getPageLayerCount(int page) const;
+
+  /// Returns whether the given page has been retired.
+  bool isRetired(int page) const;
+
+  /// Returns the number of free layers of the active pages.
+  std::size_t getFreeLayerCount() const;
+
+  /// Returns the number of layers of all pages, including retired ones.
+  std::size_t getTotalLayerCount() const;
+
+  /// Returns the number of layers which are in use.
+  std::size_t getUsedLayerCount() const;
+
+ private:
+  struct Page {
+    int              mNumLayers{};
+    bool             mRetired{};
+    std::vector<int> mFreeLayers;
+  };
+
+  bool hasUnusedPage() const;
+  int  getActiveLayerCount() const;
+
+  int                         mMaxLayerCount;
+  std::array<Page, sMaxPages> mPages;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TEXTUREPAGEPOOL_HPP
@@ -7,8 +7,11 @@
 #ifndef CSP_LOD_BODIES_TILE_HPP
 #define CSP_LOD_BODIES_TILE_HPP
 
+#include "FixedSizePool.hpp"
 #include "TileBase.hpp"
 
+#include <algorithm>
+
 namespace csp::lodbodies {
 
 /// Concrete class storing data samples of the template argument type T.
@@ -28,6 +31,10 @@ class Tile : public TileBase {
 
   ~Tile() override;
 
+  /// Tiles are allocated from one FixedSizePool per data type, see detail::getTilePool().
+  static void* operator new(std::size_t size);
+  static void  operator delete(void* ptr, std::size_t size);
+
   static std::type_info const& getStaticTypeId();
   static TileDataType          getStaticDataType();
 
@@ -67,6 +74,15 @@ template <>
 struct DataTypeTrait<glm::u8vec3> {
   static TileDataType const value = TileDataType::eU8Vec3;
 };
+
+/// Returns the pool all Tile<T> are allocated from. Slabs are sized to roughly 2 MiB, i.e. a few
+/// elevation tiles or a few dozen single channel image tiles.
+template <typename T>
+FixedSizePool& getTilePool() {
+  static FixedSizePool pool(
+      sizeof(Tile<T>), std::max<std::size_t>(1, (std::size_t(2) << 20U) / sizeof(Tile<T>)));
+  return pool;
+}
 } // namespace detail
 
 template <typename T>
@@ -78,6 +94,25 @@ Tile<T>::Tile(int level, glm::int64 patchIdx)
 template <typename T>
 Tile<T>::~Tile() = default;
 
+template <typename T>
+void* Tile<T>::operator new(std::size_t size) {
+  if (size != sizeof(Tile<T>)) {
+    return ::operator new(size);
+  }
+
+  return detail::getTilePool<T>().allocate();
+}
+
+template <typename T>
+void Tile<T>::operator delete(void* ptr, std::size_t size) {
+  if (size != sizeof(Tile<T>)) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  detail::getTilePool<T>().deallocate(ptr);
+}
+
 template <typename T>
 std::type_info const& Tile<T>::getStaticTypeId() {
   return typeid(T);
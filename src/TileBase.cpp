@@ -14,7 +14,9 @@ namespace csp::lodbodies {
 TileBase::TileBase(int level, glm::int64 patchIdx)
     : boost::noncopyable()
     , mTileId(level, patchIdx)
-    , mMinMaxPyramid(nullptr) {
+    , mMinMaxPyramid(nullptr)
+    , mMipChain(nullptr)
+    , mMipChainPtr(nullptr) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -67,4 +69,19 @@ void TileBase::setMinMaxPyramid(std::unique_ptr<MinMaxPyramid> pyramid) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MipChain const* TileBase::getMipChain() const {
+  return mMipChainPtr.load(std::memory_order_acquire);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileBase::buildMipChain() {
+  std::call_once(mMipChainOnce, [this]() {
+    mMipChain = std::make_unique<MipChain>(*this);
+    mMipChainPtr.store(mMipChain.get(), std::memory_order_release);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::lodbodies
@@ -8,11 +8,14 @@
 #define CSP_LOD_BODIES_TILEBASE_HPP
 
 #include "MinMaxPyramid.hpp"
+#include "MipChain.hpp"
 #include "TileDataType.hpp"
 #include "TileId.hpp"
 
+#include <atomic>
 #include <boost/noncopyable.hpp>
 #include <memory>
+#include <mutex>
 #include <typeinfo>
 
 namespace csp::lodbodies {
@@ -62,6 +65,15 @@ class TileBase : private boost::noncopyable {
   MinMaxPyramid* getMinMaxPyramid() const;
   void           setMinMaxPyramid(std::unique_ptr<MinMaxPyramid> pyramid);
 
+  /// The mipmap levels of the data, nullptr unless buildMipChain() has been called.
+  MipChain const* getMipChain() const;
+
+  /// Computes the mipmap levels of the data, if this has not been done before. This is done by
+  /// TreeManagerBase::onNodeLoaded on the loader threads for tiles of a TileTextureArray which uses
+  /// them. As a tile may be shared by several trees, this may be called concurrently; the levels
+  /// are built exactly once, all callers wait for them and they are never replaced afterwards.
+  void buildMipChain();
+
  protected:
   explicit TileBase(int level, glm::int64 patchIdx);
 
@@ -69,6 +81,11 @@ class TileBase : private boost::noncopyable {
 
  private:
   std::unique_ptr<MinMaxPyramid> mMinMaxPyramid;
+  std::unique_ptr<MipChain>      mMipChain;
+  std::once_flag                 mMipChainOnce;
+
+  /// Points to mMipChain once it is complete, so that it can be read without calling call_once.
+  std::atomic<MipChain const*> mMipChainPtr;
 };
 
 template <typename T>
@@ -8,9 +8,27 @@
 
 #include "../../../src/cs-utils/convert.hpp"
 #include "HEALPix.hpp"
+#include "MinMaxPyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <limits>
 
 namespace csp::lodbodies {
 
+namespace {
+
+// Number of samples along each edge of a tile used for the oriented bounds.
+int const OrientedBoundsSamples = 5;
+
+// Angle between two unit vectors.
+double angleBetween(glm::dvec3 const& a, glm::dvec3 const& b) {
+  return std::acos(std::clamp(glm::dot(a, b), -1.0, 1.0));
+}
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 BoundingBox<double> calcTileBounds(double tmin, double tmax, int tileLevel, glm::int64 patchIdx,
@@ -110,4 +128,257 @@ BoundingBox<double> calcTileBounds(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+OrientedTileBounds calcOrientedTileBounds(double tmin, double tmax, double maxStep, int tileLevel,
+    glm::int64 patchIdx, double radiusE, double radiusP, double heightScale) {
+  OrientedTileBounds result;
+
+  // min/max elevation of tile, adjusted for heightScale
+  double const        tMin  = heightScale * tmin;
+  double const        tMax  = heightScale * tmax;
+  HEALPixLevel const& hp    = HEALPix::getLevel(tileLevel);
+  glm::i64vec3 const  bxy   = hp.getBaseXY(patchIdx);
+  double const        nSide = static_cast<double>(hp.getNSide());
+
+  // Sample the surface on a regular grid covering the tile including its edges. For each sample
+  // the lowest and highest possible point and the surface normal are stored.
+  int const                     n = OrientedBoundsSamples;
+  std::array<glm::dvec3, n * n> pMin{};
+  std::array<glm::dvec3, n * n> pMax{};
+  std::array<glm::dvec3, n * n> normals{};
+
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      glm::dvec2 const lngLat = HEALPix::convertBaseXY2LngLat(static_cast<int>(bxy[0]),
+          (static_cast<double>(bxy[1]) + x / (n - 1.0)) / nSide,
+          (static_cast<double>(bxy[2]) + y / (n - 1.0)) / nSide);
+
+      int const i   = y * n + x;
+      pMin.at(i)    = cs::utils::convert::toCartesian(lngLat, radiusE, radiusP, tMin);
+      pMax.at(i)    = cs::utils::convert::toCartesian(lngLat, radiusE, radiusP, tMax);
+      normals.at(i) = cs::utils::convert::lngLatToNormal(lngLat, radiusE, radiusP);
+    }
+  }
+
+  // The box is aligned to the normal at the tile's center and to the tile's x direction projected
+  // into the tangent plane.
+  int const        centerRow = (n / 2) * n;
+  glm::dvec3 const axisZ     = normals.at(centerRow + n / 2);
+  glm::dvec3 const edge      = pMax.at(centerRow + n - 1) - pMax.at(centerRow);
+  glm::dvec3       axisX     = edge - glm::dot(edge, axisZ) * axisZ;
+
+  if (glm::dot(axisX, axisX) == 0.0) {
+    axisX = glm::cross(
+        axisZ, std::abs(axisZ.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0));
+  }
+
+  axisX                  = glm::normalize(axisX);
+  glm::dvec3 const axisY = glm::cross(axisZ, axisX);
+
+  glm::dvec3 boxMin(std::numeric_limits<double>::max());
+  glm::dvec3 boxMax(std::numeric_limits<double>::lowest());
+
+  for (auto const* points : {&pMin, &pMax}) {
+    for (auto const& p : *points) {
+      glm::dvec3 const local(glm::dot(p, axisX), glm::dot(p, axisY), glm::dot(p, axisZ));
+      boxMin = glm::min(boxMin, local);
+      boxMax = glm::max(boxMax, local);
+    }
+  }
+
+  // Between the samples the surface bulges out of the volume spanned by them. The largest angle
+  // between the normals at opposite corners of a grid cell bounds how far.
+  double cellAngle   = 0.0;
+  double spreadAngle = 0.0;
+  double minSpacing  = std::numeric_limits<double>::max();
+
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      int const i = y * n + x;
+      spreadAngle = std::max(spreadAngle, angleBetween(normals.at(i), axisZ));
+
+      if (x > 0) {
+        minSpacing = std::min(minSpacing, glm::length(pMin.at(i) - pMin.at(i - 1)));
+      }
+
+      if (y > 0) {
+        minSpacing = std::min(minSpacing, glm::length(pMin.at(i) - pMin.at(i - n)));
+      }
+
+      if (x > 0 && y > 0) {
+        cellAngle = std::max(cellAngle, angleBetween(normals.at(i), normals.at(i - n - 1)));
+        cellAngle = std::max(cellAngle, angleBetween(normals.at(i - 1), normals.at(i - n)));
+      }
+    }
+  }
+
+  double const radius = std::max(radiusE, radiusP) + std::max(tMax, 0.0);
+  double const sag    = radius * (1.0 - std::cos(0.5 * cellAngle));
+
+  boxMin -= sag;
+  boxMax += sag;
+
+  glm::dvec3 const center = 0.5 * (boxMin + boxMax);
+  glm::dvec3 const extent = 0.5 * (boxMax - boxMin);
+
+  result.mCenter      = center.x * axisX + center.y * axisY + center.z * axisZ;
+  result.mHalfAxes[0] = extent.x * axisX;
+  result.mHalfAxes[1] = extent.y * axisY;
+  result.mHalfAxes[2] = extent.z * axisZ;
+
+  // The terrain's gradient is bounded by the largest elevation difference between adjacent data
+  // samples divided by their spacing. The data samples are not evenly spaced within a tile, so
+  // half of the smallest spacing of the coarse grid is used.
+  double const dataSpacing =
+      0.5 * minSpacing * (n - 1) / static_cast<double>(TileBase::SizeX - 1);
+  double const slopeAngle =
+      dataSpacing > 0.0 ? std::atan(std::sqrt(2.0) * heightScale * maxStep / dataSpacing)
+                        : 0.5 * glm::pi<double>();
+  double const coneAngle = spreadAngle + 0.5 * cellAngle + slopeAngle;
+
+  result.mConeAxis = axisZ;
+
+  if (coneAngle < 0.5 * glm::pi<double>()) {
+    result.mConeSin = std::sin(coneAngle);
+    result.mConeCos = std::cos(coneAngle);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+OrientedTileBounds calcOrientedTileBounds(
+    TileBase const& tile, double radiusE, double radiusP, double heightScale) {
+  switch (tile.getDataType()) {
+  case TileDataType::eFloat32: {
+    MinMaxPyramid const* pyramid = tile.getMinMaxPyramid();
+    return calcOrientedTileBounds(pyramid->getMin(), pyramid->getMax(), pyramid->getMaxStep(),
+        tile.getLevel(), tile.getPatchIdx(), radiusE, radiusP, heightScale);
+  }
+
+  default:
+    // do nothing - this only works for DEM tiles
+    break;
+  }
+
+  return OrientedTileBounds();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double calcGeometricError(
+    double dataError, int tileLevel, double radiusE, double radiusP, double heightScale) {
+  // All HEALPix patches of a level have the same area, their edges span roughly the square root of
+  // that area in radians. The parent's grid cells span twice the angle of this tile's cells.
+  double const patchAngle =
+      std::sqrt(4.0 * glm::pi<double>() / 12.0) / static_cast<double>(glm::int64(1) << tileLevel);
+  double const cellAngle = 2.0 * patchAngle / static_cast<double>(TileBase::SizeX - 1);
+
+  // The flat cells are below the curved surface by at most the sag of their diagonal.
+  double const sag =
+      std::max(radiusE, radiusP) * (1.0 - std::cos(0.5 * std::sqrt(2.0) * cellAngle));
+
+  return heightScale * dataError + sag;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double calcGeometricError(
+    TileBase const& tile, double radiusE, double radiusP, double heightScale) {
+  switch (tile.getDataType()) {
+  case TileDataType::eFloat32:
+    return calcGeometricError(tile.getMinMaxPyramid()->getGeometricError(), tile.getLevel(),
+        radiusE, radiusP, heightScale);
+
+  default:
+    // do nothing - this only works for DEM tiles
+    break;
+  }
+
+  return 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileOccluders calcTileOccluders(
+    std::array<float, OccluderCellsPerEdge * OccluderCellsPerEdge> const& minHeights,
+    int tileLevel, glm::int64 patchIdx, double radiusE, double radiusP, double heightScale) {
+  TileOccluders result;
+
+  HEALPixLevel const& hp    = HEALPix::getLevel(tileLevel);
+  glm::i64vec3 const  bxy   = hp.getBaseXY(patchIdx);
+  auto const          nSide = static_cast<double>(hp.getNSide());
+
+  // The flat triangles between the samples are below the curved surface by at most the geometric
+  // error of a tile of the next level without any elevation data.
+  double const sag = calcGeometricError(0.0, tileLevel + 1, radiusE, radiusP, heightScale);
+
+  // A cell covers the samples of one entry of the MinMaxPyramid. The triangles between the last of
+  // them and the first sample of the next cell are not part of the cell.
+  double const cellSize   = 1.0 / OccluderCellsPerEdge;
+  double const sampleSize = 1.0 / (TileBase::SizeX - 1);
+
+  for (int y = 0; y < OccluderCellsPerEdge; ++y) {
+    for (int x = 0; x < OccluderCellsPerEdge; ++x) {
+      OccluderCell& cell   = result.at(y * OccluderCellsPerEdge + x);
+      double const  height = heightScale * minHeights.at(y * OccluderCellsPerEdge + x) - sag;
+
+      auto const point = [&](double u, double v) {
+        glm::dvec2 const lngLat = HEALPix::convertBaseXY2LngLat(static_cast<int>(bxy[0]),
+            (static_cast<double>(bxy[1]) + u) / nSide, (static_cast<double>(bxy[2]) + v) / nSide);
+        return cs::utils::convert::toCartesian(lngLat, radiusE, radiusP, height);
+      };
+
+      double const u0 = x * cellSize;
+      double const v0 = y * cellSize;
+      double const u1 = u0 + cellSize - sampleSize;
+      double const v1 = v0 + cellSize - sampleSize;
+
+      cell.mCorners = {point(u0, v0), point(u1, v0), point(u1, v1), point(u0, v1)};
+      cell.mCenter  = point(0.5 * (u0 + u1), 0.5 * (v0 + v1));
+
+      // The edges of the cell are slightly curved, hence the radius is enlarged a bit.
+      for (auto const& corner : cell.mCorners) {
+        cell.mRadius = std::max(cell.mRadius, 1.1 * glm::length(corner - cell.mCenter));
+      }
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileOccluders calcTileOccluders(
+    TileBase const& tile, double radiusE, double radiusP, double heightScale) {
+  switch (tile.getDataType()) {
+  case TileDataType::eFloat32: {
+    std::array<float, OccluderCellsPerEdge * OccluderCellsPerEdge> minHeights{};
+
+    // The level of the pyramid with one entry per cell. Each level halves the resolution of the
+    // previous one, hence it is found by its size.
+    auto const& pyramid = tile.getMinMaxPyramid()->getMinPyramid();
+    auto const  level   = std::find_if(pyramid.begin(), pyramid.end(),
+        [&minHeights](std::vector<float> const& l) { return l.size() == minHeights.size(); });
+
+    if (level == pyramid.end()) {
+      break;
+    }
+
+    std::copy(level->begin(), level->end(), minHeights.begin());
+
+    return calcTileOccluders(
+        minHeights, tile.getLevel(), tile.getPatchIdx(), radiusE, radiusP, heightScale);
+  }
+
+  default:
+    // do nothing - this only works for DEM tiles
+    break;
+  }
+
+  return TileOccluders();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::lodbodies
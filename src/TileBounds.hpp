@@ -10,6 +10,8 @@
 #include "BoundingBox.hpp"
 #include "Tile.hpp"
 
+#include <array>
+
 namespace csp::lodbodies {
 
 /// Returns the bounds of tile for a planet of the given equatorial radius radiusE, polar radius
@@ -21,6 +23,83 @@ BoundingBox<double> calcTileBounds(
 
 BoundingBox<double> calcTileBounds(double tmin, double tmax, int tileLevel, glm::int64 patchIdx,
     double radiusE = 1.F, double radiusP = 1.F, double heightScale = 1.F);
+
+/// Tighter bounds of a tile than the axis aligned box returned by calcTileBounds(). The box is
+/// aligned to the surface normal at the tile's center and to the tile's edges, so it hardly
+/// contains any empty space even for small tiles which are tilted with respect to the coordinate
+/// axes. The normal cone contains all normals of the tile's surface including the slopes of the
+/// terrain and is used to reject tiles which face away from the camera.
+struct OrientedTileBounds {
+  glm::dvec3 mCenter{};
+
+  /// Three orthogonal vectors from the center to the faces of the box. mHalfAxes[2] is parallel to
+  /// the surface normal at the tile's center.
+  std::array<glm::dvec3, 3> mHalfAxes{};
+
+  /// Axis and half opening angle of the normal cone. The angle is stored as sine and cosine, a
+  /// cosine of zero or less means that the cone is too wide for rejecting the tile.
+  glm::dvec3 mConeAxis{};
+  double     mConeSin{1.0};
+  double     mConeCos{0.0};
+};
+
+/// Returns the oriented bounds of the tile at tileLevel and patchIdx whose elevation is in the
+/// range [tmin, tmax]. maxStep is the largest elevation difference between adjacent samples of the
+/// tile (see MinMaxPyramid::getMaxStep()), it is used to estimate the slopes of the terrain.
+OrientedTileBounds calcOrientedTileBounds(double tmin, double tmax, double maxStep, int tileLevel,
+    glm::int64 patchIdx, double radiusE = 1.F, double radiusP = 1.F, double heightScale = 1.F);
+
+/// Returns the oriented bounds of tile, see above.
+///
+/// Assumes that tile stores elevation data (i.e. a single scalar) and has a MinMaxPyramid.
+OrientedTileBounds calcOrientedTileBounds(
+    TileBase const& tile, double radiusE = 1.F, double radiusP = 1.F, double heightScale = 1.F);
+
+/// Returns an estimate of the largest geometric error of the tile at tileLevel, i.e. how far its
+/// surface deviates from the surface of the next finer level. dataError is the error of the tile's
+/// elevation data (see MinMaxPyramid::getGeometricError()). The error of a tile's own data with
+/// respect to its parent is used as an estimate of its children's error with respect to itself.
+/// The error made by approximating the curved surface with the flat cells between the samples is
+/// added.
+double calcGeometricError(double dataError, int tileLevel, double radiusE = 1.F,
+    double radiusP = 1.F, double heightScale = 1.F);
+
+/// Returns the geometric error of tile, see above.
+///
+/// Assumes that tile stores elevation data (i.e. a single scalar) and has a MinMaxPyramid.
+double calcGeometricError(
+    TileBase const& tile, double radiusE = 1.F, double radiusP = 1.F, double heightScale = 1.F);
+
+/// A part of a tile which hides the terrain behind it, see HorizonMap. The corners are placed at
+/// the minimum elevation of the cell, so the terrain of the cell is on or above the surface spanned
+/// by them. All points of this surface are within mRadius of mCenter.
+struct OccluderCell {
+  std::array<glm::dvec3, 4> mCorners{};
+  glm::dvec3                mCenter{};
+  double                    mRadius{};
+};
+
+/// The number of OccluderCells along each edge of a tile. Each of them corresponds to an entry of
+/// the level of the tile's MinMaxPyramid with this resolution. Smaller cells are mostly narrower
+/// than the azimuth resolution of the HorizonMap, as the tiles drawn usually have a similar size on
+/// screen.
+int const OccluderCellsPerEdge = 2;
+
+using TileOccluders = std::array<OccluderCell, OccluderCellsPerEdge * OccluderCellsPerEdge>;
+
+/// Returns the occluders of the tile at tileLevel and patchIdx. minHeights contains the minimum
+/// elevation of each cell, row by row.
+TileOccluders calcTileOccluders(
+    std::array<float, OccluderCellsPerEdge * OccluderCellsPerEdge> const& minHeights,
+    int tileLevel, glm::int64 patchIdx, double radiusE = 1.F, double radiusP = 1.F,
+    double heightScale = 1.F);
+
+/// Returns the occluders of tile, see above.
+///
+/// Assumes that tile stores elevation data (i.e. a single scalar) and has a MinMaxPyramid.
+TileOccluders calcTileOccluders(
+    TileBase const& tile, double radiusE = 1.F, double radiusP = 1.F, double heightScale = 1.F);
+
 } // namespace csp::lodbodies
 
 #endif // CSP_LOD_BODIES_TILEBOUNDS_HPP
@@ -0,0 +1,435 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileDrawList.hpp"
+
+#include "HEALPix.hpp"
+#include "PlanetParameters.hpp"
+#include "RenderDataDEM.hpp"
+#include "RenderDataImg.hpp"
+
+#include "../../../src/cs-utils/convert.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <future>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+int const SizeX = TileBase::SizeX; // NOLINT(cppcoreguidelines-interfaces-global-init)
+int const SizeY = TileBase::SizeY; // NOLINT(cppcoreguidelines-interfaces-global-init)
+// number of indices: (number of quads) * (2 triangles per quad)
+//                                      * (3 indices per triangle)
+std::uint32_t const NumIndices = (SizeX - 1) * (SizeY - 1) * 6;
+
+// the index buffer is subdivided down to single quads, which is seven levels below a tile
+int const MaxDeltaLevel = 7;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::int32_t floatBits(double value) {
+  auto const   f = static_cast<float>(value);
+  std::int32_t bits{};
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::ivec4 vec3Bits(glm::dvec3 const& value) {
+  return glm::ivec4(floatBits(value.x), floatBits(value.y), floatBits(value.z), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Calculate offset and scale factor for IMG data texture coordinates
+// @a tcIMG when rendering a tile with different resolution for DEM and
+// IMG data.
+void calcOffsetScale(
+    TileId const& idDEM, TileId const& idIMG, glm::ivec3& imgOS, glm::ivec3& demOS) {
+  if (idDEM.level() < idIMG.level()) {
+    // image resolution is higher
+    glm::int64 idx      = idIMG.patchIdx();
+    int        deltaLvl = idIMG.level() - idDEM.level();
+
+    // clamp deltaLvl to [0, 7] to match the number of indices
+    deltaLvl = std::min(MaxDeltaLevel, deltaLvl);
+
+    imgOS = glm::ivec3(0, 0, (SizeX - 1) / (int64_t(1) << deltaLvl));
+    demOS = glm::ivec3(0, 0, (SizeX - 1) / (int64_t(1) << deltaLvl));
+
+    for (int i = deltaLvl; i > 0; --i) {
+      if (idx & 0x01) {
+        demOS.x += (SizeX - 1) / (int64_t(1) << i);
+      }
+      if (idx & 0x02) {
+        demOS.y += (SizeY - 1) / (int64_t(1) << i);
+      }
+
+      idx >>= 2;
+    }
+  } else {
+    // dtm resolution is higher or equal
+    glm::int64 idx      = idDEM.patchIdx();
+    int        deltaLvl = idDEM.level() - idIMG.level();
+
+    imgOS = glm::ivec3(0, 0, (SizeX - 1) * (int64_t(1) << deltaLvl));
+    demOS = glm::ivec3(0, 0, SizeX - 1);
+
+    for (int i = 0; i < deltaLvl; ++i) {
+      if (idx & 0x01) {
+        imgOS.x += (SizeX - 1) * (int64_t(1) << i);
+      }
+      if (idx & 0x02) {
+        imgOS.y += (SizeY - 1) * (int64_t(1) << i);
+      }
+
+      idx >>= 2;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the vector to upload as "VP_EdgeDelta". It stores
+// the differences in resolution levels across the edges of the tile
+// in order NE, NW, SW, SE.
+glm::ivec4 calcEdgeDelta(RenderDataDEM const* rdDEM) {
+  return glm::ivec4(rdDEM->getEdgeDelta(0), rdDEM->getEdgeDelta(1), rdDEM->getEdgeDelta(2),
+      rdDEM->getEdgeDelta(3));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::ivec4 calcEdgePageDEM(RenderDataDEM const* rdDEM) {
+  return glm::ivec4(rdDEM->getEdgeRData(0) ? rdDEM->getEdgeRData(0)->getTexPage() : 0,
+      rdDEM->getEdgeRData(1) ? rdDEM->getEdgeRData(1)->getTexPage() : 0,
+      rdDEM->getEdgeRData(2) ? rdDEM->getEdgeRData(2)->getTexPage() : 0,
+      rdDEM->getEdgeRData(3) ? rdDEM->getEdgeRData(3)->getTexPage() : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::ivec4 calcEdgeLayerDEM(RenderDataDEM const* rdDEM) {
+  return glm::ivec4(rdDEM->getEdgeRData(0) ? rdDEM->getEdgeRData(0)->getTexLayer() : 0,
+      rdDEM->getEdgeRData(1) ? rdDEM->getEdgeRData(1)->getTexLayer() : 0,
+      rdDEM->getEdgeRData(2) ? rdDEM->getEdgeRData(2)->getTexLayer() : 0,
+      rdDEM->getEdgeRData(3) ? rdDEM->getEdgeRData(3)->getTexLayer() : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the offset along the edge idx of the tile to the lower resolution neighbour. For the
+// edges NE and SW (0 and 2) the offset is along y, for NW and SE (1 and 3) it is along x.
+int calcEdgeOffset(RenderDataDEM const* rdDEM, int idx) {
+  if (rdDEM->getEdgeDelta(idx) >= 0) {
+    return 0;
+  }
+
+  RenderDataDEM const* rdNeighbour = rdDEM->getEdgeRData(idx);
+  assert(rdNeighbour != nullptr);
+
+  TileId const& idDEM       = rdDEM->getTileId();
+  TileId const& idNeighbour = rdNeighbour->getTileId();
+
+  glm::int64 patchIdx = idDEM.patchIdx();
+  int        deltaLvl = idDEM.level() - idNeighbour.level();
+  int        mask     = idx % 2 == 0 ? 0x02 : 0x01;
+  int        result   = 0;
+
+  for (int i = deltaLvl; i > 0; --i) {
+    if (patchIdx & mask) {
+      result += (idx % 2 == 0 ? SizeY - 1 : SizeX - 1) / (int64_t(1) << i);
+    }
+
+    patchIdx >>= 2;
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+glm::ivec4 calcEdgeOffset(RenderDataDEM const* rdDEM) {
+  return glm::ivec4(calcEdgeOffset(rdDEM, 0), calcEdgeOffset(rdDEM, 1), calcEdgeOffset(rdDEM, 2),
+      calcEdgeOffset(rdDEM, 3));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The corners are those of the finer of the two tiles, which is the one covering the drawn area.
+RenderData* getCornerTile(RenderData* rdDEM, RenderData* rdIMG) {
+  return rdIMG && rdIMG->getLevel() > rdDEM->getLevel() ? rdIMG : rdDEM;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RenderData::Corners calcCorners(
+    TileId const& tileId, double height, PlanetParameters const& params) {
+  std::array<glm::dvec2, 4> const cornersLngLat = HEALPix::getCornersLngLat(tileId);
+
+  RenderData::Corners result;
+  result.mTileId = tileId;
+  result.mHeight = height;
+
+  for (std::size_t i(0); i < 4; ++i) {
+    result.mPositions.at(i) = cs::utils::convert::toCartesian(
+        cornersLngLat.at(i), params.mEquatorialRadius, params.mPolarRadius, height);
+    result.mNormals.at(i) = cs::utils::convert::lngLatToNormal(
+        cornersLngLat.at(i), params.mEquatorialRadius, params.mPolarRadius);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileDrawList::Instance packTile(RenderDataDEM const* rdDEM, RenderDataImg const* rdIMG,
+    RenderData::Corners const& corners, glm::dmat4 const& matVM, glm::dmat4 const& matNormal) {
+  TileId const& idDEM = rdDEM->getTileId();
+
+  glm::ivec3 demOS(0, 0, SizeX - 1);
+  glm::ivec3 imgOS(0, 0, SizeX - 1);
+
+  if (rdIMG && rdDEM->getLevel() != rdIMG->getLevel()) {
+    calcOffsetScale(idDEM, rdIMG->getTileId(), imgOS, demOS);
+  }
+
+  auto  baseXY        = HEALPix::getBaseXY(idDEM);
+  float averageHeight = rdDEM->getNode()->getTile()->getMinMaxPyramid()->getAverage();
+
+  TileDrawList::Instance result{};
+  result.mTileOffsetScale =
+      glm::ivec4(baseXY.y, baseXY.z, HEALPix::getNSide(idDEM), rdDEM->getTexPage());
+  result.mDemOffsetScale = glm::ivec4(demOS.x, demOS.y, demOS.z, rdDEM->getTexLayer());
+  result.mImgOffsetScale = glm::ivec4(imgOS.x, imgOS.y, imgOS.z, rdIMG ? rdIMG->getTexPage() : 0);
+  result.mF1F2           = glm::ivec4(HEALPix::getF1(idDEM), HEALPix::getF2(idDEM),
+      rdIMG ? rdIMG->getTexLayer() : -1, floatBits(averageHeight));
+  result.mEdgeDelta      = calcEdgeDelta(rdDEM);
+  result.mEdgePageDEM    = calcEdgePageDEM(rdDEM);
+  result.mEdgeLayerDEM   = calcEdgeLayerDEM(rdDEM);
+  result.mEdgeOffset     = calcEdgeOffset(rdDEM);
+
+  for (std::size_t i(0); i < 4; ++i) {
+    result.mCorners.at(i) =
+        vec3Bits(glm::dvec3(matVM * glm::dvec4(corners.mPositions.at(i), 1.0)));
+    result.mNormals.at(i) =
+        vec3Bits(glm::dvec3(matNormal * glm::dvec4(corners.mNormals.at(i), 0.0)));
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileDrawList::TileDrawList()
+    : mNumThreads(1) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileDrawList::setNumThreads(int numThreads) {
+  numThreads = std::max(1, numThreads);
+
+  if (numThreads == mNumThreads) {
+    return;
+  }
+
+  mNumThreads = numThreads;
+
+  // The calling thread packs tiles as well.
+  if (mNumThreads > 1) {
+    mThreadPool = std::make_unique<cs::utils::ThreadPool>(mNumThreads - 1);
+  } else {
+    mThreadPool.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileDrawList::getNumThreads() const {
+  return mNumThreads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileDrawList::build(std::vector<RenderData*> const& reqDEM,
+    std::vector<RenderData*> const& reqIMG, glm::dmat4 const& matVM,
+    PlanetParameters const& params) {
+  mEntries.clear();
+  mBatches.clear();
+  mStaleCorners.clear();
+  mMissingDEM = 0;
+  mMissingIMG = 0;
+
+  std::array<int, MaxDeltaLevel + 1> batchSizes{};
+
+  for (std::size_t i = 0; i < reqDEM.size(); ++i) {
+    auto* rdDEM = dynamic_cast<RenderDataDEM*>(reqDEM[i]);
+    auto* rdIMG = i < reqIMG.size() ? dynamic_cast<RenderDataImg*>(reqIMG[i]) : nullptr;
+
+    // count cases of data not being on GPU ...
+    if (rdDEM->getTexLayer() < 0) {
+      ++mMissingDEM;
+    }
+
+    if (rdIMG && rdIMG->getTexLayer() < 0) {
+      ++mMissingIMG;
+    }
+
+    // ... but do not attempt to draw
+    if (rdDEM->getTexLayer() < 0 || (rdIMG && rdIMG->getTexLayer() < 0)) {
+      continue;
+    }
+
+    // the batches are ordered by decreasing number of indices
+    int const batch =
+        rdIMG ? std::clamp(rdIMG->getLevel() - rdDEM->getLevel(), 0, MaxDeltaLevel) : 0;
+
+    // the corners are lifted to the average height of the elevation data
+    RenderData*  cornerTile = getCornerTile(rdDEM, rdIMG);
+    double const height     = rdDEM->getNode()->getTile()->getMinMaxPyramid()->getAverage() *
+                          params.mHeightScale;
+
+    RenderData::Corners const& corners = cornerTile->getCorners();
+
+    if (!(corners.mTileId == cornerTile->getTileId()) || corners.mHeight != height) {
+      mStaleCorners.push_back(StaleCorners{cornerTile, height});
+    }
+
+    mEntries.push_back(Entry{rdDEM, rdIMG, cornerTile, batch});
+    ++batchSizes.at(batch);
+  }
+
+  // sort the tiles into their batches
+  std::array<int, MaxDeltaLevel + 1> batchFirsts{};
+  int                                first = 0;
+
+  for (int batch = 0; batch <= MaxDeltaLevel; ++batch) {
+    batchFirsts.at(batch) = first;
+
+    // number of indices is number of indices for full patch divided by
+    // 4^(level difference) == 2^(2 * level difference)
+    if (batchSizes.at(batch) > 0) {
+      mBatches.push_back(Batch{NumIndices >> (2 * batch), first, batchSizes.at(batch)});
+    }
+
+    first += batchSizes.at(batch);
+  }
+
+  for (auto& entry : mEntries) {
+    entry.mBatch = batchFirsts.at(entry.mBatch)++;
+  }
+
+  // A tile may be listed more than once, its corners are computed only once so that no two threads
+  // write the same RenderData.
+  std::sort(mStaleCorners.begin(), mStaleCorners.end(),
+      [](StaleCorners const& lhs, StaleCorners const& rhs) { return lhs.mTile < rhs.mTile; });
+  mStaleCorners.erase(std::unique(mStaleCorners.begin(), mStaleCorners.end(),
+                          [](StaleCorners const& lhs, StaleCorners const& rhs) {
+                            return lhs.mTile == rhs.mTile;
+                          }),
+      mStaleCorners.end());
+
+  forEachRange(mStaleCorners.size(), [this, &params](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      RenderData* tile = mStaleCorners[i].mTile;
+      tile->setCorners(calcCorners(tile->getTileId(), mStaleCorners[i].mHeight, params));
+    }
+  });
+
+  glm::dmat4 const matNormal = glm::transpose(glm::inverse(matVM));
+
+  mInstances.resize(mEntries.size());
+
+  forEachRange(mEntries.size(), [this, &matVM, &matNormal](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      Entry const& entry = mEntries[i];
+      mInstances[entry.mBatch] =
+          packTile(entry.mDEM, entry.mIMG, entry.mCornerTile->getCorners(), matVM, matNormal);
+    }
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileDrawList::Instance> const& TileDrawList::getInstances() const {
+  return mInstances;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileDrawList::Batch> const& TileDrawList::getBatches() const {
+  return mBatches;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileDrawList::getNumTriangles() const {
+  std::size_t triangles = 0;
+
+  for (auto const& batch : mBatches) {
+    triangles += static_cast<std::size_t>(batch.mIndexCount / 3) *
+                 static_cast<std::size_t>(batch.mCount);
+  }
+
+  return triangles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileDrawList::getMissingDEM() const {
+  return mMissingDEM;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileDrawList::getMissingIMG() const {
+  return mMissingIMG;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileDrawList::forEachRange(
+    std::size_t count, std::function<void(std::size_t, std::size_t)> const& func) {
+  // below this many tiles per thread handing out the work costs more than it saves
+  std::size_t const minTiles = 64;
+  std::size_t const chunks =
+      std::min(static_cast<std::size_t>(mNumThreads), (count + minTiles - 1) / minTiles);
+
+  if (chunks <= 1) {
+    func(0, count);
+    return;
+  }
+
+  std::vector<std::future<void>> results;
+  results.reserve(chunks - 1);
+
+  for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+    std::size_t const begin = count * chunk / chunks;
+    std::size_t const end   = count * (chunk + 1) / chunks;
+    results.push_back(mThreadPool->enqueue([&func, begin, end]() { func(begin, end); }));
+  }
+
+  func(0, count / chunks);
+
+  for (auto& result : results) {
+    result.get();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILEDRAWLIST_HPP
+#define CSP_LOD_BODIES_TILEDRAWLIST_HPP
+
+#include "../../../src/cs-utils/ThreadPool.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+struct PlanetParameters;
+class RenderData;
+class RenderDataDEM;
+class RenderDataImg;
+
+/// The parameters of all tiles drawn in a frame, packed for the terrain shaders. The TileRenderer
+/// uploads the instances into a buffer texture with four 32 bit integer components per texel,
+/// from which VP_loadTile() in VistaPlanetTerrainShaderFunctions.vert reads the parameters of the
+/// current tile.
+///
+/// A tile is drawn with a part of the terrain index buffer, which gets smaller with the difference
+/// in level between its image and elevation data. Tiles with the same number of indices are stored
+/// next to each other and form a batch, which is drawn with a single instanced draw call.
+///
+/// The corners of a tile do not depend on the view, they are cached in the RenderData of the tile
+/// and only recomputed when the tile or its average height changed. The remaining parameters are
+/// packed in parallel, each tile is written to its final slot directly.
+///
+/// Building the list does not use OpenGL.
+class TileDrawList {
+ public:
+  TileDrawList();
+
+  /// The layout must match VP_loadTile(). Floats are stored with their bit patterns.
+  struct Instance {
+    glm::ivec4 mTileOffsetScale; ///< xyz: VP_tileOffsetScale, w: VP_pageDEM
+    glm::ivec4 mDemOffsetScale;  ///< xyz: VP_demOffsetScale, w: VP_layerDEM
+    glm::ivec4 mImgOffsetScale;  ///< xyz: VP_imgOffsetScale, w: VP_pageIMG
+    glm::ivec4 mF1F2;            ///< xy: VP_f1f2, z: VP_layerIMG, w: VP_demAverageHeight
+    glm::ivec4 mEdgeDelta;
+    glm::ivec4 mEdgePageDEM;
+    glm::ivec4 mEdgeLayerDEM;
+    glm::ivec4 mEdgeOffset;
+
+    /// The corners and normals of the tile in view space, in order N, W, S, E. w is unused.
+    std::array<glm::ivec4, 4> mCorners;
+    std::array<glm::ivec4, 4> mNormals;
+  };
+
+  /// The number of texels of the buffer texture per instance.
+  static int const sTexelsPerInstance = 16;
+
+  /// A range of getInstances() drawn with the same number of indices.
+  struct Batch {
+    std::uint32_t mIndexCount;
+    int           mFirst;
+    int           mCount;
+  };
+
+  /// Sets the number of threads used for packing the tiles. The calling thread packs tiles as
+  /// well, so with one thread (the default) no additional threads are used. The result does not
+  /// depend on the number of threads.
+  void setNumThreads(int numThreads);
+  int  getNumThreads() const;
+
+  /// Packs the tiles of reqDEM together with the tiles at the same index of reqIMG, if there are
+  /// any. Tiles whose data is not on the GPU are skipped. matVM is the modelview matrix of the
+  /// planet, the corners and normals are transformed to view space with it.
+  void build(std::vector<RenderData*> const& reqDEM, std::vector<RenderData*> const& reqIMG,
+      glm::dmat4 const& matVM, PlanetParameters const& params);
+
+  std::vector<Instance> const& getInstances() const;
+  std::vector<Batch> const&    getBatches() const;
+
+  /// The number of triangles of all batches, i.e. of the tiles which are actually drawn.
+  std::size_t getNumTriangles() const;
+
+  /// The number of tiles skipped by the last build() because their elevation or image data was not
+  /// on the GPU.
+  int getMissingDEM() const;
+  int getMissingIMG() const;
+
+ private:
+  struct Entry {
+    RenderDataDEM const* mDEM;
+    RenderDataImg const* mIMG;
+    RenderData const*    mCornerTile; ///< The tile whose cached corners are drawn.
+    int                  mBatch;      ///< The batch, after sorting the slot in mInstances.
+  };
+
+  struct StaleCorners {
+    RenderData* mTile;
+    double      mHeight;
+  };
+
+  /// Splits [0, count) into consecutive ranges and calls func for each of them, distributed over
+  /// the threads. Returns when all ranges are done.
+  void forEachRange(
+      std::size_t count, std::function<void(std::size_t, std::size_t)> const& func);
+
+  std::vector<Instance>     mInstances;
+  std::vector<Batch>        mBatches;
+  std::vector<Entry>        mEntries;
+  std::vector<StaleCorners> mStaleCorners;
+  int                       mMissingDEM{};
+  int                       mMissingIMG{};
+
+  int                                    mNumThreads;
+  std::unique_ptr<cs::utils::ThreadPool> mThreadPool;
+};
+
+static_assert(sizeof(TileDrawList::Instance) ==
+                  TileDrawList::sTexelsPerInstance * sizeof(glm::ivec4),
+    "TileDrawList::Instance must be tightly packed.");
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILEDRAWLIST_HPP
@@ -6,8 +6,23 @@
 
 #include "TileNode.hpp"
 
+#include "FixedSizePool.hpp"
+
 namespace csp::lodbodies {
 
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FixedSizePool& getNodePool() {
+  static FixedSizePool pool(sizeof(TileNode), 256);
+  return pool;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TileNode::TileNode()
@@ -29,7 +44,7 @@ TileNode::TileNode(TileBase* tile, int childMaxLevel)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-TileNode::TileNode(std::unique_ptr<TileBase>&& tile, int childMaxLevel)
+TileNode::TileNode(std::shared_ptr<TileBase> tile, int childMaxLevel)
     : mTile(std::move(tile))
     , mParent(nullptr)
     , mChildMaxLevel(childMaxLevel) {
@@ -40,6 +55,27 @@ TileNode::TileNode(std::unique_ptr<TileBase>&& tile, int childMaxLevel)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void* TileNode::operator new(std::size_t size) {
+  if (size != sizeof(TileNode)) {
+    return ::operator new(size);
+  }
+
+  return getNodePool().allocate();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileNode::operator delete(void* ptr, std::size_t size) {
+  if (size != sizeof(TileNode)) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  getNodePool().deallocate(ptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 int TileNode::getLevel() const {
   return mTile->getLevel();
 }
@@ -76,13 +112,13 @@ TileBase* TileNode::getTile() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-TileBase* TileNode::releaseTile() {
-  return mTile.release();
+std::shared_ptr<TileBase> const& TileNode::getSharedTile() const {
+  return mTile;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileNode::setTile(std::unique_ptr<TileBase> tile) {
+void TileNode::setTile(std::shared_ptr<TileBase> tile) {
   mTile = std::move(tile);
 }
 
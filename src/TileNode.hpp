@@ -22,7 +22,12 @@ class TileNode {
  public:
   explicit TileNode();
   explicit TileNode(TileBase* tile, int childMaxLevel = -1);
-  explicit TileNode(std::unique_ptr<TileBase>&& tile, int childMaxLevel = -1);
+  explicit TileNode(std::shared_ptr<TileBase> tile, int childMaxLevel = -1);
+
+  /// TileNodes are created by loader threads and destroyed on the render thread at a high rate.
+  /// They are therefore allocated from a FixedSizePool instead of the global heap.
+  static void* operator new(std::size_t size);
+  static void  operator delete(void* ptr, std::size_t size);
 
   // move constructor -- disabled: triggers a bug with gcc 4.3?
   //     TileNode(BOOST_RV_REF(TileNode) source);
@@ -40,13 +45,15 @@ class TileNode {
   /// Returns the tile owned by this, or NULL if there is no such tile.
   TileBase* getTile() const;
 
-  /// Gives up ownership of the tile owned by this and returns it, or NULL if there is no such tile.
-  /// It is now the callers responsibility to correctly dispose of the tile.
-  TileBase* releaseTile();
+  /// Returns the tile owned by this. Tiles are immutable once loaded, so nodes in different trees
+  /// which refer to the same data (e.g. of two bodies using the same dataset) may share them. The
+  /// only exception is the mip chain, which is built at most once (see TileBase::buildMipChain())
+  /// and only read afterwards.
+  std::shared_ptr<TileBase> const& getSharedTile() const;
 
-  /// Sets the tile to be owned by this. Exclusive ownership of the tile is taken by this and when
-  /// this TileNode is destroyed the tile is destroyed as well.
-  void setTile(std::unique_ptr<TileBase> tile);
+  /// Sets the tile to be owned by this. The tile is destroyed when the last TileNode referring to
+  /// it is destroyed.
+  void setTile(std::shared_ptr<TileBase> tile);
 
   /// Returns the child at childIdx (must be in [0, 3]).
   TileNode* getChild(int childIdx) const;
@@ -70,7 +77,7 @@ class TileNode {
  private:
   void setParent(TileNode* parent);
 
-  std::unique_ptr<TileBase>                mTile;
+  std::shared_ptr<TileBase>                mTile;
   TileNode*                                mParent;
   std::array<std::unique_ptr<TileNode>, 4> mChildren;
   int                                      mChildMaxLevel;
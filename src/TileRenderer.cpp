@@ -6,15 +6,13 @@
 
 #include "TileRenderer.hpp"
 
-#include "HEALPix.hpp"
 #include "PlanetParameters.hpp"
 #include "RenderDataDEM.hpp"
-#include "RenderDataImg.hpp"
 #include "TileTextureArray.hpp"
 #include "TreeManagerBase.hpp"
 
 #include "../../../src/cs-graphics/Shadows.hpp"
-#include "../../../src/cs-utils/convert.hpp"
+#include "../../../src/cs-utils/utils.hpp"
 
 #include <VistaBase/VistaStreamUtils.h>
 #include <VistaKernel/DisplayManager/VistaDisplayManager.h>
@@ -22,6 +20,8 @@
 #include <VistaOGLExt/VistaShaderRegistry.h>
 #include <VistaOGLExt/VistaTexture.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
 #include <glm/gtx/io.hpp>
 #include <memory>
 
@@ -30,13 +30,14 @@ namespace csp::lodbodies {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 namespace {
-GLenum const texUnitNameDEM = GL_TEXTURE0;
-GLint const  texUnitDEM     = 0;
-
-GLenum const texUnitNameIMG = GL_TEXTURE1;
-GLint const  texUnitIMG     = 1;
-
-GLint const texUnitShadow = 2;
+// each page of the TileTextureArrays is bound to its own texture unit, followed by the five
+// shadow maps, PlanetShader uses the two units after those, the page cache of the virtual
+// texturing mode the one after that and the parameters of the tiles the last one
+GLint const texUnitDEM        = 0;
+GLint const texUnitIMG        = texUnitDEM + TexturePagePool::sMaxPages;
+GLint const texUnitShadow     = texUnitIMG + TexturePagePool::sMaxPages;
+GLint const texUnitVirtualIMG = texUnitShadow + TerrainShader::sMaxShadowCascades + 2;
+GLint const texUnitTiles      = texUnitVirtualIMG + 1;
 
 GLsizeiptr const SizeX = TileBase::SizeX; // NOLINT(cppcoreguidelines-interfaces-global-init)
 GLsizeiptr const SizeY = TileBase::SizeY; // NOLINT(cppcoreguidelines-interfaces-global-init)
@@ -48,6 +49,20 @@ GLsizeiptr const NumIndices = (SizeX - 1) * (SizeY - 1) * 6;
 
 const char* BoundsVertexShaderName("VistaPlanetTileBounds.vert");
 const char* BoundsFragmentShaderName("VistaPlanetTileBounds.frag");
+const char* FeedbackFragmentShaderName("VistaPlanetFeedback.frag");
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns the count texture units starting at first.
+std::vector<GLint> makeTexUnits(GLint first, int count) {
+  std::vector<GLint> result(static_cast<std::size_t>(count));
+
+  for (int i = 0; i < count; ++i) {
+    result.at(i) = first + i;
+  }
+
+  return result;
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -130,165 +145,6 @@ int buildTileIndices(GLuint* buffer, int idx, int level, int baseX, int baseY) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Calculate offset and scale factor for IMG data texture coordinates
-// @a tcIMG and an offset (@a idxOffset) and size (@a idxCount) of the
-// index buffer to use when rendering a tile with different resolution
-// for DEM and IMG data.
-void calcOffsetScale(TileId const& idDEM, TileId const& idIMG, glm::ivec3& imgOS, glm::ivec3& demOS,
-    GLuint& idxCount) {
-  if (idDEM.level() < idIMG.level()) {
-    // image resolution is higher
-    glm::int64 idx      = idIMG.patchIdx();
-    int        deltaLvl = idIMG.level() - idDEM.level();
-
-    // clamp deltaLvl to [0, 7] to avoid out of bounds access to
-    // IndexOffsets{X,Y} arrays
-    deltaLvl = std::min(7, deltaLvl);
-
-    // number of indices is number of indices for full patch divided by
-    // 4^(level difference) == 2^(2 * level difference)
-    idxCount = NumIndices / (int64_t(1) << (2 * deltaLvl));
-
-    imgOS = glm::ivec3(0, 0, (SizeX - 1) / (int64_t(1) << deltaLvl));
-    demOS = glm::ivec3(0, 0, (SizeX - 1) / (int64_t(1) << deltaLvl));
-
-    for (int i = deltaLvl; i > 0; --i) {
-      if (idx & 0x01) {
-        demOS.x += (SizeX - 1) / (int64_t(1) << i);
-      }
-      if (idx & 0x02) {
-        demOS.y += (SizeY - 1) / (int64_t(1) << i);
-      }
-
-      idx >>= 2;
-    }
-  } else {
-    // dtm resolution is higher or equal
-    glm::int64 idx      = idDEM.patchIdx();
-    int        deltaLvl = idDEM.level() - idIMG.level();
-
-    imgOS    = glm::ivec3(0, 0, (SizeX - 1) * (int64_t(1) << deltaLvl));
-    demOS    = glm::ivec3(0, 0, SizeX - 1);
-    idxCount = NumIndices;
-
-    for (int i = 0; i < deltaLvl; ++i) {
-      if (idx & 0x01) {
-        imgOS.x += (SizeX - 1) * (int64_t(1) << i);
-      }
-      if (idx & 0x02) {
-        imgOS.y += (SizeY - 1) * (int64_t(1) << i);
-      }
-
-      idx >>= 2;
-    }
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-// Returns the vector to upload as "VP_EdgeDelta" uniform. It stores
-// the differences in resolution levels across the edges of the tile
-// in order NE, NW, SW, SE.
-glm::ivec4 calcEdgeDelta(RenderDataDEM* rdDEM) {
-  return glm::ivec4(rdDEM->getEdgeDelta(0), rdDEM->getEdgeDelta(1), rdDEM->getEdgeDelta(2),
-      rdDEM->getEdgeDelta(3));
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-glm::ivec4 calcEdgeLayerDEM(RenderDataDEM* rdDEM) {
-  return glm::ivec4(rdDEM->getEdgeRData(0) ? rdDEM->getEdgeRData(0)->getTexLayer() : 0,
-      rdDEM->getEdgeRData(1) ? rdDEM->getEdgeRData(1)->getTexLayer() : 0,
-      rdDEM->getEdgeRData(2) ? rdDEM->getEdgeRData(2)->getTexLayer() : 0,
-      rdDEM->getEdgeRData(3) ? rdDEM->getEdgeRData(3)->getTexLayer() : 0);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-glm::ivec4 calcEdgeOffset(RenderDataDEM* rdDEM) {
-  glm::ivec4 result(0, 0, 0, 0);
-
-  if (rdDEM->getEdgeDelta(0) < 0) {
-    RenderDataDEM* rdNE = rdDEM->getEdgeRData(0);
-    assert(rdNE != nullptr);
-
-    TileId const& idDEM = rdDEM->getTileId();
-    TileId const& idNE  = rdNE->getTileId();
-
-    glm::int64 idx      = idDEM.patchIdx();
-    int        deltaLvl = idDEM.level() - idNE.level();
-
-    for (int i = deltaLvl; i > 0; --i) {
-      if (idx & 0x02) {
-        result[0] += (SizeY - 1) / (int64_t(1) << i);
-      }
-
-      idx >>= 2;
-    }
-  }
-
-  if (rdDEM->getEdgeDelta(1) < 0) {
-    RenderDataDEM* rdNW = rdDEM->getEdgeRData(1);
-    assert(rdNW != nullptr);
-
-    TileId const& idDEM = rdDEM->getTileId();
-    TileId const& idNW  = rdNW->getTileId();
-
-    glm::int64 idx      = idDEM.patchIdx();
-    int        deltaLvl = idDEM.level() - idNW.level();
-
-    for (int i = deltaLvl; i > 0; --i) {
-      if (idx & 0x01) {
-        result[1] += (SizeX - 1) / (int64_t(1) << i);
-      }
-
-      idx >>= 2;
-    }
-  }
-
-  if (rdDEM->getEdgeDelta(2) < 0) {
-    RenderDataDEM* rdSW = rdDEM->getEdgeRData(2);
-    assert(rdSW != nullptr);
-
-    TileId const& idDEM = rdDEM->getTileId();
-    TileId const& idSW  = rdSW->getTileId();
-
-    glm::int64 idx      = idDEM.patchIdx();
-    int        deltaLvl = idDEM.level() - idSW.level();
-
-    for (int i = deltaLvl; i > 0; --i) {
-      if (idx & 0x02) {
-        result[2] += (SizeY - 1) / (int64_t(1) << i);
-      }
-
-      idx >>= 2;
-    }
-  }
-
-  if (rdDEM->getEdgeDelta(3) < 0) {
-    RenderDataDEM* rdSE = rdDEM->getEdgeRData(3);
-    assert(rdSE != nullptr);
-
-    TileId const& idDEM = rdDEM->getTileId();
-    TileId const& idSE  = rdSE->getTileId();
-
-    glm::int64 idx      = idDEM.patchIdx();
-    int        deltaLvl = idDEM.level() - idSE.level();
-
-    for (int i = deltaLvl; i > 0; --i) {
-      if (idx & 0x01) {
-        result[3] += (SizeX - 1) / (int64_t(1) << i);
-      }
-
-      idx >>= 2;
-    }
-  }
-
-  return result;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -312,6 +168,9 @@ TileRenderer::TileRenderer(
     , mMatVM()
     , mMatP()
     , mProgTerrain(nullptr)
+    , mTileBufferId(0U)
+    , mTileTextureId(0U)
+    , mNumTriangles(0)
     , mFrameCount(0)
     , mEnableDrawTiles(true)
     , mEnableDrawBounds(false)
@@ -321,6 +180,13 @@ TileRenderer::TileRenderer(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+TileRenderer::~TileRenderer() {
+  glDeleteTextures(1, &mTileTextureId);
+  glDeleteBuffers(1, &mTileBufferId);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TileRenderer::setTerrainShader(TerrainShader* shader) {
   mProgTerrain = shader;
 }
@@ -337,6 +203,8 @@ void TileRenderer::render(std::vector<RenderData*> const& reqDEM,
     std::vector<RenderData*> const& reqIMG, cs::graphics::ShadowMap* shadowMap) {
   init();
 
+  mNumTriangles = 0;
+
   if (mEnableDrawTiles && !reqDEM.empty()) {
     preRenderTiles(shadowMap);
     renderTiles(reqDEM, reqIMG);
@@ -352,6 +220,100 @@ void TileRenderer::render(std::vector<RenderData*> const& reqDEM,
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TileRenderer::renderFeedback(
+    std::vector<RenderData*> const& reqDEM, std::vector<RenderData*> const& reqIMG) {
+  TileTextureArray* glDEM = mTreeMgrDEM ? &mTreeMgrDEM->getTileTextureArray() : nullptr;
+  TileTextureArray* glIMG = mTreeMgrIMG ? &mTreeMgrIMG->getTileTextureArray() : nullptr;
+
+  if (!glDEM || !glIMG || !glIMG->isVirtual() || !mProgTerrain) {
+    return;
+  }
+
+  init();
+
+  if (!mFeedback) {
+    mFeedback = std::make_unique<VirtualTextureFeedback>();
+  }
+
+  // the pages are uploaded by the next call to TileTextureArray::processQueue
+  glIMG->addFeedback(mFeedback->collect());
+
+  if (!mEnableDrawTiles || reqDEM.empty()) {
+    return;
+  }
+
+  // make sure that the vertex source of mProgTerrain is complete
+  mProgTerrain->bind();
+  mProgTerrain->release();
+
+  if (!mProgFeedback || mFeedbackVertexSource != mProgTerrain->mVertexSource) {
+    mFeedbackVertexSource = mProgTerrain->mVertexSource;
+    mProgFeedback         = std::make_unique<TerrainShader>(mFeedbackVertexSource,
+        VistaShaderRegistry::GetInstance().RetrieveShader(FeedbackFragmentShaderName));
+  }
+
+  mFeedback->begin();
+
+  if (mEnableFaceCulling) {
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
+  }
+
+  // only the elevation data is sampled
+  for (int page = 0; page < TexturePagePool::sMaxPages; ++page) {
+    glActiveTexture(GL_TEXTURE0 + texUnitDEM + page);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, glDEM->getTextureId(page));
+  }
+
+  mVaoTerrain->Bind();
+  mProgFeedback->bind();
+
+  TerrainShader::FrameUniforms values;
+  values.mFarClip = cs::utils::getCurrentFarClipDistance();
+  setFrameUniforms(*mProgFeedback, values);
+
+  drawTiles(*mProgFeedback, reqDEM, reqIMG);
+
+  mProgFeedback->release();
+  mVaoTerrain->Release();
+
+  for (int page = 0; page < TexturePagePool::sMaxPages; ++page) {
+    glActiveTexture(GL_TEXTURE0 + texUnitDEM + page);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+  }
+
+  mFeedback->end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileRenderer::setFrameUniforms(
+    TerrainShader& shader, TerrainShader::FrameUniforms values) const {
+  TileTextureArray* glIMG = mTreeMgrIMG ? &mTreeMgrIMG->getTileTextureArray() : nullptr;
+
+  values.mMatProjection = glm::mat4(mMatP);
+  values.mMatModelView  = glm::mat4(mMatVM);
+  values.mRadius        = glm::vec2(mParams->mEquatorialRadius, mParams->mPolarRadius);
+  values.mHeightScale = static_cast<float>(mParams->mHeightScale);
+  values.mVirtualIMG  = glIMG && glIMG->isVirtual() ? 1 : 0;
+  shader.setFrameUniforms(values);
+
+  // the texture units are only uploaded after the shader has been compiled
+  static std::vector<GLint> const unitsDEM = makeTexUnits(texUnitDEM, TexturePagePool::sMaxPages);
+  static std::vector<GLint> const unitsIMG = makeTexUnits(texUnitIMG, TexturePagePool::sMaxPages);
+  static std::vector<GLint> const unitsShadow =
+      makeTexUnits(texUnitShadow, TerrainShader::sMaxShadowCascades);
+
+  TerrainShader::UniformLocs const& locs = shader.getUniformLocs();
+  shader.setUniform(locs.mTexDEM, unitsDEM);
+  shader.setUniform(locs.mTexIMG, unitsIMG);
+  shader.setUniform(locs.mShadowMaps, unitsShadow);
+  shader.setUniform(locs.mTexVirtualIMG, texUnitVirtualIMG);
+  shader.setUniform(locs.mTiles, texUnitTiles);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TileRenderer::preRenderTiles(cs::graphics::ShadowMap* shadowMap) {
   TileTextureArray* glDEM = mTreeMgrDEM ? &mTreeMgrDEM->getTileTextureArray() : nullptr;
   TileTextureArray* glIMG = mTreeMgrIMG ? &mTreeMgrIMG->getTileTextureArray() : nullptr;
@@ -372,103 +334,59 @@ void TileRenderer::preRenderTiles(cs::graphics::ShadowMap* shadowMap) {
   }
 
   // bind textures with tile data
-  if (glDEM) {
-    glActiveTexture(texUnitNameDEM);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, glDEM->getTextureId());
+  for (int page = 0; page < TexturePagePool::sMaxPages; ++page) {
+    if (glDEM) {
+      glActiveTexture(GL_TEXTURE0 + texUnitDEM + page);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, glDEM->getTextureId(page));
+    }
+
+    if (glIMG) {
+      glActiveTexture(GL_TEXTURE0 + texUnitIMG + page);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, glIMG->getTextureId(page));
+    }
   }
 
-  if (glIMG) {
-    glActiveTexture(texUnitNameIMG);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, glIMG->getTextureId());
+  if (glIMG && glIMG->isVirtual()) {
+    glActiveTexture(GL_TEXTURE0 + texUnitVirtualIMG);
+    glBindTexture(GL_TEXTURE_2D, glIMG->getVirtualCacheId());
   }
 
   mVaoTerrain->Bind();
   mProgTerrain->bind();
-  VistaGLSLShader& shader = mProgTerrain->mShader;
 
   // update "frame global" uniforms
-  GLint loc = shader.GetUniformLocation("VP_matProjection");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(glm::fmat4x4(mMatP)));
-  loc = shader.GetUniformLocation("VP_matModelView");
-  glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(glm::fmat4x4(mMatVM)));
-  loc = shader.GetUniformLocation("VP_heightScale");
-  shader.SetUniform(loc, static_cast<float>(mParams->mHeightScale));
-  loc = shader.GetUniformLocation("VP_radius");
-  shader.SetUniform(loc, static_cast<float>(mParams->mEquatorialRadius),
-      static_cast<float>(mParams->mPolarRadius));
-  loc = shader.GetUniformLocation("VP_texDEM");
-  shader.SetUniform(loc, texUnitDEM);
-  loc = shader.GetUniformLocation("VP_texIMG");
-  shader.SetUniform(loc, texUnitIMG);
-  loc = shader.GetUniformLocation("VP_shadowMapMode");
-  shader.SetUniform(loc, shadowMap == nullptr);
+  TerrainShader::FrameUniforms values;
+  values.mShadowMapMode = shadowMap == nullptr ? 1 : 0;
 
   if (shadowMap) {
-    shader.SetUniform(shader.GetUniformLocation("VP_shadowBias"), shadowMap->getBias());
-    shader.SetUniform(shader.GetUniformLocation("VP_shadowCascades"),
-        static_cast<int>(shadowMap->getMaps().size()));
+    std::size_t const cascades = std::min(
+        shadowMap->getMaps().size(), static_cast<std::size_t>(TerrainShader::sMaxShadowCascades));
 
-    for (size_t i = 0; i < shadowMap->getMaps().size(); ++i) {
-      GLint locSamplers = glGetUniformLocation(
-          shader.GetProgram(), ("VP_shadowMaps[" + std::to_string(i) + "]").c_str());
-      GLint locMatrices = glGetUniformLocation(shader.GetProgram(),
-          ("VP_shadowProjectionViewMatrices[" + std::to_string(i) + "]").c_str());
+    values.mShadowBias     = shadowMap->getBias();
+    values.mShadowCascades = static_cast<int>(cascades);
 
+    for (std::size_t i = 0; i < cascades; ++i) {
       shadowMap->getMaps()[i]->Bind(GL_TEXTURE0 + texUnitShadow + static_cast<int>(i));
-      glUniform1i(locSamplers, texUnitShadow + static_cast<int>(i));
 
       auto mat = shadowMap->getShadowMatrices()[i];
-      glUniformMatrix4fv(locMatrices, 1, GL_FALSE, mat.GetData());
+      std::memcpy(glm::value_ptr(values.mShadowProjectionViewMatrices.at(i)), mat.GetData(),
+          sizeof(glm::mat4));
     }
   }
+
+  setFrameUniforms(*mProgTerrain, values);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileRenderer::renderTiles(
     std::vector<RenderData*> const& renderDEM, std::vector<RenderData*> const& renderIMG) {
-  VistaGLSLShader& shader = mProgTerrain->mShader;
-
-  // query uniform locations once and store in locs
-  UniformLocs locs{};
-  locs.demAverageHeight = shader.GetUniformLocation("VP_demAverageHeight");
-  locs.tileOffsetScale  = shader.GetUniformLocation("VP_tileOffsetScale");
-  locs.demOffsetScale   = shader.GetUniformLocation("VP_demOffsetScale");
-  locs.imgOffsetScale   = shader.GetUniformLocation("VP_imgOffsetScale");
-  locs.edgeDelta        = shader.GetUniformLocation("VP_edgeDelta");
-  locs.edgeLayerDEM     = shader.GetUniformLocation("VP_edgeLayerDEM");
-  locs.edgeOffset       = shader.GetUniformLocation("VP_edgeOffset");
-  locs.f1f2             = shader.GetUniformLocation("VP_f1f2");
-  locs.layerDEM         = shader.GetUniformLocation("VP_layerDEM");
-  locs.layerIMG         = shader.GetUniformLocation("VP_layerIMG");
-
-  int missingDEM = 0;
-  int missingIMG = 0;
-
-  // iterate over both std::vector<RenderData*>s together
-  for (size_t i(0); i < renderDEM.size(); ++i) {
-    // get data associated with nodes
-    auto*          rdDEM = dynamic_cast<RenderDataDEM*>(renderDEM[i]);
-    RenderDataImg* rdIMG =
-        i < renderIMG.size() ? dynamic_cast<RenderDataImg*>(renderIMG[i]) : nullptr;
-
-    // count cases of data not being on GPU ...
-    if (rdDEM->getTexLayer() < 0) {
-      ++missingDEM;
-    }
+  drawTiles(*mProgTerrain, renderDEM, renderIMG);
 
-    if (rdIMG && rdIMG->getTexLayer() < 0) {
-      ++missingIMG;
-    }
+  mNumTriangles = mDrawList.getNumTriangles();
 
-    // ... but do not attempt to draw
-    if (rdDEM->getTexLayer() < 0 || (rdIMG && rdIMG->getTexLayer() < 0)) {
-      continue;
-    }
-
-    // render
-    renderTile(rdDEM, rdIMG, locs);
-  }
+  int const missingDEM = mDrawList.getMissingDEM();
+  int const missingIMG = mDrawList.getMissingIMG();
 
   if (missingDEM || missingIMG) {
     // The only time this is "expected" to happen is after a texture had
@@ -478,88 +396,47 @@ void TileRenderer::renderTiles(
     vstr::warnp() << "Some tiles were not available on the GPU (" << missingDEM << " / "
                   << missingIMG << "  DEM/IMG)." << std::endl;
   }
-
-  // Iterate over std::vector<RenderData*>s a second time, reset edge deltas and flags.
-  // Cannot be done during rendering because a TileNode/RenderData may
-  // appear multiple times in renderDEM/renderIMG.
-  for (auto* it : renderDEM) {
-    auto* rdDEM = dynamic_cast<RenderDataDEM*>(it);
-    rdDEM->resetEdgeDeltas();
-    rdDEM->resetEdgeRData();
-    rdDEM->clearFlags();
-  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileRenderer::renderTile(RenderDataDEM* rdDEM, RenderDataImg* rdIMG, UniformLocs const& locs) {
-  VistaGLSLShader& shader   = mProgTerrain->mShader;
-  TileId const&    idDEM    = rdDEM->getTileId();
-  GLuint           idxCount = NumIndices;
-
-  std::array<glm::dvec2, 4> cornersLngLat{};
+void TileRenderer::drawTiles(TerrainShader& shader, std::vector<RenderData*> const& reqDEM,
+    std::vector<RenderData*> const& reqIMG) {
+  mDrawList.build(reqDEM, reqIMG, mMatVM, *mParams);
 
-  glm::ivec3 demOS(0, 0, 256);
-  glm::ivec3 imgOS(0, 0, 256);
+  auto const& instances = mDrawList.getInstances();
 
-  if (!rdIMG || rdDEM->getLevel() == rdIMG->getLevel()) {
-    // no image data or same resolution
-    cornersLngLat = HEALPix::getCornersLngLat(idDEM);
-  } else if (rdDEM->getLevel() < rdIMG->getLevel()) {
-    // image resolution is higher
-    calcOffsetScale(idDEM, rdIMG->getTileId(), imgOS, demOS, idxCount);
-    cornersLngLat = HEALPix::getCornersLngLat(rdIMG->getTileId());
-  } else {
-    //  elevation resolution is higher
-    calcOffsetScale(idDEM, rdIMG->getTileId(), imgOS, demOS, idxCount);
-    cornersLngLat = HEALPix::getCornersLngLat(idDEM);
+  if (instances.empty()) {
+    return;
   }
 
-  auto  baseXY        = HEALPix::getBaseXY(idDEM);
-  auto  tileOS        = glm::ivec3(baseXY.y, baseXY.z, HEALPix::getNSide(idDEM));
-  auto  edgeDelta     = calcEdgeDelta(rdDEM);
-  auto  edgeLayerDEM  = calcEdgeLayerDEM(rdDEM);
-  auto  edgeOffset    = calcEdgeOffset(rdDEM);
-  auto  patchF1F2     = glm::ivec2(HEALPix::getF1(idDEM), HEALPix::getF2(idDEM));
-  float averageHeight = rdDEM->getNode()->getTile()->getMinMaxPyramid()->getAverage();
-
-  // update uniforms
-  shader.SetUniform(locs.demAverageHeight, averageHeight);
-  shader.SetUniform(locs.tileOffsetScale, 3, 1, glm::value_ptr(tileOS));
-  shader.SetUniform(locs.demOffsetScale, 3, 1, glm::value_ptr(demOS));
-  shader.SetUniform(locs.imgOffsetScale, 3, 1, glm::value_ptr(imgOS));
-  shader.SetUniform(locs.layerIMG, rdIMG ? rdIMG->getTexLayer() : 0);
-  shader.SetUniform(locs.layerDEM, rdDEM->getTexLayer());
-  shader.SetUniform(locs.edgeDelta, 4, 1, glm::value_ptr(edgeDelta));
-  shader.SetUniform(locs.edgeLayerDEM, 4, 1, glm::value_ptr(edgeLayerDEM));
-  shader.SetUniform(locs.edgeOffset, 4, 1, glm::value_ptr(edgeOffset));
-  shader.SetUniform(locs.f1f2, 2, 1, glm::value_ptr(patchF1F2));
-
-  // order of components: N, W, S, E
-  std::array<glm::dvec3, 4> corners{};
-  std::array<glm::dvec3, 4> normals{};
-  std::array<glm::fvec3, 4> cornersViewSpace{};
-  std::array<glm::fvec3, 4> normalsViewSpace{};
-
-  glm::dmat4 matNormal = glm::transpose(glm::inverse(mMatVM));
-
-  for (int i(0); i < 4; ++i) {
-    corners.at(i) = cs::utils::convert::toCartesian(cornersLngLat.at(i), mParams->mEquatorialRadius,
-        mParams->mPolarRadius, averageHeight * static_cast<float>(mParams->mHeightScale));
-    cornersViewSpace.at(i) = glm::fvec3(mMatVM * glm::dvec4(corners.at(i), 1.0));
-
-    normals.at(i) = cs::utils::convert::lngLatToNormal(
-        cornersLngLat.at(i), mParams->mEquatorialRadius, mParams->mPolarRadius);
-    normalsViewSpace.at(i) = glm::fvec3(matNormal * glm::dvec4(normals.at(i), 0.0));
+  if (mTileBufferId == 0U) {
+    glGenBuffers(1, &mTileBufferId);
+    glGenTextures(1, &mTileTextureId);
   }
 
-  glUniform3fv(glGetUniformLocation(shader.GetProgram(), "VP_corners"), 9,
-      glm::value_ptr(cornersViewSpace[0]));
-  glUniform3fv(glGetUniformLocation(shader.GetProgram(), "VP_normals"), 4,
-      glm::value_ptr(normalsViewSpace[0]));
+  // the storage of the previous frame is orphaned, so that the upload does not wait for the draw
+  // calls which still read from it
+  glBindBuffer(GL_TEXTURE_BUFFER, mTileBufferId);
+  glBufferData(GL_TEXTURE_BUFFER,
+      static_cast<GLsizeiptr>(instances.size() * sizeof(TileDrawList::Instance)),
+      instances.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0U);
+
+  glActiveTexture(GL_TEXTURE0 + texUnitTiles);
+  glBindTexture(GL_TEXTURE_BUFFER, mTileTextureId);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, mTileBufferId);
+
+  // gl_InstanceID starts at zero for each draw call, VP_tileBase is the index of the first tile
+  GLint const locTileBase = shader.getUniformLocs().mTileBase;
+
+  for (auto const& batch : mDrawList.getBatches()) {
+    shader.setUniform(locTileBase, batch.mFirst);
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(batch.mIndexCount),
+        GL_UNSIGNED_INT, nullptr, batch.mCount);
+  }
 
-  // draw tile
-  glDrawElements(GL_TRIANGLES, idxCount, GL_UNSIGNED_INT, nullptr);
+  glBindTexture(GL_TEXTURE_BUFFER, 0U);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -569,11 +446,16 @@ void TileRenderer::postRenderTiles(cs::graphics::ShadowMap* shadowMap) {
   mProgTerrain->release();
   mVaoTerrain->Release();
 
-  glActiveTexture(texUnitNameDEM);
-  glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+  for (int page = 0; page < TexturePagePool::sMaxPages; ++page) {
+    glActiveTexture(GL_TEXTURE0 + texUnitDEM + page);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+
+    glActiveTexture(GL_TEXTURE0 + texUnitIMG + page);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+  }
 
-  glActiveTexture(texUnitNameIMG);
-  glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+  glActiveTexture(GL_TEXTURE0 + texUnitVirtualIMG);
+  glBindTexture(GL_TEXTURE_2D, 0U);
 
   if (mEnableFaceCulling) {
     glDisable(GL_CULL_FACE);
@@ -608,7 +490,9 @@ void TileRenderer::preRenderBounds() {
 
 void TileRenderer::renderBounds(
     std::vector<RenderData*> const& reqDEM, std::vector<RenderData*> const& reqIMG) {
-  auto renderBounds = [this](std::vector<RenderData*> const& req) {
+  GLint const locCorners = mProgBounds->GetUniformLocation("VP_corners");
+
+  auto renderBounds = [this, locCorners](std::vector<RenderData*> const& req) {
     for (auto const& it : req) {
       if (it->hasBounds()) {
         BoundingBox<double> const& tb = it->getBounds();
@@ -629,8 +513,7 @@ void TileRenderer::renderBounds(
           controlPointsViewSpace.at(i) = glm::fvec3(mMatVM * cornersWorldSpace.at(i));
         }
 
-        glUniform3fv(glGetUniformLocation(mProgBounds->GetProgram(), "VP_corners"), 8,
-            glm::value_ptr(controlPointsViewSpace[0]));
+        glUniform3fv(locCorners, 8, glm::value_ptr(controlPointsViewSpace[0]));
 
         glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, nullptr);
       }
@@ -945,4 +828,22 @@ bool TileRenderer::getFaceCulling() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TileRenderer::setNumThreads(int numThreads) {
+  mDrawList.setNumThreads(numThreads);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileRenderer::getNumThreads() const {
+  return mDrawList.getNumThreads();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileRenderer::getNumTriangles() const {
+  return mNumTriangles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::lodbodies
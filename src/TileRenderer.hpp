@@ -8,12 +8,15 @@
 #define CSP_LOD_BODIES_TILERENDERER_HPP
 
 #include "TerrainShader.hpp"
+#include "TileDrawList.hpp"
 #include "TileId.hpp"
+#include "VirtualTextureFeedback.hpp"
 
 #include <VistaOGLExt/VistaBufferObject.h>
 #include <VistaOGLExt/VistaGLSLShader.h>
 #include <VistaOGLExt/VistaVertexArrayObject.h>
 #include <boost/noncopyable.hpp>
+#include <memory>
 #include <vector>
 
 namespace cs::graphics {
@@ -25,16 +28,24 @@ namespace csp::lodbodies {
 struct PlanetParameters;
 class TileNode;
 class RenderData;
-class RenderDataDEM;
-class RenderDataImg;
 class TreeManagerBase;
 
-/// Renders tiles with elevation (DEM) and optionally image (IMG) data.
+/// Renders tiles with elevation (DEM) and optionally image (IMG) data. The parameters of the tiles
+/// are packed into a TileDrawList, which is uploaded to a buffer texture once per pass. All tiles
+/// drawn with the same number of indices are drawn with a single instanced draw call.
 class TileRenderer : private boost::noncopyable {
  public:
   explicit TileRenderer(PlanetParameters const& params, TreeManagerBase* treeMgrDEM = nullptr,
       TreeManagerBase* treeMgrIMG = nullptr);
 
+  TileRenderer(TileRenderer const& other) = delete;
+  TileRenderer(TileRenderer&& other)      = delete;
+
+  TileRenderer& operator=(TileRenderer const& other) = delete;
+  TileRenderer& operator=(TileRenderer&& other) = delete;
+
+  ~TileRenderer();
+
   TreeManagerBase* getTreeManagerDEM() const;
   void             setTreeManagerDEM(TreeManagerBase* treeMgr);
 
@@ -43,20 +54,20 @@ class TileRenderer : private boost::noncopyable {
 
   /// Set the shader for rendering terrain tiles. Initially (or when shader is nullptr) a
   /// default shader is used. The shader must declare certain inputs and uniforms detailed below.
+  /// Its vertex shader has to call VP_loadTile() before using any parameters of the tile. Passing
+  /// the mode of VP_getVertexPosition(), as in VP_loadTile(mode), skips the parameters it does not
+  /// use.
   ///
   /// @code
   /// | Kind    | Type           | Name                 | Description |
   /// |---------|----------------|----------------------|-------------|
-  /// | uniform | vec3           | VP_PatchOffsetScale  |             |
-  /// | uniform | vec3           | VP_IMG_TCOffsetScale |             |
-  /// | uniform | ivec4          | VP_EdgeDelta         |             |
-  /// | uniform | ivec2          | VP_f1f2              |             |
-  /// | uniform | int            | VP_LayerDEM          |             |
-  /// | uniform | int            | VP_LayerIMG          |             |
-  /// | uniform | vec3           | VP_Radius            |             |
-  /// | uniform | float          | VP_HeightScale       |             |
+  /// | uniform | isamplerBuffer | VP_tiles             |             |
+  /// | uniform | int            | VP_tileBase          |             |
+  /// | uniform | block          | VP_FrameUniforms     | See TerrainShader::FrameUniforms |
   /// | uniform | sampler2DArray | VP_TexDEM            |             |
   /// | uniform | sampler2DArray | VP_TexIMG            |             |
+  /// | uniform | sampler2D      | VP_texVirtualIMG     |             |
+  /// | uniform | sampler2DShadow| VP_shadowMaps        |             |
   /// | in      | ivec2          | vtxPosition          |             |
   /// @endcode
   void setTerrainShader(TerrainShader* shader);
@@ -68,10 +79,17 @@ class TileRenderer : private boost::noncopyable {
   void setProjection(glm::dmat4 const& m);
   void setModelview(glm::dmat4 const& m);
 
-  /// Render the elevation and image tiles in reqDEM and reqIMG respectively.
+  /// Render the elevation and image tiles in reqDEM and reqIMG respectively. reqIMG may be empty,
+  /// e.g. for rendering shadow maps, which only need the elevation data.
   void render(std::vector<RenderData*> const& reqDEM, std::vector<RenderData*> const& reqIMG,
       cs::graphics::ShadowMap* shadowMap);
 
+  /// If the image tiles use the virtual texturing mode, passes the pages requested by the previous
+  /// call to their TileTextureArray and renders the pages sampled by the tiles in reqDEM and
+  /// reqIMG into a feedback buffer.
+  void renderFeedback(
+      std::vector<RenderData*> const& reqDEM, std::vector<RenderData*> const& reqIMG);
+
   /// Enable or disable drawing of tiles.
   void setDrawTiles(bool enable);
   bool getDrawTiles() const;
@@ -88,24 +106,26 @@ class TileRenderer : private boost::noncopyable {
   void setFaceCulling(bool enable);
   bool getFaceCulling() const;
 
+  /// Sets the number of threads used for preparing the parameters of the drawn tiles.
+  void setNumThreads(int numThreads);
+  int  getNumThreads() const;
+
+  /// Returns the number of terrain triangles drawn by the last call to render().
+  std::size_t getNumTriangles() const;
+
  private:
-  struct UniformLocs {
-    GLint demAverageHeight;
-    GLint tileOffsetScale;
-    GLint demOffsetScale;
-    GLint imgOffsetScale;
-    GLint edgeDelta;
-    GLint edgeLayerDEM;
-    GLint edgeOffset;
-    GLint f1f2;
-    GLint layerDEM;
-    GLint layerIMG;
-  };
+  /// Sets the uniforms which are the same for all tiles of a render pass. values holds those
+  /// which depend on the pass, e.g. the shadow parameters, the others are filled in.
+  void setFrameUniforms(TerrainShader& shader, TerrainShader::FrameUniforms values) const;
 
   void preRenderTiles(cs::graphics::ShadowMap* shadowMap);
   void renderTiles(
       std::vector<RenderData*> const& renderDEM, std::vector<RenderData*> const& renderIMG);
-  void renderTile(RenderDataDEM* rdDEM, RenderDataImg* rdIMG, UniformLocs const& locs);
+
+  /// Packs and uploads the tiles of reqDEM and reqIMG and draws them with the bound shader.
+  void drawTiles(TerrainShader& shader, std::vector<RenderData*> const& reqDEM,
+      std::vector<RenderData*> const& reqIMG);
+
   void postRenderTiles(cs::graphics::ShadowMap* shadowMap);
 
   void preRenderBounds();
@@ -136,11 +156,25 @@ class TileRenderer : private boost::noncopyable {
   static std::unique_ptr<VistaVertexArrayObject> mVaoTerrain;
   TerrainShader*                                 mProgTerrain;
 
+  // The feedback pass uses the vertex shader of mProgTerrain, mProgFeedback is rebuilt whenever
+  // that changes.
+  std::unique_ptr<VirtualTextureFeedback> mFeedback;
+  std::unique_ptr<TerrainShader>          mProgFeedback;
+  std::string                             mFeedbackVertexSource;
+
+  // the packed parameters of the tiles of the current pass and the buffer texture they are read
+  // from by the shaders
+  TileDrawList mDrawList;
+  GLuint       mTileBufferId;
+  GLuint       mTileTextureId;
+
   static std::unique_ptr<VistaBufferObject>      mVboBounds;
   static std::unique_ptr<VistaBufferObject>      mIboBounds;
   static std::unique_ptr<VistaVertexArrayObject> mVaoBounds;
   static std::unique_ptr<VistaGLSLShader>        mProgBounds;
 
+  std::size_t mNumTriangles;
+
   int  mFrameCount;
   bool mEnableDrawTiles;
   bool mEnableDrawBounds;
@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileResidency.hpp"
+
+#include "RenderData.hpp"
+
+#include <cassert>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+TileResidency::TileResidency(int maxLayerCount)
+    : boost::noncopyable()
+    , mPool(maxLayerCount)
+    , mEvictionReady(false) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileResidency::uploadQueued(std::function<bool(int)> const& budgetSpent) {
+  mUploadQueue.prioritize();
+
+  int                      count = 0;
+  std::vector<RenderData*> evicted;
+  mEvictionReady = false;
+
+  while (!mUploadQueue.empty()) {
+    // remaining requests are processed in the next frame, unless they
+    // complete the siblings of the last upload
+    if (count > 0 && !mUploadQueue.continuesGroup() && budgetSpent(count)) {
+      break;
+    }
+
+    if (mPool.getFreeLayerCount() == 0 && !grow() && !evict(evicted)) {
+      // only tiles which are at least as important as the next one are on
+      // the GPU, the current view needs more tiles than fit
+      if (mUploadQueue.peekFrame() >= mEviction.getNewestFrame()) {
+        onStorageExhausted();
+      }
+
+      break;
+    }
+
+    UploadQueue::Upload const     upload = mUploadQueue.pop();
+    TexturePagePool::Handle const handle = mPool.allocate();
+
+    assert(upload.mRdata->getTexLayer() < 0);
+    uploadLayer(upload, handle);
+    ++count;
+  }
+
+  // evicted tiles are uploaded again once they are more important than
+  // others on the GPU
+  for (auto* rdata : evicted) {
+    mUploadQueue.push(rdata, -1);
+  }
+
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileResidency::grow() {
+  int const page = mPool.grow();
+
+  if (page >= 0) {
+    allocatePage(page);
+    mResident.at(page).assign(mPool.getPageLayerCount(page), nullptr);
+    return true;
+  }
+
+  // All page slots are in use, e.g. after the maximum has been raised several times.
+  if (mPool.getShortfall() == 0 || !canResizePages()) {
+    return false;
+  }
+
+  int const enlarged = mPool.enlarge();
+
+  if (enlarged < 0) {
+    return false;
+  }
+
+  // the tiles keep their layers
+  resizePage(enlarged);
+  mResident.at(enlarged).resize(mPool.getPageLayerCount(enlarged), nullptr);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileResidency::evict(std::vector<RenderData*>& evicted) {
+  // Collect the candidates once per call to uploadQueued. Tiles on retired
+  // pages are considered as well, otherwise rarely used ones would keep
+  // their pages from being removed and the pool from growing.
+  if (!mEvictionReady) {
+    std::vector<EvictionPolicy::Tile> candidates;
+    mEvictionCandidates.clear();
+
+    for (int page = 0; page < TexturePagePool::sMaxPages; ++page) {
+      for (auto* rdata : mResident.at(page)) {
+        if (rdata) {
+          candidates.push_back(EvictionPolicy::Tile{rdata->getLastFrame(), rdata->getLevel()});
+          mEvictionCandidates.push_back(rdata);
+        }
+      }
+    }
+
+    mEviction.setCandidates(std::move(candidates));
+    mEvictionReady = true;
+  }
+
+  RenderData const*          next = mUploadQueue.peek().mRdata;
+  EvictionPolicy::Tile const waiting{mUploadQueue.peekFrame(), next->getLevel()};
+
+  while (true) {
+    int const victim = mEviction.selectVictim(waiting);
+
+    if (victim < 0) {
+      return false;
+    }
+
+    RenderData* rdata   = mEvictionCandidates.at(victim);
+    bool const  retired = mPool.isRetired(rdata->getTexPage());
+    releaseLayer(rdata);
+    evicted.push_back(rdata);
+
+    // The layer of a retired page can not be reused. Once the page is empty
+    // though, it is removed and the pool may add a new one.
+    if (!retired || grow()) {
+      return true;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileResidency::assignLayer(RenderData* rdata, TexturePagePool::Handle handle) {
+  rdata->setTexPage(handle.mPage);
+  rdata->setTexLayer(handle.mLayer);
+  mResident.at(handle.mPage).at(handle.mLayer) = rdata;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileResidency::releaseLayer(RenderData* rdata) {
+  assert(rdata->getTexLayer() >= 0);
+
+  // simply mark the layer as available and record that rdata is not
+  // currently on the GPU (i.e. set the texture layer to an invalid value)
+  int const page = rdata->getTexPage();
+  mPool.free(TexturePagePool::Handle{page, rdata->getTexLayer()});
+  mResident.at(page).at(rdata->getTexLayer()) = nullptr;
+  rdata->setTexPage(-1);
+  rdata->setTexLayer(-1);
+
+  // the last tile of a retired page frees the page
+  if (mPool.isRetired(page)) {
+    releaseEmptyPages();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileResidency::releaseEmptyPages() {
+  for (int page : mPool.collectEmptyPages()) {
+    releasePage(page);
+    mResident.at(page).clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILERESIDENCY_HPP
+#define CSP_LOD_BODIES_TILERESIDENCY_HPP
+
+#include "EvictionPolicy.hpp"
+#include "TexturePagePool.hpp"
+#include "UploadQueue.hpp"
+
+#include <array>
+#include <boost/noncopyable.hpp>
+#include <functional>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class RenderData;
+
+/// Decides which tiles are stored in the layers of a TexturePagePool. The tiles waiting in an
+/// UploadQueue are given layers in the order of their importance. If all layers are in use, the
+/// pool grows or tiles which have not been used for a while are evicted in favour of more important
+/// ones, see EvictionPolicy.
+///
+/// This does not call OpenGL. Derived classes create the textures of the pages and upload the
+/// tiles in the hooks below, see TileTextureArray. The tests replay the tiles used by recorded
+/// traversals (see TileTrace) against this.
+class TileResidency : private boost::noncopyable {
+ public:
+  explicit TileResidency(int maxLayerCount);
+
+  TileResidency(TileResidency const& other) = delete;
+  TileResidency(TileResidency&& other)      = delete;
+
+  TileResidency& operator=(TileResidency const& other) = delete;
+  TileResidency& operator=(TileResidency&& other) = delete;
+
+  virtual ~TileResidency() = default;
+
+ protected:
+  /// Gives layers to the queued tiles in the order of their importance and passes them to
+  /// uploadLayer(). Stops once budgetSpent returns true for the number of tiles given a layer so
+  /// far. It is only asked between groups of siblings, so that all children of a tile become
+  /// available in the same frame, and after at least one tile. Evicted tiles are queued again.
+  /// Returns the number of tiles given a layer.
+  int uploadQueued(std::function<bool(int)> const& budgetSpent);
+
+  /// Adds a page if the active pages are full but the maximum layer count has not been reached. If
+  /// all pages are in use, the smallest one is enlarged instead. Returns false if no layers have
+  /// been added.
+  bool grow();
+
+  /// Releases the layer of the least valuable tile on the GPU if the next tile in mUploadQueue
+  /// is more important. The evicted tiles are appended to evicted, these may include tiles of
+  /// retired pages. Returns false if no layer has become available.
+  virtual bool evict(std::vector<RenderData*>& evicted);
+
+  /// Stores the page and layer in rdata once its data is on the GPU.
+  virtual void assignLayer(RenderData* rdata, TexturePagePool::Handle handle);
+
+  /// Frees the layer of rdata. The last tile of a retired page removes the page.
+  virtual void releaseLayer(RenderData* rdata);
+
+  /// Removes all retired pages which do not hold any tiles anymore.
+  void releaseEmptyPages();
+
+  /// Has to upload the tile of upload.mRdata to the given layer and call assignLayer() once it is
+  /// on the GPU.
+  virtual void uploadLayer(UploadQueue::Upload const& upload, TexturePagePool::Handle handle) = 0;
+
+  /// Creates the storage of a page which has been added to mPool.
+  virtual void allocatePage(int page) = 0;
+
+  /// Returns whether the storage of a page can be enlarged. This is only asked once all page slots
+  /// are in use, but the maximum layer count has not been reached.
+  virtual bool canResizePages() = 0;
+
+  /// Enlarges the storage of a page which has been enlarged by mPool, keeping the layers it holds.
+  virtual void resizePage(int page) = 0;
+
+  /// Deletes the storage of a page.
+  virtual void releasePage(int page) = 0;
+
+  /// Called when the next queued tile can not be given a layer, because all tiles on the GPU are
+  /// more important.
+  virtual void onStorageExhausted() {
+  }
+
+  TexturePagePool mPool;
+  UploadQueue     mUploadQueue;
+
+  // The tile stored in each layer of each page, nullptr for free layers.
+  std::array<std::vector<RenderData*>, TexturePagePool::sMaxPages> mResident;
+
+  // The tiles which may be evicted during the current call to uploadQueued, in the order of the
+  // candidates of mEviction. mEvictionReady is false until they have been collected.
+  EvictionPolicy           mEviction;
+  std::vector<RenderData*> mEvictionCandidates;
+  bool                     mEvictionReady;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILERESIDENCY_HPP
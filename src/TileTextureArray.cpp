@@ -6,10 +6,16 @@
 
 #include "TileTextureArray.hpp"
 
+#include "HEALPix.hpp"
+#include "MipChain.hpp"
 #include "RenderData.hpp"
 #include "TreeManagerBase.hpp"
+#include "UploadRing.hpp"
 
 #include <VistaBase/VistaStreamUtils.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace csp::lodbodies {
 
@@ -70,33 +76,129 @@ GLenum getType(TileDataType dataType) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// number of tiles the staging ring of each TileTextureArray can hold
+int const stagingSlots = 32;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t getTileBytes(TileDataType dataType) {
+  std::size_t const samples = TileBase::SizeX * TileBase::SizeY;
+
+  switch (dataType) {
+  case TileDataType::eFloat32:
+    return samples * sizeof(float);
+  case TileDataType::eUInt8:
+    return samples;
+  case TileDataType::eU8Vec3:
+    return samples * 3;
+  }
+
+  return samples;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The index of the tile stored in the given page and layer in the VirtualPageTable. This must
+// match VP_getFeedbackIMG in VistaPlanetTerrainShaderFunctions.frag.
+int getVirtualTile(int page, int layer) {
+  return layer * TexturePagePool::sMaxPages + page;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fences of the staging ring implemented with OpenGL sync objects.
+class GLFenceApi : public UploadRing::FenceApi {
+ public:
+  void* insertFence() override {
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  bool testFence(void* fence) override {
+    GLenum const result = glClientWaitSync(static_cast<GLsync>(fence), 0, 0);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+  }
+
+  void deleteFence(void* fence) override {
+    glDeleteSync(static_cast<GLsync>(fence));
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* explicit */
-TileTextureArray::TileTextureArray(TileDataType dataType, int maxLayerCount)
-    : boost::noncopyable()
-    , mTexId(0U)
-    , mIformat()
-    , mFormat()
-    , mType()
+TileTextureArray::TileTextureArray(
+    TileDataType dataType, int maxLayerCount, bool virtualTexture, bool mipmaps)
+    : TileResidency(virtualTexture ? maxLayerCount * sVirtualTilesPerLayer : maxLayerCount)
+    , mIformat(getInternalFormat(dataType))
+    , mFormat(getFormat(dataType))
+    , mType(getType(dataType))
     , mDataType(dataType)
-    , mNumLayers(maxLayerCount) {
+    , mMipmaps(mipmaps && !virtualTexture)
+    , mTexIds()
+    , mShortfallReported(false)
+    , mPboId(0U)
+    , mPendingBase(0U)
+    , mCacheTexId(0U)
+    , mCachePagesPerRow(0) {
+  // the cache is created once there is an OpenGL context, see preUpload
+  if (virtualTexture) {
+    mPageTable = std::make_unique<VirtualPageTable>(0);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TileTextureArray::~TileTextureArray() {
-  releaseTexture();
+  releaseRing();
+  releaseVirtualCache();
+
+  for (int page = 0; page < TexturePagePool::sMaxPages; ++page) {
+    releasePage(page);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileTextureArray::allocateGPU(RenderData* rdata) {
+int TileTextureArray::stage(TileBase const& tile) {
+  std::shared_lock lock(mRingMutex);
+
+  if (!mRing || (mMipmaps && !tile.getMipChain())) {
+    return -1;
+  }
+
+  int const slot = mRing->acquire();
+
+  if (slot >= 0) {
+    auto* data = static_cast<std::uint8_t*>(mRing->getData(slot));
+    std::memcpy(data, tile.getDataPtr(), getTileBytes(mDataType));
+
+    if (mMipmaps) {
+      std::memcpy(data + getTileBytes(mDataType), // NOLINT(*-pointer-arithmetic)
+          tile.getMipChain()->getData(), MipChain::getBytes(mDataType));
+    }
+  }
+
+  return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::releaseSlot(int slot) {
+  if (slot >= 0 && mRing) {
+    mRing->release(slot);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::allocateGPU(RenderData* rdata, int slot) {
   assert(rdata->getTexLayer() < 0);
 
-  mUploadQueue.push_back(rdata);
+  mUploadQueue.push(rdata, slot);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -104,58 +206,73 @@ void TileTextureArray::allocateGPU(RenderData* rdata) {
 void TileTextureArray::releaseGPU(RenderData* rdata) {
   if (rdata->getTexLayer() >= 0) {
     releaseLayer(rdata);
-  } else {
-    // Tile is not uploaded, could be in the queue?
-    // XXX TODO Linear search, but mUploadQueue is usually small and
-    //          this case should be rare
+    return;
+  }
 
-    auto rIt = std::find(mUploadQueue.begin(), mUploadQueue.end(), rdata);
+  // Tile is not uploaded, could be in the queue?
+  UploadQueue::Upload const queued = mUploadQueue.remove(rdata);
 
-    // avoid erasing an element in the middle of std::vector,
-    // just invalidate the pointer and skip NULL entries when uploading
-    if (rIt != mUploadQueue.end()) {
-      *rIt = nullptr;
-    }
+  if (queued.mRdata) {
+    releaseSlot(queued.mSlot);
+    return;
+  }
+
+  // Or its upload from the ring is still in flight, then the layer is
+  // freed once the upload has completed.
+  auto pIt = mPending.find(rdata);
+
+  if (pIt != mPending.end()) {
+    mPendingUploads.at(pIt->second - mPendingBase).mRdata = nullptr;
+    mPending.erase(pIt);
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileTextureArray::processQueue(int maxItems) {
-  if (mUploadQueue.empty()) {
+void TileTextureArray::processQueue(
+    std::size_t maxBytes, std::chrono::steady_clock::time_point deadline) {
+  if (mUploadQueue.empty() && mPendingUploads.empty() && mFeedback.empty()) {
     return;
   }
 
   preUpload();
+  finishPendingUploads();
 
-  std::size_t upload = std::min<std::size_t>(maxItems, mUploadQueue.size());
+  // in the virtual texturing mode only the page table of a tile is set up
+  // here, its data is uploaded page by page below
+  std::size_t const tileBytes = mPageTable ? 0U : getUploadBytes();
 
-  if (mFreeLayers.size() < upload) {
-    // XXX TODO This is bad for performance and visuals, since *all* tiles
-    // must be (re)-uploaded to the larger texture
-    vstr::warnp() << "[TileTextureArray::processQueue]"
-                  << " Pre-allocated GPU storage exhausted!"
-                  << " [" << getUsedLayerCount() << " | " << getTotalLayerCount() << "]"
-                  << std::endl;
-  }
+  int const count = uploadQueued([&](int uploads) {
+    return static_cast<std::size_t>(uploads) * tileBytes >= maxBytes ||
+           std::chrono::steady_clock::now() > deadline;
+  });
 
-  int count = 0;
+  // tiles which have to wait for a later frame give their staging slots to
+  // those loaded in the meantime
+  if (mRing) {
+    std::vector<int> waiting;
+    mUploadQueue.takeSlots(waiting);
 
-  while (!mUploadQueue.empty() && count < maxItems) {
-    if (mFreeLayers.empty()) {
-      break;
+    for (int slot : waiting) {
+      mRing->release(slot);
     }
+  }
 
-    RenderData* rdata = mUploadQueue.back();
+  // all uploads from the ring issued above complete with a single fence
+  if (!mBatchSlots.empty()) {
+    std::uint64_t const batch = mRing->submit(mBatchSlots);
 
-    // rdata could be NULL if a tile is removed before it is ever
-    // uploaded to the GPU, c.f. releaseGPU
-    if (rdata != nullptr) {
-      allocateLayer(rdata);
-      ++count;
+    for (auto it = mPendingUploads.end() - static_cast<std::ptrdiff_t>(mBatchSlots.size());
+         it != mPendingUploads.end(); ++it) {
+      it->mBatch = batch;
     }
 
-    mUploadQueue.pop_back();
+    mBatchSlots.clear();
+  }
+
+  if (mPageTable) {
+    uploadVirtualPages(maxBytes);
+    uploadPageTables();
   }
 
   postUpload();
@@ -164,7 +281,7 @@ void TileTextureArray::processQueue(int maxItems) {
 #if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
     vstr::outi() << "[TileTextureArray::processQueue]"
                  << " uploaded/pending/used/free layers " << count << " / " << mUploadQueue.size()
-                 << " / " << (mNumLayers - mFreeLayers.size()) << " / " << mFreeLayers.size()
+                 << " / " << mPool.getUsedLayerCount() << " / " << mPool.getFreeLayerCount()
                  << std::endl;
 #endif
   }
@@ -172,88 +289,201 @@ void TileTextureArray::processQueue(int maxItems) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-unsigned int TileTextureArray::getTextureId() const {
-  return mTexId;
+void TileTextureArray::setMaxLayerCount(int maxLayerCount) {
+  mPool.setMaxLayerCount(mPageTable ? maxLayerCount * sVirtualTilesPerLayer : maxLayerCount);
+
+  // pages retired without holding any tiles can be deleted right away, new pages are added once
+  // they are needed
+  releaseEmptyPages();
+
+  // the pages in the cache are requested again by the next feedback
+  if (mCacheTexId != 0U) {
+    allocateVirtualCache();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileTextureArray::getMaxLayerCount() const {
+  return mPool.getMaxLayerCount() / (mPageTable ? sVirtualTilesPerLayer : 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int TileTextureArray::getTextureId(int page) const {
+  return mTexIds.at(page);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTextureArray::isVirtual() const {
+  return mPageTable != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTextureArray::hasMipmaps() const {
+  return mMipmaps;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::addFeedback(std::vector<VirtualPageTable::Request> const& requests) {
+  if (mPageTable) {
+    mFeedback.insert(mFeedback.end(), requests.begin(), requests.end());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int TileTextureArray::getVirtualCacheId() const {
+  return mCacheTexId;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::size_t TileTextureArray::getTotalLayerCount() const {
-  return mNumLayers;
+  return mPool.getTotalLayerCount();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::size_t TileTextureArray::getUsedLayerCount() const {
-  return mNumLayers - mFreeLayers.size();
+  return mPool.getUsedLayerCount();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileTextureArray::allocateTexture(TileDataType dataType) {
-  if (mTexId > 0U) {
-    return;
-  }
+std::size_t TileTextureArray::getMissingLayerCount() const {
+  return GLEW_ARB_copy_image ? 0U : static_cast<std::size_t>(mPool.getShortfall());
+}
 
-  // allocate a 2D array texture for storing tile data of type dataType
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::allocatePage(int page) {
+  // allocate a 2D array texture for storing tile data of type mDataType,
+  // or the page tables of the tiles in the virtual texturing mode
 
-  glGenTextures(1, &mTexId);
+  GLuint& texId = mTexIds.at(page);
+  glGenTextures(1, &texId);
 
   GLsizei const level  = 0;
-  GLsizei const width  = TileBase::SizeX;
-  GLsizei const height = TileBase::SizeY;
-  GLsizei const depth  = mNumLayers;
+  GLsizei const width  = mPageTable ? VirtualPageTable::sPagesPerSide : TileBase::SizeX;
+  GLsizei const height = mPageTable ? VirtualPageTable::sPagesPerSide : TileBase::SizeY;
+  GLsizei const depth  = mPool.getPageLayerCount(page);
   GLint const   border = 0;
+  GLenum const  format = mPageTable ? GL_RGBA : mFormat;
+  GLenum const  type   = mPageTable ? GL_FLOAT : mType;
+  GLint const   filter = mPageTable ? GL_NEAREST : GL_LINEAR;
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texId);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, level, mPageTable ? GL_RGBA32F : mIformat, width, height,
+      depth, border, format, type, nullptr);
 
-  mIformat = getInternalFormat(dataType);
-  mFormat  = getFormat(dataType);
-  mType    = getType(dataType);
+  int const levels = mMipmaps ? MipChain::getLevelCount() : 1;
 
-  glBindTexture(GL_TEXTURE_2D_ARRAY, mTexId);
-  glTexImage3D(
-      GL_TEXTURE_2D_ARRAY, level, mIformat, width, height, depth, border, mFormat, mType, nullptr);
+  for (int l = 1; l < levels; ++l) {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, l, mIformat, MipChain::getSizeX(l), MipChain::getSizeY(l),
+        depth, border, format, type, nullptr);
+  }
 
   // set filter and wrapping parameters
-  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+      mMipmaps ? GL_LINEAR_MIPMAP_LINEAR : filter);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
   glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  // all layers of newly allocated texture are available for use
-  mFreeLayers.reserve(mNumLayers);
+void TileTextureArray::releasePage(int page) {
+  GLuint& texId = mTexIds.at(page);
 
-  for (int i = 0; i < mNumLayers; ++i) {
-    mFreeLayers.push_back(mNumLayers - i - 1);
+  if (texId == 0U) {
+    return;
   }
+
+  glDeleteTextures(1, &texId);
+  texId = 0U;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TileTextureArray::releaseTexture() {
-  if (mTexId == 0U) {
-    return;
+bool TileTextureArray::canResizePages() {
+  // enlarging a page requires copying its layers on the GPU
+  if (GLEW_ARB_copy_image) {
+    return true;
   }
 
-  glDeleteTextures(1, &mTexId);
-  mTexId = 0U;
-  mFreeLayers.clear();
+  if (!mShortfallReported) {
+    vstr::warnp() << "[TileTextureArray::canResizePages]"
+                  << " All texture pages are in use, the maximum number of tiles can not be"
+                  << " reached! [" << getTotalLayerCount() << " | "
+                  << getTotalLayerCount() + getMissingLayerCount() << "]" << std::endl;
+    mShortfallReported = true;
+  }
+
+  return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Uploads tile data from the node associated with @a rdata to the GPU.
-// @note May only be called after a call to @c preUpload.
-void TileTextureArray::allocateLayer(RenderData* rdata) {
-  assert(!mFreeLayers.empty());
-  assert(rdata->getTexLayer() < 0);
+void TileTextureArray::resizePage(int page) {
+  GLuint const oldTexId = mTexIds.at(page);
+  auto const   oldDepth = static_cast<GLsizei>(mResident.at(page).size());
+
+  allocatePage(page);
+
+  int const levels = mMipmaps ? MipChain::getLevelCount() : 1;
+
+  for (int l = 0; l < levels; ++l) {
+    GLsizei const width  = mPageTable ? VirtualPageTable::sPagesPerSide : MipChain::getSizeX(l);
+    GLsizei const height = mPageTable ? VirtualPageTable::sPagesPerSide : MipChain::getSizeY(l);
+
+    glCopyImageSubData(oldTexId, GL_TEXTURE_2D_ARRAY, l, 0, 0, 0, mTexIds.at(page),
+        GL_TEXTURE_2D_ARRAY, l, 0, 0, 0, width, height, oldDepth);
+  }
+
+  glDeleteTextures(1, &oldTexId);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::onStorageExhausted() {
+  vstr::warnp() << "[TileTextureArray::processQueue]"
+                << " GPU storage exhausted, consider raising the maximum number of tiles!"
+                << " [" << getUsedLayerCount() << " | " << getTotalLayerCount() << "]"
+                << std::endl;
+}
 
-  TileNode* node = rdata->getNode();
-  TileBase* tile = node->getTile();
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TileTextureArray::getUploadBytes() const {
+  return getTileBytes(mDataType) + (mMipmaps ? MipChain::getBytes(mDataType) : 0U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Uploads tile data from the node associated with @a upload.mRdata to the GPU.
+// @note May only be called after a call to @c preUpload.
+void TileTextureArray::uploadLayer(
+    UploadQueue::Upload const& upload, TexturePagePool::Handle handle) {
+  RenderData* rdata = upload.mRdata;
+  TileNode*   node  = rdata->getNode();
+  TileBase*   tile  = node->getTile();
+  GLint const layer = handle.mLayer;
+
+  // the pages of the tile are uploaded once the feedback requests them
+  if (mPageTable) {
+    assignLayer(rdata, handle);
+    return;
+  }
 
-  int layer = mFreeLayers.back();
-  mFreeLayers.pop_back();
+  glBindTexture(GL_TEXTURE_2D_ARRAY, mTexIds.at(handle.mPage));
 
   GLint const   level   = 0;
   GLint const   xoffset = 0;
@@ -261,35 +491,343 @@ void TileTextureArray::allocateLayer(RenderData* rdata) {
   GLsizei const width   = TileBase::SizeX;
   GLsizei const height  = TileBase::SizeY;
   GLsizei const depth   = 1;
-  GLvoid const* data    = tile->getDataPtr();
 
+  if (upload.mSlot < 0) {
+    // the tile is not staged, the driver has to copy it from client memory
+    if (mPboId > 0U) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+    }
+
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, xoffset, yoffset, layer, width, height, depth,
+        mFormat, mType, tile->getDataPtr());
+
+    // the levels have been built by TreeManagerBase::onNodeLoaded even if the tile could not be
+    // staged; the tile may be shared with other trees, so they are only read here
+    if (mMipmaps) {
+      MipChain const* mipChain = tile->getMipChain();
+      assert(mipChain != nullptr);
+
+      if (mipChain) {
+        uploadMipLevels(layer, static_cast<std::uint8_t const*>(mipChain->getData()));
+      }
+    }
+
+    assignLayer(rdata, handle);
+    return;
+  }
+
+  // with a pixel unpack buffer bound, the data pointer is an offset into it
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPboId);
   glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, xoffset, yoffset, layer, width, height, depth,
-      mFormat, mType, data);
+      mFormat, mType,
+      reinterpret_cast<GLvoid const*>(mRing->getOffset(upload.mSlot))); // NOLINT(*-int-to-ptr)
+
+  // the levels follow level 0 in the slot, see stage
+  if (mMipmaps) {
+    uploadMipLevels(layer, reinterpret_cast<std::uint8_t const*>( // NOLINT(*-int-to-ptr)
+                               mRing->getOffset(upload.mSlot) + getTileBytes(mDataType)));
+  }
 
-  rdata->setTexLayer(layer);
+  // the layer is assigned once the batch of this upload has completed, see processQueue
+  mBatchSlots.push_back(upload.mSlot);
+  mPending[rdata] = mPendingBase + mPendingUploads.size();
+  mPendingUploads.push_back(PendingUpload{rdata, handle, 0U});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::uploadMipLevels(GLint layer, std::uint8_t const* data) {
+  // the rows of the smaller levels are not aligned to four bytes
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  for (int level = 1; level < MipChain::getLevelCount(); ++level) {
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, MipChain::getSizeX(level),
+        MipChain::getSizeY(level), 1, mFormat, mType,
+        data + MipChain::getOffset(mDataType, level)); // NOLINT(*-pointer-arithmetic)
+  }
+
+  glPopClientAttrib();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileTextureArray::releaseLayer(RenderData* rdata) {
-  assert(rdata->getTexLayer() >= 0);
+  if (mPageTable) {
+    removeVirtualTile(rdata);
+  }
 
-  // simply mark the layer as available and record that rdata is not
-  // currently on the GPU (i.e. set the texture layer to an invalid value)
-  mFreeLayers.push_back(rdata->getTexLayer());
-  rdata->setTexLayer(-1);
+  TileResidency::releaseLayer(rdata);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::assignLayer(RenderData* rdata, TexturePagePool::Handle handle) {
+  TileResidency::assignLayer(rdata, handle);
+
+  if (mPageTable) {
+    addVirtualTile(rdata);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::finishPendingUploads() {
+  if (!mRing) {
+    return;
+  }
+
+  mRing->retire();
+
+  // mPendingUploads is ordered by batch, so the completed uploads are at the front
+  while (!mPendingUploads.empty() && mRing->isComplete(mPendingUploads.front().mBatch)) {
+    PendingUpload const& pending = mPendingUploads.front();
+
+    if (pending.mRdata) {
+      assignLayer(pending.mRdata, pending.mHandle);
+      mPending.erase(pending.mRdata);
+    } else {
+      // the tile has been released while its upload was in flight
+      mPool.free(pending.mHandle);
+    }
+
+    mPendingUploads.pop_front();
+    ++mPendingBase;
+  }
+
+  releaseEmptyPages();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::allocateVirtualCache() {
+  releaseVirtualCache();
+
+  // The cache is a square of pages holding as many texels as getMaxLayerCount() tiles, unless
+  // that exceeds the maximum texture size.
+  int const pagesPerTile = VirtualPageTable::sPagesPerSide * VirtualPageTable::sPagesPerSide;
+  int const pages        = getMaxLayerCount() * pagesPerTile;
+  GLint     maxSize      = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+  mCachePagesPerRow = std::clamp(static_cast<int>(std::ceil(std::sqrt(pages))), 1,
+      std::max(1, maxSize / VirtualPageTable::sPageTexels));
+  int const rows = std::min(mCachePagesPerRow, (pages + mCachePagesPerRow - 1) / mCachePagesPerRow);
+
+  glGenTextures(1, &mCacheTexId);
+  glBindTexture(GL_TEXTURE_2D, mCacheTexId);
+  glTexImage2D(GL_TEXTURE_2D, 0, mIformat, mCachePagesPerRow * VirtualPageTable::sPageTexels,
+      rows * VirtualPageTable::sPageTexels, 0, mFormat, mType, nullptr);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glBindTexture(GL_TEXTURE_2D, 0U);
+
+  mPageTable->setPhysicalPageCount(std::min(pages, mCachePagesPerRow * rows));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::releaseVirtualCache() {
+  if (mCacheTexId == 0U) {
+    return;
+  }
+
+  glDeleteTextures(1, &mCacheTexId);
+  mCacheTexId = 0U;
+  mPageTable->setPhysicalPageCount(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::addVirtualTile(RenderData* rdata) {
+  int const       tile = getVirtualTile(rdata->getTexPage(), rdata->getTexLayer());
+  TileNode const* node = rdata->getNode();
+
+  mPageTable->addTile(tile);
+  mVirtualTiles[node] = tile;
+
+  // Pages which are not loaded fall back to those of the parent. The
+  // children of a tile are numbered like its pages, x first.
+  auto parent = mVirtualTiles.find(node->getParent());
+
+  if (parent != mVirtualTiles.end()) {
+    int const childIdx = HEALPix::getChildIdx(node->getTileId());
+    mPageTable->setParent(tile, parent->second, childIdx % 2, childIdx / 2);
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    auto child = mVirtualTiles.find(node->getChild(i));
+
+    if (child != mVirtualTiles.end()) {
+      mPageTable->setParent(child->second, tile, i % 2, i / 2);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::removeVirtualTile(RenderData* rdata) {
+  mPageTable->removeTile(getVirtualTile(rdata->getTexPage(), rdata->getTexLayer()));
+  mVirtualTiles.erase(rdata->getNode());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::uploadVirtualPages(std::size_t maxBytes) {
+  if (mFeedback.empty()) {
+    return;
+  }
+
+  std::size_t const pageBytes = getTileBytes(mDataType) / (TileBase::SizeX * TileBase::SizeY) *
+                                VirtualPageTable::sPageTexels * VirtualPageTable::sPageTexels;
+  std::vector<VirtualPageTable::Upload> const uploads =
+      mPageTable->update(mFeedback, std::max<std::size_t>(1U, maxBytes / pageBytes));
+  mFeedback.clear();
+
+  if (uploads.empty()) {
+    return;
+  }
+
+  // the pages are copied directly out of the tiles
+  glBindTexture(GL_TEXTURE_2D, mCacheTexId);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, TileBase::SizeX);
+
+  for (auto const& upload : uploads) {
+    int const   page  = upload.mPage.mTile % TexturePagePool::sMaxPages;
+    int const   layer = upload.mPage.mTile / TexturePagePool::sMaxPages;
+    RenderData* rdata = mResident.at(page).at(layer);
+
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, upload.mPage.mX * VirtualPageTable::sPageSize);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, upload.mPage.mY * VirtualPageTable::sPageSize);
+    glTexSubImage2D(GL_TEXTURE_2D, 0,
+        upload.mPhysical % mCachePagesPerRow * VirtualPageTable::sPageTexels,
+        upload.mPhysical / mCachePagesPerRow * VirtualPageTable::sPageTexels,
+        VirtualPageTable::sPageTexels, VirtualPageTable::sPageTexels, mFormat, mType,
+        rdata->getNode()->getTile()->getDataPtr());
+  }
+
+  glPopClientAttrib();
+  glBindTexture(GL_TEXTURE_2D, 0U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::uploadPageTables() {
+  int const sides = VirtualPageTable::sPagesPerSide;
+
+  // Each entry holds the position of the page in the cache, in texels, its
+  // scale and whether it is valid (see VP_sampleVirtualIMG).
+  std::array<std::array<GLfloat, 4>, sides * sides> entries{};
+
+  for (int tile : mPageTable->takeDirtyTiles()) {
+    int const page  = tile % TexturePagePool::sMaxPages;
+    int const layer = tile / TexturePagePool::sMaxPages;
+
+    for (int y = 0; y < sides; ++y) {
+      for (int x = 0; x < sides; ++x) {
+        VirtualPageTable::Entry const entry = mPageTable->getEntry({tile, x, y});
+
+        if (entry.mPhysical < 0) {
+          entries.at(y * sides + x) = {0.F, 0.F, 0.F, 0.F};
+          continue;
+        }
+
+        int const originX = entry.mPhysical % mCachePagesPerRow * VirtualPageTable::sPageTexels;
+        int const originY = entry.mPhysical / mCachePagesPerRow * VirtualPageTable::sPageTexels;
+
+        entries.at(y * sides + x) = {static_cast<GLfloat>(originX) + entry.mOffset[0],
+            static_cast<GLfloat>(originY) + entry.mOffset[1], entry.mScale, 1.F};
+      }
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTexIds.at(page));
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, sides, sides, 1, GL_RGBA, GL_FLOAT,
+        entries.data());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::allocateRing() {
+  if (mPboId > 0U || !GLEW_ARB_buffer_storage) {
+    return;
+  }
+
+  // A persistently mapped buffer stays mapped while uploads from it are in flight, so that loader
+  // threads can fill free slots at any time. Coherent mapping makes their writes visible to
+  // uploads issued after the slot has been passed to the render thread.
+  GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  auto const       size  = static_cast<GLsizeiptr>(getUploadBytes() * stagingSlots);
+
+  glGenBuffers(1, &mPboId);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPboId);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+  void* memory = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+
+  if (!memory) {
+    vstr::warnp() << "[TileTextureArray::allocateRing]"
+                  << " Failed to map staging buffer, uploading from client memory!" << std::endl;
+    glDeleteBuffers(1, &mPboId);
+    mPboId = 0U;
+    return;
+  }
+
+  std::unique_lock lock(mRingMutex);
+  mRing = std::make_unique<UploadRing>(
+      std::make_unique<GLFenceApi>(), memory, getUploadBytes(), stagingSlots);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTextureArray::releaseRing() {
+  if (mPboId == 0U) {
+    return;
+  }
+
+  // waits for loader threads which are still copying into the ring, later calls to stage() find no
+  // ring, so the memory can be unmapped safely
+  {
+    std::unique_lock lock(mRingMutex);
+    mRing.reset();
+  }
+
+  mPendingBase += mPendingUploads.size();
+  mPendingUploads.clear();
+  mPending.clear();
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPboId);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+  glDeleteBuffers(1, &mPboId);
+  mPboId = 0U;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileTextureArray::preUpload() {
-  allocateTexture(mDataType);
-  glBindTexture(GL_TEXTURE_2D_ARRAY, mTexId);
+  // in the virtual texturing mode the tiles are uploaded page by page
+  // directly from their memory
+  if (!mPageTable) {
+    allocateRing();
+  } else if (mCacheTexId == 0U) {
+    allocateVirtualCache();
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TileTextureArray::postUpload() {
+  if (mPboId > 0U) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0U);
+  }
+
   glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
 }
 
@@ -8,30 +8,69 @@
 #define CSP_LOD_BODIES_TILETEXTUREARRAY_HPP
 
 #include "TileDataType.hpp"
+#include "TileResidency.hpp"
+#include "VirtualPageTable.hpp"
 
 #include <GL/glew.h>
 #include <array>
-#include <boost/noncopyable.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <shared_mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace csp::lodbodies {
 
+class TileBase;
 class TileNode;
 class RenderData;
 class TreeManagerBase;
+class UploadRing;
 
 /// Responsible for handling tile data that is uploaded the GPU and for balancing additional upload
 /// requests.
 ///
-/// Tile data is stored in a 2D array texture (GL_TEXTURE_2D_ARRAY) with width and height matching
-/// those of a single tile and as many layers as there are tiles that can be kept on the GPU at
-/// once. If more tiles are needed on the GPU the array texture must be resized (which requires all
-/// tiles to be re-uploaded), this should be avoided to prevent the tile resolution to drop
-/// dramatically while only low resolution tiles are on the GPU.
-class TileTextureArray : private boost::noncopyable {
+/// Tile data is stored in up to TexturePagePool::sMaxPages 2D array textures (GL_TEXTURE_2D_ARRAY)
+/// with width and height matching those of a single tile. These pages together have as many layers
+/// as there are tiles that can be kept on the GPU at once, a tile is identified by the page and
+/// layer stored in its RenderData. The number of tiles can be changed at any time with
+/// setMaxLayerCount(). The array grows by adding a page and shrinks by removing pages once their
+/// tiles have been released, see TexturePagePool. If all pages are in use, a page is enlarged by
+/// copying it to a larger texture. Hence the tiles which are on the GPU never have to be
+/// re-uploaded.
+///
+/// If all layers are in use, tiles which have not been used for a while are evicted in favour of
+/// more important tiles waiting for their upload, see TileResidency. Evicted tiles are queued for
+/// upload again, so that they return to the GPU once they are needed.
+///
+/// If persistently mapped buffers are supported, tiles are uploaded through a staging ring of pixel
+/// buffer objects (see UploadRing). Loader threads copy their tiles into the ring with stage(), the
+/// render thread then only issues the uploads from the ring, which the driver performs
+/// asynchronously. A layer is assigned to the RenderData of a tile once the fence of its upload is
+/// signaled, until then the tile counts as not being on the GPU. Tiles which could not be staged,
+/// because the ring was full, are uploaded from their own memory.
+///
+/// In the virtual texturing mode only the parts of the tiles which are actually seen are kept on
+/// the GPU. The tiles are split into pages which are stored in a single cache texture, the layers
+/// of the pages of the array then hold the page tables of the tiles (see VirtualPageTable). As a
+/// page table is much smaller than a tile, sVirtualTilesPerLayer times as many tiles can be on the
+/// GPU as in the normal mode, while the cache holds as many texels as maxLayerCount tiles. The
+/// TileRenderer determines the pages which are needed with a feedback pass and passes them to
+/// addFeedback(), processQueue() then uploads the missing pages.
+///
+/// Optionally, the layers have mipmap levels. They are computed on the loader threads (see
+/// MipChain) and uploaded together with level 0. The virtual texturing mode does not support
+/// mipmaps.
+class TileTextureArray : private TileResidency {
  public:
-  explicit TileTextureArray(TileDataType dataType, int maxLayerCount);
+  /// The number of tiles which can be on the GPU per layer of maxLayerCount in the virtual
+  /// texturing mode.
+  static int const sVirtualTilesPerLayer = 4;
+
+  explicit TileTextureArray(TileDataType dataType, int maxLayerCount, bool virtualTexture = false,
+      bool mipmaps = false);
 
   TileTextureArray(TileTextureArray const& other) = delete;
   TileTextureArray(TileTextureArray&& other)      = delete;
@@ -41,63 +80,186 @@ class TileTextureArray : private boost::noncopyable {
 
   ~TileTextureArray();
 
-  /// Requests that data for the tile associated with rdata be uploaded to the GPU.
-  void allocateGPU(RenderData* rdata);
+  /// Copies the data of tile into a free slot of the staging ring and returns the slot, or -1 if
+  /// there is no ring or all of its slots are in use. This may be called from any thread. The slot
+  /// must be passed to allocateGPU or releaseSlot.
+  int stage(TileBase const& tile);
+
+  /// Frees a slot returned by stage() whose tile is not going to be uploaded.
+  void releaseSlot(int slot);
+
+  /// Requests that data for the tile associated with rdata be uploaded to the GPU. If the tile has
+  /// been staged, slot is the slot returned by stage().
+  void allocateGPU(RenderData* rdata, int slot = -1);
 
   /// Release GPU resources allocated for the tile associated with rdata.
   void releaseGPU(RenderData* rdata);
 
-  /// Process up to maxItems upload requests.
-  void processQueue(int maxItems);
+  /// Process upload requests in order of their importance (see UploadQueue) until maxBytes of tile
+  /// data have been uploaded or deadline has passed. The budgets are only checked between groups
+  /// of siblings, so that all children of a tile become available in the same frame, and at least
+  /// one request is processed per call so that uploads always make progress. Tiles whose uploads
+  /// from the staging ring have completed since the last call become available. In the virtual
+  /// texturing mode, the pages requested by the feedback are uploaded within maxBytes as well.
+  void processQueue(std::size_t maxBytes,
+      std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::time_point::max());
+
+  /// Changes the number of tiles which can be kept on the GPU. Tiles which are already on the GPU
+  /// stay there, if the number is lowered the memory of their pages is freed once they have been
+  /// released.
+  void setMaxLayerCount(int maxLayerCount);
+  int  getMaxLayerCount() const;
 
-  /// Returns the OpenGL id of the texture used to store tiles on the GPU. This is an internal
-  /// interface for TileRenderer.
-  unsigned int getTextureId() const;
+  /// Returns the OpenGL id of the texture of the given page, or 0 if the page does not exist. This
+  /// is an internal interface for TileRenderer.
+  unsigned int getTextureId(int page) const;
 
-  /// Gets Total Layer Count
+  /// Returns whether the array is in the virtual texturing mode.
+  bool isVirtual() const;
+
+  /// Returns whether the layers have mipmap levels. If so, the tiles passed to stage() must have a
+  /// MipChain, tiles without one are not staged.
+  bool hasMipmaps() const;
+
+  /// Adds the pages sampled by a feedback pass of the TileRenderer. The pages are uploaded by the
+  /// next call to processQueue(). Has no effect if the array is not in the virtual texturing mode.
+  void addFeedback(std::vector<VirtualPageTable::Request> const& requests);
+
+  /// Returns the OpenGL id of the cache texture holding the pages in the virtual texturing mode,
+  /// or 0 if it does not exist. This is an internal interface for TileRenderer.
+  unsigned int getVirtualCacheId() const;
+
+  /// Gets Total Layer Count, including the layers of pages which are about to be removed.
   std::size_t getTotalLayerCount() const;
 
   /// Gets Used Layer Count
   std::size_t getUsedLayerCount() const;
 
+  /// Returns the number of layers by which the array falls short of the maximum layer count,
+  /// because all pages are in use and they can not be enlarged without ARB_copy_image.
+  std::size_t getMissingLayerCount() const;
+
  private:
-  void allocateTexture(TileDataType dataType);
-  void releaseTexture();
+  /// Creates the texture of a page which has been added to mPool.
+  void allocatePage(int page) override;
+  void releasePage(int page) override;
+
+  /// Pages can only be enlarged with ARB_copy_image. Warns once if it is not available.
+  bool canResizePages() override;
+
+  /// Reallocates the texture of a page which has been enlarged by mPool and copies the previous
+  /// layers to the new texture.
+  void resizePage(int page) override;
+
+  void onStorageExhausted() override;
 
-  void allocateLayer(RenderData* rdata);
-  void releaseLayer(RenderData* rdata);
+  /// Creates the staging ring, if persistently mapped buffers are supported.
+  void allocateRing();
+  void releaseRing();
 
-  void        preUpload();
-  static void postUpload();
+  /// An upload from the ring which has been issued, but may not have completed yet. The page and
+  /// layer are assigned to mRdata once mBatch is complete. mRdata is nullptr if the tile has been
+  /// released in the meantime.
+  struct PendingUpload {
+    RenderData*             mRdata;
+    TexturePagePool::Handle mHandle;
+    std::uint64_t           mBatch;
+  };
+
+  /// The number of bytes uploaded for a tile, including its mipmap levels.
+  std::size_t getUploadBytes() const;
+
+  void uploadLayer(UploadQueue::Upload const& upload, TexturePagePool::Handle handle) override;
+
+  /// Uploads the levels of a MipChain to layer of the bound page. data is an offset into the bound
+  /// pixel unpack buffer, if there is one.
+  void uploadMipLevels(GLint layer, std::uint8_t const* data);
+
+  /// In the virtual texturing mode, the page table of the tile is added or removed as well.
+  void releaseLayer(RenderData* rdata) override;
+  void assignLayer(RenderData* rdata, TexturePagePool::Handle handle) override;
+
+  /// Assigns the layers of all completed uploads from the ring.
+  void finishPendingUploads();
+
+  /// Creates the cache texture of the virtual texturing mode with space for the texels of
+  /// getMaxLayerCount() tiles. All pages have to be uploaded again.
+  void allocateVirtualCache();
+  void releaseVirtualCache();
+
+  /// Adds the page table of rdata to mPageTable and links it to those of its parent and children.
+  void addVirtualTile(RenderData* rdata);
+  void removeVirtualTile(RenderData* rdata);
+
+  /// Uploads the pages requested by the feedback since the last call, at most maxBytes.
+  void uploadVirtualPages(std::size_t maxBytes);
+
+  /// Uploads the entries of the page tables which have changed.
+  void uploadPageTables();
+
+  void preUpload();
+  void postUpload();
 
-  GLuint       mTexId;
   GLenum       mIformat;
   GLenum       mFormat;
   GLenum       mType;
   TileDataType mDataType;
+  bool         mMipmaps;
+
+  std::array<GLuint, TexturePagePool::sMaxPages> mTexIds;
+
+  // Whether the warning that the maximum layer count can not be reached has been printed.
+  bool mShortfallReported;
 
-  const GLint        mNumLayers;
-  std::vector<GLint> mFreeLayers;
+  // The ring is created and released on the render thread, which holds mRingMutex exclusively
+  // meanwhile. Loader threads hold it shared in stage(), so that the ring is not released while
+  // they copy into its memory. The render thread reads mRing without locking.
+  GLuint                      mPboId;
+  std::unique_ptr<UploadRing> mRing;
+  std::shared_mutex           mRingMutex;
+  std::vector<int>            mBatchSlots;
 
-  std::vector<RenderData*> mUploadQueue;
+  // The pending upload with sequence number n is at mPendingUploads[n - mPendingBase], mPending
+  // maps each tile to the sequence number of its upload.
+  std::deque<PendingUpload>                      mPendingUploads;
+  std::uint64_t                                  mPendingBase;
+  std::unordered_map<RenderData*, std::uint64_t> mPending;
+
+  // Only set in the virtual texturing mode. A tile is identified in mPageTable by its layer and
+  // page, mVirtualTiles maps the nodes of all tiles on the GPU to their index.
+  std::unique_ptr<VirtualPageTable>        mPageTable;
+  std::unordered_map<TileNode const*, int> mVirtualTiles;
+  std::vector<VirtualPageTable::Request>   mFeedback;
+  GLuint                                   mCacheTexId;
+  int                                      mCachePagesPerRow;
 };
 
 /// DocTODO
 class GLResources {
  public:
-  GLResources(int maxLayersFloat32, int maxLayersUInt8, int maxLayersU8Vec3) {
+  /// If virtualImages is true, the arrays for image data use the virtual texturing mode. If
+  /// mipmapImages is true, they have mipmap levels. The elevation data is only sampled at level 0
+  /// by the vertex shader and never has mipmap levels.
+  GLResources(int maxLayersFloat32, int maxLayersUInt8, int maxLayersU8Vec3,
+      bool virtualImages = false, bool mipmapImages = false) {
     mextureArrays[static_cast<int>(TileDataType::eFloat32)] =
         std::make_unique<TileTextureArray>(TileDataType::eFloat32, maxLayersFloat32);
-    mextureArrays[static_cast<int>(TileDataType::eUInt8)] =
-        std::make_unique<TileTextureArray>(TileDataType::eUInt8, maxLayersUInt8);
-    mextureArrays[static_cast<int>(TileDataType::eU8Vec3)] =
-        std::make_unique<TileTextureArray>(TileDataType::eU8Vec3, maxLayersU8Vec3);
+    mextureArrays[static_cast<int>(TileDataType::eUInt8)] = std::make_unique<TileTextureArray>(
+        TileDataType::eUInt8, maxLayersUInt8, virtualImages, mipmapImages);
+    mextureArrays[static_cast<int>(TileDataType::eU8Vec3)] = std::make_unique<TileTextureArray>(
+        TileDataType::eU8Vec3, maxLayersU8Vec3, virtualImages, mipmapImages);
   }
 
   TileTextureArray& operator[](TileDataType type) {
     return *mextureArrays.at(static_cast<int>(type));
   }
 
+  /// Changes the number of tiles of the given type which can be kept on the GPU.
+  void setMaxLayerCount(TileDataType type, int maxLayerCount) {
+    (*this)[type].setMaxLayerCount(maxLayerCount);
+  }
+
  private:
   std::array<std::unique_ptr<TileTextureArray>, 3> mextureArrays;
 };
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileTrace.hpp"
+
+#include <sstream>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* explicit */
+TileTrace::TileTrace(std::string const& fileName)
+    : mFile(fileName, std::ofstream::out | std::ofstream::trunc) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileTrace::isOpen() const {
+  return mFile.is_open();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileTrace::addFrame(std::vector<TileId> const& tileIds) {
+  for (std::size_t i = 0; i < tileIds.size(); ++i) {
+    mFile << (i > 0 ? " " : "") << tileIds[i].level() << " " << tileIds[i].patchIdx();
+  }
+
+  mFile << '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileTrace::Frames TileTrace::read(std::istream& is) {
+  Frames      frames;
+  std::string line;
+
+  while (std::getline(is, line)) {
+    std::istringstream  tiles(line);
+    std::vector<TileId> frame;
+    int                 level    = 0;
+    glm::int64          patchIdx = 0;
+
+    while (tiles >> level >> patchIdx) {
+      frame.emplace_back(level, patchIdx);
+    }
+
+    frames.push_back(std::move(frame));
+  }
+
+  return frames;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TILETRACE_HPP
+#define CSP_LOD_BODIES_TILETRACE_HPP
+
+#include "TileId.hpp"
+
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Records the tiles used by the traversal in each frame to a file, one line per frame listing the
+/// level and patch index of each tile. The tests of EvictionPolicy replay such traces against a
+/// TileResidency, see TreeManagerBase::setTraceFile.
+class TileTrace {
+ public:
+  /// The tiles used in each frame.
+  using Frames = std::vector<std::vector<TileId>>;
+
+  /// Creates or truncates the given file.
+  explicit TileTrace(std::string const& fileName);
+
+  /// Returns false if the file could not be opened.
+  bool isOpen() const;
+
+  /// Appends a line for the next frame.
+  void addFrame(std::vector<TileId> const& tileIds);
+
+  /// Reads a trace written by addFrame.
+  static Frames read(std::istream& is);
+
+ private:
+  std::ofstream mFile;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TILETRACE_HPP
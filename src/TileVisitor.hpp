@@ -11,6 +11,7 @@
 #include "TileId.hpp"
 #include "TileQuadTree.hpp"
 
+#include <array>
 #include <boost/assert.hpp>
 
 namespace csp::lodbodies {
@@ -26,7 +27,9 @@ class TileNode;
 ///
 /// This is the CRTP (curiously recurring template pattern) pattern and allows TileVistor to call
 /// member functions of DerivedT without having to resort to runtime polymorphism (i.e. virtual
-/// functions).
+/// functions). None of the callbacks below is virtual, DerivedT simply declares functions with the
+/// same signature, which hide the default implementations. All calls are resolved at compile time
+/// and can be inlined into the traversal loop.
 ///
 /// The functions preTraverse, postTraverse, preVisitRoot, postVisitRoot, preVisit, and postVisit
 /// are called during traversal before/after the traversal as a whole, visiting a root node, and
@@ -34,6 +37,7 @@ class TileNode;
 ///
 /// @code{.cpp}
 /// preTraverse()
+/// visitRoots()
 ///   preVisitRoot()        // root 0
 ///     preVisit()          // root 0 - child 0
 ///     postVisit()         // root 0 - child 0
@@ -53,6 +57,12 @@ class TileNode;
 /// the preVisit / preVisitRoot callbacks, but the postVisit / postVisitRoot ones will not see
 /// correct values!
 ///
+/// The roots are visited one after another by visitRoots. DerivedT may reimplement it to visit the
+/// roots in a different order or concurrently, see LODVisitor for an example.
+///
+/// The nodes below a root are traversed without recursion, using a stack of at most sMaxDepth
+/// entries which is part of the visitor. Trees must therefore not be deeper than sMaxDepth levels.
+///
 /// If the "callback" functions (pre/postTraverse, pre/postVisit) are protected or private in
 /// DerivedT make TileVisitor a friend class so that it can call these functions.
 template <typename DerivedT>
@@ -78,6 +88,9 @@ class TileVisitor {
   int           getLevel() const;
   glm::int64    getPatchIdx() const;
 
+  /// The maximum number of levels of the visited trees.
+  static int const sMaxDepth = 32;
+
  protected:
   class StateBase {
    public:
@@ -91,18 +104,22 @@ class TileVisitor {
   DerivedType&       self();
   DerivedType const& self() const;
 
+  void visitRoot(int rootIdx);
   void visitRoot(TileNode* rootDEM, TileNode* rootIMG, TileId tileId);
-  void visitLevel(TileNode* nodeDEM, TileNode* nodeIMG, TileId tileId);
 
   /// Called before visiting the first root node. Returns if traversal should commence or
   /// not.
   /// Reimplement in the derived class, the default just returns true.
-  virtual bool preTraverse();
+  bool preTraverse();
 
   /// Called after visiting the last node. Reimplement in the derived class, the default
   /// just does
   /// nothing.
-  virtual void postTraverse();
+  void postTraverse();
+
+  /// Called between preTraverse and postTraverse to visit the TileQuadTree::sNumRoots root nodes.
+  /// Reimplement in the derived class, the default visits the roots in order on the calling thread.
+  void visitRoots();
 
   /// Called for each root node visited, before visiting any children. Returns if any
   /// children
@@ -112,12 +129,12 @@ class TileVisitor {
   /// For finer grained control over which children to visit, set the corresponding entries of
   /// StateBase::children to true (visit child - the default) or false (skip child). These
   /// entries are only considered if this functions returns true.
-  virtual bool preVisitRoot(TileId const& tileId);
+  bool preVisitRoot(TileId const& tileId);
 
   /// Called for each root node visited, after visiting any children. Reimplement in the
   /// derived
   /// class, the default just does nothing.
-  virtual void postVisitRoot(TileId const& tileId);
+  void postVisitRoot(TileId const& tileId);
 
   /// Called for each non-root node visited, before visiting the child nodes.
   /// Returns if children should be visited (true) or skipped (false).
@@ -126,21 +143,38 @@ class TileVisitor {
   /// For finer grained control over which children to visit, set the corresponding entries
   /// of StateBase::children to true (visit child - the default) or false (skip child).
   /// These entries are only considered if this functions returns true.
-  virtual bool preVisit(TileId const& tileId);
+  bool preVisit(TileId const& tileId);
 
   /// Called for each node visited, after visiting the child nodes. Reimplement in the
   /// derived
   /// class, the default just does nothing.
-  virtual void postVisit(TileId const& tileId);
+  void postVisit(TileId const& tileId);
 
-  virtual void             pushState();
-  virtual void             popState();
-  virtual StateBase&       getState();
-  virtual StateBase const& getState() const;
+  void             pushState();
+  void             popState();
+  StateBase&       getState();
+  StateBase const& getState() const;
 
   TileQuadTree* mTreeDEM;
   TileQuadTree* mTreeIMG;
   StateBase     mDummyState;
+
+ private:
+  /// An entry of the traversal stack. Bit i of mChildren is set if child i still has to be
+  /// visited, the children are visited in order of their index.
+  struct Frame {
+    std::array<TileNode*, 4> mChildrenDEM{};
+    std::array<TileNode*, 4> mChildrenIMG{};
+    TileId                   mTileId;
+    unsigned                 mChildren{};
+  };
+
+  /// Initializes the state of the node, calls preVisitRoot or preVisit and stores the children
+  /// which should be visited and exist in any of the trees in frame.
+  void enterNode(Frame& frame, TileNode* nodeDEM, TileNode* nodeIMG, TileId const& tileId,
+      bool isRoot);
+
+  std::array<Frame, sMaxDepth> mFrames;
 };
 
 template <typename DerivedT>
@@ -153,13 +187,7 @@ TileVisitor<DerivedT>::TileVisitor(TileQuadTree* treeDEM, TileQuadTree* treeIMG)
 template <typename DerivedT>
 void TileVisitor<DerivedT>::visit() {
   if (self().preTraverse()) {
-    for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
-      TileNode* rootDEM = mTreeDEM->getRoot(i);
-      TileNode* rootIMG = mTreeIMG ? mTreeIMG->getRoot(i) : nullptr;
-
-      // if (i==7)
-      visitRoot(rootDEM, rootIMG, TileId(0, i));
-    }
+    self().visitRoots();
   }
 
   self().postTraverse();
@@ -220,80 +248,92 @@ typename TileVisitor<DerivedT>::DerivedType const& TileVisitor<DerivedT>::self()
   return *static_cast<DerivedType const*>(this);
 }
 
+template <typename DerivedT>
+void TileVisitor<DerivedT>::visitRoot(int rootIdx) {
+  TileNode* rootDEM = mTreeDEM->getRoot(rootIdx);
+  TileNode* rootIMG = mTreeIMG ? mTreeIMG->getRoot(rootIdx) : nullptr;
+
+  visitRoot(rootDEM, rootIMG, TileId(0, rootIdx));
+}
+
 template <typename DerivedT>
 void TileVisitor<DerivedT>::visitRoot(TileNode* rootDEM, TileNode* rootIMG, TileId tileId) {
-  // check that nodes have expected level - if this triggers the trees are
-  // corrupted
-  assert(rootDEM == NULL || rootDEM->getLevel() == tileId.level());
-  assert(rootIMG == NULL || rootIMG->getLevel() == tileId.level());
+  int top = 0;
+  enterNode(mFrames[0], rootDEM, rootIMG, tileId, true);
 
-  // push & init state
-  self().pushState();
-  StateBase& state   = self().getState();
-  state.mChildren[0] = true;
-  state.mChildren[1] = true;
-  state.mChildren[2] = true;
-  state.mChildren[3] = true;
-  state.mNodeDEM     = rootDEM;
-  state.mNodeIMG     = rootIMG;
-  state.mTileId      = tileId;
-
-  if (self().preVisitRoot(tileId)) {
-    for (int i = 0; i < 4; ++i) {
-      if (!state.mChildren[i]) {
-        continue;
-      }
+  while (top >= 0) {
+    Frame& frame = mFrames[top];
 
-      TileNode* childDEM = rootDEM ? rootDEM->getChild(i) : nullptr;
-      TileNode* childIMG = rootIMG ? rootIMG->getChild(i) : nullptr;
+    // Descend into the next child which should be visited and exists in any of the trees.
+    if (frame.mChildren != 0U) {
+      int childIdx = 0;
 
-      if (childDEM || childIMG) {
-        TileId childId = HEALPix::getChildTileId(tileId, i);
-        visitLevel(childDEM, childIMG, childId);
+      while ((frame.mChildren & (1U << static_cast<unsigned>(childIdx))) == 0U) {
+        ++childIdx;
       }
+
+      frame.mChildren &= frame.mChildren - 1U;
+
+      // check that the stack does not overflow
+      assert(top + 1 < sMaxDepth);
+
+      TileId const childId = HEALPix::getChildTileId(frame.mTileId, childIdx);
+      ++top;
+      enterNode(mFrames[top], frame.mChildrenDEM[childIdx], frame.mChildrenIMG[childIdx], childId,
+          false);
+      continue;
+    }
+
+    // All children are done.
+    if (top == 0) {
+      self().postVisitRoot(frame.mTileId);
+    } else {
+      self().postVisit(frame.mTileId);
     }
-  }
 
-  self().postVisitRoot(tileId);
-  self().popState();
+    self().popState();
+    --top;
+  }
 }
 
 template <typename DerivedT>
-void TileVisitor<DerivedT>::visitLevel(TileNode* nodeDEM, TileNode* nodeIMG, TileId tileId) {
+void TileVisitor<DerivedT>::enterNode(
+    Frame& frame, TileNode* nodeDEM, TileNode* nodeIMG, TileId const& tileId, bool isRoot) {
   // check that nodes have expected level - if this triggers the trees are
   // corrupted
   assert(nodeDEM == NULL || nodeDEM->getLevel() == tileId.level());
   assert(nodeIMG == NULL || nodeIMG->getLevel() == tileId.level());
 
+  frame.mTileId = tileId;
+
   // push & init state
   self().pushState();
-  StateBase& state   = self().getState();
-  state.mChildren[0] = true;
-  state.mChildren[1] = true;
-  state.mChildren[2] = true;
-  state.mChildren[3] = true;
-  state.mNodeDEM     = nodeDEM;
-  state.mNodeIMG     = nodeIMG;
-  state.mTileId      = tileId;
-
-  if (self().preVisit(tileId)) {
-    for (int i = 0; i < 4; ++i) {
-      if (!state.mChildren[i]) {
-        continue;
-      }
+  StateBase& state = self().getState();
+  state.mChildren  = {true, true, true, true};
+  state.mNodeDEM   = nodeDEM;
+  state.mNodeIMG   = nodeIMG;
+  state.mTileId    = tileId;
 
-      TileNode* childDEM = nodeDEM ? nodeDEM->getChild(i) : nullptr;
-      TileNode* childIMG = nodeIMG ? nodeIMG->getChild(i) : nullptr;
+  bool const visitChildren = isRoot ? self().preVisitRoot(tileId) : self().preVisit(tileId);
 
-      if (childDEM || childIMG) {
-        TileId childId = HEALPix::getChildTileId(tileId, i);
-        visitLevel(childDEM, childIMG, childId);
-      }
-    }
+  frame.mChildren = 0U;
+
+  if (!visitChildren) {
+    return;
   }
 
-  self().postVisit(tileId);
-  self().popState();
+  for (int i = 0; i < 4; ++i) {
+    if (!state.mChildren[i]) {
+      continue;
+    }
+
+    frame.mChildrenDEM[i] = nodeDEM ? nodeDEM->getChild(i) : nullptr;
+    frame.mChildrenIMG[i] = nodeIMG ? nodeIMG->getChild(i) : nullptr;
+
+    if (frame.mChildrenDEM[i] || frame.mChildrenIMG[i]) {
+      frame.mChildren |= 1U << static_cast<unsigned>(i);
+    }
+  }
 }
 
 template <typename DerivedT>
@@ -307,6 +347,13 @@ void TileVisitor<DerivedT>::postTraverse() {
   // default impl - empty
 }
 
+template <typename DerivedT>
+void TileVisitor<DerivedT>::visitRoots() {
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    visitRoot(i);
+  }
+}
+
 template <typename DerivedT>
 bool TileVisitor<DerivedT>::preVisitRoot(TileId const& /*tileId*/) {
   // default impl - do not visit children
@@ -22,6 +22,12 @@ template <>
 
   rdata->setBounds(calcTileBounds(
       *node->getTile(), mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+  rdata->setOrientedBounds(calcOrientedTileBounds(
+      *node->getTile(), mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+  rdata->setGeometricError(calcGeometricError(
+      *node->getTile(), mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+  rdata->setOccluders(calcTileOccluders(
+      *node->getTile(), mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
 
   return rdata;
 }
@@ -6,13 +6,18 @@
 
 #include "TreeManagerBase.hpp"
 
+#include "HEALPix.hpp"
+#include "MipChain.hpp"
 #include "PlanetParameters.hpp"
 #include "RenderData.hpp"
+#include "RetainBudget.hpp"
 #include "TileSource.hpp"
 #include "TileTextureArray.hpp"
+#include "TileTrace.hpp"
 
 #include <VistaBase/VistaStreamUtils.h>
 
+#include <algorithm>
 #include <utility>
 
 namespace csp::lodbodies {
@@ -34,12 +39,18 @@ int const maxNodeAge = 10;
 // is kept around
 int const maxUnmergedAge = 500;
 
+// number of frames between checks for expired unmerged nodes
+int const unmergedCheckInterval = 64;
+
 // number of nodes to pre-allocate data structures
 std::size_t const preAllocNodeCount = 500;
 
 // number of nodes to pre-allocate IO data structures
 std::size_t const preAllocIONodeCount = 200;
 
+// tile data uploaded to the GPU per frame, about 30 elevation tiles
+std::size_t const defaultUploadBytes = 8 * 1024 * 1024;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 } // namespace
@@ -89,33 +100,175 @@ TreeManagerBase::NodeAge::NodeAge(TileNode* node, int frame)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* explicit */
+TreeManagerBase::LoadToken::LoadToken(TreeManagerBase* owner)
+    : mOwner(owner) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /* explicit */
 TreeManagerBase::TreeManagerBase(
     PlanetParameters const& params, std::shared_ptr<GLResources> glResources)
     : mParams(&params)
     , mGlMgr(std::move(glResources))
     , mSrc()
+    , mLoadToken(std::make_shared<LoadToken>(this))
+    , mMaxRetainedTrees(0)
+    , mMaxUploadBytes(defaultUploadBytes)
+    , mTraceFrame(-1)
     , mFrameCount(0)
     , mAsyncLoading(true) {
   mRdMap.reserve(preAllocNodeCount);
   mAgeStore.reserve(preAllocNodeCount);
 
   mUnmergedNodes.reserve(preAllocIONodeCount);
-  mLoadedNodes.reserve(preAllocIONodeCount);
+  mMergeNodes.reserve(preAllocIONodeCount);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* virtual */
-TreeManagerBase::~TreeManagerBase() = default;
+TreeManagerBase::~TreeManagerBase() {
+  // The source may be shared with other bodies and keep loading tiles for this, these must not be
+  // passed to onNodeLoaded anymore.
+  cancelRequests();
+
+  // Nodes which are still in flight or deferred have to be deleted here, the queue only owns its
+  // links.
+  mLoadedNodes.drain(mMergeNodes);
+
+  for (auto const& loaded : mMergeNodes) {
+    releaseSlot(loaded.mNode, loaded.mSlot);
+    delete loaded.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+  }
+
+  for (auto const& parked : mUnmergedNodes) {
+    for (auto const& nodeAge : parked.second) {
+      delete nodeAge.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+    }
+  }
+
+  if (mRetainBudget) {
+    mRetainBudget->removeAll(this);
+  }
+
+  // The RenderData of retained trees is released together with the pool of the derived class,
+  // only the unmerged nodes need to be deleted here.
+  for (auto& tree : mRetainedTrees) {
+    for (auto const& parked : tree.mUnmergedNodes) {
+      for (auto const& nodeAge : parked.second) {
+        delete nodeAge.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+      }
+    }
+  }
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TreeManagerBase::setSource(TileSource* src) {
-  // remove all existing nodes
-  std::unique_lock<std::mutex> lck(mLoadedMtx);
-  clear();
+  if (src == mSrc) {
+    return;
+  }
+
+  // keep the existing nodes around if the source is likely to be used
+  // again, otherwise remove them
+  if (mSrc && mMaxRetainedTrees > 0) {
+    retainTree();
+  } else {
+    // Without retained trees, nodes still being loaded are of no use. Once mSrc is null, pending
+    // requests belong to a retained tree and have to be delivered.
+    if (mSrc) {
+      cancelRequests();
+    }
+
+    clear();
+  }
+
   mSrc = src;
+
+  if (mSrc) {
+    restoreTree();
+  }
+
+  enforceRetainLimits();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::setMaxRetainedTrees(std::size_t count) {
+  mMaxRetainedTrees = count;
+  enforceRetainLimits();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TreeManagerBase::getMaxRetainedTrees() const {
+  return mMaxRetainedTrees;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::setRetainBudget(std::shared_ptr<RetainBudget> budget) {
+  if (budget == mRetainBudget) {
+    return;
+  }
+
+  // the trees retained so far are only limited by their number from now on
+  if (mRetainBudget) {
+    mRetainBudget->removeAll(this);
+  }
+
+  mRetainBudget = std::move(budget);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<RetainBudget> const& TreeManagerBase::getRetainBudget() const {
+  return mRetainBudget;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::setMaxUploadBytes(std::size_t bytes) {
+  mMaxUploadBytes = bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t TreeManagerBase::getMaxUploadBytes() const {
+  return mMaxUploadBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::setTraceFile(std::string const& fileName) {
+  mTrace.reset();
+
+  if (fileName.empty()) {
+    return;
+  }
+
+  mTrace      = std::make_unique<TileTrace>(fileName);
+  mTraceFrame = mFrameCount;
+
+  if (!mTrace->isOpen()) {
+    vstr::warnp() << "[TreeManagerBase::setTraceFile] [" << mName << "] Failed to open "
+                  << fileName << "!" << std::endl;
+    mTrace.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::dropRetainedTree(TileSource const* src) {
+  for (auto it = mRetainedTrees.begin(); it != mRetainedTrees.end(); ++it) {
+    if (it->mSrc == src) {
+      releaseRetainedTree(*it);
+      mRetainedTrees.erase(it);
+      return;
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -133,8 +286,8 @@ void TreeManagerBase::request(std::vector<TileId> const& tileIds) {
   // load the tile.
   // In the case of async loading, register @c onNodeLoaded as the callback
   // that the source invokes when the tile is ready.
-  std::unique_lock<std::mutex> lck(mLoadedMtx);
-
+  // mPendingTiles is only accessed from the render thread, so no lock is
+  // required here.
   auto iIt  = tileIds.begin();
   auto iEnd = tileIds.end();
 
@@ -143,13 +296,17 @@ void TreeManagerBase::request(std::vector<TileId> const& tileIds) {
       mPendingTiles.insert(*iIt);
 
       if (mAsyncLoading) {
-#if (BOOST_VERSION / 100) % 1000 < 60
-        mSrc->loadTileAsync(iIt->level(), iIt->patchIdx(),
-            std::bind(&TreeManagerBase::onNodeLoaded, this, _1, _2, _3, _4));
-#else
         mSrc->loadTileAsync(iIt->level(), iIt->patchIdx(),
-            [this](auto a, auto b, auto c, auto d) { onNodeLoaded(a, b, c, d); });
-#endif
+            [token = mLoadToken](
+                TileSource* source, int level, glm::int64 patchIdx, TileNode* node) {
+              std::shared_lock<std::shared_mutex> lock(token->mMutex);
+
+              if (token->mOwner) {
+                token->mOwner->onNodeLoaded(source, level, patchIdx, node);
+              } else {
+                delete node; // NOLINT(cppcoreguidelines-owning-memory)
+              }
+            });
       } else {
         TileNode* node = mSrc->loadTile(iIt->level(), iIt->patchIdx());
         onNodeLoaded(mSrc, iIt->level(), iIt->patchIdx(), node);
@@ -160,23 +317,42 @@ void TreeManagerBase::request(std::vector<TileId> const& tileIds) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TreeManagerBase::update() {
+void TreeManagerBase::update(std::chrono::steady_clock::time_point deadline) {
   // remove unused nodes - do this before the merge to free up resources
   // that can then be consumed by newly loaded ones.
   prune();
 
   // insert new nodes
-  merge();
+  merge(deadline);
 
   // upload tiles to GPU
-  getTileTextureArray().processQueue(20);
+  getTileTextureArray().processQueue(mMaxUploadBytes, deadline);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TreeManagerBase::clear() {
   mPendingTiles.clear();
-  mLoadedNodes.clear();
+
+  // Loaded nodes belong to the old source and are of no use anymore. Nodes
+  // which are still being loaded are discarded in merge() as their source
+  // does not match mSrc.
+  mLoadedNodes.drain(mMergeNodes);
+
+  for (auto const& loaded : mMergeNodes) {
+    releaseSlot(loaded.mNode, loaded.mSlot);
+    delete loaded.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+  }
+
+  mMergeNodes.clear();
+
+  for (auto const& parked : mUnmergedNodes) {
+    for (auto const& nodeAge : parked.second) {
+      delete nodeAge.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+    }
+  }
+
+  mUnmergedNodes.clear();
 
   auto rdIt  = mRdMap.begin();
   auto rdEnd = mRdMap.end();
@@ -247,24 +423,34 @@ std::size_t TreeManagerBase::getNodeCountGPU() const {
 
 void TreeManagerBase::onNodeLoaded(
     TileSource* source, int level, glm::int64 patchIdx, TileNode* node) {
-  std::unique_lock<std::mutex> lck(mLoadedMtx);
-  if (node && source == mSrc) {
-    // Only add node to list of loaded nodes, actual insertion into the
-    // quad-tree is done in merge().
-    // This ensures that the tree is not modified at unpredictable moments
-    // in time (for example while a traversal is in progress).
-
-    mLoadedNodes.push_back(node);
-  } else {
-    // source has changed or loading failed, discard node
-    mPendingTiles.erase(TileId(level, patchIdx));
-    delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO where does it get created?
+  // Only add node to the queue of loaded nodes, actual insertion into the
+  // quad-tree is done in merge().
+  // This ensures that the tree is not modified at unpredictable moments
+  // in time (for example while a traversal is in progress). Failed loads
+  // are queued as well, so that merge() can remove them from mPendingTiles.
+  //
+  // The mipmap levels are computed and the copy to the staging ring is done
+  // here, so that the render thread only has to issue the upload.
+  int slot = -1;
+
+  if (node && mGlMgr) {
+    TileBase*         tile  = node->getTile();
+    TileTextureArray& array = (*mGlMgr)[tile->getDataType()];
+
+    // the tile may be shared with other trees, which build the levels only once
+    if (array.hasMipmaps()) {
+      tile->buildMipChain();
+    }
+
+    slot = array.stage(*tile);
   }
+
+  mLoadedNodes.push(LoadedNode{source, TileId(level, patchIdx), node, slot});
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TreeManagerBase::onNodeInserted(TileNode* node) {
+void TreeManagerBase::onNodeInserted(TileNode* node, int slot) {
   RenderData* rdata = allocateRenderData(node);
 
   if (node->getParent()) {
@@ -277,8 +463,19 @@ void TreeManagerBase::onNodeInserted(TileNode* node) {
   auto res = mRdMap.insert(RDMapValue(node->getTileId(), rdata));
   assert(res.second);
 
-  getTileTextureArray().allocateGPU(rdata);
+  getTileTextureArray().allocateGPU(rdata, slot);
   mAgeStore.push_back(&(*res.first));
+
+  // children which have been loaded before this node can now be inserted
+  mergeUnmerged(node);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::releaseSlot(TileNode const* node, int slot) {
+  if (slot >= 0) {
+    (*mGlMgr)[node->getTile()->getDataType()].releaseSlot(slot);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -290,11 +487,177 @@ void TreeManagerBase::releaseResources(RenderData* rdata) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TreeManagerBase::erasePending(TileSource const* source, TileId const& tileId) {
+  // a tile of another source must not clear the request of the current
+  // tree, which would request it a second time
+  if (source == mSrc) {
+    mPendingTiles.erase(tileId);
+    return;
+  }
+
+  for (auto& tree : mRetainedTrees) {
+    if (tree.mSrc == source) {
+      tree.mPendingTiles.erase(tileId);
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::cancelRequests() {
+  {
+    std::unique_lock<std::shared_mutex> lock(mLoadToken->mMutex);
+    mLoadToken->mOwner = nullptr;
+  }
+
+  mLoadToken = std::make_shared<LoadToken>(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::retainTree() {
+  // free the GPU layers, they are needed by the new source
+  for (auto const& rd : mRdMap) {
+    getTileTextureArray().releaseGPU(rd.second);
+  }
+
+  mLoadedNodes.drain(mMergeNodes);
+
+  for (auto const& loaded : mMergeNodes) {
+    erasePending(loaded.mSource, loaded.mTileId);
+    releaseSlot(loaded.mNode, loaded.mSlot);
+    delete loaded.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+  }
+
+  mMergeNodes.clear();
+
+  // tiles shared with other trees are only counted once by the budget
+  std::vector<TileBase const*> tiles;
+
+  if (mRetainBudget) {
+    tiles.reserve(mRdMap.size());
+
+    for (auto const& rd : mRdMap) {
+      tiles.push_back(rd.second->getNode()->getTile());
+    }
+
+    for (auto const& parked : mUnmergedNodes) {
+      for (auto const& nodeAge : parked.second) {
+        tiles.push_back(nodeAge.mNode->getTile());
+      }
+    }
+  }
+
+  RetainedTree tree;
+  tree.mSrc  = mSrc;
+  tree.mTree = std::move(mTree);
+
+  // Moving the map keeps its elements in place, so the pointers in
+  // mAgeStore stay valid.
+  tree.mRdMap         = std::move(mRdMap);
+  tree.mAgeStore      = std::move(mAgeStore);
+  tree.mPendingTiles  = std::move(mPendingTiles);
+  tree.mUnmergedNodes = std::move(mUnmergedNodes);
+
+  mTree = TileQuadTree();
+  mRdMap.clear();
+  mAgeStore.clear();
+  mPendingTiles.clear();
+  mUnmergedNodes.clear();
+
+  mRdMap.reserve(preAllocNodeCount);
+  mAgeStore.reserve(preAllocNodeCount);
+
+  mRetainedTrees.push_front(std::move(tree));
+
+  // this may drop retained trees of any TreeManager sharing the budget, including this one
+  if (mRetainBudget) {
+    TileSource const* src = mSrc;
+    mRetainBudget->add(this, src, std::move(tiles), [this, src]() { dropRetainedTree(src); });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::restoreTree() {
+  auto it = std::find_if(mRetainedTrees.begin(), mRetainedTrees.end(),
+      [this](RetainedTree const& tree) { return tree.mSrc == mSrc; });
+
+  if (it == mRetainedTrees.end()) {
+    return;
+  }
+
+  mTree          = std::move(it->mTree);
+  mRdMap         = std::move(it->mRdMap);
+  mAgeStore      = std::move(it->mAgeStore);
+  mPendingTiles  = std::move(it->mPendingTiles);
+  mUnmergedNodes = std::move(it->mUnmergedNodes);
+
+  mRetainedTrees.erase(it);
+
+  if (mRetainBudget) {
+    mRetainBudget->remove(this, mSrc);
+  }
+
+  // Mark all nodes as used, otherwise they would be pruned right away.
+  // Then queue the tiles for upload, the upload queue orders them by level.
+  for (auto const& rd : mRdMap) {
+    rd.second->setLastFrame(mFrameCount);
+    getTileTextureArray().allocateGPU(rd.second);
+  }
+
+#if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
+  vstr::outi() << "[TreeManagerBase::restoreTree] [" << mName << "] restored nodes "
+               << mRdMap.size() << std::endl;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::releaseRetainedTree(RetainedTree& tree) {
+  if (mRetainBudget) {
+    mRetainBudget->remove(this, tree.mSrc);
+  }
+
+  // GPU resources have already been released in retainTree
+  for (auto const& rd : tree.mRdMap) {
+    releaseRenderData(rd.second);
+  }
+
+  for (auto const& parked : tree.mUnmergedNodes) {
+    for (auto const& nodeAge : parked.second) {
+      delete nodeAge.mNode; // NOLINT(cppcoreguidelines-owning-memory)
+    }
+  }
+
+  tree.mRdMap.clear();
+  tree.mAgeStore.clear();
+  tree.mUnmergedNodes.clear();
+  tree.mTree = TileQuadTree();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TreeManagerBase::enforceRetainLimits() {
+  // mRetainedTrees is ordered by recent use, so drop trees from the back
+  while (mRetainedTrees.size() > mMaxRetainedTrees) {
+    releaseRetainedTree(mRetainedTrees.back());
+    mRetainedTrees.pop_back();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TreeManagerBase::prune() {
   // sort by age, oldest nodes at the back
   std::sort(mAgeStore.begin(), mAgeStore.end(), AgeLess(mFrameCount));
   int count = 0;
 
+  if (mTrace) {
+    recordTrace();
+  }
+
   while (!mAgeStore.empty()) {
     RDMapValue* value = mAgeStore.back();
 
@@ -331,85 +694,137 @@ void TreeManagerBase::prune() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TreeManagerBase::merge() {
-  // exchange mLoadedNodes and mergeNodes so the lock need not be held
-  // for the duration of the whole merge
-  std::vector<TileNode*> mergeNodes;
-  {
-    std::unique_lock<std::mutex> lck(mLoadedMtx);
+void TreeManagerBase::merge(std::chrono::steady_clock::time_point deadline) {
+  // take all nodes loaded since the last merge and append them to those
+  // deferred in previous frames, mMergeNodes keeps its capacity so this does
+  // not allocate
+  mLoadedNodes.drain(mMergeNodes);
 
-    mergeNodes = mLoadedNodes;
-    mLoadedNodes.clear();
-  }
+  // Tiles may arrive out of order, as LODVisitor requests tiles several levels ahead. Merging the
+  // coarse ones first lets their descendants be inserted directly instead of being parked, and
+  // makes the coarse tiles available first when the deadline defers the rest.
+  std::stable_sort(mMergeNodes.begin(), mMergeNodes.end(),
+      [](LoadedNode const& lhs, LoadedNode const& rhs) {
+        return lhs.mTileId.level() < rhs.mTileId.level();
+      });
+
+  int         merged   = 0;
+  int         unmerged = 0;
+  std::size_t count    = 0;
 
-  int merged   = 0;
-  int unmerged = 0;
+  for (; count < mMergeNodes.size(); ++count) {
+    // the remaining nodes are merged in the next frame
+    if (count > 0 && std::chrono::steady_clock::now() > deadline) {
+      break;
+    }
+
+    LoadedNode const& loaded = mMergeNodes[count];
+
+    if (loaded.mNode == nullptr || loaded.mSource != mSrc) {
+      // Source has changed or loading failed, discard node. The node may
+      // have been requested for a tree which is now retained, it has to be
+      // requested again once that tree is restored.
+      erasePending(loaded.mSource, loaded.mTileId);
+      releaseSlot(loaded.mNode, loaded.mSlot);
+      delete loaded.mNode; // NOLINT(cppcoreguidelines-owning-memory)
 
-  for (auto& node : mergeNodes) {
-    assert(node != nullptr);
+      continue;
+    }
+
+    TileNode* node = loaded.mNode;
     assert(node->getTile() != nullptr);
 
     if (insertNode(&mTree, node)) {
       mPendingTiles.erase(node->getTileId());
-      onNodeInserted(node);
+      onNodeInserted(node, loaded.mSlot);
 
       ++merged;
-      node = nullptr;
     } else {
-      // keep track of nodes that could not be inserted, e.g. because
-      // their parent is currently not loaded
+      // The parent of the node is currently not in the tree. Park the node
+      // until the parent is inserted (see mergeUnmerged) or its age
+      // exceeds maxUnmergedAge.
+      releaseSlot(node, loaded.mSlot);
+      mUnmergedNodes[HEALPix::getParentTileId(node->getTileId())].emplace_back(node, mFrameCount);
+
       ++unmerged;
     }
   }
 
-  // attempt to merge unmerged nodes from previous frames
-  // Go through list of unmerged nodes and attempt to insert them into the
-  // tree. If that fails and the nodes age exceeds maxUnmergedAge, it is
-  // discarded.
-  for (std::size_t i = 0; i < mUnmergedNodes.size();) {
-    TileNode* node = mUnmergedNodes[i].mNode;
+  mMergeNodes.erase(mMergeNodes.begin(), mMergeNodes.begin() + static_cast<std::ptrdiff_t>(count));
 
-    if (insertNode(&mTree, node)) {
-      // insert succeeded, remove from pending and unmerged and
-      // associate render data with node
-      mPendingTiles.erase(node->getTileId());
-      mUnmergedNodes.erase(mUnmergedNodes.begin() + i);
-
-      onNodeInserted(node);
-    } else if ((mFrameCount - mUnmergedNodes[i].mFrame) > maxUnmergedAge) {
-      // node is waiting for too long to be merged - discard it
-      mPendingTiles.erase(node->getTileId());
-      mUnmergedNodes.erase(mUnmergedNodes.begin() + i);
-
-      delete node; // NOLINT(cppcoreguidelines-owning-memory): TODO where does it get created?
-    } else {
-      ++i;
-    }
+  // the deferred nodes give their staging slots to those loaded until the next frame
+  for (auto& loaded : mMergeNodes) {
+    releaseSlot(loaded.mNode, loaded.mSlot);
+    loaded.mSlot = -1;
   }
 
-  // copy any nodes that where not merged to mUnmergedNodes
-  if (unmerged > 0) {
-    // Store unmerged nodes together with the current frame number.
-    // Attempts to merge these into the tree will be made until their age
-    // exceeds maxUnmergedAge (see mergeUnmerged).
-    for (auto const& node : mergeNodes) {
-      if (node) {
-        mUnmergedNodes.emplace_back(node, mFrameCount);
-        --unmerged;
+  // Discard nodes that have been waiting for their parent for too long.
+  // Nodes which are released by a parent insertion are removed from
+  // mUnmergedNodes in mergeUnmerged, so this only has to check the age and
+  // it is sufficient to do so every few frames.
+  if (mFrameCount % unmergedCheckInterval == 0) {
+    for (auto it = mUnmergedNodes.begin(); it != mUnmergedNodes.end();) {
+      auto& nodes = it->second;
+
+      for (std::size_t i = 0; i < nodes.size();) {
+        if ((mFrameCount - nodes[i].mFrame) > maxUnmergedAge) {
+          mPendingTiles.erase(nodes[i].mNode->getTileId());
+          delete nodes[i].mNode; // NOLINT(cppcoreguidelines-owning-memory)
+
+          // swap-and-pop, the order of parked nodes is irrelevant
+          nodes[i] = nodes.back();
+          nodes.pop_back();
+        } else {
+          ++i;
+        }
+      }
+
+      if (nodes.empty()) {
+        it = mUnmergedNodes.erase(it);
+      } else {
+        ++it;
       }
     }
   }
 
   if (merged > 0 || unmerged > 0) {
 #if !defined(NDEBUG) && !defined(VISTAPLANET_NO_VERBOSE)
-    vstr::outi() << "[TreeManagerBase::merge] [" << mName << "] nodes merged/unmerged " << merged
-                 << " / " << unmerged << std::endl;
+    vstr::outi() << "[TreeManagerBase::merge] [" << mName << "] nodes merged/unmerged/deferred "
+                 << merged << " / " << unmerged << " / " << mMergeNodes.size() << std::endl;
 #endif
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TreeManagerBase::mergeUnmerged(TileNode* parent) {
+  auto it = mUnmergedNodes.find(parent->getTileId());
+
+  if (it == mUnmergedNodes.end()) {
+    return;
+  }
+
+  // Move the parked nodes out of the map first, inserting them may
+  // recursively release their own children and modify mUnmergedNodes.
+  std::vector<NodeAge> nodes(std::move(it->second));
+  mUnmergedNodes.erase(it);
+
+  for (auto const& nodeAge : nodes) {
+    TileNode* node = nodeAge.mNode;
+
+    // The parent is known, so there is no need to walk the tree from the
+    // root as insertNode would do.
+    int childIdx = HEALPix::getChildIdx(node->getTileId());
+    assert(parent->getChild(childIdx) == nullptr);
+
+    parent->setChild(childIdx, node);
+    mPendingTiles.erase(node->getTileId());
+    onNodeInserted(node, -1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 TileQuadTree* TreeManagerBase::getTree() {
   return &mTree;
 }
@@ -422,6 +837,27 @@ std::string const& TreeManagerBase::getName() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TreeManagerBase::recordTrace() {
+  // the most recently used nodes are at the front of mAgeStore, those used since the last call
+  // make up the next frame of the trace
+  std::vector<TileId> used;
+
+  for (RDMapValue const* value : mAgeStore) {
+    if (value->second->getLastFrame() <= mTraceFrame) {
+      break;
+    }
+
+    used.push_back(value->first);
+  }
+
+  if (!used.empty()) {
+    mTraceFrame = mAgeStore.front()->second->getLastFrame();
+    mTrace->addFrame(used);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TreeManagerBase::setName(std::string const& name) {
   mName = name;
 }
@@ -7,12 +7,16 @@
 #ifndef CSP_LOD_BODIES_TREEMANAGERBASE_HPP
 #define CSP_LOD_BODIES_TREEMANAGERBASE_HPP
 
+#include "MPSCQueue.hpp"
 #include "TileId.hpp"
 #include "TileQuadTree.hpp"
 
 #include <boost/cast.hpp>
 #include <boost/noncopyable.hpp>
-#include <mutex>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -25,7 +29,9 @@ class TileNode;
 class TileSource;
 class RenderData;
 class GLResources;
+class RetainBudget;
 class TileTextureArray;
+class TileTrace;
 
 /// Manages a TileQuadTree and TileNode requested from a TileSource as well as data (RenderData)
 /// associated with each TileNode.
@@ -43,6 +49,12 @@ class TileTextureArray;
 /// do not change, even when rehashing occurs). The AgeStore is sorted so that the oldest nodes are
 /// at the back and those are removed if their age exceeds a certain threshold (see
 /// TreeManagerBase::prune).
+///
+/// Loader threads never touch the tree or any other state of this class. They only push their
+/// results into a lock-free queue (see TreeManagerBase::onNodeLoaded) which is drained on the
+/// render thread by merge(). Hence, apart from onNodeLoaded, all methods must be called from the
+/// render thread. As a source may be shared with other bodies and outlive this, the callbacks
+/// passed to it only reach this through a LoadToken, which is cancelled on destruction.
 class TreeManagerBase : private boost::noncopyable {
  public:
   explicit TreeManagerBase(
@@ -56,9 +68,34 @@ class TreeManagerBase : private boost::noncopyable {
 
   virtual ~TreeManagerBase() = 0;
 
-  /// Set tile source src to use.
+  /// Set tile source src to use. The tree of the previous source is retained (see
+  /// setMaxRetainedTrees), if a tree for src has been retained before, it is restored.
   void setSource(TileSource* src);
 
+  /// Sets the maximum number of trees of previously used sources which are kept in memory. When
+  /// switching back to such a source, its tree is available immediately and its tiles do not need
+  /// to be loaded again. Retained trees do not occupy any GPU memory. Zero disables retention.
+  void        setMaxRetainedTrees(std::size_t count);
+  std::size_t getMaxRetainedTrees() const;
+
+  /// Sets the budget which limits the memory of the retained trees of this and all other
+  /// TreeManagers sharing it. Without a budget, only the number of retained trees is limited.
+  void                                 setRetainBudget(std::shared_ptr<RetainBudget> budget);
+  std::shared_ptr<RetainBudget> const& getRetainBudget() const;
+
+  /// Sets the amount of tile data in bytes which is uploaded to the GPU per call to update. The
+  /// most important tiles are uploaded first, see TileTextureArray::processQueue.
+  void        setMaxUploadBytes(std::size_t bytes);
+  std::size_t getMaxUploadBytes() const;
+
+  /// Records the tiles used in each frame to the given file, see TileTrace. The frames are written
+  /// by update. An empty name stops the recording.
+  void setTraceFile(std::string const& fileName);
+
+  /// Deletes the tree retained for src (if any). This must be called before a source which was
+  /// previously passed to setSource is destroyed.
+  void dropRetainedTree(TileSource const* src);
+
   /// Returns currently used tile source.
   TileSource* getSource() const;
 
@@ -77,8 +114,12 @@ class TreeManagerBase : private boost::noncopyable {
   void request(std::vector<TileId> const& tileIds);
 
   /// Update the TileQuadTree managed by this with the tiles that have been loaded from the
-  /// TileSource since the last call to update.
-  void update();
+  /// TileSource since the last call to update and upload them to the GPU. Once deadline has passed,
+  /// the remaining tiles are merged and uploaded in later calls. At least one tile is merged and
+  /// uploaded per call, so a deadline which is always exceeded still makes progress.
+  void update(
+      std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::time_point::max());
 
   /// Removes all nodes from the tree and frees data associated with them.
   void clear();
@@ -139,6 +180,7 @@ class TreeManagerBase : private boost::noncopyable {
   struct AgeLess;
 
   /// Tracks a node and the frame it was loaded in - for nodes that can not immediately be merged.
+  /// Parked nodes do not hold a staging slot, their tiles are uploaded from their own memory.
   struct NodeAge {
     explicit NodeAge(TileNode* node, int frame);
 
@@ -146,16 +188,73 @@ class TreeManagerBase : private boost::noncopyable {
     int       mFrame;
   };
 
-  /// Used as a callback for the TileSource to call when a node is loaded.
+  /// The result of a tile request, as passed from the loader threads to merge(). mSlot is the slot
+  /// of the staging ring the tile has been copied to (see TileTextureArray::stage) or -1. The slot
+  /// is only kept if the node is inserted in the next merge(), otherwise the few slots of the ring
+  /// would be blocked by nodes which are not uploaded anytime soon.
+  struct LoadedNode {
+    TileSource* mSource;
+    TileId      mTileId;
+    TileNode*   mNode;
+    int         mSlot;
+  };
+
+  /// Used as a callback for the TileSource to call when a node is loaded. This is called from the
+  /// loader threads and only copies the tile to the staging ring and pushes the node to
+  /// mLoadedNodes.
   void onNodeLoaded(TileSource* source, int level, glm::int64 patchIdx, TileNode* node);
 
   /// Helper function to handle processing after node is successfully inserted into the managed
-  /// TileQuadTree.
-  void onNodeInserted(TileNode* node);
+  /// TileQuadTree. slot is the staging slot of the node's tile or -1.
+  void onNodeInserted(TileNode* node, int slot);
+
+  /// Frees the staging slot of a loaded node which is not going to be uploaded. Does nothing if
+  /// slot is -1.
+  void releaseSlot(TileNode const* node, int slot);
 
   /// Helper function to free resources associated with rdata.
   void releaseResources(RenderData* rdata);
 
+  /// The state of the tree of a previously used source, see setMaxRetainedTrees.
+  struct RetainedTree {
+    TileSource const*                                mSrc;
+    TileQuadTree                                     mTree;
+    std::unordered_map<TileId, RenderData*>          mRdMap;
+    AgeStore                                         mAgeStore;
+    std::unordered_set<TileId>                       mPendingTiles;
+    std::unordered_map<TileId, std::vector<NodeAge>> mUnmergedNodes;
+  };
+
+  /// Removes tileId from the pending tiles of the tree it has been requested for, which is either
+  /// the current tree or the retained tree of source.
+  void erasePending(TileSource const* source, TileId const& tileId);
+
+  /// Moves the current tree to mRetainedTrees and releases its GPU resources.
+  void retainTree();
+
+  /// Makes the tree retained for mSrc the current one, if there is such a tree.
+  void restoreTree();
+
+  /// Deletes all nodes and data of a retained tree and removes it from the RetainBudget.
+  void releaseRetainedTree(RetainedTree& tree);
+
+  /// Shared between this and the callbacks of its requests. mOwner is reset once this is not
+  /// interested in the requests anymore, the callbacks then delete the loaded nodes instead.
+  struct LoadToken {
+    explicit LoadToken(TreeManagerBase* owner);
+
+    std::shared_mutex mMutex;
+    TreeManagerBase*  mOwner;
+  };
+
+  /// Makes sure that none of the requests issued so far calls onNodeLoaded anymore. Waits for
+  /// callbacks which are currently running.
+  void cancelRequests();
+
+  /// Drops the least recently used retained trees until their number is within the limit. Their
+  /// memory is limited by the RetainBudget.
+  void enforceRetainLimits();
+
   /// Allocates and returns data to be associated with node.
   virtual RenderData* allocateRenderData(TileNode* node) = 0;
 
@@ -167,13 +266,20 @@ class TreeManagerBase : private boost::noncopyable {
   /// removes those considered too "old".
   void prune();
 
-  /// Merge nodes loaded since the last merge into the managed TileQuadTree. It is possible that a
-  /// loaded node can not be inserted into the tree, for example because its parent has been removed
-  /// in the meantime. These "unmerged" nodes are kept around in unmergedNodes_ (see
-  /// TreeManagerBase::storeUnmerged) for a few frames, in case the parent node is loaded in the
-  /// meantime. If this "grace period" has expired and the node still cannot be inserted into the
-  /// tree it is deleted (see TreeManagerBase::mergeUnmerged).
-  void merge();
+  /// Merge nodes loaded since the last merge into the managed TileQuadTree, coarse levels first. It
+  /// is possible that a loaded node can not be inserted into the tree, for example because its
+  /// parent has been removed in the meantime or has been requested at the same time and is still
+  /// being loaded. These "unmerged" nodes are parked in mUnmergedNodes, keyed by the TileId of
+  /// their missing parent, for a few frames, in case the parent node is loaded in the meantime. If
+  /// this "grace period" has expired and the node still cannot be inserted into the tree it is
+  /// deleted. Nodes which are not merged before deadline stay in mMergeNodes for the next call.
+  void merge(std::chrono::steady_clock::time_point deadline);
+
+  /// Inserts all nodes parked in mUnmergedNodes waiting for parent, which has just been inserted.
+  void mergeUnmerged(TileNode* parent);
+
+  /// Writes the tiles used since the last call to mTrace. mAgeStore has to be sorted.
+  void recordTrace();
 
   PlanetParameters const*                 mParams;
   std::shared_ptr<GLResources>            mGlMgr;
@@ -183,11 +289,22 @@ class TreeManagerBase : private boost::noncopyable {
   TileQuadTree mTree;
   TileSource*  mSrc;
 
-  std::unordered_set<TileId> mPendingTiles;
-  std::vector<NodeAge>       mUnmergedNodes;
+  std::unordered_set<TileId>                        mPendingTiles;
+  std::unordered_map<TileId, std::vector<NodeAge>> mUnmergedNodes;
+
+  MPSCQueue<LoadedNode>      mLoadedNodes;
+  std::shared_ptr<LoadToken> mLoadToken;
+
+  /// Nodes taken from mLoadedNodes which have not been merged yet, see merge().
+  std::vector<LoadedNode> mMergeNodes;
+
+  std::list<RetainedTree>       mRetainedTrees;
+  std::size_t                   mMaxRetainedTrees;
+  std::shared_ptr<RetainBudget> mRetainBudget;
+  std::size_t                   mMaxUploadBytes;
 
-  std::mutex             mLoadedMtx;
-  std::vector<TileNode*> mLoadedNodes;
+  std::unique_ptr<TileTrace> mTrace;
+  int                        mTraceFrame;
 
   std::string mName;
   int         mFrameCount;
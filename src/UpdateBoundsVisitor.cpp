@@ -40,6 +40,12 @@ bool UpdateBoundsVisitor::preVisitRoot(TileId const& tileId) {
 
     rdDEM->setBounds(calcTileBounds(
         *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+    rdDEM->setOrientedBounds(calcOrientedTileBounds(
+        *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+    rdDEM->setGeometricError(calcGeometricError(
+        *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+    rdDEM->setOccluders(calcTileOccluders(
+        *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
 
     result = true;
   }
@@ -56,6 +62,12 @@ bool UpdateBoundsVisitor::preVisit(TileId const& tileId) {
 
   rdDEM->setBounds(calcTileBounds(
       *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+  rdDEM->setOrientedBounds(calcOrientedTileBounds(
+      *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+  rdDEM->setGeometricError(calcGeometricError(
+      *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+  rdDEM->setOccluders(calcTileOccluders(
+      *tile, mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
 
   return true;
 }
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "UploadQueue.hpp"
+
+#include "HEALPix.hpp"
+#include "RenderData.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadQueue::push(RenderData* rdata, int slot) {
+  assert(mIndex.count(rdata) == 0);
+
+  mIndex[rdata] = mEntries.size();
+  mEntries.push_back(Entry{Upload{rdata, slot}, TileId(), rdata->getLastFrame()});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadQueue::Upload UploadQueue::remove(RenderData* rdata) {
+  auto it = mIndex.find(rdata);
+
+  if (it == mIndex.end()) {
+    return Upload{nullptr, -1};
+  }
+
+  // avoid erasing an element in the middle of mEntries, just invalidate it
+  Upload& upload = mEntries.at(it->second).mUpload;
+  Upload  result = upload;
+  upload         = Upload{nullptr, -1};
+  mIndex.erase(it);
+  skipRemoved();
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadQueue::prioritize() {
+  mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                     [](Entry const& entry) { return entry.mUpload.mRdata == nullptr; }),
+      mEntries.end());
+
+  // A group is as important as its most recently used tile. Root tiles form groups of their own.
+  std::unordered_map<TileId, int> groupFrames;
+
+  for (auto& entry : mEntries) {
+    TileId const& tileId = entry.mUpload.mRdata->getTileId();
+    entry.mGroup         = tileId.level() > 0 ? HEALPix::getParentTileId(tileId) : tileId;
+
+    int const lastFrame = entry.mUpload.mRdata->getLastFrame();
+    int&      frame     = groupFrames.emplace(entry.mGroup, lastFrame).first->second;
+    frame               = std::max(frame, lastFrame);
+  }
+
+  // Sort the least important entries to the front: older groups, then finer levels. Siblings have
+  // the same frame and level, ties are broken by the group to keep siblings together.
+  for (auto& entry : mEntries) {
+    entry.mFrame = groupFrames.at(entry.mGroup);
+  }
+
+  auto key = [](Entry const& entry) {
+    TileId const& tileId = entry.mUpload.mRdata->getTileId();
+    return std::make_tuple(
+        entry.mFrame, -tileId.level(), entry.mGroup.patchIdx(), tileId.patchIdx());
+  };
+
+  std::sort(mEntries.begin(), mEntries.end(),
+      [&key](Entry const& lhs, Entry const& rhs) { return key(lhs) < key(rhs); });
+
+  for (std::size_t i = 0; i < mEntries.size(); ++i) {
+    mIndex[mEntries[i].mUpload.mRdata] = i;
+  }
+
+  mHasLastGroup = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool UploadQueue::continuesGroup() const {
+  return mHasLastGroup && !mEntries.empty() && mEntries.back().mGroup == mLastGroup;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadQueue::Upload UploadQueue::pop() {
+  assert(!mEntries.empty());
+
+  Entry const entry = mEntries.back();
+  mEntries.pop_back();
+  mIndex.erase(entry.mUpload.mRdata);
+
+  mLastGroup    = entry.mGroup;
+  mHasLastGroup = true;
+  skipRemoved();
+
+  return entry.mUpload;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadQueue::Upload const& UploadQueue::peek() const {
+  assert(!mEntries.empty());
+  return mEntries.back().mUpload;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int UploadQueue::peekFrame() const {
+  assert(!mEntries.empty());
+  return mEntries.back().mFrame;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool UploadQueue::empty() const {
+  return mIndex.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t UploadQueue::size() const {
+  return mIndex.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadQueue::takeSlots(std::vector<int>& slots) {
+  for (auto& entry : mEntries) {
+    if (entry.mUpload.mRdata && entry.mUpload.mSlot >= 0) {
+      slots.push_back(entry.mUpload.mSlot);
+      entry.mUpload.mSlot = -1;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadQueue::skipRemoved() {
+  while (!mEntries.empty() && mEntries.back().mUpload.mRdata == nullptr) {
+    mEntries.pop_back();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_UPLOADQUEUE_HPP
+#define CSP_LOD_BODIES_UPLOADQUEUE_HPP
+
+#include "TileId.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::lodbodies {
+
+class RenderData;
+
+/// The tiles waiting to be uploaded to the GPU by a TileTextureArray, ordered by their importance
+/// for the current view.
+///
+/// Tiles are grouped with their siblings, since LODVisitor only refines a tile once all four of its
+/// children are on the GPU. prioritize() orders the groups so that those used most recently come
+/// first and among those the coarser levels, which cover more of the screen. The tiles of a group
+/// are adjacent in the queue and continuesGroup() tells whether the next tile belongs to the same
+/// group as the previous one, so that the caller can complete a group before its budget stops the
+/// uploads.
+///
+/// Removing a tile is O(1), it merely invalidates its entry which is skipped later on. Tiles pushed
+/// while the queue is being emptied are taken first, so they should be pushed after taking the
+/// tiles for the current frame.
+class UploadQueue {
+ public:
+  /// A request to upload the tile of mRdata, from the given slot of the staging ring if it is not
+  /// -1 (see TileTextureArray::stage).
+  struct Upload {
+    RenderData* mRdata;
+    int         mSlot;
+  };
+
+  /// Appends the tile of rdata. It must not be in the queue already.
+  void push(RenderData* rdata, int slot);
+
+  /// Removes the tile of rdata and returns its upload, mRdata is nullptr if it has not been queued.
+  Upload remove(RenderData* rdata);
+
+  /// Orders the queue by the importance of the tiles, based on their level and the frame they have
+  /// been used last. This must be called before taking tiles from the queue.
+  void prioritize();
+
+  /// Returns whether the next tile belongs to the same group of siblings as the last one returned
+  /// by pop(). Returns false if the queue is empty or nothing has been popped since prioritize().
+  bool continuesGroup() const;
+
+  /// Removes the most important tile from the queue and returns it. The queue must not be empty.
+  Upload pop();
+
+  /// Returns the most important tile without removing it. The queue must not be empty.
+  Upload const& peek() const;
+
+  /// Returns the frame the group of the most important tile has been used last, as determined by
+  /// the last call to prioritize(). The queue must not be empty.
+  int peekFrame() const;
+
+  /// Returns whether the queue contains any tiles.
+  bool empty() const;
+
+  /// Returns the number of tiles in the queue.
+  std::size_t size() const;
+
+  /// Appends the staging slots of all queued tiles to slots, the tiles are uploaded from their own
+  /// memory instead. Their order is not changed.
+  void takeSlots(std::vector<int>& slots);
+
+ private:
+  struct Entry {
+    Upload mUpload;
+    TileId mGroup;
+    int    mFrame;
+  };
+
+  /// Drops invalidated entries from the back of mEntries, so that the entry at the back is always
+  /// valid.
+  void skipRemoved();
+
+  // The most important entry is at the back.
+  std::vector<Entry>                           mEntries;
+  std::unordered_map<RenderData*, std::size_t> mIndex;
+  TileId                                       mLastGroup;
+  bool                                         mHasLastGroup{};
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_UPLOADQUEUE_HPP
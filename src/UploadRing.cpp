@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "UploadRing.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadRing::UploadRing(
+    std::unique_ptr<FenceApi> fences, void* memory, std::size_t slotBytes, int numSlots)
+    : mFences(std::move(fences))
+    , mMemory(static_cast<char*>(memory))
+    , mSlotBytes(slotBytes)
+    , mNumSlots(numSlots) {
+  // Hand out the slots in order of their offset, that is from the back of mFreeSlots.
+  mFreeSlots.reserve(numSlots);
+
+  for (int i = 0; i < numSlots; ++i) {
+    mFreeSlots.push_back(numSlots - i - 1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadRing::~UploadRing() {
+  for (auto const& batch : mBatches) {
+    mFences->deleteFence(batch.mFence);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int UploadRing::acquire() {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mFreeSlots.empty()) {
+    return -1;
+  }
+
+  int const slot = mFreeSlots.back();
+  mFreeSlots.pop_back();
+
+  return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadRing::release(int slot) {
+  assert(slot >= 0 && slot < mNumSlots);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mFreeSlots.push_back(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int UploadRing::getNumFree() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return static_cast<int>(mFreeSlots.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* UploadRing::getData(int slot) const {
+  assert(slot >= 0 && slot < mNumSlots);
+  return mMemory + getOffset(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t UploadRing::getOffset(int slot) const {
+  return static_cast<std::size_t>(slot) * mSlotBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::uint64_t UploadRing::submit(std::vector<int> const& slots) {
+  mBatches.push_back(Batch{mNextBatch, mFences->insertFence(), slots});
+  return mNextBatch++;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadRing::retire() {
+  // The GPU executes the uploads in order, so a batch can not complete before its predecessors.
+  while (!mBatches.empty() && mFences->testFence(mBatches.front().mFence)) {
+    Batch& batch = mBatches.front();
+    mFences->deleteFence(batch.mFence);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mFreeSlots.insert(mFreeSlots.end(), batch.mSlots.begin(), batch.mSlots.end());
+    }
+
+    mCompleted = batch.mId;
+    mBatches.pop_front();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool UploadRing::isComplete(std::uint64_t batch) const {
+  return batch <= mCompleted;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t UploadRing::getNumInFlight() const {
+  return mBatches.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
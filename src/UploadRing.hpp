@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_UPLOADRING_HPP
+#define CSP_LOD_BODIES_UPLOADRING_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// Manages the slots of a staging buffer through which tiles are uploaded to the GPU, see
+/// TileTextureArray.
+///
+/// The memory of the ring is a persistently mapped pixel buffer object which is divided into slots
+/// of one tile each. Loader threads acquire a slot, copy the tile into it and pass the slot on to
+/// the render thread. The render thread issues the uploads from the slots and submits them as a
+/// batch, which inserts a fence. The slots of a batch are reused and its uploads are considered
+/// complete once retire() finds its fence signaled. If all slots are in use, acquire() fails and
+/// the tile has to be uploaded from its own memory instead.
+///
+/// The ring itself does not call OpenGL, all fence operations go through a FenceApi. Hence it can
+/// be used with plain memory and fake fences, for example in tests.
+///
+/// acquire(), release() and getNumFree() may be called from any thread, all other methods must be
+/// called from the render thread.
+class UploadRing {
+ public:
+  /// The fence operations used by the ring.
+  class FenceApi {
+   public:
+    FenceApi()                      = default;
+    FenceApi(FenceApi const& other) = delete;
+    FenceApi(FenceApi&& other)      = delete;
+
+    FenceApi& operator=(FenceApi const& other) = delete;
+    FenceApi& operator=(FenceApi&& other) = delete;
+
+    virtual ~FenceApi() = default;
+
+    /// Inserts a fence after all commands issued so far and returns a handle to it.
+    virtual void* insertFence() = 0;
+
+    /// Returns whether all commands before the fence have completed, without waiting.
+    virtual bool testFence(void* fence) = 0;
+
+    /// Deletes a fence returned by insertFence.
+    virtual void deleteFence(void* fence) = 0;
+  };
+
+  /// Divides the given memory into numSlots slots of slotBytes each. The memory must stay valid
+  /// while the ring exists.
+  UploadRing(
+      std::unique_ptr<FenceApi> fences, void* memory, std::size_t slotBytes, int numSlots);
+
+  UploadRing(UploadRing const& other) = delete;
+  UploadRing(UploadRing&& other)      = delete;
+
+  UploadRing& operator=(UploadRing const& other) = delete;
+  UploadRing& operator=(UploadRing&& other) = delete;
+
+  /// Deletes the fences of all batches which have not been retired.
+  ~UploadRing();
+
+  /// Returns a free slot or -1 if all slots are in use.
+  int acquire();
+
+  /// Returns a slot acquired with acquire() which is not going to be uploaded.
+  void release(int slot);
+
+  /// Returns the number of slots which are currently free.
+  int getNumFree() const;
+
+  /// Returns the memory of the given slot.
+  void* getData(int slot) const;
+
+  /// Returns the offset of the given slot from the start of the memory of the ring.
+  std::size_t getOffset(int slot) const;
+
+  /// Must be called after the uploads from the given slots have been issued. Inserts a fence and
+  /// returns the id of the new batch, which is greater than all previous ids. The slots stay in use
+  /// until the batch is retired.
+  std::uint64_t submit(std::vector<int> const& slots);
+
+  /// Tests the fences of the submitted batches in order of submission. The slots of each batch
+  /// whose fence is signaled are freed. Stops at the first batch which is still in flight.
+  void retire();
+
+  /// Returns whether the uploads of the batch with the given id have completed.
+  bool isComplete(std::uint64_t batch) const;
+
+  /// Returns the number of batches which have been submitted but not retired.
+  std::size_t getNumInFlight() const;
+
+ private:
+  struct Batch {
+    std::uint64_t    mId;
+    void*            mFence;
+    std::vector<int> mSlots;
+  };
+
+  std::unique_ptr<FenceApi> mFences;
+  char*                     mMemory;
+  std::size_t               mSlotBytes;
+  int                       mNumSlots;
+
+  mutable std::mutex mMutex;
+  std::vector<int>   mFreeSlots;
+
+  std::deque<Batch> mBatches;
+  std::uint64_t     mNextBatch{1};
+  std::uint64_t     mCompleted{0};
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_UPLOADRING_HPP
@@ -0,0 +1,342 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VirtualPageTable.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VirtualPageTable::VirtualPageTable(int physicalPageCount) {
+  setPhysicalPageCount(physicalPageCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualPageTable::setPhysicalPageCount(int physicalPageCount) {
+  for (int tile = 0; tile < static_cast<int>(mTiles.size()); ++tile) {
+    if (mTiles[tile].mValid) {
+      mTiles[tile].mPhysical.fill(-1);
+      markDirty(tile);
+    }
+  }
+
+  mPhysical.assign(physicalPageCount, PhysicalPage{});
+  mFreePhysical.clear();
+
+  // the first pages are handed out first
+  for (int physical = physicalPageCount - 1; physical >= 0; --physical) {
+    mFreePhysical.push_back(physical);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int VirtualPageTable::getPhysicalPageCount() const {
+  return static_cast<int>(mPhysical.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualPageTable::addTile(int tile) {
+  if (tile >= static_cast<int>(mTiles.size())) {
+    mTiles.resize(tile + 1);
+  }
+
+  mTiles[tile]        = Tile{};
+  mTiles[tile].mValid = true;
+  mTiles[tile].mPhysical.fill(-1);
+  markDirty(tile);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualPageTable::removeTile(int tile) {
+  if (!hasTile(tile)) {
+    return;
+  }
+
+  for (int physical : mTiles[tile].mPhysical) {
+    if (physical >= 0) {
+      freePage(physical);
+    }
+  }
+
+  if (mTiles[tile].mParent >= 0) {
+    auto& siblings = mTiles[mTiles[tile].mParent].mChildren;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), tile));
+  }
+
+  for (int child : mTiles[tile].mChildren) {
+    mTiles[child].mParent = -1;
+    markDirty(child);
+  }
+
+  mTiles[tile].mChildren.clear();
+  mTiles[tile].mValid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualPageTable::setParent(int tile, int parent, int childX, int childY) {
+  Tile& t = mTiles.at(tile);
+
+  if (t.mParent >= 0) {
+    auto& siblings = mTiles[t.mParent].mChildren;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), tile));
+  }
+
+  t.mParent = parent;
+  t.mChildX = childX;
+  t.mChildY = childY;
+  mTiles.at(parent).mChildren.push_back(tile);
+
+  markDirty(tile);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::uint32_t VirtualPageTable::encodeFeedback(Page const& page) {
+  return 1U + static_cast<std::uint32_t>(
+                  (page.mTile * sPagesPerSide + page.mY) * sPagesPerSide + page.mX);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<VirtualPageTable::Request> VirtualPageTable::collectRequests(
+    std::uint32_t const* pixels, std::size_t count) {
+  std::unordered_map<std::uint32_t, int> counts;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    if (pixels[i] != 0U) { // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      ++counts[pixels[i]]; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+  }
+
+  std::vector<Request> requests;
+  requests.reserve(counts.size());
+
+  for (auto const& [value, pixelCount] : counts) {
+    auto const index = static_cast<int>(value - 1U);
+    requests.push_back(Request{Page{index / sPagesPerTile, index % sPagesPerSide,
+                                   index / sPagesPerSide % sPagesPerSide},
+        pixelCount});
+  }
+
+  std::sort(requests.begin(), requests.end(), [](Request const& lhs, Request const& rhs) {
+    return lhs.mCount != rhs.mCount ? lhs.mCount > rhs.mCount
+                                    : encodeFeedback(lhs.mPage) < encodeFeedback(rhs.mPage);
+  });
+
+  return requests;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<VirtualPageTable::Upload> VirtualPageTable::update(
+    std::vector<Request> const& requests, std::size_t maxUploads) {
+  ++mGeneration;
+
+  // The requested pages and the pages of the ancestors covering them, with the number of pixels
+  // depending on them and the number of ancestors of their tile.
+  struct Wanted {
+    Page mPage;
+    int  mCount;
+    int  mDepth;
+  };
+
+  std::vector<Wanted>                            wanted;
+  std::unordered_map<std::uint32_t, std::size_t> wantedIndex;
+  std::vector<Page>                              chain;
+
+  for (auto const& request : requests) {
+    if (!hasTile(request.mPage.mTile)) {
+      continue;
+    }
+
+    chain.assign(1, request.mPage);
+
+    while (mTiles[chain.back().mTile].mParent >= 0) {
+      chain.push_back(getParentPage(chain.back()));
+    }
+
+    for (std::size_t i = 0; i < chain.size(); ++i) {
+      auto const depth    = static_cast<int>(chain.size() - 1 - i);
+      auto [it, inserted] = wantedIndex.emplace(encodeFeedback(chain[i]), wanted.size());
+
+      if (inserted) {
+        wanted.push_back(Wanted{chain[i], 0, depth});
+      }
+
+      wanted[it->second].mCount += request.mCount;
+    }
+  }
+
+  std::vector<Wanted const*> missing;
+
+  for (auto const& w : wanted) {
+    Tile const& tile     = mTiles[w.mPage.mTile];
+    int const   physical = tile.mPhysical.at(w.mPage.mY * sPagesPerSide + w.mPage.mX);
+
+    if (physical >= 0) {
+      mPhysical[physical].mLastUsed = mGeneration;
+    } else {
+      missing.push_back(&w);
+    }
+  }
+
+  // coarse pages first, since the finer pages fall back to them
+  std::sort(missing.begin(), missing.end(), [](Wanted const* lhs, Wanted const* rhs) {
+    if (lhs->mDepth != rhs->mDepth) {
+      return lhs->mDepth < rhs->mDepth;
+    }
+
+    return lhs->mCount != rhs->mCount ? lhs->mCount > rhs->mCount
+                                      : encodeFeedback(lhs->mPage) < encodeFeedback(rhs->mPage);
+  });
+
+  // the least recently used pages are evicted first
+  std::vector<int> candidates;
+
+  if (std::min(missing.size(), maxUploads) > mFreePhysical.size()) {
+    for (int physical = 0; physical < static_cast<int>(mPhysical.size()); ++physical) {
+      if (mPhysical[physical].mPage.mTile >= 0 && mPhysical[physical].mLastUsed < mGeneration) {
+        candidates.push_back(physical);
+      }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [this](int lhs, int rhs) {
+      return mPhysical[lhs].mLastUsed < mPhysical[rhs].mLastUsed;
+    });
+  }
+
+  std::vector<Upload> uploads;
+  std::size_t         nextCandidate = 0;
+
+  for (auto const* w : missing) {
+    if (uploads.size() >= maxUploads) {
+      break;
+    }
+
+    if (mFreePhysical.empty()) {
+      if (nextCandidate == candidates.size()) {
+        break;
+      }
+
+      freePage(candidates[nextCandidate++]);
+    }
+
+    int const physical = mFreePhysical.back();
+    mFreePhysical.pop_back();
+
+    mTiles[w->mPage.mTile].mPhysical.at(w->mPage.mY * sPagesPerSide + w->mPage.mX) = physical;
+    mPhysical[physical] = PhysicalPage{w->mPage, mGeneration};
+    markDirty(w->mPage.mTile);
+
+    uploads.push_back(Upload{w->mPage, physical});
+  }
+
+  return uploads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VirtualPageTable::Entry VirtualPageTable::getEntry(Page const& page) const {
+  Page                 current = page;
+  float                scale   = 1.F;
+  std::array<float, 2> offset{0.F, 0.F};
+
+  while (hasTile(current.mTile)) {
+    Tile const& tile     = mTiles[current.mTile];
+    int const   physical = tile.mPhysical.at(current.mY * sPagesPerSide + current.mX);
+
+    if (physical >= 0) {
+      return Entry{physical, scale, offset};
+    }
+
+    if (tile.mParent < 0) {
+      break;
+    }
+
+    // the parent has half the resolution, the page covers a quarter of a page of the parent
+    offset[0] = (offset[0] + static_cast<float>(current.mX % 2 * sPageSize)) * 0.5F;
+    offset[1] = (offset[1] + static_cast<float>(current.mY % 2 * sPageSize)) * 0.5F;
+    scale *= 0.5F;
+    current = getParentPage(current);
+  }
+
+  return Entry{-1, 1.F, {0.F, 0.F}};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> VirtualPageTable::takeDirtyTiles() {
+  std::vector<int> tiles;
+  tiles.reserve(mDirtyTiles.size());
+
+  for (int tile : mDirtyTiles) {
+    if (mTiles[tile].mValid) {
+      tiles.push_back(tile);
+    }
+
+    mTiles[tile].mDirty = false;
+  }
+
+  mDirtyTiles.clear();
+  return tiles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool VirtualPageTable::hasTile(int tile) const {
+  return tile >= 0 && tile < static_cast<int>(mTiles.size()) && mTiles[tile].mValid;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VirtualPageTable::Page VirtualPageTable::getParentPage(Page const& page) const {
+  Tile const& tile = mTiles[page.mTile];
+  int const   half = sPagesPerSide / 2;
+
+  return Page{tile.mParent, tile.mChildX * half + page.mX / 2, tile.mChildY * half + page.mY / 2};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualPageTable::markDirty(int tile) {
+  std::vector<int> stack{tile};
+
+  while (!stack.empty()) {
+    Tile& t = mTiles[stack.back()];
+
+    if (!t.mDirty) {
+      t.mDirty = true;
+      mDirtyTiles.push_back(stack.back());
+    }
+
+    stack.pop_back();
+    stack.insert(stack.end(), t.mChildren.begin(), t.mChildren.end());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualPageTable::freePage(int physical) {
+  Page const& page = mPhysical[physical].mPage;
+
+  mTiles[page.mTile].mPhysical.at(page.mY * sPagesPerSide + page.mX) = -1;
+  markDirty(page.mTile);
+
+  mPhysical[physical] = PhysicalPage{};
+  mFreePhysical.push_back(physical);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_VIRTUALPAGETABLE_HPP
+#define CSP_LOD_BODIES_VIRTUALPAGETABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// The CPU side of the virtual texturing mode of a TileTextureArray. It decides which pages of the
+/// image tiles are kept in a cache of physical pages on the GPU and computes the page table which
+/// maps the pages of each tile to the physical pages.
+///
+/// Each tile is split into sPagesPerSide x sPagesPerSide pages. A page covers sPageSize texel
+/// intervals and stores sPageTexels texels, so that neighbouring pages share their border texels
+/// and can be filtered without seams. Tiles are identified by an index chosen by the caller.
+///
+/// The pages which are actually sampled are determined by a feedback pass, whose pixels are
+/// decoded with collectRequests(). update() then loads the requested pages which are missing,
+/// coarser tiles first, and evicts the least recently requested pages if the cache is full. Each
+/// requested page also requests the pages of the ancestors of its tile covering it, so that a page
+/// which is not loaded yet can fall back to the closest ancestor which is (see getEntry()).
+class VirtualPageTable {
+ public:
+  static int const sPagesPerSide = 4;
+  static int const sPageSize     = 64;
+  static int const sPageTexels   = sPageSize + 1;
+
+  /// A page of a tile, mX and mY are in [0, sPagesPerSide).
+  struct Page {
+    int mTile;
+    int mX;
+    int mY;
+  };
+
+  /// A page and the number of feedback pixels which requested it.
+  struct Request {
+    Page mPage;
+    int  mCount;
+  };
+
+  /// A page which has to be uploaded to the given physical page.
+  struct Upload {
+    Page mPage;
+    int  mPhysical;
+  };
+
+  /// The physical page a page is sampled from, -1 if neither the page nor any of its fallbacks is
+  /// loaded. A texel at position p relative to the page maps to mOffset + p * mScale in the
+  /// physical page, in texels.
+  struct Entry {
+    int                  mPhysical;
+    float                mScale;
+    std::array<float, 2> mOffset;
+  };
+
+  explicit VirtualPageTable(int physicalPageCount);
+
+  /// Changes the size of the cache. All pages are dropped and have to be requested again.
+  void setPhysicalPageCount(int physicalPageCount);
+  int  getPhysicalPageCount() const;
+
+  /// Adds a tile without any pages loaded. The tile must not exist already.
+  void addTile(int tile);
+
+  /// Removes a tile and frees its pages. Its children fall back to nothing.
+  void removeTile(int tile);
+
+  /// Makes parent the fallback of tile. childX and childY select the quadrant of parent covered by
+  /// tile, x and y of the children of a tile grow in the same direction as its pages.
+  void setParent(int tile, int parent, int childX, int childY);
+
+  /// Encodes a page as written by the feedback pass, 0 means that no page has been sampled.
+  static std::uint32_t encodeFeedback(Page const& page);
+
+  /// Decodes the pixels of a feedback pass and returns each requested page once, the pages
+  /// requested by most pixels first.
+  static std::vector<Request> collectRequests(std::uint32_t const* pixels, std::size_t count);
+
+  /// Processes the requests of a frame, requests for tiles which do not exist are ignored. Returns
+  /// at most maxUploads pages which are assigned to a physical page now and have to be uploaded.
+  /// Pages requested in this call are never evicted.
+  std::vector<Upload> update(std::vector<Request> const& requests, std::size_t maxUploads);
+
+  /// Returns the physical page to sample for the given page.
+  Entry getEntry(Page const& page) const;
+
+  /// Returns the tiles whose entries have changed since the last call.
+  std::vector<int> takeDirtyTiles();
+
+ private:
+  static int const sPagesPerTile = sPagesPerSide * sPagesPerSide;
+
+  struct Tile {
+    bool                           mValid{};
+    bool                           mDirty{};
+    int                            mParent{-1};
+    int                            mChildX{};
+    int                            mChildY{};
+    std::array<int, sPagesPerTile> mPhysical{};
+    std::vector<int>               mChildren;
+  };
+
+  struct PhysicalPage {
+    Page mPage{-1, 0, 0};
+    int  mLastUsed{-1};
+  };
+
+  bool hasTile(int tile) const;
+
+  /// Returns the page of the parent of page.mTile which covers page.
+  Page getParentPage(Page const& page) const;
+
+  /// Marks tile and all its descendants as dirty, since their fallbacks may have changed.
+  void markDirty(int tile);
+
+  void freePage(int physical);
+
+  std::vector<Tile>         mTiles;
+  std::vector<PhysicalPage> mPhysical;
+  std::vector<int>          mFreePhysical;
+  std::vector<int>          mDirtyTiles;
+  int                       mGeneration{};
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_VIRTUALPAGETABLE_HPP
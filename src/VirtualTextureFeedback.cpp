@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VirtualTextureFeedback.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace csp::lodbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VirtualTextureFeedback::VirtualTextureFeedback()
+    : mFboId(0U)
+    , mColorId(0U)
+    , mDepthId(0U)
+    , mPboIds{0U, 0U}
+    , mPixelCounts{0, 0}
+    , mNextPbo(0)
+    , mWidth(0)
+    , mHeight(0)
+    , mPrevFboId(0) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VirtualTextureFeedback::~VirtualTextureFeedback() {
+  release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextureFeedback::begin() {
+  std::array<GLint, 4> viewport{};
+  glGetIntegerv(GL_VIEWPORT, viewport.data());
+
+  GLsizei const width  = std::max(1, viewport[2] / sDownscale);
+  GLsizei const height = std::max(1, viewport[3] / sDownscale);
+
+  if (mFboId == 0U || width != mWidth || height != mHeight) {
+    allocate(width, height);
+  }
+
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mPrevFboId);
+  glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, mFboId);
+  glViewport(0, 0, mWidth, mHeight);
+
+  glDisable(GL_BLEND);
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+
+  // 0 means that no page has been sampled
+  std::array<GLuint, 4> const clearColor{0U, 0U, 0U, 0U};
+  GLfloat const               clearDepth = 1.F;
+  glClearBufferuiv(GL_COLOR, 0, clearColor.data());
+  glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextureFeedback::end() {
+  // the read completes asynchronously, the buffer is mapped by collect() in the next frame
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, mPboIds.at(mNextPbo));
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glReadPixels(0, 0, mWidth, mHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0U);
+
+  mPixelCounts.at(mNextPbo) = mWidth * mHeight;
+  mNextPbo                  = 1 - mNextPbo;
+
+  glPopAttrib();
+  glBindFramebuffer(GL_FRAMEBUFFER, mPrevFboId);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<VirtualPageTable::Request> VirtualTextureFeedback::collect() {
+  int const lastPbo = 1 - mNextPbo;
+
+  if (mPixelCounts.at(lastPbo) == 0) {
+    return {};
+  }
+
+  auto const count = static_cast<std::size_t>(mPixelCounts.at(lastPbo));
+  mPixelCounts.at(lastPbo) = 0;
+
+  std::vector<VirtualPageTable::Request> requests;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, mPboIds.at(lastPbo));
+  auto const* pixels = static_cast<std::uint32_t const*>(glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(count * sizeof(GLuint)), GL_MAP_READ_BIT));
+
+  if (pixels) {
+    requests = VirtualPageTable::collectRequests(pixels, count);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0U);
+
+  return requests;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextureFeedback::allocate(int width, int height) {
+  release();
+
+  mWidth  = width;
+  mHeight = height;
+
+  glGenRenderbuffers(1, &mColorId);
+  glBindRenderbuffer(GL_RENDERBUFFER, mColorId);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, mWidth, mHeight);
+
+  glGenRenderbuffers(1, &mDepthId);
+  glBindRenderbuffer(GL_RENDERBUFFER, mDepthId);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mWidth, mHeight);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0U);
+
+  GLint prevFboId = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFboId);
+
+  glGenFramebuffers(1, &mFboId);
+  glBindFramebuffer(GL_FRAMEBUFFER, mFboId);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColorId);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthId);
+  glBindFramebuffer(GL_FRAMEBUFFER, prevFboId);
+
+  glGenBuffers(2, mPboIds.data());
+
+  for (GLuint pboId : mPboIds) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pboId);
+    glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(mWidth * mHeight * sizeof(GLuint)),
+        nullptr, GL_STREAM_READ);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VirtualTextureFeedback::release() {
+  if (mFboId == 0U) {
+    return;
+  }
+
+  glDeleteFramebuffers(1, &mFboId);
+  glDeleteRenderbuffers(1, &mColorId);
+  glDeleteRenderbuffers(1, &mDepthId);
+  glDeleteBuffers(2, mPboIds.data());
+
+  mFboId       = 0U;
+  mColorId     = 0U;
+  mDepthId     = 0U;
+  mPboIds      = {0U, 0U};
+  mPixelCounts = {0, 0};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::lodbodies
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_VIRTUALTEXTUREFEEDBACK_HPP
+#define CSP_LOD_BODIES_VIRTUALTEXTUREFEEDBACK_HPP
+
+#include "VirtualPageTable.hpp"
+
+#include <GL/glew.h>
+#include <array>
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+namespace csp::lodbodies {
+
+/// The framebuffer of the feedback pass of the virtual texturing mode. The TileRenderer draws the
+/// tiles into it with a shader which writes the page of the image data each pixel samples (see
+/// VirtualPageTable::encodeFeedback()).
+///
+/// The framebuffer has a fraction of the resolution of the viewport, as a page covers many pixels.
+/// Its content is read into one of two pixel buffer objects without waiting for the GPU and decoded
+/// by collect() in the next frame.
+class VirtualTextureFeedback : private boost::noncopyable {
+ public:
+  /// The size of the framebuffer is the size of the viewport divided by this.
+  static int const sDownscale = 8;
+
+  VirtualTextureFeedback();
+
+  VirtualTextureFeedback(VirtualTextureFeedback const& other) = delete;
+  VirtualTextureFeedback(VirtualTextureFeedback&& other)      = delete;
+
+  VirtualTextureFeedback& operator=(VirtualTextureFeedback const& other) = delete;
+  VirtualTextureFeedback& operator=(VirtualTextureFeedback&& other) = delete;
+
+  ~VirtualTextureFeedback();
+
+  /// Binds and clears the framebuffer, its size follows the current viewport. The depth test is
+  /// enabled until end() is called.
+  void begin();
+
+  /// Starts reading the framebuffer and restores the previous framebuffer and OpenGL state.
+  void end();
+
+  /// Returns the pages requested by the pixels read by the last call to end(). Each read is only
+  /// returned once.
+  std::vector<VirtualPageTable::Request> collect();
+
+ private:
+  void allocate(int width, int height);
+  void release();
+
+  GLuint                mFboId;
+  GLuint                mColorId;
+  GLuint                mDepthId;
+  std::array<GLuint, 2> mPboIds;
+
+  // the number of pixels which have been read into each of the pixel buffer objects
+  std::array<GLsizei, 2> mPixelCounts;
+  int                    mNextPbo;
+
+  GLsizei mWidth;
+  GLsizei mHeight;
+  GLint   mPrevFboId;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_VIRTUALTEXTUREFEEDBACK_HPP
@@ -34,6 +34,7 @@ VistaPlanet::VistaPlanet(std::shared_ptr<GLResources> const& glResources)
     , mTreeMgrDEM(mParams, glResources)
     , mSrcIMG(nullptr)
     , mTreeMgrIMG(mParams, glResources)
+    , mNumTriangles(0)
     , mLastFrameClock(GetVistaSystem()->GetFrameClock())
     , mSumFrameClock(0.0)
     , mSumDrawTiles(0)
@@ -70,13 +71,16 @@ VistaPlanet::~VistaPlanet() {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /* virtual */ void VistaPlanet::doShadows() {
-  mLodVisitor.visit();
-
-  // get matrices and viewport
+  // get matrices and viewport of the current shadow cascade
   int          frameCount = GetVistaSystem()->GetFrameLoop()->GetFrameCount();
   glm::dmat4   matVM      = getModelviewMatrix();
   glm::fmat4x4 matP       = getProjectionMatrix();
-  renderTiles(frameCount, matVM, matP, nullptr);
+  glm::ivec4   viewport   = getViewport();
+
+  // the tiles of the last traversal are reused, culled against the light frustum and coarsened to
+  // the resolution of the cascade
+  mLodVisitor.selectShadowTiles(matVM, matP, viewport);
+  renderTiles(frameCount, matVM, matP, mLodVisitor.getShadowDEM(), {}, nullptr);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -159,6 +163,9 @@ void VistaPlanet::setDEMSource(TileSource* srcDEM) {
     mTreeMgrDEM.setSource(mSrcDEM);
     mLodVisitor.setTreeManagerDEM(&mTreeMgrDEM);
     mRenderer.setTreeManagerDEM(&mTreeMgrDEM);
+
+    // a restored tree may have been built with different radii or height scale
+    mFlags |= sFlagTileBoundsInvalid;
   }
 }
 
@@ -205,6 +212,41 @@ TileSource* VistaPlanet::getIMGSource() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void VistaPlanet::setMaxRetainedSources(std::size_t count) {
+  mTreeMgrDEM.setMaxRetainedTrees(count);
+  mTreeMgrIMG.setMaxRetainedTrees(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VistaPlanet::setRetainBudget(std::shared_ptr<RetainBudget> const& budget) {
+  mTreeMgrDEM.setRetainBudget(budget);
+  mTreeMgrIMG.setRetainBudget(budget);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VistaPlanet::setMaxUploadBytes(std::size_t bytes) {
+  mTreeMgrDEM.setMaxUploadBytes(bytes);
+  mTreeMgrIMG.setMaxUploadBytes(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VistaPlanet::setTraceFiles(std::string const& prefix) {
+  mTreeMgrDEM.setTraceFile(prefix.empty() ? "" : prefix + "-dem.trace");
+  mTreeMgrIMG.setTraceFile(prefix.empty() ? "" : prefix + "-img.trace");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void VistaPlanet::dropRetainedSource(TileSource const* src) {
+  mTreeMgrDEM.dropRetainedTree(src);
+  mTreeMgrIMG.dropRetainedTree(src);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 // The funciton that drives all operations that need to be done each frame.
 // It simply calls the other functions in this section in order and passes
 // a few shared values between them (e.g. the matrices for the current view).
@@ -219,20 +261,36 @@ void VistaPlanet::doFrame() {
   // collect/print statistics
   updateStatistics(frameCount);
 
+  // the time left for merging and uploading tiles is determined from the
+  // durations of the other stages in previous frames
+  mFrameBudget.beginFrame();
+
   // update bounding boxes
   updateTileBounds();
+  mFrameBudget.endStage(FrameBudget::Stage::eBounds);
 
   // integrate newly loaded tiles/remove unused tiles
-  updateTileTrees(frameCount);
+  updateTileTrees(frameCount, mFrameBudget.getDeadline());
+  mFrameBudget.endStage(FrameBudget::Stage::eUpdate);
 
   // determine tiles to draw and load
   traverseTileTrees(frameCount, matVM, matP, viewport);
+  mFrameBudget.endStage(FrameBudget::Stage::eTraverse);
 
   // pass requests to load tiles to TreeManagers
   processLoadRequests();
+  mFrameBudget.endStage(FrameBudget::Stage::eRequest);
 
-  // render
-  renderTiles(frameCount, matVM, matP, mShadowMap);
+  // render, the pages needed in the virtual texturing mode are determined first
+  mRenderer.setModelview(matVM);
+  mRenderer.setProjection(matP);
+  mRenderer.renderFeedback(mLodVisitor.getRenderDEM(), mLodVisitor.getRenderIMG());
+  renderTiles(frameCount, matVM, matP, mLodVisitor.getRenderDEM(), mLodVisitor.getRenderIMG(),
+      mShadowMap);
+  mFrameBudget.endStage(FrameBudget::Stage::eRender);
+
+  // the shadow passes render the tiles as well, only the main pass is counted
+  mNumTriangles = mRenderer.getNumTriangles();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -269,6 +327,13 @@ void VistaPlanet::updateStatistics(int frameCount) {
     }
 
     vstr::out() << std::endl;
+
+    vstr::outi() << "[VistaPlanet::Do] avg. ms bounds/update/traverse/request/render ["
+                 << mFrameBudget.getStageTime(FrameBudget::Stage::eBounds) << " / "
+                 << mFrameBudget.getStageTime(FrameBudget::Stage::eUpdate) << " / "
+                 << mFrameBudget.getStageTime(FrameBudget::Stage::eTraverse) << " / "
+                 << mFrameBudget.getStageTime(FrameBudget::Stage::eRequest) << " / "
+                 << mFrameBudget.getStageTime(FrameBudget::Stage::eRender) << "]" << std::endl;
 #endif
 
     mSumFrameClock = 0.0;
@@ -285,23 +350,26 @@ void VistaPlanet::updateTileBounds() {
     UpdateBoundsVisitor ubVisitor(&mTreeMgrDEM, mParams);
     ubVisitor.visit();
 
+    // The occluders of the last frame have been computed with the old bounds.
+    mLodVisitor.clearOccluders();
+
     mFlags &= ~sFlagTileBoundsInvalid;
   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void VistaPlanet::updateTileTrees(int frameCount) {
+void VistaPlanet::updateTileTrees(int frameCount, FrameBudget::Clock::time_point deadline) {
   // update DEM tree
   if (mSrcDEM) {
     mTreeMgrDEM.setFrameCount(frameCount);
-    mTreeMgrDEM.update();
+    mTreeMgrDEM.update(deadline);
   }
 
   // update IMG tree
   if (mSrcIMG) {
     mTreeMgrIMG.setFrameCount(frameCount);
-    mTreeMgrIMG.update();
+    mTreeMgrIMG.update(deadline);
   }
 }
 
@@ -335,12 +403,13 @@ void VistaPlanet::processLoadRequests() {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void VistaPlanet::renderTiles(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
+    std::vector<RenderData*> const& renderDEM, std::vector<RenderData*> const& renderIMG,
     cs::graphics::ShadowMap* shadowMap) {
   // update per-frame information of TileRenderer
   mRenderer.setFrameCount(frameCount);
   mRenderer.setModelview(matVM);
   mRenderer.setProjection(matP);
-  mRenderer.render(mLodVisitor.getRenderDEM(), mLodVisitor.getRenderIMG(), shadowMap);
+  mRenderer.render(renderDEM, renderIMG, shadowMap);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -456,6 +525,24 @@ int VistaPlanet::getMinLevel() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void VistaPlanet::setFrameBudget(double milliseconds) {
+  mFrameBudget.setBudget(milliseconds);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double VistaPlanet::getFrameBudget() const {
+  return mFrameBudget.getBudget();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::size_t VistaPlanet::getNumTriangles() const {
+  return mNumTriangles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 TileRenderer& VistaPlanet::getTileRenderer() {
   return mRenderer;
 }
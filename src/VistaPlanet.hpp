@@ -7,6 +7,7 @@
 #ifndef CSP_LOD_BODIES_VISTAPLANET_HPP
 #define CSP_LOD_BODIES_VISTAPLANET_HPP
 
+#include "FrameBudget.hpp"
 #include "LODVisitor.hpp"
 #include "PlanetParameters.hpp"
 #include "TileRenderer.hpp"
@@ -85,6 +86,27 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   /// Returns the currently active source for image data.
   TileSource* getIMGSource() const;
 
+  /// Sets how many trees of previously used sources are kept in memory per channel, see
+  /// TreeManagerBase::setMaxRetainedTrees. Switching back to such a source does not require
+  /// reloading its tiles.
+  void setMaxRetainedSources(std::size_t count);
+
+  /// Sets the budget which limits the memory of the retained trees of both channels together with
+  /// those of other planets sharing it, see TreeManagerBase::setRetainBudget.
+  void setRetainBudget(std::shared_ptr<RetainBudget> const& budget);
+
+  /// Sets the amount of tile data in bytes uploaded to the GPU per frame and channel, see
+  /// TreeManagerBase::setMaxUploadBytes.
+  void setMaxUploadBytes(std::size_t bytes);
+
+  /// Records the tiles used in each frame to prefix + "-dem.trace" and prefix + "-img.trace", see
+  /// TreeManagerBase::setTraceFile. An empty prefix stops the recording.
+  void setTraceFiles(std::string const& prefix);
+
+  /// Drops the tree retained for src. This must be called before a source which was previously
+  /// passed to setDEMSource or setIMGSource is destroyed.
+  void dropRetainedSource(TileSource const* src);
+
   /// Set planet equatorial radius. This is a potentially expensive operation since it invalidates
   /// the cached bounding volume for all tiles and requires recalculating them.
   void   setEquatorialRadius(float radius);
@@ -106,6 +128,15 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   void setMinLevel(int minLevel);
   int  getMinLevel() const;
 
+  /// Sets the time in milliseconds this planet should take per frame. The duration of each stage
+  /// of a frame is measured and, if a burst of loaded tiles would exceed the budget, merging and
+  /// uploading them is spread across several frames. Zero (the default) disables the limit.
+  void   setFrameBudget(double milliseconds);
+  double getFrameBudget() const;
+
+  /// Returns the number of triangles drawn in the last frame.
+  std::size_t getNumTriangles() const;
+
   /// Returns the TileRenderer instance used to render this VistaPlanet.
   TileRenderer&       getTileRenderer();
   TileRenderer const& getTileRenderer() const;
@@ -118,11 +149,12 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   void doFrame();
   void updateStatistics(int frameCount);
   void updateTileBounds();
-  void updateTileTrees(int frameCount);
+  void updateTileTrees(int frameCount, FrameBudget::Clock::time_point deadline);
   void traverseTileTrees(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
       glm::ivec4 const& viewport);
   void processLoadRequests();
   void renderTiles(int frameCount, glm::dmat4 const& matVM, glm::fmat4x4 const& matP,
+      std::vector<RenderData*> const& renderDEM, std::vector<RenderData*> const& renderIMG,
       cs::graphics::ShadowMap* shadowMap);
 
   glm::dmat4        getModelviewMatrix() const;
@@ -144,6 +176,9 @@ class VistaPlanet : public IVistaOpenGLDraw, public cs::graphics::ShadowCaster {
   TileSource*                mSrcIMG;
   TreeManager<RenderDataImg> mTreeMgrIMG;
 
+  FrameBudget mFrameBudget;
+  std::size_t mNumTriangles;
+
   // global statistics
   double      mLastFrameClock;
   double      mSumFrameClock;
@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/Culling.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+std::array<glm::dvec3, 8> getCorners(BoundingBox<double> const& box) {
+  glm::dvec3 const& tbMin = box.getMin();
+  glm::dvec3 const& tbMax = box.getMax();
+
+  return {{glm::dvec3(tbMin.x, tbMin.y, tbMin.z), glm::dvec3(tbMax.x, tbMin.y, tbMin.z),
+      glm::dvec3(tbMax.x, tbMin.y, tbMax.z), glm::dvec3(tbMin.x, tbMin.y, tbMax.z),
+      glm::dvec3(tbMin.x, tbMax.y, tbMin.z), glm::dvec3(tbMax.x, tbMax.y, tbMin.z),
+      glm::dvec3(tbMax.x, tbMax.y, tbMax.z), glm::dvec3(tbMin.x, tbMax.y, tbMax.z)}};
+}
+
+std::array<glm::dvec3, 8> getCorners(OrientedTileBounds const& box) {
+  std::array<glm::dvec3, 8> result;
+
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    result.at(i) = box.mCenter + ((i & 1U) ? 1.0 : -1.0) * box.mHalfAxes[0] +
+                   ((i & 2U) ? 1.0 : -1.0) * box.mHalfAxes[1] +
+                   ((i & 4U) ? 1.0 : -1.0) * box.mHalfAxes[2];
+  }
+
+  return result;
+}
+
+// Straightforward implementation testing all eight corners against all planes.
+bool referenceInFrustum(Frustum const& frustum, std::array<glm::dvec3, 8> const& corners) {
+  for (auto const& plane : frustum.getPlanes()) {
+    glm::dvec3 const normal(plane.x, plane.y, plane.z);
+    bool             outside = true;
+
+    for (auto const& corner : corners) {
+      if (glm::dot(normal, corner) >= -plane.w) {
+        outside = false;
+        break;
+      }
+    }
+
+    if (outside) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Straightforward implementation of one ray-sphere intersection per corner.
+bool referenceAboveHorizon(
+    glm::dvec3 const& camPos, double radius, std::array<glm::dvec3, 8> const& corners) {
+  for (auto const& corner : corners) {
+    double     rayLength = glm::length(corner - camPos);
+    glm::dvec3 rayDir    = (corner - camPos) / rayLength;
+    double     b         = glm::dot(camPos, rayDir);
+    double     c         = glm::dot(camPos, camPos) - radius * radius;
+    double     det       = b * b - c;
+
+    if (det < 0.0) {
+      return true;
+    }
+
+    det = std::sqrt(det);
+
+    if ((-b - det) < 0.0 && (-b + det) < 0.0) {
+      return true;
+    }
+
+    if (rayLength < -b - det) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Random boxes with an extent of up to 0.2 close to the surface of the unit sphere, similar to
+// tiles of a planet with a radius of one.
+BoundingBox<double> randomBox(std::mt19937& rng) {
+  std::uniform_real_distribution<double> coord(-1.0, 1.0);
+  std::uniform_real_distribution<double> radius(0.9, 1.1);
+  std::uniform_real_distribution<double> extent(0.0, 0.2);
+
+  glm::dvec3 const bbMin =
+      radius(rng) * glm::normalize(glm::dvec3(coord(rng), coord(rng), coord(rng)) +
+                                   glm::dvec3(0.0, 0.0, 0.01));
+  glm::dvec3 const bbMax(bbMin.x + extent(rng), bbMin.y + extent(rng), bbMin.z + extent(rng));
+
+  return BoundingBox<double>(bbMin, bbMax);
+}
+
+// Random oriented boxes close to the surface of the unit sphere with an extent of up to 0.2 and a
+// random normal cone with a half angle of up to 60 degrees around the direction of the center.
+OrientedTileBounds randomOrientedBox(std::mt19937& rng) {
+  std::uniform_real_distribution<double> coord(-1.0, 1.0);
+  std::uniform_real_distribution<double> radius(0.9, 1.1);
+  std::uniform_real_distribution<double> extent(0.0, 0.1);
+  std::uniform_real_distribution<double> angle(0.0, glm::radians(60.0));
+
+  glm::dvec3 const up = glm::normalize(glm::dvec3(coord(rng), coord(rng), coord(rng)) +
+                                       glm::dvec3(0.0, 0.0, 0.01));
+  glm::dvec3 const right =
+      glm::normalize(glm::cross(up, glm::dvec3(coord(rng), coord(rng), coord(rng))));
+  double const coneAngle = angle(rng);
+
+  OrientedTileBounds result;
+  result.mCenter      = radius(rng) * up;
+  result.mHalfAxes[0] = extent(rng) * right;
+  result.mHalfAxes[1] = extent(rng) * glm::cross(up, right);
+  result.mHalfAxes[2] = extent(rng) * up;
+  result.mConeAxis    = up;
+  result.mConeSin     = std::sin(coneAngle);
+  result.mConeCos     = std::cos(coneAngle);
+
+  return result;
+}
+
+// A frustum with random planes, the tests do not rely on the planes enclosing a volume.
+Frustum randomFrustum(std::mt19937& rng) {
+  std::uniform_real_distribution<double> coord(-1.0, 1.0);
+
+  Frustum frustum;
+
+  for (std::size_t i = 0; i < Frustum::NUM_PLANES; ++i) {
+    glm::dvec3 const normal =
+        glm::normalize(glm::dvec3(coord(rng), coord(rng), coord(rng)) + glm::dvec3(0.0, 0.0, 0.1));
+    frustum.setPlane(static_cast<FrustumPlaneIdx>(i), glm::dvec4(normal, 0.5 * coord(rng)));
+  }
+
+  return frustum;
+}
+
+glm::dvec3 randomCamera(std::mt19937& rng) {
+  std::uniform_real_distribution<double> coord(-1.0, 1.0);
+  std::uniform_real_distribution<double> distance(0.95, 3.0);
+
+  return distance(rng) *
+         glm::normalize(glm::dvec3(coord(rng), coord(rng), coord(rng)) + glm::dvec3(0.0, 0.1, 0.0));
+}
+
+// A symmetric frustum with the given half opening angle for a camera on the positive z-axis at the
+// given distance, looking at the origin.
+Frustum viewFrustum(double distance, double halfAngle) {
+  double const cosA = std::cos(halfAngle);
+  double const sinA = std::sin(halfAngle);
+
+  Frustum frustum;
+  frustum.setPlane(FrustumPlaneIdx::eLeft, glm::dvec4(cosA, 0.0, -sinA, sinA * distance));
+  frustum.setPlane(FrustumPlaneIdx::eRight, glm::dvec4(-cosA, 0.0, -sinA, sinA * distance));
+  frustum.setPlane(FrustumPlaneIdx::eBottom, glm::dvec4(0.0, cosA, -sinA, sinA * distance));
+  frustum.setPlane(FrustumPlaneIdx::eTop, glm::dvec4(0.0, -cosA, -sinA, sinA * distance));
+  frustum.setPlane(FrustumPlaneIdx::eNear, glm::dvec4(0.0, 0.0, -1.0, distance - 0.01));
+  frustum.setPlane(FrustumPlaneIdx::eFar, glm::dvec4(0.0, 0.0, 1.0, 10.0 - distance));
+
+  return frustum;
+}
+
+// The boxes for the benchmarks, seen from the same view as in the LODVisitor tests. Like the
+// children of a tile, the four boxes of each batch are the quadrants of a parent box. The oriented
+// bounds are the same boxes, so all tests find the same number of visible boxes.
+struct BenchmarkBoxes {
+  explicit BenchmarkBoxes(int numBatches)
+      : mFrustum(viewFrustum(1.5, glm::radians(30.0)))
+      , mCamPos(0.0, 0.0, 1.5)
+      , mBatches(numBatches)
+      , mOrientedBatches(numBatches) {
+    std::mt19937 rng(42);
+
+    for (int i = 0; i < numBatches; ++i) {
+      BoundingBox<double> const parent = randomBox(rng);
+      glm::dvec3 const&         pMin   = parent.getMin();
+      glm::dvec3 const&         pMax   = parent.getMax();
+      glm::dvec3 const          pMid   = 0.5 * (pMin + pMax);
+
+      for (int j = 0; j < BoxBatch::sSize; ++j) {
+        glm::dvec3 const bbMin((j & 1) ? pMid.x : pMin.x, (j & 2) ? pMid.y : pMin.y, pMin.z);
+        glm::dvec3 const bbMax((j & 1) ? pMax.x : pMid.x, (j & 2) ? pMax.y : pMid.y, pMax.z);
+
+        OrientedTileBounds oriented;
+        oriented.mCenter      = 0.5 * (bbMin + bbMax);
+        oriented.mHalfAxes[0] = glm::dvec3(0.5 * (bbMax.x - bbMin.x), 0.0, 0.0);
+        oriented.mHalfAxes[1] = glm::dvec3(0.0, 0.5 * (bbMax.y - bbMin.y), 0.0);
+        oriented.mHalfAxes[2] = glm::dvec3(0.0, 0.0, 0.5 * (bbMax.z - bbMin.z));
+
+        mBoxes.emplace_back(bbMin, bbMax);
+        mOrientedBoxes.push_back(oriented);
+        mBatches[i].set(j, mBoxes.back());
+        mOrientedBatches[i].set(j, oriented);
+      }
+    }
+  }
+
+  Frustum                         mFrustum;
+  glm::dvec3                      mCamPos;
+  std::vector<BoundingBox<double>> mBoxes;
+  std::vector<OrientedTileBounds>  mOrientedBoxes;
+  std::vector<BoxBatch>            mBatches;
+  std::vector<OrientedBoxBatch>    mOrientedBatches;
+};
+
+struct CullingThroughput {
+  double      mTilesPerSecond;
+  std::size_t mVisible;
+};
+
+// Runs test numRounds times, test returns the number of visible boxes.
+template <typename Test>
+CullingThroughput measureCulling(std::string const& name, BenchmarkBoxes const& boxes,
+    int numRounds, Test const& test, bool print = true) {
+  std::size_t numVisible = 0;
+  auto        start      = std::chrono::high_resolution_clock::now();
+
+  for (int round = 0; round < numRounds; ++round) {
+    numVisible += test();
+  }
+
+  auto   end     = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  CullingThroughput const result{
+      static_cast<double>(boxes.mBoxes.size() * numRounds) / seconds, numVisible / numRounds};
+
+  if (print) {
+    MESSAGE(name << ": " << result.mTilesPerSecond / 1e6 << " million tiles per second ("
+            << result.mVisible << " visible)");
+  }
+
+  return result;
+}
+
+template <typename Box>
+std::size_t countScalar(BenchmarkBoxes const& boxes, std::vector<Box> const& boxList) {
+  std::size_t visible = 0;
+  for (auto const& box : boxList) {
+    visible += testInFrustum(boxes.mFrustum, box) && testAboveHorizon(boxes.mCamPos, 1.0, box);
+  }
+  return visible;
+}
+
+template <typename Batch>
+std::size_t countBatched(BenchmarkBoxes const& boxes, std::vector<Batch> const& batches) {
+  std::size_t visible   = 0;
+  int         planeHint = 0;
+  for (auto const& batch : batches) {
+    unsigned mask = testInFrustum(boxes.mFrustum, batch, 0xFU, planeHint);
+    mask          = testAboveHorizon(boxes.mCamPos, 1.0, batch, mask);
+    for (int j = 0; j < Batch::sSize; ++j) {
+      visible += (mask >> static_cast<unsigned>(j)) & 1U;
+    }
+  }
+  return visible;
+}
+
+CullingThroughput measureScalar(
+    BenchmarkBoxes const& boxes, bool oriented, int numRounds, bool print = true) {
+  if (oriented) {
+    return measureCulling("scalar (oriented)", boxes, numRounds,
+        [&]() { return countScalar(boxes, boxes.mOrientedBoxes); }, print);
+  }
+
+  return measureCulling(
+      "scalar", boxes, numRounds, [&]() { return countScalar(boxes, boxes.mBoxes); }, print);
+}
+
+CullingThroughput measureBatched(
+    BenchmarkBoxes const& boxes, bool oriented, int numRounds, bool print = true) {
+  if (oriented) {
+    return measureCulling("batched (oriented)", boxes, numRounds,
+        [&]() { return countBatched(boxes, boxes.mOrientedBatches); }, print);
+  }
+
+  return measureCulling(
+      "batched", boxes, numRounds, [&]() { return countBatched(boxes, boxes.mBatches); }, print);
+}
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::Culling frustum") {
+  std::mt19937 rng(42);
+  int          planeHint = 0;
+  int          numInside = 0;
+
+  for (int i = 0; i < 10000; ++i) {
+    Frustum const frustum = randomFrustum(rng);
+
+    BoxBatch         batch;
+    OrientedBoxBatch orientedBatch;
+    unsigned         expected         = 0;
+    unsigned         expectedOriented = 0;
+
+    for (int j = 0; j < BoxBatch::sSize; ++j) {
+      {
+        BoundingBox<double> const box = randomBox(rng);
+        batch.set(j, box);
+        bool const inside = referenceInFrustum(frustum, getCorners(box));
+        CHECK_EQ(testInFrustum(frustum, box), inside);
+        expected |= static_cast<unsigned>(inside) << static_cast<unsigned>(j);
+        numInside += static_cast<int>(inside);
+      }
+
+      {
+        OrientedTileBounds const box = randomOrientedBox(rng);
+        orientedBatch.set(j, box);
+        bool const inside = referenceInFrustum(frustum, getCorners(box));
+        CHECK_EQ(testInFrustum(frustum, box), inside);
+        expectedOriented |= static_cast<unsigned>(inside) << static_cast<unsigned>(j);
+        numInside += static_cast<int>(inside);
+      }
+    }
+
+    // Boxes not included in the mask are never reported as inside.
+    unsigned const mask = rng() % 16;
+    CHECK_EQ(testInFrustum(frustum, batch, mask, planeHint), expected & mask);
+    CHECK_EQ(testInFrustum(frustum, batch, 0xFU, planeHint), expected);
+    CHECK_EQ(testInFrustum(frustum, orientedBatch, mask, planeHint), expectedOriented & mask);
+    CHECK_EQ(testInFrustum(frustum, orientedBatch, 0xFU, planeHint), expectedOriented);
+    CHECK_GE(planeHint, 0);
+    CHECK_LT(planeHint, static_cast<int>(Frustum::NUM_PLANES));
+  }
+
+  // Make sure both outcomes are covered.
+  CHECK_GT(numInside, 2000);
+  CHECK_LT(numInside, 78000);
+}
+
+TEST_CASE("csp::lodbodies::Culling horizon") {
+  std::mt19937 rng(42);
+  int          numVisible = 0;
+
+  for (int i = 0; i < 10000; ++i) {
+    glm::dvec3 const camPos = randomCamera(rng);
+
+    BoxBatch         batch;
+    OrientedBoxBatch orientedBatch;
+    unsigned         expected         = 0;
+    unsigned         expectedOriented = 0;
+
+    for (int j = 0; j < BoxBatch::sSize; ++j) {
+      {
+        BoundingBox<double> const box = randomBox(rng);
+        batch.set(j, box);
+        bool const visible = referenceAboveHorizon(camPos, 1.0, getCorners(box));
+        CHECK_EQ(testAboveHorizon(camPos, 1.0, box), visible);
+        expected |= static_cast<unsigned>(visible) << static_cast<unsigned>(j);
+        numVisible += static_cast<int>(visible);
+      }
+
+      {
+        OrientedTileBounds const box = randomOrientedBox(rng);
+        orientedBatch.set(j, box);
+        bool const visible = referenceAboveHorizon(camPos, 1.0, getCorners(box));
+        CHECK_EQ(testAboveHorizon(camPos, 1.0, box), visible);
+        expectedOriented |= static_cast<unsigned>(visible) << static_cast<unsigned>(j);
+        numVisible += static_cast<int>(visible);
+      }
+    }
+
+    unsigned const mask = rng() % 16;
+    CHECK_EQ(testAboveHorizon(camPos, 1.0, batch, mask), expected & mask);
+    CHECK_EQ(testAboveHorizon(camPos, 1.0, batch, 0xFU), expected);
+    CHECK_EQ(testAboveHorizon(camPos, 1.0, orientedBatch, mask), expectedOriented & mask);
+    CHECK_EQ(testAboveHorizon(camPos, 1.0, orientedBatch, 0xFU), expectedOriented);
+  }
+
+  CHECK_GT(numVisible, 2000);
+  CHECK_LT(numVisible, 78000);
+}
+
+TEST_CASE("csp::lodbodies::Culling back-facing") {
+  std::mt19937                           rng(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_real_distribution<double> coord(-1.0, 1.0);
+  int                                    numBackFacing = 0;
+
+  for (int i = 0; i < 10000; ++i) {
+    glm::dvec3 const         camPos = randomCamera(rng);
+    OrientedTileBounds const box    = randomOrientedBox(rng);
+
+    if (!testBackFacing(camPos, box)) {
+      continue;
+    }
+
+    ++numBackFacing;
+
+    // Random points in the box and random normals within the cone all face away from the camera.
+    for (int j = 0; j < 100; ++j) {
+      glm::dvec3 const point = box.mCenter + coord(rng) * box.mHalfAxes[0] +
+                               coord(rng) * box.mHalfAxes[1] + coord(rng) * box.mHalfAxes[2];
+
+      glm::dvec3 const side =
+          glm::normalize(glm::cross(box.mConeAxis, glm::dvec3(coord(rng), coord(rng), coord(rng))));
+      double const     cosA   = 1.0 - unit(rng) * (1.0 - box.mConeCos);
+      glm::dvec3 const normal = cosA * box.mConeAxis + std::sqrt(1.0 - cosA * cosA) * side;
+
+      CHECK_LT(glm::dot(normal, camPos - point), 0.0);
+    }
+  }
+
+  CHECK_GT(numBackFacing, 1000);
+
+  // Tiles are never rejected if the cone is too wide or if the camera is close to them.
+  OrientedTileBounds box = randomOrientedBox(rng);
+  box.mConeSin           = 1.0;
+  box.mConeCos           = 0.0;
+  CHECK_FALSE(testBackFacing(-3.0 * box.mCenter, box));
+
+  box = randomOrientedBox(rng);
+  CHECK_FALSE(testBackFacing(box.mCenter + 0.5 * box.mHalfAxes[0], box));
+}
+
+// Compares the throughput of the reference implementation with the scalar and the batched tests.
+// It is skipped by default, run it with --test-case="*Culling benchmark*" --no-skip.
+TEST_CASE("csp::lodbodies::Culling benchmark" * doctest::skip()) {
+  BenchmarkBoxes const boxes(250000);
+
+  std::size_t const reference = measureCulling("reference", boxes, 10, [&]() {
+    std::size_t visible = 0;
+    for (auto const& box : boxes.mBoxes) {
+      auto const corners = getCorners(box);
+      visible += referenceInFrustum(boxes.mFrustum, corners) &&
+                 referenceAboveHorizon(boxes.mCamPos, 1.0, corners);
+    }
+    return visible;
+  }).mVisible;
+
+  for (bool oriented : {false, true}) {
+    CullingThroughput const scalar  = measureScalar(boxes, oriented, 10);
+    CullingThroughput const batched = measureBatched(boxes, oriented, 10);
+
+    CHECK_EQ(scalar.mVisible, reference);
+    CHECK_EQ(batched.mVisible, reference);
+  }
+}
+
+// The batched tests are used by LODVisitor::cullChildren, they have to be at least as fast as the
+// scalar ones. The best of several short runs is compared to reduce the influence of other load.
+// Timings of unoptimized builds say nothing about this, so the test is only part of release builds.
+#ifdef NDEBUG
+TEST_CASE("csp::lodbodies::Culling batched throughput") {
+  BenchmarkBoxes const boxes(20000);
+
+  for (bool oriented : {false, true}) {
+    double scalar  = 0.0;
+    double batched = 0.0;
+
+    for (int run = 0; run < 5; ++run) {
+      scalar  = std::max(scalar, measureScalar(boxes, oriented, 5, false).mTilesPerSecond);
+      batched = std::max(batched, measureBatched(boxes, oriented, 5, false).mTilesPerSecond);
+    }
+
+    CHECK_GE(batched, scalar);
+  }
+}
+#endif
+
+} // namespace csp::lodbodies
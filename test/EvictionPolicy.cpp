@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/EvictionPolicy.hpp"
+#include "../src/TileResidency.hpp"
+#include "../src/TileTrace.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+#include "TestTiles.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// A camera which moves across a single quadtree for moveFrames frames and then stays still. The
+// patch index of a tile interleaves the bits of its x and y position, so that the parent of a tile
+// is found by dividing its patch index by four as in the HEALPix scheme. All ancestors of the
+// selected tiles are used as well, like LODVisitor does.
+TileTrace::Frames makeTrace(int moveFrames, int stillFrames, int maxLevel) {
+  TileTrace::Frames trace;
+
+  for (int f = 0; f < moveFrames + stillFrames; ++f) {
+    double const t      = std::min(f, moveFrames) / static_cast<double>(moveFrames);
+    double const focusX = 0.1 + 0.8 * t;
+    double const focusY = 0.3 + 0.4 * t;
+
+    std::vector<TileId>                           frame;
+    std::vector<std::tuple<int, glm::int64, int>> stack{{0, 0, 0}};
+
+    while (!stack.empty()) {
+      auto [level, x, y] = stack.back();
+      stack.pop_back();
+
+      glm::int64 patchIdx = 0;
+
+      for (int bit = 0; bit < level; ++bit) {
+        patchIdx |= ((x >> bit) & 1) << (2 * bit);
+        patchIdx |= static_cast<glm::int64>((y >> bit) & 1) << (2 * bit + 1);
+      }
+
+      frame.emplace_back(level, patchIdx);
+
+      double const size = std::ldexp(1.0, -level);
+      double const dist =
+          std::hypot((static_cast<double>(x) + 0.5) * size - focusX, (y + 0.5) * size - focusY);
+
+      if (level < maxLevel && dist < 1.5 * size) {
+        for (int i = 0; i < 4; ++i) {
+          stack.emplace_back(level + 1, 2 * x + (i & 1), 2 * y + (i >> 1));
+        }
+      }
+    }
+
+    trace.push_back(std::move(frame));
+  }
+
+  return trace;
+}
+
+// A TileResidency without textures, tiles are on the GPU as soon as they have been given a layer.
+// Eviction can be disabled for comparison.
+class TestResidency : public TileResidency {
+ public:
+  TestResidency(int layers, bool evict)
+      : TileResidency(layers)
+      , mEvict(evict) {
+  }
+
+  void allocateGPU(RenderData* rdata) {
+    mUploadQueue.push(rdata, -1);
+  }
+
+  void releaseGPU(RenderData* rdata) {
+    if (rdata->getTexLayer() >= 0) {
+      releaseLayer(rdata);
+    } else {
+      mUploadQueue.remove(rdata);
+    }
+  }
+
+  int processQueue(int maxUploads) {
+    return uploadQueued([maxUploads](int uploads) { return uploads >= maxUploads; });
+  }
+
+  std::size_t getEvictions() const {
+    return mEvictions;
+  }
+
+ private:
+  bool evict(std::vector<RenderData*>& evicted) override {
+    std::size_t const count  = evicted.size();
+    bool const        result = mEvict && TileResidency::evict(evicted);
+    mEvictions += evicted.size() - count;
+    return result;
+  }
+
+  void uploadLayer(UploadQueue::Upload const& upload, TexturePagePool::Handle handle) override {
+    assignLayer(upload.mRdata, handle);
+  }
+
+  void allocatePage(int /*page*/) override {
+  }
+
+  bool canResizePages() override {
+    return true;
+  }
+
+  void resizePage(int /*page*/) override {
+  }
+
+  void releasePage(int /*page*/) override {
+  }
+
+  bool        mEvict;
+  std::size_t mEvictions{};
+};
+
+struct SimulationResult {
+  double      mHitRatio;
+  int         mUploads;
+  std::size_t mEvictions;
+};
+
+// Replays a trace against a TestResidency with the given number of layers. Tiles are loaded
+// loadFrames after they have been used first and uploaded at most uploadsPerFrame per frame. Like
+// TreeManagerBase, tiles which have not been used for ten frames are removed. The hit ratio is the
+// fraction of used tiles which are on the GPU when they are used.
+SimulationResult simulate(
+    TileTrace::Frames const& trace, int layers, int uploadsPerFrame, int loadFrames, bool evict) {
+  struct Node : QueuedNode {
+    using QueuedNode::QueuedNode;
+
+    int  mArrival{};
+    bool mQueued{};
+  };
+
+  std::unordered_map<TileId, std::unique_ptr<Node>> nodes;
+  TestResidency                                     residency(layers, evict);
+
+  int const        maxNodeAge = 10;
+  SimulationResult result{0.0, 0, 0};
+  std::size_t      hits = 0;
+  std::size_t      used = 0;
+
+  for (int frame = 0; frame < static_cast<int>(trace.size()); ++frame) {
+    // prune
+    for (auto it = nodes.begin(); it != nodes.end();) {
+      if (frame - it->second->mRdata.getLastFrame() > maxNodeAge) {
+        residency.releaseGPU(&it->second->mRdata);
+        it = nodes.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    // merge the tiles which have been loaded
+    for (auto& node : nodes) {
+      if (!node.second->mQueued && node.second->mArrival <= frame) {
+        residency.allocateGPU(&node.second->mRdata);
+        node.second->mQueued = true;
+      }
+    }
+
+    result.mUploads += residency.processQueue(uploadsPerFrame);
+
+    // traverse, new tiles are requested
+    for (auto const& tileId : trace[frame]) {
+      auto& node = nodes[tileId];
+
+      if (!node) {
+        node           = std::make_unique<Node>(tileId);
+        node->mArrival = frame + loadFrames;
+      }
+
+      node->mRdata.setLastFrame(frame);
+      hits += node->mRdata.getTexLayer() >= 0 ? 1 : 0;
+      ++used;
+    }
+  }
+
+  result.mEvictions = residency.getEvictions();
+  result.mHitRatio  = used > 0 ? static_cast<double>(hits) / static_cast<double>(used) : 1.0;
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::EvictionPolicy") {
+  EvictionPolicy policy;
+  policy.setCandidates({{5, 3}, {2, 4}, {2, 6}, {9, 1}});
+  CHECK_EQ(policy.getNewestFrame(), 9);
+
+  // The oldest candidates go first, among those the finest.
+  CHECK_EQ(policy.selectVictim({6, 2}), 2);
+  CHECK_EQ(policy.selectVictim({6, 2}), 1);
+  CHECK_EQ(policy.selectVictim({6, 2}), 0);
+
+  // Candidates used as recently as the waiting tile stay.
+  CHECK_EQ(policy.selectVictim({9, 0}), -1);
+  CHECK_FALSE(EvictionPolicy::mayEvict({9, 1}, {9, 0}));
+  CHECK(EvictionPolicy::mayEvict({8, 0}, {9, 20}));
+}
+
+TEST_CASE("csp::lodbodies::EvictionPolicy simulation") {
+  // While the camera moves, the GPU is full of tiles which were used a few frames ago. Without
+  // eviction, new tiles have to wait until those are pruned.
+  TileTrace::Frames const trace = makeTrace(40, 20, 7);
+
+  SimulationResult const prune = simulate(trace, 64, 8, 2, false);
+  SimulationResult const evict = simulate(trace, 64, 8, 2, true);
+
+  CHECK_EQ(prune.mEvictions, 0);
+  CHECK_GT(evict.mEvictions, 0);
+  CHECK_GT(evict.mHitRatio, prune.mHitRatio);
+}
+
+TEST_CASE("csp::lodbodies::EvictionPolicy replay" * doctest::skip()) {
+  // Replays the trace recorded to LOD_BODIES_RESIDENCY_TRACE (see the tileTraceDirectory setting),
+  // or a synthetic one, with different numbers of layers to tune the policy.
+  TileTrace::Frames trace;
+
+  if (char const* path = std::getenv("LOD_BODIES_RESIDENCY_TRACE")) {
+    std::ifstream file(path);
+    trace = TileTrace::read(file);
+  } else {
+    trace = makeTrace(200, 100, 9);
+  }
+
+  for (int layers : {128, 256, 512}) {
+    for (bool evict : {false, true}) {
+      SimulationResult const result = simulate(trace, layers, 20, 3, evict);
+      MESSAGE(layers << " layers, eviction " << evict << ": hit ratio " << result.mHitRatio
+              << ", " << result.mUploads << " uploads, " << result.mEvictions << " evictions");
+    }
+  }
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/FixedSizePool.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace csp::lodbodies {
+
+namespace {
+std::size_t getResidentBytes() {
+  // Only available on Linux, elsewhere the RSS columns of the benchmark simply stay zero.
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  std::size_t   size     = 0;
+  std::size_t   resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 0;
+#endif
+}
+} // namespace
+
+TEST_CASE("csp::lodbodies::FixedSizePool") {
+  FixedSizePool pool(100, 4);
+
+  std::vector<void*> blocks;
+  for (int i = 0; i < 10; ++i) {
+    blocks.push_back(pool.allocate());
+    std::memset(blocks.back(), i, pool.getBlockSize());
+  }
+
+  CHECK_EQ(pool.getNumAllocated(), 10U);
+  CHECK_EQ(pool.getNumSlabs(), 3U);
+
+  std::sort(blocks.begin(), blocks.end());
+  CHECK(std::adjacent_find(blocks.begin(), blocks.end()) == blocks.end());
+
+  for (void* block : blocks) {
+    pool.deallocate(block);
+  }
+
+  CHECK_EQ(pool.getNumAllocated(), 0U);
+
+  // Freed blocks are reused, no new slab is required.
+  for (int i = 0; i < 12; ++i) {
+    blocks.at(i % blocks.size()) = pool.allocate();
+  }
+  CHECK_EQ(pool.getNumSlabs(), 3U);
+}
+
+// This benchmark simulates the allocation pattern of a long session: several loader threads create
+// elevation-tile sized blocks while the main thread prunes random ones. It is skipped by default,
+// run it with --test-case="*FixedSizePool benchmark*" --no-skip.
+TEST_CASE("csp::lodbodies::FixedSizePool benchmark" * doctest::skip()) {
+  std::size_t const blockSize  = 257 * 257 * sizeof(float) + 64;
+  int const         numThreads = 4;
+  int const         numRounds  = 20;
+  int const         perRound   = 2000;
+  std::size_t const maxLive    = 500;
+
+  FixedSizePool pool(blockSize, 8);
+
+  std::size_t const rssStart = getResidentBytes();
+
+  for (int round = 0; round < numRounds; ++round) {
+    std::vector<std::vector<void*>> live(numThreads);
+    std::vector<double>             maxNanos(numThreads, 0.0);
+    std::vector<double>             sumNanos(numThreads, 0.0);
+    std::vector<std::thread>        threads;
+
+    for (int t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        std::mt19937 rng(round * numThreads + t);
+
+        for (int i = 0; i < perRound; ++i) {
+          auto  start = std::chrono::high_resolution_clock::now();
+          void* block = pool.allocate();
+          auto  end   = std::chrono::high_resolution_clock::now();
+
+          double nanos = std::chrono::duration<double, std::nano>(end - start).count();
+          sumNanos[t] += nanos;
+          maxNanos[t] = std::max(maxNanos[t], nanos);
+
+          // Touch the first page to make the block resident, like a loaded tile would.
+          static_cast<char*>(block)[0] = 1;
+          live[t].push_back(block);
+
+          if (live[t].size() > maxLive / numThreads) {
+            std::size_t idx = rng() % live[t].size();
+            std::swap(live[t][idx], live[t].back());
+            pool.deallocate(live[t].back());
+            live[t].pop_back();
+          }
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    for (auto& blocks : live) {
+      for (void* block : blocks) {
+        pool.deallocate(block);
+      }
+    }
+
+    double meanNanos = 0.0;
+    for (int t = 0; t < numThreads; ++t) {
+      meanNanos += sumNanos[t] / (perRound * numThreads);
+    }
+
+    MESSAGE("round " << round << ": slabs " << pool.getNumSlabs() << ", reserved "
+            << pool.getReservedBytes() / (1024 * 1024) << " MiB, rss growth "
+            << (static_cast<double>(getResidentBytes()) - static_cast<double>(rssStart)) /
+                   (1024.0 * 1024.0)
+            << " MiB, mean alloc " << meanNanos << " ns, max alloc "
+            << *std::max_element(maxNanos.begin(), maxNanos.end()) << " ns");
+  }
+
+  CHECK_EQ(pool.getNumAllocated(), 0U);
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/FrameBudget.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::FrameBudget") {
+  using Clock = FrameBudget::Clock;
+  using Stage = FrameBudget::Stage;
+
+  auto const ms = [](double milliseconds) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(milliseconds));
+  };
+
+  FrameBudget       budget;
+  Clock::time_point time;
+
+  // Simulates one frame with the given stage durations, the update stage takes until the deadline.
+  auto const frame = [&](double bounds, double traverse, double request, double render) {
+    budget.beginFrame(time);
+    time += ms(bounds);
+    budget.endStage(Stage::eBounds, time);
+    time = std::max(time, budget.getDeadline());
+    budget.endStage(Stage::eUpdate, time);
+    time += ms(traverse);
+    budget.endStage(Stage::eTraverse, time);
+    time += ms(request);
+    budget.endStage(Stage::eRequest, time);
+    time += ms(render);
+    budget.endStage(Stage::eRender, time);
+  };
+
+  // Without a budget there is no deadline.
+  budget.beginFrame(time);
+  CHECK_EQ(budget.getDeadline(), Clock::time_point::max());
+
+  // The averaged durations converge to the actual durations. The deferrable update stage gets the
+  // remaining time.
+  budget.setBudget(10.0);
+
+  for (int i = 0; i < 200; ++i) {
+    frame(1.0, 2.0, 0.5, 3.0);
+  }
+
+  CHECK_EQ(budget.getStageTime(Stage::eBounds), doctest::Approx(1.0).epsilon(0.01));
+  CHECK_EQ(budget.getStageTime(Stage::eTraverse), doctest::Approx(2.0).epsilon(0.01));
+  CHECK_EQ(budget.getStageTime(Stage::eRequest), doctest::Approx(0.5).epsilon(0.01));
+  CHECK_EQ(budget.getStageTime(Stage::eRender), doctest::Approx(3.0).epsilon(0.01));
+  CHECK_EQ(budget.getStageTime(Stage::eUpdate), doctest::Approx(3.5).epsilon(0.01));
+
+  // The deadline is computed when the update stage starts, the bounds stage is not reserved again.
+  budget.beginFrame(time);
+  CHECK_EQ(budget.getDeadline(), Clock::time_point::max());
+  time += ms(1.0);
+  budget.endStage(Stage::eBounds, time);
+  std::chrono::duration<double, std::milli> const available = budget.getDeadline() - time;
+  CHECK_EQ(available.count(), doctest::Approx(3.5).epsilon(0.01));
+
+  // If the other stages exceed the budget, the deadline is at the beginning of the frame.
+  for (int i = 0; i < 200; ++i) {
+    frame(1.0, 8.0, 0.5, 3.0);
+  }
+
+  budget.beginFrame(time);
+  time += ms(1.0);
+  budget.endStage(Stage::eBounds, time);
+  CHECK_EQ(budget.getDeadline(), time);
+  CHECK_LT(budget.getStageTime(Stage::eUpdate), 0.01);
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/HorizonMap.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::HorizonMap") {
+  // The camera is on the surface of a planet with radius one. The up direction is +z.
+  glm::dvec3 const camPos(0.0, 0.0, 1.0);
+
+  HorizonMap map;
+  map.reset(camPos, 1.0);
+  map.finish();
+
+  // Without occluders nothing is hidden.
+  BoundingBox<double> const behind(glm::dvec3(0.05, -0.002, 0.99), glm::dvec3(0.06, 0.002, 1.002));
+  CHECK(map.isEmpty());
+  CHECK_FALSE(map.testOccluded(behind));
+
+  // A ridge in +x direction at a distance of 0.01, which rises 0.002 above the camera. It is made
+  // of narrow cells, which span several azimuth bins each.
+  map.reset(camPos, 1.0);
+
+  for (int i = -10; i < 10; ++i) {
+    double const y0 = 0.001 * i;
+    double const y1 = y0 + 0.001;
+    double const z  = 1.002;
+
+    OccluderCell cell;
+    cell.mCorners = {glm::dvec3(0.01, y0, z), glm::dvec3(0.0102, y0, z),
+        glm::dvec3(0.0102, y1, z), glm::dvec3(0.01, y1, z)};
+    cell.mCenter  = glm::dvec3(0.0101, y0 + 0.0005, z);
+
+    for (auto const& corner : cell.mCorners) {
+      cell.mRadius = std::max(cell.mRadius, 1.1 * glm::length(corner - cell.mCenter));
+    }
+
+    map.addOccluder(cell);
+  }
+
+  map.finish();
+  CHECK_FALSE(map.isEmpty());
+
+  // Boxes behind the ridge and below its top are hidden.
+  CHECK(map.testOccluded(behind));
+
+  OrientedTileBounds oriented;
+  oriented.mCenter   = glm::dvec3(0.5, 0.0, 0.9);
+  oriented.mHalfAxes = {
+      glm::dvec3(0.01, 0.0, 0.0), glm::dvec3(0.0, 0.01, 0.0), glm::dvec3(0.0, 0.0, 0.01)};
+  CHECK(map.testOccluded(oriented));
+
+  // Boxes in front of the ridge, above it or beside it are not.
+  CHECK_FALSE(map.testOccluded(
+      BoundingBox<double>(glm::dvec3(0.004, -0.001, 0.99), glm::dvec3(0.006, 0.001, 1.0))));
+  CHECK_FALSE(map.testOccluded(
+      BoundingBox<double>(glm::dvec3(0.05, -0.002, 0.99), glm::dvec3(0.06, 0.002, 1.01))));
+  CHECK_FALSE(map.testOccluded(
+      BoundingBox<double>(glm::dvec3(-0.06, -0.002, 0.99), glm::dvec3(-0.05, 0.002, 1.0))));
+  CHECK_FALSE(map.testOccluded(
+      BoundingBox<double>(glm::dvec3(0.05, 0.05, 0.99), glm::dvec3(0.06, 0.06, 1.0))));
+
+  // Boxes which contain the camera are never hidden.
+  CHECK_FALSE(map.testOccluded(
+      BoundingBox<double>(glm::dvec3(-0.1, -0.1, 0.9), glm::dvec3(0.1, 0.1, 1.1))));
+}
+
+} // namespace csp::lodbodies
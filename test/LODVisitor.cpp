@@ -0,0 +1,493 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/LODVisitor.hpp"
+#include "../src/PlanetParameters.hpp"
+#include "../src/RenderDataDEM.hpp"
+#include "../src/RenderDataImg.hpp"
+#include "../src/TreeManagerBase.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+#include "TestTiles.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <thread>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// A tree manager whose tree is completely loaded and uploaded up to maxLevel. The data set it
+// pretends to load from goes down to dataMaxLevel, which defaults to maxLevel. It neither uses a
+// TileSource nor any OpenGL resources. The terrain is flat, but the geometric error of the tiles is
+// set as if there was terrain whose elevation error at level 0 is roughness and which halves with
+// each level. If image is set, the tree holds image tiles instead.
+class SyntheticTreeManager : public TreeManagerBase {
+ public:
+  SyntheticTreeManager(PlanetParameters const& params, int maxLevel, double roughness = 0.01,
+      int dataMaxLevel = -1, bool image = false)
+      : TreeManagerBase(params, nullptr)
+      , mRoughness(roughness)
+      , mDataMaxLevel(dataMaxLevel < 0 ? maxLevel : dataMaxLevel)
+      , mImage(image) {
+    for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+      // LODVisitor uses the MinMaxPyramids of the roots for horizon culling.
+      auto tile = std::make_shared<Tile<float>>(0, i);
+      tile->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(tile.get()));
+
+      auto* root = new TileNode(tile, mDataMaxLevel);
+      mTree.setRoot(i, root);
+      addNode(root, maxLevel);
+    }
+  }
+
+  SyntheticTreeManager(SyntheticTreeManager const& other) = delete;
+  SyntheticTreeManager(SyntheticTreeManager&& other)      = delete;
+
+  SyntheticTreeManager& operator=(SyntheticTreeManager const& other) = delete;
+  SyntheticTreeManager& operator=(SyntheticTreeManager&& other) = delete;
+
+  ~SyntheticTreeManager() override {
+    for (auto const& entry : mRdMap) {
+      releaseRenderData(entry.second);
+    }
+  }
+
+ protected:
+  RenderData* allocateRenderData(TileNode* node) override {
+    if (mImage) {
+      return new RenderDataImg(node);
+    }
+
+    return new RenderDataDEM(node);
+  }
+
+  void releaseRenderData(RenderData* rdata) override {
+    delete rdata;
+  }
+
+ private:
+  void addNode(TileNode* node, int maxLevel) {
+    TileId const& tileId = node->getTileId();
+
+    if (mImage) {
+      RenderData* rdata = allocateRenderData(node);
+      rdata->setTexLayer(0);
+      mRdMap[tileId] = rdata;
+    } else {
+      addRenderDataDEM(node);
+    }
+
+    if (tileId.level() < maxLevel) {
+      for (int i = 0; i < 4; ++i) {
+        TileId childId = HEALPix::getChildTileId(tileId, i);
+        auto*  child   = new TileNode(std::make_shared<EmptyTile>(childId), mDataMaxLevel);
+        node->setChild(i, child);
+        addNode(child, maxLevel);
+      }
+    }
+  }
+
+  void addRenderDataDEM(TileNode* node) {
+    TileId const& tileId = node->getTileId();
+    auto*         rdata  = static_cast<RenderDataDEM*>(allocateRenderData(node));
+
+    rdata->setTexLayer(0);
+    rdata->setBounds(calcTileBounds(0.0, 0.0, tileId.level(), tileId.patchIdx(),
+        mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+    rdata->setOrientedBounds(calcOrientedTileBounds(0.0, 0.0, 0.0, tileId.level(),
+        tileId.patchIdx(), mParams->mEquatorialRadius, mParams->mPolarRadius,
+        mParams->mHeightScale));
+    rdata->setGeometricError(calcGeometricError(std::ldexp(mRoughness, -tileId.level()),
+        tileId.level(), mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+    rdata->setOccluders(calcTileOccluders({}, tileId.level(), tileId.patchIdx(),
+        mParams->mEquatorialRadius, mParams->mPolarRadius, mParams->mHeightScale));
+    mRdMap[tileId] = rdata;
+  }
+
+  double mRoughness;
+  int    mDataMaxLevel;
+  bool   mImage;
+};
+
+// Places the camera at a height of 0.5 radii above the equator, looking at the planet center. The
+// camera is rotated around the planet by angle radians.
+void setCamera(LODVisitor& visitor, double angle) {
+  glm::dvec3 const eye(1.5 * std::sin(angle), 0.0, 1.5 * std::cos(angle));
+
+  visitor.setModelview(glm::lookAt(eye, glm::dvec3(0.0), glm::dvec3(0.0, 1.0, 0.0)));
+  visitor.setProjection(glm::perspective(glm::radians(60.0), 16.0 / 9.0, 0.01, 10.0));
+  visitor.setViewport(glm::ivec4(0, 0, 1920, 1080));
+}
+
+// Places the camera along a scripted flight which descends from an altitude of one radius to one
+// thousandth of a radius while moving around the planet. The camera looks at a point on the
+// surface ahead, so that the tiles are seen at increasingly grazing angles. t is in [0, 1].
+void setFlightCamera(LODVisitor& visitor, double t) {
+  double const     altitude = std::pow(0.001, t);
+  double const     angle    = 2.0 * t;
+  glm::dvec3 const eye      = (1.0 + altitude) * glm::dvec3(std::sin(angle), 0.0, std::cos(angle));
+  glm::dvec3 const target(std::sin(angle + 0.3), 0.0, std::cos(angle + 0.3));
+
+  visitor.setModelview(glm::lookAt(eye, target, glm::dvec3(0.0, 1.0, 0.0)));
+  visitor.setProjection(glm::perspective(glm::radians(60.0), 16.0 / 9.0, 0.0001, 10.0));
+  visitor.setViewport(glm::ivec4(0, 0, 1920, 1080));
+}
+
+std::vector<TileId> getTileIds(std::vector<RenderData*> const& rdatas) {
+  std::vector<TileId> result;
+
+  for (auto const* rdata : rdatas) {
+    result.push_back(rdata->getNode()->getTileId());
+  }
+
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::LODVisitor parallel traversal") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  SyntheticTreeManager treeMgr(params, 4);
+
+  LODVisitor sequential(params, &treeMgr);
+  LODVisitor parallel(params, &treeMgr);
+  parallel.setNumThreads(4);
+
+  for (double angle = 0.0; angle < 6.0; angle += 1.0) {
+    setCamera(sequential, angle);
+    setCamera(parallel, angle);
+
+    sequential.visit();
+    parallel.visit();
+
+    CHECK_FALSE(sequential.getRenderDEM().empty());
+    CHECK(getTileIds(sequential.getRenderDEM()) == getTileIds(parallel.getRenderDEM()));
+    CHECK(sequential.getLoadDEM() == parallel.getLoadDEM());
+  }
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor temporal coherence") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  SyntheticTreeManager treeMgr(params, 4);
+
+  LODVisitor visitor(params, &treeMgr);
+  setCamera(visitor, 0.0);
+  visitor.visit();
+
+  std::vector<TileId> const renderDEM = getTileIds(visitor.getRenderDEM());
+  std::size_t const         numTests  = visitor.getNumRefineTests();
+  CHECK_GT(numTests, 0U);
+
+  // All decisions are reused while the camera does not move.
+  visitor.visit();
+  CHECK_EQ(visitor.getNumRefineTests(), 0U);
+  CHECK(getTileIds(visitor.getRenderDEM()) == renderDEM);
+
+  // Moving far causes a complete evaluation.
+  setCamera(visitor, 1.0);
+  visitor.visit();
+  CHECK_GT(visitor.getNumRefineTests(), 0U);
+
+  LODVisitor reference(params, &treeMgr);
+  reference.setTemporalCoherence(false);
+  setCamera(reference, 1.0);
+  reference.visit();
+  CHECK(getTileIds(visitor.getRenderDEM()) == getTileIds(reference.getRenderDEM()));
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor oriented bounds") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  SyntheticTreeManager treeMgr(params, 6);
+
+  LODVisitor oriented(params, &treeMgr);
+  LODVisitor axisAligned(params, &treeMgr);
+  axisAligned.setOrientedBounds(false);
+
+  std::size_t numOriented    = 0;
+  std::size_t numAxisAligned = 0;
+
+  for (int frame = 0; frame <= 20; ++frame) {
+    setFlightCamera(oriented, frame / 20.0);
+    setFlightCamera(axisAligned, frame / 20.0);
+
+    oriented.visit();
+    axisAligned.visit();
+
+    CHECK_FALSE(oriented.getRenderDEM().empty());
+    numOriented += oriented.getRenderDEM().size();
+    numAxisAligned += axisAligned.getRenderDEM().size();
+  }
+
+  // The axis aligned boxes of tilted tiles are much larger than the tiles, which causes tiles
+  // outside the view or behind the horizon to pass the culling tests and too many tiles to be
+  // refined.
+  CHECK_LT(numOriented, numAxisAligned);
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor geometric error") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  SyntheticTreeManager flatTreeMgr(params, 6, 0.0);
+  SyntheticTreeManager roughTreeMgr(params, 6, 0.01);
+
+  LODVisitor flat(params, &flatTreeMgr);
+  LODVisitor rough(params, &roughTreeMgr);
+  LODVisitor solidAngle(params, &flatTreeMgr);
+  solidAngle.setGeometricLod(false);
+
+  for (int frame = 0; frame <= 10; ++frame) {
+    setFlightCamera(flat, frame / 10.0);
+    setFlightCamera(rough, frame / 10.0);
+    setFlightCamera(solidAngle, frame / 10.0);
+
+    flat.visit();
+    rough.visit();
+    solidAngle.visit();
+
+    CHECK_FALSE(flat.getRenderDEM().empty());
+
+    // Flat terrain stops at coarser levels than rough terrain, and at coarser levels than with the
+    // solid angle criterion, which does not depend on the terrain.
+    CHECK_LT(flat.getRenderDEM().size(), rough.getRenderDEM().size());
+    CHECK_LT(flat.getRenderDEM().size(), solidAngle.getRenderDEM().size());
+  }
+}
+
+// Compares the number of selected tiles and the traversal time of oriented and axis aligned bounds
+// along the scripted flight. It is skipped by default, run it with
+// --test-case="*LODVisitor flight benchmark*" --no-skip.
+TEST_CASE("csp::lodbodies::LODVisitor load ahead") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  // Only the first two levels are loaded, the data set goes down to level 12.
+  SyntheticTreeManager treeMgr(params, 2, 0.01, 12);
+
+  LODVisitor visitor(params, &treeMgr);
+  visitor.setGeometricLod(false);
+  setFlightCamera(visitor, 0.6);
+
+  // Without loading ahead, only children of loaded tiles are requested.
+  visitor.setLoadAheadLevels(0);
+  visitor.visit();
+
+  std::size_t const numChildren = visitor.getLoadDEM().size();
+  CHECK_GT(numChildren, 0U);
+
+  for (auto const& tileId : visitor.getLoadDEM()) {
+    CHECK_EQ(tileId.level(), 3);
+  }
+
+  // Otherwise deeper tiles follow their ancestors in the list, and all of them are either loaded or
+  // requested as well.
+  visitor.setLoadAheadLevels(3);
+  visitor.visit();
+
+  std::vector<TileId> const& load = visitor.getLoadDEM();
+  CHECK_GT(load.size(), numChildren);
+  CHECK_EQ(load.back().level(), 6);
+
+  for (auto it = load.begin(); it != load.end(); ++it) {
+    TileId const parentId  = HEALPix::getParentTileId(*it);
+    bool const   requested = std::find(load.begin(), it, parentId) != it;
+
+    CHECK((treeMgr.findRData(parentId) != nullptr || requested));
+  }
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor load ahead with image data") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  // Smooth terrain, whose elevation data needs fewer levels than the image data for some tiles.
+  // The visitors store their decisions in the render data, so each of them gets its own trees.
+  SyntheticTreeManager demOnlyTreeMgr(params, 2, 0.002, 12);
+  SyntheticTreeManager demTreeMgr(params, 2, 0.002, 12);
+  SyntheticTreeManager imgTreeMgr(params, 2, 0.0, 12, true);
+
+  LODVisitor demOnly(params, &demOnlyTreeMgr);
+  LODVisitor withImage(params, &demTreeMgr, &imgTreeMgr);
+
+  for (auto* visitor : {&demOnly, &withImage}) {
+    visitor->setLoadAheadLevels(3);
+    setCamera(*visitor, 0.0);
+    visitor->visit();
+  }
+
+  // The elevation data is only requested ahead down to the level its geometric error requires,
+  // regardless of the image data.
+  CHECK_GT(demOnly.getLoadDEM().size(), 0U);
+  CHECK_EQ(withImage.getLoadDEM().size(), demOnly.getLoadDEM().size());
+  CHECK_LT(withImage.getLoadDEM().size(), withImage.getLoadIMG().size());
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor shadow tiles") {
+  PlanetParameters params;
+  params.mLodFactor = 200.0;
+
+  SyntheticTreeManager treeMgr(params, 6);
+
+  LODVisitor visitor(params, &treeMgr);
+  setFlightCamera(visitor, 0.5);
+  visitor.visit();
+
+  // The area covered by a list of tiles in units of a base patch, each tile is counted once.
+  auto getArea = [](std::vector<RenderData*> const& rdatas) {
+    std::vector<RenderData*> unique(rdatas);
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+    double area = 0.0;
+    for (auto const* rdata : unique) {
+      area += std::ldexp(1.0, -2 * rdata->getLevel());
+    }
+    return area;
+  };
+
+  auto getMaxLevel = [](std::vector<RenderData*> const& rdatas) {
+    int level = 0;
+    for (auto const* rdata : rdatas) {
+      level = std::max(level, rdata->getLevel());
+    }
+    return level;
+  };
+
+  std::vector<RenderData*> const& renderDEM = visitor.getRenderDEM();
+  REQUIRE_GT(getMaxLevel(renderDEM), 3);
+
+  // A light from +z whose frustum contains the whole planet. The texels are about 0.0007 apart and
+  // the vertices of level 3 tiles about 0.0005.
+  glm::dmat4 const matVM =
+      glm::lookAt(glm::dvec3(0.0, 0.0, 3.0), glm::dvec3(0.0), glm::dvec3(0.0, 1.0, 0.0));
+  glm::dmat4 const matP = glm::ortho(-1.5, 1.5, -1.5, 1.5, 0.1, 10.0);
+
+  visitor.selectShadowTiles(matVM, matP, glm::ivec4(0, 0, 4096, 4096));
+
+  std::vector<RenderData*> const shadowDEM = visitor.getShadowDEM();
+  CHECK_EQ(getMaxLevel(shadowDEM), 3);
+  CHECK_LT(shadowDEM.size(), renderDEM.size());
+
+  // the parents of tiles at the border of the view cover a little more than those
+  CHECK_GE(getArea(shadowDEM), doctest::Approx(getArea(renderDEM)));
+
+  std::vector<RenderData*> sorted(shadowDEM);
+  std::sort(sorted.begin(), sorted.end());
+  CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+  // The coarser tiles are stitched to their neighbours, until the next traversal.
+  auto const* coarse = dynamic_cast<RenderDataDEM const*>(*std::find_if(
+      shadowDEM.begin(), shadowDEM.end(), [&renderDEM](RenderData* rdata) {
+        return std::find(renderDEM.begin(), renderDEM.end(), rdata) == renderDEM.end();
+      }));
+
+  CHECK(coarse->getEdgeRData(0) != nullptr);
+  visitor.visit();
+  CHECK(coarse->getEdgeRData(0) == nullptr);
+
+  // A smaller shadow map uses coarser tiles and only the tiles in the light frustum are selected.
+  visitor.selectShadowTiles(matVM, matP, glm::ivec4(0, 0, 1024, 1024));
+  CHECK_EQ(getMaxLevel(visitor.getShadowDEM()), 1);
+
+  visitor.selectShadowTiles(
+      matVM, glm::ortho(-1.5, 1.5, -1.5, 1.5, 5.0, 10.0), glm::ivec4(0, 0, 4096, 4096));
+  CHECK(visitor.getShadowDEM().empty());
+}
+
+TEST_CASE("csp::lodbodies::LODVisitor flight benchmark" * doctest::skip()) {
+  PlanetParameters params;
+  params.mLodFactor = 400.0;
+
+  SyntheticTreeManager treeMgr(params, 7);
+
+  int const numFrames = 200;
+
+  for (bool orientedBounds : {false, true}) {
+    LODVisitor visitor(params, &treeMgr);
+    visitor.setOrientedBounds(orientedBounds);
+    visitor.setTemporalCoherence(false);
+
+    std::size_t numTiles = 0;
+    std::size_t numLoads = 0;
+    std::size_t numTests = 0;
+    auto        start    = std::chrono::high_resolution_clock::now();
+
+    for (int frame = 0; frame < numFrames; ++frame) {
+      visitor.setFrameCount(frame);
+      setFlightCamera(visitor, frame / (numFrames - 1.0));
+      visitor.visit();
+      numTiles += visitor.getRenderDEM().size();
+      numLoads += visitor.getLoadDEM().size();
+      numTests += visitor.getNumRefineTests();
+    }
+
+    auto   end    = std::chrono::high_resolution_clock::now();
+    double millis = std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+
+    MESSAGE((orientedBounds ? "oriented bounds: " : "axis aligned bounds: ") << millis
+            << " ms per frame, " << numTiles / numFrames << " tiles, " << numLoads / numFrames
+            << " loads and " << numTests / numFrames << " refinement tests per frame");
+  }
+}
+
+// Traverses a fully loaded tree with an increasing number of threads while the camera flies around
+// the planet, with and without temporal coherence. It is skipped by default, run it with
+// --test-case="*LODVisitor traversal benchmark*" --no-skip.
+TEST_CASE("csp::lodbodies::LODVisitor traversal benchmark" * doctest::skip()) {
+  PlanetParameters params;
+  params.mLodFactor = 400.0;
+
+  SyntheticTreeManager treeMgr(params, 7);
+
+  int const numFrames  = 200;
+  int const numRoots   = TileQuadTree::sNumRoots;
+  int const maxThreads =
+      std::max(1, std::min(static_cast<int>(std::thread::hardware_concurrency()), numRoots));
+
+  for (bool coherence : {false, true}) {
+    double sequentialMillis = 0.0;
+
+    for (int numThreads = 1; numThreads <= maxThreads; ++numThreads) {
+      LODVisitor visitor(params, &treeMgr);
+      visitor.setNumThreads(numThreads);
+      visitor.setTemporalCoherence(coherence);
+
+      std::size_t numTiles = 0;
+      std::size_t numTests = 0;
+      auto        start    = std::chrono::high_resolution_clock::now();
+
+      for (int frame = 0; frame < numFrames; ++frame) {
+        visitor.setFrameCount(frame);
+        setCamera(visitor, 0.001 * frame);
+        visitor.visit();
+        numTiles += visitor.getRenderDEM().size();
+        numTests += visitor.getNumRefineTests();
+      }
+
+      auto   end    = std::chrono::high_resolution_clock::now();
+      double millis = std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+
+      if (numThreads == 1) {
+        sequentialMillis = millis;
+      }
+
+      MESSAGE("coherence " << coherence << ", " << numThreads << " threads: " << millis
+              << " ms per frame, speedup " << sequentialMillis / millis << ", "
+              << numTiles / numFrames << " tiles and " << numTests / numFrames
+              << " refinement tests per frame");
+    }
+  }
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/LodController.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <cmath>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// A simple model of the renderer: A constant frame time plus a cost per triangle, the number of
+// triangles grows with the square of the LOD factor. Every tenth frame is slowed down by uploads.
+struct SimulatedRenderer {
+  double mConstantTime = 4.0;
+  double mTriangleCost = 2e-6;
+  double mTriangles    = 5000.0;
+
+  std::size_t triangles(double lodFactor) const {
+    return static_cast<std::size_t>(mTriangles * lodFactor * lodFactor);
+  }
+
+  double frameTime(int frame, double lodFactor) const {
+    double const spike = frame % 10 == 0 ? 20.0 : 0.0;
+    return mConstantTime + mTriangleCost * static_cast<double>(triangles(lodFactor)) + spike;
+  }
+};
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::LodController") {
+  SimulatedRenderer renderer;
+  LodController     controller;
+  controller.setTargetTime(11.1);
+  controller.setRange(5.0, 100.0);
+
+  // Without a good estimate of the triangle cost the LOD factor is increased cautiously, but it
+  // converges nevertheless. The upload spikes do not disturb the controller.
+  double lodFactor = 15.0;
+
+  for (int frame = 0; frame < 300; ++frame) {
+    lodFactor = controller.update(
+        renderer.frameTime(frame, lodFactor), renderer.triangles(lodFactor), lodFactor);
+  }
+
+  double const optimum = std::sqrt((11.1 - 4.0) / renderer.mTriangleCost / renderer.mTriangles);
+  CHECK_EQ(lodFactor, doctest::Approx(optimum).epsilon(0.05));
+
+  // Once converged, the LOD factor stays constant instead of oscillating. It is hardly ever
+  // changed, as each change invalidates the coherence data of the LODVisitor.
+  double minLodFactor = lodFactor;
+  double maxLodFactor = lodFactor;
+  int    changes      = 0;
+
+  for (int frame = 300; frame < 600; ++frame) {
+    double const last = lodFactor;
+    lodFactor         = controller.update(
+        renderer.frameTime(frame, lodFactor), renderer.triangles(lodFactor), lodFactor);
+    minLodFactor = std::min(minLodFactor, lodFactor);
+    maxLodFactor = std::max(maxLodFactor, lodFactor);
+    changes += lodFactor != last ? 1 : 0;
+  }
+
+  CHECK_LT(maxLodFactor - minLodFactor, 0.05 * optimum);
+  CHECK_EQ(changes, 0);
+
+  // If the scene becomes more expensive, the LOD factor is reduced. Small steps are held back
+  // while converging as well.
+  renderer.mTriangles *= 2.0;
+  changes = 0;
+
+  for (int frame = 600; frame < 900; ++frame) {
+    double const last = lodFactor;
+    lodFactor         = controller.update(
+        renderer.frameTime(frame, lodFactor), renderer.triangles(lodFactor), lodFactor);
+    changes += lodFactor != last ? 1 : 0;
+  }
+
+  CHECK_EQ(lodFactor, doctest::Approx(optimum / std::sqrt(2.0)).epsilon(0.05));
+  CHECK_LE(changes, 12);
+  CHECK_GT(controller.getTriangleCost(), 0.0);
+  CHECK_LE(controller.getTriangleCost(), renderer.mTriangleCost * 2.0);
+
+  // The LOD factor stays in the given range.
+  controller.setTargetTime(1000.0);
+
+  for (int frame = 900; frame < 1200; ++frame) {
+    lodFactor = controller.update(
+        renderer.frameTime(frame, lodFactor), renderer.triangles(lodFactor), lodFactor);
+  }
+
+  CHECK_EQ(lodFactor, 100.0);
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,52 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/MPSCQueue.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <thread>
+
+namespace csp::lodbodies {
+TEST_CASE("csp::lodbodies::MPSCQueue") {
+  int const numThreads = 4;
+  int const perThread  = 10000;
+
+  MPSCQueue<int>   queue;
+  std::vector<int> drained;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&queue, t]() {
+      for (int i = 0; i < perThread; ++i) {
+        queue.push(t * perThread + i);
+      }
+    });
+  }
+
+  // Drain concurrently to the producers, like merge() does.
+  while (drained.size() < static_cast<std::size_t>(numThreads * perThread)) {
+    queue.drain(drained);
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(queue.empty());
+
+  // Items of each producer arrive in the order they were pushed.
+  std::vector<int> last(numThreads, -1);
+  for (int value : drained) {
+    int t = value / perThread;
+    CHECK_GT(value, last[t]);
+    last[t] = value;
+  }
+
+  for (int t = 0; t < numThreads; ++t) {
+    CHECK_EQ(last[t], (t + 1) * perThread - 1);
+  }
+}
+} // namespace csp::lodbodies
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/MipChain.hpp"
+#include "../src/Tile.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::MipChain") {
+  // 257 x 257 samples go down to a single sample in eight levels, as OpenGL expects.
+  CHECK_EQ(MipChain::getLevelCount(), 9);
+  CHECK_EQ(MipChain::getSizeX(1), 128);
+  CHECK_EQ(MipChain::getSizeY(7), 2);
+  CHECK_EQ(MipChain::getSizeX(8), 1);
+  CHECK_EQ(MipChain::getOffset(TileDataType::eU8Vec3, 2), 128 * 128 * 3);
+  CHECK_EQ(MipChain::getBytes(TileDataType::eFloat32),
+      MipChain::getOffset(TileDataType::eFloat32, 8) + sizeof(float));
+
+  // A constant tile stays constant.
+  auto color = std::make_unique<Tile<glm::u8vec3>>(0, 0);
+  color->data().fill(glm::u8vec3(10, 200, 255));
+
+  MipChain const colorChain(*color);
+  auto const*    colors = static_cast<std::uint8_t const*>(colorChain.getData());
+
+  for (std::size_t i = 0; i < MipChain::getBytes(TileDataType::eU8Vec3); i += 3) {
+    REQUIRE_EQ(colors[i], 10);
+    REQUIRE_EQ(colors[i + 1], 200);
+    REQUIRE_EQ(colors[i + 2], 255);
+  }
+
+  // The samples of a level are centered on the area they cover, so a ramp in x is reproduced up
+  // to the error of treating each sample as constant over its area. The last level is the average.
+  auto ramp = std::make_unique<Tile<float>>(0, 0);
+
+  for (int y = 0; y < TileBase::SizeY; ++y) {
+    for (int x = 0; x < TileBase::SizeX; ++x) {
+      ramp->data()[y * TileBase::SizeX + x] = static_cast<float>(x);
+    }
+  }
+
+  MipChain const rampChain(*ramp);
+  auto const*    values = static_cast<float const*>(rampChain.getData());
+
+  for (int level = 1; level < MipChain::getLevelCount(); ++level) {
+    float const* samples = values + MipChain::getOffset(TileDataType::eFloat32, level) / 4;
+    double const ratio   = static_cast<double>(TileBase::SizeX) / MipChain::getSizeX(level);
+
+    for (int x = 0; x < MipChain::getSizeX(level); ++x) {
+      double const expected = (x + 0.5) * ratio - 0.5;
+      REQUIRE(std::abs(samples[x] - expected) < 0.01);
+    }
+  }
+
+  std::size_t const last = MipChain::getOffset(TileDataType::eFloat32, 8) / 4;
+  CHECK_LT(std::abs(values[last] - 128.F), 1e-3);
+}
+
+TEST_CASE("csp::lodbodies::TileBase::buildMipChain") {
+  // A tile shared by several trees is given its levels by all of their loader threads, but they
+  // must be built only once and never be replaced.
+  auto tile = std::make_unique<Tile<float>>(0, 0);
+  tile->data().fill(1.F);
+  CHECK_EQ(tile->getMipChain(), nullptr);
+
+  std::vector<MipChain const*> chains(8, nullptr);
+  std::vector<std::thread>     threads;
+
+  for (std::size_t i = 0; i < chains.size(); ++i) {
+    threads.emplace_back([&tile, &chains, i]() {
+      tile->buildMipChain();
+      chains[i] = tile->getMipChain();
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  REQUIRE_NE(chains[0], nullptr);
+
+  for (auto const* chain : chains) {
+    CHECK_EQ(chain, chains[0]);
+  }
+
+  tile->buildMipChain();
+  CHECK_EQ(tile->getMipChain(), chains[0]);
+}
+
+} // namespace csp::lodbodies
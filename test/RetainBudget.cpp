@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/RetainBudget.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+#include "TestTiles.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::RetainBudget") {
+  // The sources only identify the trees, they are never dereferenced.
+  std::array<int, 4> datasets{};
+  auto const         source = [&datasets](std::size_t i) {
+    return reinterpret_cast<TileSource const*>(&datasets.at(i)); // NOLINT
+  };
+
+  // The owners are only compared as well.
+  int const owner1 = 1;
+  int const owner2 = 2;
+
+  std::vector<std::unique_ptr<EmptyTile>> tiles;
+
+  for (int i = 0; i < 5; ++i) {
+    tiles.push_back(std::make_unique<EmptyTile>(TileId(1, i)));
+  }
+
+  std::size_t const tileBytes = TileBase::SizeX * TileBase::SizeY * sizeof(float);
+
+  RetainBudget             budget;
+  std::vector<std::string> dropped;
+
+  // Records the dropped tree and releases it, as TreeManagerBase::dropRetainedTree does.
+  auto const drop = [&](void const* owner, std::size_t dataset, std::string name) {
+    return [&budget, &dropped, &source, owner, dataset, name]() {
+      dropped.push_back(name);
+      budget.remove(owner, source(dataset));
+    };
+  };
+
+  budget.setMaxBytes(3 * tileBytes);
+
+  // Tiles shared by the trees of two bodies are counted once.
+  budget.add(&owner1, source(0), {tiles[0].get(), tiles[1].get()}, drop(&owner1, 0, "1:0"));
+  budget.add(&owner2, source(0), {tiles[1].get(), tiles[2].get()}, drop(&owner2, 0, "2:0"));
+  CHECK_EQ(budget.getUsedBytes(), 3 * tileBytes);
+  CHECK(dropped.empty());
+
+  // The limit is shared by all owners, the least recently retained tree is dropped first, even if
+  // it belongs to another owner.
+  budget.add(&owner2, source(1), {tiles[3].get()}, drop(&owner2, 1, "2:1"));
+  CHECK(dropped == std::vector<std::string>{"1:0"});
+  CHECK_EQ(budget.getTreeCount(), 2);
+  CHECK_EQ(budget.getUsedBytes(), 3 * tileBytes);
+
+  // A restored tree is unregistered without being dropped.
+  budget.remove(&owner2, source(0));
+  CHECK_EQ(budget.getUsedBytes(), tileBytes);
+
+  // A tree which exceeds the limit on its own is dropped right away, after all older ones.
+  budget.setMaxBytes(tileBytes);
+  budget.add(&owner1, source(2), {tiles[0].get(), tiles[4].get()}, drop(&owner1, 2, "1:2"));
+  CHECK((dropped == std::vector<std::string>{"1:0", "2:1", "1:2"}));
+  CHECK_EQ(budget.getTreeCount(), 0);
+  CHECK_EQ(budget.getUsedBytes(), 0);
+
+  // Lowering the limit drops trees as well. The trees of a destroyed owner are removed without
+  // being dropped.
+  budget.setMaxBytes(4 * tileBytes);
+  budget.add(&owner1, source(0), {tiles[0].get()}, drop(&owner1, 0, "1:0"));
+  budget.add(&owner2, source(3), {tiles[1].get()}, drop(&owner2, 3, "2:3"));
+  budget.add(&owner1, source(1), {tiles[2].get()}, drop(&owner1, 1, "1:1"));
+  budget.setMaxBytes(2 * tileBytes);
+  CHECK_EQ(dropped.back(), "1:0");
+  CHECK_EQ(budget.getTreeCount(), 2);
+
+  budget.removeAll(&owner1);
+  CHECK_EQ(budget.getTreeCount(), 1);
+  CHECK_EQ(budget.getUsedBytes(), tileBytes);
+  CHECK_EQ(dropped.size(), 4);
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/SharedTileSource.hpp"
+#include "../src/PlanetParameters.hpp"
+#include "../src/RenderDataDEM.hpp"
+#include "../src/TileNode.hpp"
+#include "../src/TreeManagerBase.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+#include "TestTiles.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// A source which only records the asynchronous requests, the test decides when they are finished.
+class ManualTileSource : public TileSource {
+ public:
+  void init() override {
+    ++mInits;
+  }
+
+  void fini() override {
+    ++mFinis;
+  }
+
+  TileDataType getDataType() const override {
+    return TileDataType::eFloat32;
+  }
+
+  TileNode* loadTile(int level, glm::int64 patchIdx) override {
+    return new TileNode(std::make_shared<EmptyTile>(TileId(level, patchIdx)));
+  }
+
+  void loadTileAsync(int level, glm::int64 patchIdx, OnLoadCallback cb) override {
+    mRequests.emplace_back(TileId(level, patchIdx), std::move(cb));
+  }
+
+  int getPendingRequests() override {
+    return static_cast<int>(mRequests.size());
+  }
+
+  bool isSame(TileSource const* other) const override {
+    return other == this;
+  }
+
+  // Finishes the oldest request and returns the tile passed to its callback.
+  std::weak_ptr<TileBase> finish() {
+    auto [tileId, cb] = std::move(mRequests.front());
+    mRequests.erase(mRequests.begin());
+
+    auto* node = new TileNode(std::make_shared<EmptyTile>(tileId));
+    std::weak_ptr<TileBase> tile(node->getSharedTile());
+    cb(this, tileId.level(), tileId.patchIdx(), node);
+
+    return tile;
+  }
+
+  std::vector<std::pair<TileId, OnLoadCallback>> mRequests;
+  int                                            mInits = 0;
+  int                                            mFinis = 0;
+};
+
+// A tree manager which only requests tiles, it neither merges them nor uses OpenGL.
+class RequestingTreeManager : public TreeManagerBase {
+ public:
+  explicit RequestingTreeManager(PlanetParameters const& params)
+      : TreeManagerBase(params, nullptr) {
+  }
+
+ protected:
+  RenderData* allocateRenderData(TileNode* node) override {
+    return new RenderDataDEM(node);
+  }
+
+  void releaseRenderData(RenderData* rdata) override {
+    delete rdata;
+  }
+};
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::SharedTileSource shares loads") {
+  auto             manual = std::make_shared<ManualTileSource>();
+  SharedTileSource shared(manual);
+
+  // The wrapped source is initialized by the first consumer and shut down by the last one.
+  shared.init();
+  shared.init();
+  CHECK_EQ(manual->mInits, 1);
+  shared.fini();
+  CHECK_EQ(manual->mFinis, 0);
+  shared.fini();
+  shared.fini();
+  CHECK_EQ(manual->mFinis, 1);
+
+  // Two consumers requesting the same tile share a single load.
+  std::vector<std::unique_ptr<TileNode>> nodes;
+  auto const consumer = [&nodes](TileSource* /*source*/, int /*level*/, glm::int64 /*patchIdx*/,
+                            TileNode* node) { nodes.emplace_back(node); };
+
+  shared.loadTileAsync(2, 17, consumer);
+  shared.loadTileAsync(2, 17, consumer);
+  REQUIRE_EQ(manual->mRequests.size(), 1);
+
+  std::weak_ptr<TileBase> tile = manual->finish();
+  REQUIRE_EQ(nodes.size(), 2);
+  CHECK_NE(nodes[0].get(), nodes[1].get());
+  CHECK_EQ(nodes[0]->getTile(), tile.lock().get());
+  CHECK_EQ(nodes[1]->getTile(), tile.lock().get());
+
+  // While a consumer uses the tile, it is not loaded again.
+  shared.loadTileAsync(2, 17, consumer);
+  CHECK(manual->mRequests.empty());
+  REQUIRE_EQ(nodes.size(), 3);
+  CHECK_EQ(nodes[2]->getTile(), tile.lock().get());
+
+  // Tiles which are not used anymore are not kept.
+  nodes.clear();
+  CHECK(tile.expired());
+  shared.loadTileAsync(2, 17, consumer);
+  CHECK_EQ(manual->mRequests.size(), 1);
+}
+
+TEST_CASE("csp::lodbodies::SharedTileSource cancelled consumers") {
+  PlanetParameters params;
+  auto             manual = std::make_shared<ManualTileSource>();
+  SharedTileSource shared(manual);
+
+  auto first  = std::make_unique<RequestingTreeManager>(params);
+  auto second = std::make_unique<RequestingTreeManager>(params);
+  first->setSource(&shared);
+  second->setSource(&shared);
+
+  first->request({TileId(1, 3)});
+  second->request({TileId(1, 3)});
+  REQUIRE_EQ(manual->mRequests.size(), 1);
+
+  // The first consumer is destroyed while its tile is being loaded. Its node is deleted instead of
+  // being passed to it, the node of the second consumer is queued for its next merge.
+  first.reset();
+  std::weak_ptr<TileBase> tile = manual->finish();
+  CHECK_FALSE(tile.expired());
+
+  second.reset();
+  CHECK(tile.expired());
+
+  // Without retained trees, the requests of a previous source are cancelled as well.
+  RequestingTreeManager third(params);
+  third.setSource(&shared);
+  third.request({TileId(1, 4)});
+  third.setSource(nullptr);
+
+  CHECK(manual->finish().expired());
+}
+
+} // namespace csp::lodbodies
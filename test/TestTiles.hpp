@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_LOD_BODIES_TEST_TESTTILES_HPP
+#define CSP_LOD_BODIES_TEST_TESTTILES_HPP
+
+#include "../src/RenderDataDEM.hpp"
+#include "../src/TileBase.hpp"
+#include "../src/TileId.hpp"
+#include "../src/TileNode.hpp"
+
+#include <memory>
+#include <typeinfo>
+
+namespace csp::lodbodies {
+
+/// A tile without any samples, only its id is used. The tests use it for trees and queues which
+/// are too large to allocate the data of all tiles.
+class EmptyTile : public TileBase {
+ public:
+  explicit EmptyTile(TileId const& tileId)
+      : TileBase(tileId.level(), tileId.patchIdx()) {
+  }
+
+  std::type_info const& getTypeId() const override {
+    return typeid(float);
+  }
+
+  TileDataType getDataType() const override {
+    return TileDataType::eFloat32;
+  }
+
+  void const* getDataPtr() const override {
+    return nullptr;
+  }
+};
+
+/// A node with an EmptyTile and its RenderData, used last in the given frame. The tests queue these
+/// for upload without a TreeManager.
+struct QueuedNode {
+  explicit QueuedNode(TileId const& tileId, int lastFrame = 0)
+      : mNode(std::make_shared<EmptyTile>(tileId))
+      , mRdata(&mNode) {
+    mRdata.setLastFrame(lastFrame);
+  }
+
+  TileNode      mNode;
+  RenderDataDEM mRdata;
+};
+
+} // namespace csp::lodbodies
+
+#endif // CSP_LOD_BODIES_TEST_TESTTILES_HPP
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TexturePagePool.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::TexturePagePool") {
+  TexturePagePool pool(4);
+
+  // The first page is added once a layer is needed.
+  CHECK_EQ(pool.allocate().mPage, -1);
+  CHECK_EQ(pool.getGrowth(), 4);
+  CHECK_EQ(pool.grow(), 0);
+  CHECK_EQ(pool.getGrowth(), 0);
+  CHECK_EQ(pool.getPageLayerCount(0), 4);
+
+  std::vector<TexturePagePool::Handle> handles;
+
+  for (int i = 0; i < 4; ++i) {
+    handles.push_back(pool.allocate());
+    CHECK_EQ(handles.back().mPage, 0);
+    CHECK_EQ(handles.back().mLayer, i);
+  }
+
+  CHECK_EQ(pool.allocate().mPage, -1);
+  CHECK_EQ(pool.getUsedLayerCount(), 4U);
+
+  // Raising the maximum adds a page for the missing layers, the existing ones stay where they are.
+  pool.setMaxLayerCount(6);
+  CHECK_EQ(pool.getGrowth(), 2);
+  CHECK_EQ(pool.grow(), 1);
+  CHECK_EQ(pool.getPageLayerCount(1), 2);
+  CHECK_EQ(pool.getTotalLayerCount(), 6U);
+
+  handles.push_back(pool.allocate());
+  CHECK_EQ(handles.back().mPage, 1);
+  CHECK_EQ(handles.back().mLayer, 0);
+  CHECK_EQ(pool.getFreeLayerCount(), 1U);
+
+  // Lowering the maximum retires the page with the fewest tiles. Its tiles stay valid, but no
+  // layers are handed out from it and it is removed once it is empty.
+  pool.setMaxLayerCount(4);
+  CHECK(pool.isRetired(1));
+  CHECK_FALSE(pool.isRetired(0));
+  CHECK_EQ(pool.getFreeLayerCount(), 0U);
+  CHECK_EQ(pool.getGrowth(), 0);
+  CHECK(pool.collectEmptyPages().empty());
+
+  pool.free(handles.back());
+  handles.pop_back();
+  std::vector<int> const empty = pool.collectEmptyPages();
+  CHECK_EQ(empty.size(), 1U);
+  CHECK_EQ(empty.at(0), 1);
+  CHECK_EQ(pool.getPageLayerCount(1), 0);
+  CHECK_EQ(pool.getTotalLayerCount(), 4U);
+
+  // Freed layers are reused.
+  pool.free(handles.at(2));
+  TexturePagePool::Handle const reused = pool.allocate();
+  CHECK_EQ(reused.mPage, 0);
+  CHECK_EQ(reused.mLayer, 2);
+}
+
+TEST_CASE("csp::lodbodies::TexturePagePool reactivation") {
+  TexturePagePool pool(2);
+  CHECK_EQ(pool.grow(), 0);
+  pool.setMaxLayerCount(5);
+  CHECK_EQ(pool.grow(), 1);
+
+  TexturePagePool::Handle const first = pool.allocate();
+  CHECK_EQ(first.mPage, 0);
+
+  // Shrinking below the size of both pages retires both, a new page fills the gap.
+  pool.setMaxLayerCount(1);
+  CHECK(pool.isRetired(0));
+  CHECK(pool.isRetired(1));
+  std::vector<int> const empty = pool.collectEmptyPages();
+  CHECK_EQ(empty.size(), 1U);
+  CHECK_EQ(empty.at(0), 1);
+  CHECK_EQ(pool.getGrowth(), 1);
+
+  // Growing again reactivates the retired page holding tiles instead of adding a new one.
+  pool.setMaxLayerCount(2);
+  CHECK_FALSE(pool.isRetired(0));
+  CHECK_EQ(pool.getGrowth(), 0);
+
+  // Once all page slots are used, the pool can not add pages anymore.
+  for (int i = 1; i < TexturePagePool::sMaxPages; ++i) {
+    pool.setMaxLayerCount(2 + i);
+    CHECK_EQ(pool.grow(), i);
+    CHECK_EQ(pool.getShortfall(), 0);
+  }
+
+  pool.setMaxLayerCount(100);
+  CHECK_EQ(pool.getGrowth(), 0);
+  CHECK_EQ(pool.grow(), -1);
+  CHECK_EQ(pool.getShortfall(), 95);
+
+  // Instead the smallest page is enlarged to reach the maximum. Its existing layer is kept, the
+  // new ones are handed out in order.
+  CHECK_EQ(pool.enlarge(), 1);
+  CHECK_EQ(pool.getPageLayerCount(1), 96);
+  CHECK_EQ(pool.getTotalLayerCount(), 100U);
+  CHECK_EQ(pool.getShortfall(), 0);
+  CHECK_EQ(pool.enlarge(), -1);
+
+  CHECK_EQ(pool.allocate().mPage, 0);
+  TexturePagePool::Handle const added = pool.allocate();
+  CHECK_EQ(added.mPage, 1);
+  CHECK_EQ(added.mLayer, 1);
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileBounds.hpp"
+#include "../src/HEALPix.hpp"
+#include "../src/MinMaxPyramid.hpp"
+#include "../src/Tile.hpp"
+#include "../../../src/cs-utils/convert.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <random>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::TileBounds oriented") {
+  std::mt19937                           rng(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  double const radiusE   = 6378137.0;
+  double const radiusP   = 6356752.0;
+  double const minHeight = -10000.0;
+  double const maxHeight = 8000.0;
+
+  for (int level = 0; level < 12; ++level) {
+    HEALPixLevel const& hp = HEALPix::getLevel(level);
+
+    for (int i = 0; i < 50; ++i) {
+      auto const patchIdx =
+          static_cast<glm::int64>(unit(rng) * static_cast<double>(hp.getTotalPatchCount()));
+
+      OrientedTileBounds const bounds = calcOrientedTileBounds(
+          minHeight, maxHeight, 0.0, level, patchIdx, radiusE, radiusP, 1.0);
+      BoundingBox<double> const box =
+          calcTileBounds(minHeight, maxHeight, level, patchIdx, radiusE, radiusP, 1.0);
+
+      // Random points of the tile are inside the box and their normals are inside the normal cone.
+      glm::i64vec3 const bxy   = hp.getBaseXY(patchIdx);
+      auto const         nSide = static_cast<double>(hp.getNSide());
+
+      for (int j = 0; j < 100; ++j) {
+        glm::dvec2 const lngLat = HEALPix::convertBaseXY2LngLat(static_cast<int>(bxy[0]),
+            (static_cast<double>(bxy[1]) + unit(rng)) / nSide,
+            (static_cast<double>(bxy[2]) + unit(rng)) / nSide);
+        double const     height = minHeight + unit(rng) * (maxHeight - minHeight);
+        glm::dvec3 const point =
+            cs::utils::convert::toCartesian(lngLat, radiusE, radiusP, height) - bounds.mCenter;
+
+        for (auto const& axis : bounds.mHalfAxes) {
+          CHECK_LE(std::abs(glm::dot(point, axis)), glm::dot(axis, axis) * (1.0 + 1e-9));
+        }
+
+        if (bounds.mConeCos > 0.0) {
+          glm::dvec3 const normal = cs::utils::convert::lngLatToNormal(lngLat, radiusE, radiusP);
+          CHECK_GE(glm::dot(normal, bounds.mConeAxis), bounds.mConeCos - 1e-9);
+        }
+      }
+
+      // Except for the large tiles of the first levels, the oriented box is much tighter than the
+      // axis aligned box.
+      if (level >= 3) {
+        glm::dvec3 const extent = box.getMax() - box.getMin();
+        double const     volume = 8.0 * glm::length(bounds.mHalfAxes[0]) *
+                              glm::length(bounds.mHalfAxes[1]) * glm::length(bounds.mHalfAxes[2]);
+        CHECK_LT(volume, extent.x * extent.y * extent.z);
+      }
+    }
+  }
+}
+
+TEST_CASE("csp::lodbodies::TileBounds geometric error") {
+  // Linear data is represented exactly by every second sample.
+  Tile<float> tile(3, 0);
+
+  for (int y = 0; y < TileBase::SizeY; ++y) {
+    for (int x = 0; x < TileBase::SizeX; ++x) {
+      tile.data()[y * TileBase::SizeX + x] = 2.F * static_cast<float>(x) - static_cast<float>(y);
+    }
+  }
+
+  CHECK_EQ(MinMaxPyramid(&tile).getGeometricError(), 0.F);
+
+  // A single peak between the samples of the parent's grid is missed completely.
+  tile.data()[11 * TileBase::SizeX + 11] += 100.F;
+  CHECK_EQ(MinMaxPyramid(&tile).getGeometricError(), doctest::Approx(100.F));
+
+  // The error of the curved surface decreases by a factor of four with each level and is small
+  // compared to the radius, the data error is scaled with the height scale.
+  double const radius = 6378137.0;
+
+  for (int level = 0; level < 15; ++level) {
+    double const curvature = calcGeometricError(0.0, level, radius, radius, 1.0);
+    CHECK_GT(curvature, 0.0);
+    CHECK_LT(curvature, 1e-4 * radius);
+    CHECK_EQ(calcGeometricError(0.0, level + 1, radius, radius, 1.0),
+        doctest::Approx(0.25 * curvature).epsilon(0.01));
+    CHECK_EQ(calcGeometricError(10.0, level, radius, radius, 3.0),
+        doctest::Approx(30.0 + curvature));
+  }
+}
+
+TEST_CASE("csp::lodbodies::TileBounds occluders") {
+  std::mt19937                           rng(42);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  double const radiusE = 6378137.0;
+  double const radiusP = 6356752.0;
+
+  std::array<float, OccluderCellsPerEdge * OccluderCellsPerEdge> minHeights{};
+
+  for (auto& height : minHeights) {
+    height = static_cast<float>(-1000.0 + 2000.0 * unit(rng));
+  }
+
+  for (int level = 2; level < 12; ++level) {
+    HEALPixLevel const& hp       = HEALPix::getLevel(level);
+    auto const          patchIdx = static_cast<glm::int64>(
+        unit(rng) * static_cast<double>(hp.getTotalPatchCount()));
+    glm::i64vec3 const bxy       = hp.getBaseXY(patchIdx);
+    auto const         nSide     = static_cast<double>(hp.getNSide());
+
+    TileOccluders const occluders =
+        calcTileOccluders(minHeights, level, patchIdx, radiusE, radiusP, 2.0);
+
+    // Points of each cell at its minimum height are inside its radius.
+    for (int y = 0; y < OccluderCellsPerEdge; ++y) {
+      for (int x = 0; x < OccluderCellsPerEdge; ++x) {
+        OccluderCell const& cell   = occluders.at(y * OccluderCellsPerEdge + x);
+        double const        height = 2.0 * minHeights.at(y * OccluderCellsPerEdge + x);
+
+        for (int j = 0; j < 20; ++j) {
+          double const     u      = (x + 0.9 * unit(rng)) / OccluderCellsPerEdge;
+          double const     v      = (y + 0.9 * unit(rng)) / OccluderCellsPerEdge;
+          glm::dvec2 const lngLat = HEALPix::convertBaseXY2LngLat(static_cast<int>(bxy[0]),
+              (static_cast<double>(bxy[1]) + u) / nSide, (static_cast<double>(bxy[2]) + v) / nSide);
+          glm::dvec3 const point =
+              cs::utils::convert::toCartesian(lngLat, radiusE, radiusP, height);
+
+          CHECK_LE(glm::length(point - cell.mCenter), cell.mRadius);
+        }
+      }
+    }
+  }
+
+  // The occluders of a tile use the level of its MinMaxPyramid with one entry per cell.
+  Tile<float> tile(5, 42);
+  auto        pyramid = std::make_unique<MinMaxPyramid>();
+
+  for (auto& level : pyramid->getMinPyramid()) {
+    if (level.size() == minHeights.size()) {
+      std::copy(minHeights.begin(), minHeights.end(), level.begin());
+    }
+  }
+
+  tile.setMinMaxPyramid(std::move(pyramid));
+
+  TileOccluders const expected = calcTileOccluders(minHeights, 5, 42, radiusE, radiusP, 2.0);
+  TileOccluders const actual   = calcTileOccluders(tile, radiusE, radiusP, 2.0);
+
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    CHECK_EQ(actual.at(i).mCenter, expected.at(i).mCenter);
+    CHECK_EQ(actual.at(i).mRadius, expected.at(i).mRadius);
+  }
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,286 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileDrawList.hpp"
+#include "../src/HEALPix.hpp"
+#include "../src/PlanetParameters.hpp"
+#include "../src/RenderDataDEM.hpp"
+#include "../src/RenderDataImg.hpp"
+#include "../../../src/cs-utils/convert.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// The nodes and render data of a list of tiles, all tiles are on the GPU. The elevation tiles
+// have samples of the given height, as the TileDrawList needs their MinMaxPyramid.
+class Tiles {
+ public:
+  void add(TileId const& idDEM, int levelIMG = -1, float height = 0.F) {
+    auto tile = std::make_shared<Tile<float>>(idDEM.level(), idDEM.patchIdx());
+    tile->data().fill(height);
+    tile->setMinMaxPyramid(std::make_unique<MinMaxPyramid>(tile.get()));
+
+    auto& node = mNodes.emplace_back(std::make_unique<TileNode>(tile));
+    auto& dem  = mDEM.emplace_back(std::make_unique<RenderDataDEM>(node.get()));
+    dem->setTexPage(1);
+    dem->setTexLayer(static_cast<int>(mDEM.size()));
+    mReqDEM.push_back(dem.get());
+
+    if (levelIMG >= 0) {
+      // the image tile at levelIMG which covers the south corner of the elevation tile
+      TileId idIMG = idDEM;
+
+      while (idIMG.level() < levelIMG) {
+        idIMG = HEALPix::getChildTileId(idIMG, 0);
+      }
+
+      while (idIMG.level() > levelIMG) {
+        idIMG = HEALPix::getParentTileId(idIMG);
+      }
+
+      auto  imgTile = std::make_shared<Tile<float>>(idIMG.level(), idIMG.patchIdx());
+      auto& imgNode = mNodes.emplace_back(std::make_unique<TileNode>(imgTile));
+      auto& img = mIMG.emplace_back(std::make_unique<RenderDataImg>(imgNode.get()));
+      img->setTexPage(2);
+      img->setTexLayer(static_cast<int>(mIMG.size()));
+      mReqIMG.push_back(img.get());
+    }
+  }
+
+  std::vector<std::unique_ptr<TileNode>>      mNodes;
+  std::vector<std::unique_ptr<RenderDataDEM>> mDEM;
+  std::vector<std::unique_ptr<RenderDataImg>> mIMG;
+  std::vector<RenderData*>                    mReqDEM;
+  std::vector<RenderData*>                    mReqIMG;
+};
+
+float toFloat(int bits) {
+  float value{};
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileDrawList packing") {
+  PlanetParameters params;
+  params.mEquatorialRadius = 2.0;
+  params.mPolarRadius      = 1.5;
+  params.mHeightScale      = 3.0;
+
+  TileId const id(2, 37);
+  Tiles        tiles;
+  tiles.add(id, -1, 0.25F);
+
+  glm::dmat4 matVM(1.0);
+  matVM[3] = glm::dvec4(1.0, 2.0, 3.0, 1.0);
+
+  TileDrawList list;
+  list.build(tiles.mReqDEM, tiles.mReqIMG, matVM, params);
+
+  REQUIRE_EQ(list.getInstances().size(), 1);
+  REQUIRE_EQ(list.getBatches().size(), 1);
+  CHECK_EQ(list.getBatches()[0].mIndexCount, 256 * 256 * 6);
+  CHECK_EQ(list.getBatches()[0].mCount, 1);
+
+  auto const& instance = list.getInstances()[0];
+  auto const  baseXY   = HEALPix::getBaseXY(id);
+
+  CHECK_EQ(instance.mTileOffsetScale.x, baseXY.y);
+  CHECK_EQ(instance.mTileOffsetScale.y, baseXY.z);
+  CHECK_EQ(instance.mTileOffsetScale.z, HEALPix::getNSide(id));
+  CHECK_EQ(instance.mTileOffsetScale.w, 1);
+  CHECK_EQ(instance.mDemOffsetScale.z, 256);
+  CHECK_EQ(instance.mDemOffsetScale.w, 1);
+  CHECK_EQ(instance.mImgOffsetScale.z, 256);
+  CHECK_EQ(instance.mF1F2.x, HEALPix::getF1(id));
+  CHECK_EQ(instance.mF1F2.y, HEALPix::getF2(id));
+  CHECK_EQ(instance.mF1F2.z, -1);
+
+  float const average = tiles.mNodes[0]->getTile()->getMinMaxPyramid()->getAverage();
+  CHECK_EQ(toFloat(instance.mF1F2.w), average);
+
+  // the corners are lifted to the average height and translated to view space
+  auto const cornersLngLat = HEALPix::getCornersLngLat(id);
+
+  for (std::size_t i = 0; i < 4; ++i) {
+    glm::dvec3 const expected =
+        cs::utils::convert::toCartesian(cornersLngLat.at(i), params.mEquatorialRadius,
+            params.mPolarRadius, average * params.mHeightScale) +
+        glm::dvec3(1.0, 2.0, 3.0);
+
+    CHECK_LT(std::abs(toFloat(instance.mCorners.at(i).x) - expected.x), 1e-5);
+    CHECK_LT(std::abs(toFloat(instance.mCorners.at(i).y) - expected.y), 1e-5);
+    CHECK_LT(std::abs(toFloat(instance.mCorners.at(i).z) - expected.z), 1e-5);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileDrawList batches") {
+  PlanetParameters params;
+
+  // image tiles at one and two levels below the elevation tiles are drawn with a quarter and a
+  // sixteenth of the indices
+  Tiles tiles;
+  tiles.add(TileId(1, 0), 3);
+  tiles.add(TileId(1, 1), 1);
+  tiles.add(TileId(1, 2), 2);
+  tiles.add(TileId(1, 3), 1);
+  tiles.add(TileId(2, 0), 1);
+
+  // a tile whose image data is not on the GPU is skipped
+  tiles.add(TileId(1, 4), 1);
+  tiles.mIMG.back()->setTexLayer(-1);
+
+  TileDrawList list;
+  list.build(tiles.mReqDEM, tiles.mReqIMG, glm::dmat4(1.0), params);
+
+  CHECK_EQ(list.getMissingDEM(), 0);
+  CHECK_EQ(list.getMissingIMG(), 1);
+  REQUIRE_EQ(list.getInstances().size(), 5);
+  REQUIRE_EQ(list.getBatches().size(), 3);
+
+  std::uint32_t const indices = 256 * 256 * 6;
+
+  // the coarser image tile of the last tile is drawn with all indices as well
+  CHECK_EQ(list.getBatches()[0].mIndexCount, indices);
+  CHECK_EQ(list.getBatches()[0].mFirst, 0);
+  CHECK_EQ(list.getBatches()[0].mCount, 3);
+  CHECK_EQ(list.getBatches()[1].mIndexCount, indices / 4);
+  CHECK_EQ(list.getBatches()[1].mFirst, 3);
+  CHECK_EQ(list.getBatches()[1].mCount, 1);
+  CHECK_EQ(list.getBatches()[2].mIndexCount, indices / 16);
+  CHECK_EQ(list.getBatches()[2].mFirst, 4);
+  CHECK_EQ(list.getBatches()[2].mCount, 1);
+
+  // only the drawn triangles are counted
+  CHECK_EQ(list.getNumTriangles(), (3 * indices + indices / 4 + indices / 16) / 3);
+
+  // within a batch the tiles keep their order
+  auto const& instances = list.getInstances();
+  CHECK_EQ(instances[0].mDemOffsetScale.w, 2);
+  CHECK_EQ(instances[1].mDemOffsetScale.w, 4);
+  CHECK_EQ(instances[2].mDemOffsetScale.w, 5);
+  CHECK_EQ(instances[3].mDemOffsetScale.w, 3);
+  CHECK_EQ(instances[4].mDemOffsetScale.w, 1);
+
+  // the elevation data of the finer image tiles is a sub quadrant of the elevation tile
+  CHECK_EQ(instances[3].mDemOffsetScale.z, 128);
+  CHECK_EQ(instances[3].mImgOffsetScale.z, 128);
+  CHECK_EQ(instances[4].mDemOffsetScale.z, 64);
+
+  // the elevation tile at level 2 is finer than its image tile
+  CHECK_EQ(instances[2].mImgOffsetScale.z, 512);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("csp::lodbodies::TileDrawList threads") {
+  PlanetParameters params;
+  Tiles            tiles;
+
+  for (int i = 0; i < 768; ++i) {
+    tiles.add(TileId(3, i), i % 4 + 2, static_cast<float>(i % 5));
+  }
+
+  glm::dmat4 matVM(1.0);
+  matVM[3] = glm::dvec4(1.0, 2.0, 3.0, 1.0);
+
+  TileDrawList serial;
+  serial.build(tiles.mReqDEM, tiles.mReqIMG, matVM, params);
+
+  // the corners are cached in the render data of the finer tile, which covers the drawn area
+  CHECK(tiles.mDEM[0]->getCorners().mTileId == tiles.mDEM[0]->getTileId());
+  CHECK(tiles.mIMG[2]->getCorners().mTileId == tiles.mIMG[2]->getTileId());
+  CHECK_FALSE(tiles.mDEM[2]->getCorners().mTileId == tiles.mDEM[2]->getTileId());
+
+  // changing the height scale invalidates the cached corners
+  params.mHeightScale = 2.0;
+
+  TileDrawList parallel;
+  parallel.setNumThreads(4);
+  CHECK_EQ(parallel.getNumThreads(), 4);
+  parallel.build(tiles.mReqDEM, tiles.mReqIMG, matVM, params);
+  serial.build(tiles.mReqDEM, tiles.mReqIMG, matVM, params);
+
+  REQUIRE_EQ(parallel.getInstances().size(), serial.getInstances().size());
+  REQUIRE_EQ(parallel.getBatches().size(), serial.getBatches().size());
+  CHECK_EQ(std::memcmp(parallel.getInstances().data(), serial.getInstances().data(),
+               serial.getInstances().size() * sizeof(TileDrawList::Instance)),
+      0);
+
+  for (std::size_t i = 0; i < serial.getBatches().size(); ++i) {
+    CHECK_EQ(parallel.getBatches()[i].mFirst, serial.getBatches()[i].mFirst);
+    CHECK_EQ(parallel.getBatches()[i].mCount, serial.getBatches()[i].mCount);
+  }
+
+  float const average = tiles.mNodes[2]->getTile()->getMinMaxPyramid()->getAverage();
+  CHECK_EQ(tiles.mDEM[1]->getCorners().mHeight, average * 2.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Measures the time needed for building the list with one to all available threads, with the
+// cached corners and with corners which are recomputed in every frame. The tiles are classified
+// in a serial pass, which limits the speedup. It is skipped by default, run it with
+// --test-case="*TileDrawList benchmark*" --no-skip.
+TEST_CASE("csp::lodbodies::TileDrawList benchmark" * doctest::skip()) {
+  // all 3072 tiles of level 4, a typical number of tiles for a camera close to the surface
+  PlanetParameters params;
+  Tiles            tiles;
+
+  for (int i = 0; i < 3072; ++i) {
+    tiles.add(TileId(4, i), i % 3 == 0 ? 5 : 4, 1.F);
+  }
+
+  int const numFrames  = 200;
+  int const maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+  for (bool staleCorners : {false, true}) {
+    double sequentialMillis = 0.0;
+
+    for (int numThreads = 1; numThreads <= maxThreads; ++numThreads) {
+      TileDrawList list;
+      list.setNumThreads(numThreads);
+      list.build(tiles.mReqDEM, tiles.mReqIMG, glm::dmat4(1.0), params);
+
+      auto start = std::chrono::high_resolution_clock::now();
+
+      for (int frame = 0; frame < numFrames; ++frame) {
+        // a changed height scale invalidates the corners of all tiles
+        if (staleCorners) {
+          params.mHeightScale = 1.0 + frame % 2;
+        }
+
+        list.build(tiles.mReqDEM, tiles.mReqIMG, glm::dmat4(1.0), params);
+      }
+
+      auto   end    = std::chrono::high_resolution_clock::now();
+      double millis = std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+
+      if (numThreads == 1) {
+        sequentialMillis = millis;
+      }
+
+      MESSAGE("stale corners " << staleCorners << ", " << numThreads << " threads: " << millis
+              << " ms per frame, speedup " << sequentialMillis / millis << ", "
+              << millis * 1e6 / static_cast<double>(tiles.mReqDEM.size()) << " ns per tile");
+    }
+  }
+}
+
+} // namespace csp::lodbodies
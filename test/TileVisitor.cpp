@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TileNode.hpp"
+#include "../src/TileVisitor.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+#include "TestTiles.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// Adds all children to node. Only the first numRefined of them get children themselves, until
+// maxLevel is reached.
+void addChildren(TileNode* node, int maxLevel, int (*numRefined)(int level)) {
+  if (node->getLevel() >= maxLevel) {
+    return;
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    TileId const childId = HEALPix::getChildTileId(node->getTileId(), i);
+    auto*        child   = new TileNode(std::make_shared<EmptyTile>(childId), maxLevel);
+    node->setChild(i, child);
+
+    if (i < numRefined(childId.level())) {
+      addChildren(child, maxLevel, numRefined);
+    }
+  }
+}
+
+// Records the order of the callbacks. Child (level % 4) of each node is skipped.
+class RecordingVisitor : public TileVisitor<RecordingVisitor> {
+ public:
+  explicit RecordingVisitor(TileQuadTree* tree)
+      : TileVisitor<RecordingVisitor>(tree) {
+  }
+
+  std::vector<std::pair<bool, TileId>> mEvents;
+
+ private:
+  bool preVisitRoot(TileId const& tileId) {
+    return preVisit(tileId);
+  }
+
+  void postVisitRoot(TileId const& tileId) {
+    postVisit(tileId);
+  }
+
+  bool preVisit(TileId const& tileId) {
+    CHECK_EQ(getNodeDEM()->getTileId(), tileId);
+    mEvents.emplace_back(true, tileId);
+    getState().mChildren.at(tileId.level() % 4) = false;
+    return true;
+  }
+
+  void postVisit(TileId const& tileId) {
+    CHECK_EQ(getTileId(), tileId);
+    mEvents.emplace_back(false, tileId);
+  }
+
+  void pushState() {
+    ++mStackTop;
+  }
+
+  void popState() {
+    --mStackTop;
+  }
+
+  StateBase& getState() {
+    return mStack.at(mStackTop);
+  }
+
+  StateBase const& getState() const {
+    return mStack.at(mStackTop);
+  }
+
+  std::array<StateBase, sMaxDepth> mStack;
+  int                              mStackTop = -1;
+
+  friend class TileVisitor<RecordingVisitor>;
+};
+
+// Produces the events of RecordingVisitor by recursion.
+void record(TileNode* node, std::vector<std::pair<bool, TileId>>& events) {
+  events.emplace_back(true, node->getTileId());
+
+  for (int i = 0; i < 4; ++i) {
+    if (i != node->getLevel() % 4 && node->getChild(i)) {
+      record(node->getChild(i), events);
+    }
+  }
+
+  events.emplace_back(false, node->getTileId());
+}
+
+// Visits all nodes and counts them, with the state handling of the default implementation.
+class CountingVisitor : public TileVisitor<CountingVisitor> {
+ public:
+  explicit CountingVisitor(TileQuadTree* tree)
+      : TileVisitor<CountingVisitor>(tree) {
+  }
+
+  std::size_t mNumNodes = 0;
+
+ private:
+  bool preVisitRoot(TileId const& /*tileId*/) {
+    ++mNumNodes;
+    return true;
+  }
+
+  bool preVisit(TileId const& /*tileId*/) {
+    ++mNumNodes;
+    return true;
+  }
+
+  friend class TileVisitor<CountingVisitor>;
+};
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::TileVisitor order") {
+  TileQuadTree tree;
+
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    auto* root = new TileNode(std::make_shared<EmptyTile>(TileId(0, i)), 6);
+    addChildren(root, 6, [](int level) { return level < 3 ? 4 : 2; });
+    tree.setRoot(i, root);
+  }
+
+  std::vector<std::pair<bool, TileId>> expected;
+
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    record(tree.getRoot(i), expected);
+  }
+
+  RecordingVisitor visitor(&tree);
+  visitor.visit();
+
+  CHECK(visitor.mEvents == expected);
+}
+
+TEST_CASE("csp::lodbodies::TileVisitor benchmark" * doctest::skip()) {
+  // A tree which is complete up to level 8 in two quadrants and then refines a single path per
+  // node down to level 18, similar to the trees of a camera close to the surface.
+  int const    maxLevel = 18;
+  TileQuadTree tree;
+
+  for (int i = 0; i < TileQuadTree::sNumRoots; ++i) {
+    auto* root = new TileNode(std::make_shared<EmptyTile>(TileId(0, i)), maxLevel);
+    addChildren(root, maxLevel, [](int level) { return level < 8 ? 2 : 1; });
+    tree.setRoot(i, root);
+  }
+
+  CountingVisitor visitor(&tree);
+  visitor.visit();
+
+  int const  frames = 200;
+  auto const start  = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < frames; ++i) {
+    visitor.visit();
+  }
+
+  std::chrono::duration<double, std::nano> const time = std::chrono::steady_clock::now() - start;
+
+  std::size_t const numNodes = visitor.mNumNodes / (frames + 1);
+  MESSAGE(numNodes << " nodes up to level " << maxLevel << ": "
+          << time.count() / frames / 1e6 << " ms per traversal, "
+          << time.count() / frames / static_cast<double>(numNodes) << " ns per node");
+}
+
+} // namespace csp::lodbodies
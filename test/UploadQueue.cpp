@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/UploadQueue.hpp"
+#include "../src/HEALPix.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+#include "TestTiles.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::UploadQueue") {
+  TileId const parent(3, 100);
+  TileId const other(3, 200);
+
+  // The children of parent have been used in frame 10, one child of other in frame 12. A tile of
+  // level 2 has been used in frame 12 as well, it is coarser than the rest and the most important.
+  std::vector<std::unique_ptr<QueuedNode>> nodes;
+
+  for (int i = 0; i < 4; ++i) {
+    nodes.push_back(std::make_unique<QueuedNode>(HEALPix::getChildTileId(parent, i), 10));
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    int const lastFrame = i == 2 ? 12 : 8;
+    nodes.push_back(std::make_unique<QueuedNode>(HEALPix::getChildTileId(other, i), lastFrame));
+  }
+
+  nodes.push_back(std::make_unique<QueuedNode>(TileId(2, 7), 12));
+
+  UploadQueue queue;
+
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    queue.push(&nodes[i]->mRdata, static_cast<int>(i));
+  }
+
+  CHECK_EQ(queue.size(), nodes.size());
+
+  // Removing a tile returns its upload, removing it again returns nothing.
+  UploadQueue::Upload const removed = queue.remove(&nodes[1]->mRdata);
+  CHECK_EQ(removed.mRdata, &nodes[1]->mRdata);
+  CHECK_EQ(removed.mSlot, 1);
+  CHECK_EQ(queue.remove(&nodes[1]->mRdata).mRdata, nullptr);
+  CHECK_EQ(queue.size(), nodes.size() - 1);
+
+  queue.prioritize();
+  CHECK_FALSE(queue.continuesGroup());
+
+  // The coarse tile comes first, it forms a group of its own.
+  UploadQueue::Upload const first = queue.pop();
+  CHECK_EQ(first.mRdata, &nodes[8]->mRdata);
+  CHECK_EQ(first.mSlot, 8);
+  CHECK_FALSE(queue.continuesGroup());
+
+  // The tiles which have to wait give up their staging slots.
+  std::vector<int> slots;
+  queue.takeSlots(slots);
+  std::sort(slots.begin(), slots.end());
+  CHECK((slots == std::vector<int>{0, 2, 3, 4, 5, 6, 7}));
+
+  // Then the children of other, which are as recent as their most recently used sibling.
+  for (int i = 0; i < 4; ++i) {
+    UploadQueue::Upload const upload = queue.pop();
+    CHECK_EQ(HEALPix::getParentTileId(upload.mRdata->getTileId()), other);
+    CHECK_EQ(upload.mSlot, -1);
+    CHECK_EQ(queue.continuesGroup(), i < 3);
+  }
+
+  // Finally the remaining children of parent.
+  for (int i = 0; i < 3; ++i) {
+    UploadQueue::Upload const upload = queue.pop();
+    CHECK_EQ(HEALPix::getParentTileId(upload.mRdata->getTileId()), parent);
+    CHECK_NE(upload.mRdata, &nodes[1]->mRdata);
+  }
+
+  CHECK(queue.empty());
+  CHECK_FALSE(queue.continuesGroup());
+}
+
+} // namespace csp::lodbodies
@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/UploadRing.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+#include <algorithm>
+#include <set>
+#include <thread>
+
+namespace csp::lodbodies {
+
+namespace {
+
+// Fences which are signaled once the test says so. Fence i is the i-th inserted fence.
+class FakeFenceApi : public UploadRing::FenceApi {
+ public:
+  explicit FakeFenceApi(int& signaled, int& alive)
+      : mSignaled(signaled)
+      , mAlive(alive) {
+  }
+
+  void* insertFence() override {
+    ++mAlive;
+    return reinterpret_cast<void*>(++mInserted); // NOLINT(*-int-to-ptr)
+  }
+
+  bool testFence(void* fence) override {
+    return reinterpret_cast<std::intptr_t>(fence) <= mSignaled;
+  }
+
+  void deleteFence(void* /*fence*/) override {
+    --mAlive;
+  }
+
+ private:
+  int&          mSignaled;
+  int&          mAlive;
+  std::intptr_t mInserted = 0;
+};
+
+} // namespace
+
+TEST_CASE("csp::lodbodies::UploadRing") {
+  int signaled = 0;
+  int alive    = 0;
+
+  std::vector<char> memory(4 * 16);
+
+  {
+    UploadRing ring(std::make_unique<FakeFenceApi>(signaled, alive), memory.data(), 16, 4);
+    CHECK_EQ(ring.getNumFree(), 4);
+
+    // The slots are handed out in order and cover the memory.
+    std::vector<int> slots;
+
+    for (int i = 0; i < 4; ++i) {
+      slots.push_back(ring.acquire());
+      CHECK_EQ(slots.back(), i);
+      CHECK_EQ(ring.getData(i), memory.data() + 16 * i);
+      CHECK_EQ(ring.getOffset(i), 16U * i);
+    }
+
+    // A full ring does not hand out slots until some are returned.
+    CHECK_EQ(ring.acquire(), -1);
+
+    ring.release(slots.back());
+    slots.pop_back();
+    CHECK_EQ(ring.getNumFree(), 1);
+    CHECK_EQ(ring.acquire(), 3);
+    ring.release(3);
+
+    // Submitted slots stay in use until their fence is signaled.
+    std::uint64_t const first  = ring.submit({slots.at(0)});
+    std::uint64_t const second = ring.submit({slots.at(1), slots.at(2)});
+    CHECK_LT(first, second);
+    CHECK_EQ(ring.getNumInFlight(), 2U);
+
+    ring.retire();
+    CHECK_FALSE(ring.isComplete(first));
+    CHECK_EQ(ring.getNumFree(), 1);
+
+    signaled = 1;
+    ring.retire();
+    CHECK(ring.isComplete(first));
+    CHECK_FALSE(ring.isComplete(second));
+    CHECK_EQ(ring.getNumFree(), 2);
+    CHECK_EQ(alive, 1);
+
+    // Batches retire in order of submission.
+    std::uint64_t const third = ring.submit({ring.acquire()});
+    signaled                  = 3;
+    ring.retire();
+    CHECK(ring.isComplete(second));
+    CHECK(ring.isComplete(third));
+    CHECK_EQ(ring.getNumFree(), 4);
+    CHECK_EQ(ring.getNumInFlight(), 0U);
+    CHECK_EQ(alive, 0);
+
+    // Fences of batches in flight are deleted with the ring.
+    ring.submit({ring.acquire()});
+    CHECK_EQ(alive, 1);
+  }
+
+  CHECK_EQ(alive, 0);
+}
+
+TEST_CASE("csp::lodbodies::UploadRing concurrent acquire") {
+  int signaled = 0;
+  int alive    = 0;
+
+  int const         numSlots = 64;
+  std::vector<char> memory(numSlots);
+  UploadRing ring(std::make_unique<FakeFenceApi>(signaled, alive), memory.data(), 1, numSlots);
+
+  // Loader threads compete for the slots, each slot is handed out exactly once.
+  std::vector<std::vector<int>> acquired(4);
+  std::vector<std::thread>      threads;
+
+  for (auto& slots : acquired) {
+    threads.emplace_back([&ring, &slots]() {
+      for (int slot = ring.acquire(); slot >= 0; slot = ring.acquire()) {
+        slots.push_back(slot);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::set<int> all;
+
+  for (auto const& slots : acquired) {
+    all.insert(slots.begin(), slots.end());
+  }
+
+  CHECK_EQ(all.size(), static_cast<std::size_t>(numSlots));
+  CHECK_EQ(ring.getNumFree(), 0);
+}
+
+} // namespace csp::lodbodies
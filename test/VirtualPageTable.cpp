@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/VirtualPageTable.hpp"
+#include "../../../src/cs-utils/doctest.hpp"
+
+namespace csp::lodbodies {
+
+TEST_CASE("csp::lodbodies::VirtualPageTable feedback") {
+  using Page = VirtualPageTable::Page;
+
+  std::vector<std::uint32_t> pixels(16, 0U);
+  pixels[1] = VirtualPageTable::encodeFeedback(Page{7, 1, 2});
+  pixels[2] = VirtualPageTable::encodeFeedback(Page{3, 0, 3});
+  pixels[5] = VirtualPageTable::encodeFeedback(Page{3, 0, 3});
+  pixels[9] = VirtualPageTable::encodeFeedback(Page{3, 0, 3});
+
+  std::vector<VirtualPageTable::Request> const requests =
+      VirtualPageTable::collectRequests(pixels.data(), pixels.size());
+
+  // each page once, the one seen most often first
+  REQUIRE_EQ(requests.size(), 2);
+  CHECK_EQ(requests[0].mPage.mTile, 3);
+  CHECK_EQ(requests[0].mPage.mX, 0);
+  CHECK_EQ(requests[0].mPage.mY, 3);
+  CHECK_EQ(requests[0].mCount, 3);
+  CHECK_EQ(requests[1].mPage.mTile, 7);
+  CHECK_EQ(requests[1].mPage.mX, 1);
+  CHECK_EQ(requests[1].mPage.mY, 2);
+  CHECK_EQ(requests[1].mCount, 1);
+}
+
+TEST_CASE("csp::lodbodies::VirtualPageTable") {
+  using Page = VirtualPageTable::Page;
+
+  // Tile 1 is the child of tile 0 covering its upper right quadrant.
+  VirtualPageTable table(3);
+  table.addTile(0);
+  table.addTile(1);
+  table.setParent(1, 0, 1, 1);
+
+  std::vector<int> dirty = table.takeDirtyTiles();
+  CHECK_EQ(dirty.size(), 2);
+  CHECK(table.takeDirtyTiles().empty());
+  CHECK_EQ(table.getEntry(Page{1, 3, 2}).mPhysical, -1);
+
+  // Requesting a page of tile 1 loads the page of tile 0 covering it first.
+  std::vector<VirtualPageTable::Upload> uploads = table.update({{Page{1, 3, 2}, 10}}, 1);
+  REQUIRE_EQ(uploads.size(), 1);
+  CHECK_EQ(uploads[0].mPage.mTile, 0);
+  CHECK_EQ(uploads[0].mPage.mX, 3);
+  CHECK_EQ(uploads[0].mPage.mY, 3);
+
+  // Until its own page is loaded, tile 1 samples the lower left quarter of that page.
+  VirtualPageTable::Entry entry = table.getEntry(Page{1, 3, 2});
+  CHECK_EQ(entry.mPhysical, uploads[0].mPhysical);
+  CHECK_EQ(entry.mScale, 0.5F);
+  CHECK_EQ(entry.mOffset[0], 32.F);
+  CHECK_EQ(entry.mOffset[1], 0.F);
+
+  dirty = table.takeDirtyTiles();
+  CHECK_EQ(dirty.size(), 2);
+
+  uploads = table.update({{Page{1, 3, 2}, 10}}, 4);
+  REQUIRE_EQ(uploads.size(), 1);
+  CHECK_EQ(uploads[0].mPage.mTile, 1);
+  entry = table.getEntry(Page{1, 3, 2});
+  CHECK_EQ(entry.mPhysical, uploads[0].mPhysical);
+  CHECK_EQ(entry.mScale, 1.F);
+
+  // Only one page is free, the pages requested in the same frame are not evicted for the others.
+  uploads = table.update({{Page{0, 0, 0}, 5}, {Page{0, 1, 0}, 4}, {Page{1, 3, 2}, 1}}, 4);
+  REQUIRE_EQ(uploads.size(), 1);
+  CHECK_EQ(uploads[0].mPage.mX, 0);
+
+  // In the next frame tile 1 is no longer needed, the least recently used page is evicted.
+  uploads = table.update({{Page{0, 1, 0}, 4}, {Page{0, 0, 0}, 1}}, 4);
+  REQUIRE_EQ(uploads.size(), 1);
+  CHECK_EQ(uploads[0].mPage.mX, 1);
+  CHECK_EQ(table.getEntry(Page{0, 3, 3}).mPhysical, -1);
+  CHECK_GE(table.getEntry(Page{0, 0, 0}).mPhysical, 0);
+  CHECK_EQ(table.getEntry(Page{1, 3, 2}).mScale, 1.F);
+
+  // Removing the parent leaves tile 1 without a fallback.
+  table.takeDirtyTiles();
+  table.removeTile(0);
+  dirty = table.takeDirtyTiles();
+  REQUIRE_EQ(dirty.size(), 1);
+  CHECK_EQ(dirty[0], 1);
+}
+
+} // namespace csp::lodbodies
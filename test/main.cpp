@@ -0,0 +1,9 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks are skipped by default, run them with --no-skip.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../../../src/cs-utils/doctest.hpp"